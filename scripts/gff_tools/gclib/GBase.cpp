@@ -1,6 +1,9 @@
 #include "GBase.h"
 #include <ctype.h>
 #include <errno.h>
+#ifdef GMEMSTATS
+#include <new>
+#endif
 
 #ifndef S_ISDIR
 #define S_ISDIR(mode)  (((mode) & S_IFMT) == S_IFDIR)
@@ -68,17 +71,148 @@ void GMessage(const char* format,...){
   }
 
 /*************** Memory management routines *****************/
+#ifdef GMEMSTATS
+//header in front of each accounted block (16 bytes, keeping the malloc alignment)
+struct GMemHeader {
+  uint64 size;
+  uint32 tag;
+  uint32 magic;
+};
+#define GMEM_MAGIC 0x47a11c0du
+
+static GMemTagStats gmem_stats[gmtNumTags+1]; //the last one has the totals
+static thread_local int gmem_tag=gmtOther;
+static const char* gmem_tagnames[gmtNumTags]={"other", "GffLine", "GffObj",
+    "GffAttr", "GFaSeqGet", "GStr", "GHash" };
+
+int GMemSetTag(int tag) {
+  int prev=gmem_tag;
+  gmem_tag=tag;
+  return prev;
+}
+
+const char* GMemTagName(int tag) {
+  if (tag==gmtNumTags) return "total";
+  return (tag>=0 && tag<gmtNumTags) ? gmem_tagnames[tag] : "?";
+}
+
+//tag can be gmtNumTags for the totals
+void GMemGetStats(int tag, GMemTagStats& stats) {
+  GMemTagStats& st=gmem_stats[tag];
+  stats.allocs=__atomic_load_n(&st.allocs, __ATOMIC_RELAXED);
+  stats.frees=__atomic_load_n(&st.frees, __ATOMIC_RELAXED);
+  stats.bytes=__atomic_load_n(&st.bytes, __ATOMIC_RELAXED);
+  stats.live=__atomic_load_n(&st.live, __ATOMIC_RELAXED);
+  stats.peak=__atomic_load_n(&st.peak, __ATOMIC_RELAXED);
+}
+
+void GMemPrintStats(FILE* f) {
+  fprintf(f, "Allocations by tag:\n  %-10s %12s %12s %14s %14s %14s\n",
+      "tag", "allocs", "frees", "bytes", "live bytes", "peak live");
+  for (int t=0;t<=gmtNumTags;t++) {
+    GMemTagStats st;
+    GMemGetStats(t, st);
+    if (st.allocs==0 && t<gmtNumTags) continue;
+    fprintf(f, "  %-10s %12llu %12llu %14llu %14llu %14llu\n", GMemTagName(t),
+        (unsigned long long)st.allocs, (unsigned long long)st.frees,
+        (unsigned long long)st.bytes, (unsigned long long)st.live,
+        (unsigned long long)st.peak);
+  }
+}
+
+//change the live bytes of a tag and of the totals by delta
+static void gmem_account(int tag, int64 delta, int allocs, int frees) {
+  GMemTagStats* sts[2]={ &gmem_stats[tag], &gmem_stats[gmtNumTags] };
+  for (int i=0;i<2;i++) {
+    GMemTagStats& st=*sts[i];
+    if (allocs) __atomic_add_fetch(&st.allocs, allocs, __ATOMIC_RELAXED);
+    if (frees) __atomic_add_fetch(&st.frees, frees, __ATOMIC_RELAXED);
+    if (delta>0) __atomic_add_fetch(&st.bytes, (uint64)delta, __ATOMIC_RELAXED);
+    uint64 live=__atomic_add_fetch(&st.live, (uint64)delta, __ATOMIC_RELAXED);
+    uint64 peak=__atomic_load_n(&st.peak, __ATOMIC_RELAXED);
+    while (live>peak && !__atomic_compare_exchange_n(&st.peak, &peak, live, true,
+          __ATOMIC_RELAXED, __ATOMIC_RELAXED)) ;
+  }
+}
+
+static void* gmem_alloc(size_t size, bool zero) {
+  GMemHeader* h=(GMemHeader*)(zero ? calloc(1, sizeof(GMemHeader)+size) :
+      malloc(sizeof(GMemHeader)+size));
+  if (h==NULL) return NULL;
+  h->size=size;
+  h->tag=gmem_tag;
+  h->magic=GMEM_MAGIC;
+  gmem_account(h->tag, (int64)size, 1, 0);
+  return h+1;
+}
+
+static GMemHeader* gmem_header(void* p) {
+  GMemHeader* h=((GMemHeader*)p)-1;
+  if (h->magic!=GMEM_MAGIC)
+    GError("Error: memory block %p was not allocated by GMalloc/new!\n", p);
+  return h;
+}
+
+static void* gmem_realloc(void* p, size_t size) {
+  if (p==NULL) return gmem_alloc(size, false);
+  GMemHeader* h=gmem_header(p);
+  int tag=h->tag;
+  int64 oldsize=h->size;
+  h=(GMemHeader*)realloc(h, sizeof(GMemHeader)+size);
+  if (h==NULL) return NULL;
+  h->size=size;
+  gmem_account(tag, (int64)size-oldsize, 0, 0);
+  return h+1;
+}
+
+static void gmem_free(void* p) {
+  if (p==NULL) return;
+  GMemHeader* h=gmem_header(p);
+  gmem_account(h->tag, -(int64)h->size, 0, 1);
+  h->magic=0;
+  free(h);
+}
+
+//the objects created with new are accounted the same way
+void* operator new(size_t size) {
+  void* p=gmem_alloc(size, false);
+  if (p==NULL) GError(ERR_ALLOC);
+  return p;
+}
+void* operator new[](size_t size) {
+  void* p=gmem_alloc(size, false);
+  if (p==NULL) GError(ERR_ALLOC);
+  return p;
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return gmem_alloc(size, false); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return gmem_alloc(size, false); }
+void operator delete(void* p) noexcept { gmem_free(p); }
+void operator delete[](void* p) noexcept { gmem_free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { gmem_free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { gmem_free(p); }
+
+ #define GMEM_MALLOC(size) gmem_alloc(size, false)
+ #define GMEM_CALLOC(size) gmem_alloc(size, true)
+ #define GMEM_REALLOC(p, size) gmem_realloc(p, size)
+ #define GMEM_FREE(p) gmem_free(p)
+#else
+ #define GMEM_MALLOC(size) malloc(size)
+ #define GMEM_CALLOC(size) calloc(size,1)
+ #define GMEM_REALLOC(p, size) realloc(p, size)
+ #define GMEM_FREE(p) free(p)
+#endif
+
 // Allocate memory
 bool GMalloc(pointer* ptr,unsigned long size){
   //GASSERT(ptr);
-  if (size!=0) *ptr=malloc(size);
+  if (size!=0) *ptr=GMEM_MALLOC(size);
   return *ptr!=NULL;
   }
 
 // Allocate cleaned memory (0 filled)
 bool GCalloc(pointer* ptr,unsigned long size){
   GASSERT(ptr);
-  *ptr=calloc(size,1);
+  *ptr=GMEM_CALLOC(size);
   return *ptr!=NULL;
   }
 
@@ -90,7 +224,7 @@ bool GRealloc(pointer* ptr,unsigned long size){
     return true;
     }
   if (*ptr==NULL) {//simple malloc
-   void *p=malloc(size);
+   void *p=GMEM_MALLOC(size);
    if (p != NULL) {
      *ptr=p;
      return true;
@@ -98,7 +232,7 @@ bool GRealloc(pointer* ptr,unsigned long size){
     else return false;
    }//malloc
   else {//realloc
-   void *p=realloc(*ptr,size);
+   void *p=GMEM_REALLOC(*ptr,size);
    if (p) {
        *ptr=p;
        return true;
@@ -109,7 +243,7 @@ bool GRealloc(pointer* ptr,unsigned long size){
 // Free memory, resets ptr to NULL afterward
 void GFree(pointer* ptr){
   GASSERT(ptr);
-  if (*ptr) free(*ptr);
+  if (*ptr) GMEM_FREE(*ptr);
   *ptr=NULL;
   }
 
@@ -204,6 +204,46 @@ bool GCalloc(pointer* ptr, unsigned long size); // Allocate and initialize memor
 bool GRealloc(pointer* ptr,unsigned long size); // Resize memory
 void GFree(pointer* ptr); // Free memory, resets ptr to NULL
 
+// Allocation accounting, only compiled in with -DGMEMSTATS ('make memstats'):
+// the allocations made through GMalloc/GCalloc/GRealloc and operator new are
+// counted for the tag set by the innermost GMEM_TAG() scope of the calling
+// thread, and the freed blocks are credited back to the tag they were
+// allocated for (a small header is kept in front of each block)
+enum GMemTag {
+  gmtOther=0,
+  gmtGffLine,
+  gmtGffObj,
+  gmtGffAttr,
+  gmtGFaSeqGet,
+  gmtGStr,
+  gmtGHash,
+  gmtNumTags
+};
+
+struct GMemTagStats {
+  uint64 allocs; //number of allocations
+  uint64 frees;
+  uint64 bytes; //total bytes allocated
+  uint64 live; //bytes currently allocated
+  uint64 peak; //high-water mark of live
+};
+
+#ifdef GMEMSTATS
+int GMemSetTag(int tag); //returns the previous tag of this thread
+const char* GMemTagName(int tag);
+void GMemGetStats(int tag, GMemTagStats& stats);
+void GMemPrintStats(FILE* f=stderr); //per tag summary
+class GMemTagScope {
+    int prev;
+  public:
+    GMemTagScope(int tag):prev(GMemSetTag(tag)) { }
+    ~GMemTagScope() { GMemSetTag(prev); }
+};
+ #define GMEM_TAG(tag) GMemTagScope _gmem_tag_scope(tag)
+#else
+ #define GMEM_TAG(tag)
+#endif
+
 
 //int saprintf(char **retp, const char *fmt, ...);
 
@@ -337,6 +377,7 @@ class GSeg {
         return (r->end<end)? r->end-start+1 : end-start+1;
         }
      }
+  int overlapLen(GSeg& r) { return overlapLen(&r); }
   int overlapLen(uint rstart, uint rend) {
      if (rstart>rend) { Gswap(rstart,rend); }
      if (start<rstart) {
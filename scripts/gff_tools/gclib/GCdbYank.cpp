@@ -404,21 +404,16 @@ GCdbYank::~GCdbYank() {
 }
 
 
-int GCdbYank::getRecord(const char* key, FastaSeq& rec, charFunc* seqCallBack) {
-//assumes fdb is open, cdb was created on the index file
+int GCdbYank::findRecord(const char* key, off_t& fpos, uint32& reclen) {
  int r=cdb->find(key);
  if (r==0) return 0;
  if (r==-1)
    GError("cdbyank: error searching for key %s in %s\n", key, idxfile);
- /* while (r>0) { */
  off_t pos = cdb->datapos(); //position of this key's record in the index file
  unsigned int len=cdb->datalen(); // length of this key's record
  char bytes[32]; // data buffer -- should just accomodate fastarec_pos, fastarec_length
  if (cdb->read(bytes,len,pos) == -1)
        GError("cdbyank: error at GCbd::read (%s)!\n", idxfile);
-
- off_t fpos; //this will be the fastadb offset
- uint32 reclen;  //this will be the fasta record offset
  if (len>irec_size32) { //64 bit file offset was used
   fpos=gcvt_offt(bytes);
   reclen=gcvt_uint(&bytes[sizeof(uint32)<<1]);
@@ -427,10 +422,14 @@ int GCdbYank::getRecord(const char* key, FastaSeq& rec, charFunc* seqCallBack) {
   fpos=gcvt_uint(bytes);
   reclen=gcvt_uint(&bytes[sizeof(uint32)]);
   }
-  //GMessage("reclen=%d\n", reclen);
+ return 1;
+}
 
- /* if (showQuery)
-  fprintf(fout, "%c%s%c\t", delimQuery, key, delimQuery);*/
+int GCdbYank::getRecord(const char* key, FastaSeq& rec, charFunc* seqCallBack) {
+//assumes fdb is open, cdb was created on the index file
+ off_t fpos; //this will be the fastadb offset
+ uint32 reclen;  //this will be the fasta record offset
+ if (findRecord(key, fpos, reclen)==0) return 0;
   /*========= FETCHING RECORD CONTENT ======= */
    if (is_compressed) {
      //for now: ignore special retrievals, just print the whole record
@@ -487,3 +486,166 @@ off_t GCdbYank::getRecordPos(const char* key, uint32* record_len) {
   if (record_len!=NULL) *record_len=rlen;
   return fpos;
 }
+
+//---- batch retrieval
+
+struct GCdbBatchRec {
+  off_t fpos; //database offset of the record
+  uint32 reclen;
+  int idx; //index of its key
+};
+
+static int cmpCdbBatchRec(const pointer p1, const pointer p2) {
+  off_t o1=((GCdbBatchRec*)p1)->fpos;
+  off_t o2=((GCdbBatchRec*)p2)->fpos;
+  if (o1!=o2) return (o1<o2) ? -1 : 1;
+  return ((GCdbBatchRec*)p1)->idx-((GCdbBatchRec*)p2)->idx;
+}
+
+struct GCdbBatchJobs {
+  GCdbYank* cdby;
+  GVec<GCdbBatchRec> recs; //sorted by database offset
+  const char** keys;
+  GCdbRecordFunc* func;
+  void* udata;
+  const char* map; //the mapped database file, if not compressed
+  int chunk; //records per task
+  int numChunks;
+  bool serial; //run in the calling thread, can use its file handles
+  //records of the chunks fetched ahead of nextChunk (thread pool only),
+  //so the callback still gets all the records in database order
+  GPVec<FastaSeq>** fetched;
+  int nextChunk; //next chunk to pass to the callback
+};
+
+void GCdbYank::batchRange(int from, int to, void* p) {
+  GCdbBatchJobs& jobs=*(GCdbBatchJobs*)p;
+  GCdbYank& y=*jobs.cdby;
+  FastaSeq rec;
+  GFastaCharHandler fahandler(y.recdelim);
+#ifdef ENABLE_COMPRESSION
+  GCdbZFasta* zf=NULL;
+  if (y.is_compressed) {
+    //each task needs its own file position and inflate stream
+    zf=jobs.serial ? y.cdbz : y.openCdbz(y.dbname);
+    if (zf==NULL) GError("Error opening the cdbz file '%s'\n", y.dbname);
+  }
+#endif
+  char* buf=NULL; //record buffer, when the database file could not be mapped
+  uint32 bufcap=0;
+  for (int c=from;c<to;c++) {
+    int rfrom=c*jobs.chunk;
+    int rto=rfrom+jobs.chunk;
+    if (rto>jobs.recs.Count()) rto=jobs.recs.Count();
+    GPVec<FastaSeq>* crecs=jobs.serial ? NULL : new GPVec<FastaSeq>(rto-rfrom);
+    for (int i=rfrom;i<rto;i++) {
+      GCdbBatchRec& br=jobs.recs[i];
+      if (y.is_compressed) {
+#ifdef ENABLE_COMPRESSION
+        zf->decompress(rec, br.reclen, br.fpos);
+#else
+        GError(err_COMPRESSED);
+#endif
+      }
+      else {
+        if (br.fpos+(off_t)br.reclen>y.db_size)
+          GError("cdbyank: record of key %s is beyond the end of %s!\n",
+              jobs.keys[br.idx], y.dbname);
+        const char* data=NULL;
+        if (jobs.map!=NULL) data=jobs.map+br.fpos;
+        else {
+          if (br.reclen>bufcap) {
+            bufcap=br.reclen;
+            GREALLOC(buf, bufcap);
+          }
+          if (pread(y.fdb, buf, br.reclen, br.fpos)!=(ssize_t)br.reclen)
+            GError(ERR_READ);
+          data=buf;
+        }
+        fahandler.init(&rec, NULL);
+        for (uint32 j=0;j<br.reclen;j++)
+          fahandler.processChar(data[j]);
+        fahandler.done();
+      }
+      if (crecs==NULL) (*jobs.func)(br.idx, jobs.keys[br.idx], rec, jobs.udata);
+      else crecs->Add(new FastaSeq(rec, true));
+    }
+    if (crecs==NULL) continue;
+    //pass on this chunk and the ones after it which were already fetched
+    GLockGuard<GMutex> guard(y.batchLock);
+    jobs.fetched[c]=crecs;
+    while (jobs.nextChunk<jobs.numChunks && jobs.fetched[jobs.nextChunk]!=NULL) {
+      int n=jobs.nextChunk;
+      GPVec<FastaSeq>& frecs=*(jobs.fetched[n]);
+      for (int i=0;i<frecs.Count();i++) {
+        int idx=jobs.recs[n*jobs.chunk+i].idx;
+        (*jobs.func)(idx, jobs.keys[idx], *(frecs[i]), jobs.udata);
+      }
+      delete jobs.fetched[n];
+      jobs.fetched[n]=NULL;
+      jobs.nextChunk++;
+    }
+  }
+  GFREE(buf);
+#ifdef ENABLE_COMPRESSION
+  if (zf!=NULL && zf!=y.cdbz) {
+    fclose(zf->getZFile());
+    delete zf;
+  }
+#endif
+}
+
+int GCdbYank::getRecords(const char** keys, int numKeys, GCdbRecordFunc* func,
+    void* udata, int numThreads) {
+  GCdbBatchJobs jobs;
+  jobs.cdby=this;
+  jobs.keys=keys;
+  jobs.func=func;
+  jobs.udata=udata;
+  jobs.map=NULL;
+  jobs.fetched=NULL;
+  jobs.nextChunk=0;
+  //the index lookups are fast (the index file is mapped), so they are done here
+  for (int i=0;i<numKeys;i++) {
+    GCdbBatchRec br;
+    if (findRecord(keys[i], br.fpos, br.reclen)==0) {
+      if (warnings) GMessage("cdbyank: key \"%s\" not found in %s\n", keys[i], idxfile);
+      continue;
+    }
+    br.idx=i;
+    jobs.recs.Add(br);
+  }
+  int numRecs=jobs.recs.Count();
+  if (numRecs==0) return 0;
+  //read the database file sequentially rather than seeking back and forth
+  jobs.recs.Sort(cmpCdbBatchRec);
+  GThreadPool& pool=GThreadPool::global();
+  jobs.serial=(numThreads<=1 || pool.size()<=1 || numRecs<2);
+#ifndef NO_MMAP
+  char* dbmap=NULL;
+  if (!is_compressed && db_size>0) {
+    dbmap=(char*) mmap(0, db_size, PROT_READ, MAP_SHARED, fdb, 0);
+    if (dbmap==(char*)MAP_FAILED) dbmap=NULL; //use pread() instead
+    jobs.map=dbmap;
+  }
+#endif
+  if (jobs.serial) {
+    jobs.chunk=numRecs;
+    jobs.numChunks=1;
+    batchRange(0, 1, (void*) &jobs);
+  }
+  else {
+    //about 8 chunks per thread, but not too small for the cost of
+    //opening a decompression stream for each
+    jobs.chunk=numRecs/(pool.size()*8);
+    if (jobs.chunk<16) jobs.chunk=16;
+    jobs.numChunks=(numRecs+jobs.chunk-1)/jobs.chunk;
+    GCALLOC(jobs.fetched, jobs.numChunks*sizeof(GPVec<FastaSeq>*));
+    pool.parallel_for(0, jobs.numChunks, batchRange, (void*) &jobs, 1);
+    GFREE(jobs.fetched);
+  }
+#ifndef NO_MMAP
+  if (dbmap!=NULL) munmap(dbmap, db_size);
+#endif
+  return numRecs;
+}
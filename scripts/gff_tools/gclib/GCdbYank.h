@@ -5,6 +5,8 @@
 #include <stdio.h>
 #include "GFastaFile.h"
 // FastaSeq class and *charFunc() callback type
+#include "GThreads.h"
+#include "GVec.hh"
 
 #define DEF_CDBREC_DELIM ">"
 
@@ -39,6 +41,10 @@ class GCdbZFasta {
 
 #endif
 
+//callback of GCdbYank::getRecords(): rec is the record found for keys[idx],
+//only valid during the call
+typedef void GCdbRecordFunc(int idx, const char* key, FastaSeq& rec, void* udata);
+
 class GCdbYank {
   char* idxfile;
   //char* dbfile;
@@ -57,6 +63,10 @@ class GCdbYank {
   int fd;
   FILE* fz; // if compressed
   GFastaCharHandler* fastahandler;
+  GMutex batchLock; //for the getRecords() callbacks
+  //database offset and length of the record of key; returns 0 if not found
+  int findRecord(const char* key, off_t& fpos, uint32& reclen);
+  static void batchRange(int from, int to, void* p); //getRecords() task
 #ifdef ENABLE_COMPRESSION
  protected: 
    GCdbZFasta* openCdbz(char* p);
@@ -66,6 +76,12 @@ class GCdbYank {
   ~GCdbYank();
   int getRecord(const char* key, FastaSeq& rec, charFunc* seqCallBack=NULL);
   off_t getRecordPos(const char* key, uint32* record_len=NULL);
+  //retrieve the records of numKeys keys, in the order of their database
+  //offsets, using the threads of the global GThreadPool when numThreads>1;
+  //func is called for each record found, in database order and by one
+  //thread at a time; returns the number of records found
+  int getRecords(const char** keys, int numKeys, GCdbRecordFunc* func,
+      void* udata=NULL, int numThreads=1);
   char* getDbName() { return dbname; }
 
 };
@@ -3,12 +3,13 @@
 #include <ctype.h>
 
 GFaSeqGet* fastaSeqGet(GFastaDb& gfasta, const char* seqid) {
-  if (gfasta.fastaPath==NULL) return NULL;
+  if (!gfasta.hasSeqs()) return NULL;
   return gfasta.fetch(seqid);
 }
 
 
 void GSubSeq::setup(uint sstart, int slen, int sovl, int qfrom, int qto, uint maxseqlen) {
+     GMEM_TAG(gmtGFaSeqGet);
      if (sovl==0) {
        GFREE(sq);
        sqstart=sstart;
@@ -251,6 +252,7 @@ const char* GFaSeqGet::subseq(uint cstart, int& clen) {
 }
 
 char* GFaSeqGet::copyRange(uint cstart, uint cend, bool revCmpl, bool upCase) {
+  GMEM_TAG(gmtGFaSeqGet);
   if (cstart>cend) { Gswap(cstart, cend); }
   int clen=cend-cstart+1;
   const char* gs=subseq(cstart, clen);
@@ -270,6 +272,7 @@ char* GFaSeqGet::copyRange(uint cstart, uint cend, bool revCmpl, bool upCase) {
 const char* GFaSeqGet::loadsubseq(uint cstart, int& clen) {
   //assumes enough lastsub->sq space allocated previously
   //only loads the requested clen chars from file, at offset &lastsub->sq[cstart-lastsub->sqstart]
+  GMEM_TAG(gmtGFaSeqGet);
   if (cstart>seq_len || lastsub->sqstart>cstart) {
 	   clen=0; //invalid request
 	   return NULL;
@@ -1,6 +1,7 @@
 #ifndef GFASEQGET_H
 #define GFASEQGET_H
 #include "GFastaIndex.h"
+#include "GTrace.h"
 
 #define MAX_FASUBSEQ 0x20000000
 //max 512MB sequence data held in memory at a time
@@ -75,6 +76,17 @@ class GFaSeqGet {
 
   GFaSeqGet(FILE* f, off_t fofs=0, bool validate=false);
 
+  //in-memory sequence (e.g. from a GenBank file), taking over the seq buffer
+  GFaSeqGet(const char* sname, char* seq, uint seqlen):fname(NULL), fh(NULL),
+		    fseqstart(0), seq_len(seqlen), line_len(0), line_blen(0),
+			lastsub(NULL), seqname(NULL) {
+     seqname=Gstrdup(sname);
+     lastsub=new GSubSeq();
+     lastsub->sq=seq;
+     lastsub->sqstart=1;
+     lastsub->sqlen=seqlen;
+  }
+
   ~GFaSeqGet() {
     if (fname!=NULL) {
        GFREE(fname);
@@ -147,9 +159,12 @@ class GFastaDb {
   //int last_fetchid;
   const char* last_seqname;
   GFaSeqGet* faseq;
+  GHash<GFaSeqGet> memSeqs; //in-memory sequences, looked up before fastaPath
+  uint64 cacheHits; //sequence requests served from memory
+  uint64 cacheMisses; //sequences loaded from the FASTA file(s)
   //GCdbYank* gcdb;
   GFastaDb(const char* fpath=NULL, bool forceIndexFile=true):fastaPath(NULL), faIdx(NULL), last_seqname(NULL),
-		  faseq(NULL) {
+		  faseq(NULL), memSeqs(), cacheHits(0), cacheMisses(0) {
      //gcdb=NULL;
      init(fpath, forceIndexFile);
   }
@@ -256,25 +271,41 @@ class GFastaDb {
 	GFREE(s);
   }
 
- GFaSeqGet* fetch(const char* gseqname) {
+ //add an in-memory sequence (e.g. parsed from a GenBank file), taking over
+ //the seq buffer; a sequence with the same name is replaced
+ void addSeq(const char* gseqname, char* seq, uint seqlen) {
+    GFaSeqGet* ms=new GFaSeqGet(gseqname, seq, seqlen);
+    if (memSeqs.Find(gseqname)!=NULL) memSeqs.Remove(gseqname);
+    memSeqs.Add(gseqname, ms);
+ }
+
+ //true if any sequences can be fetched (FASTA file/directory or in-memory)
+ bool hasSeqs() { return (fastaPath!=NULL || memSeqs.Count()>0); }
+
+ //load the sequence gseqname into a new GFaSeqGet object, owned by the caller;
+ //no sequence is cached, so this can be called by multiple threads
+ GFaSeqGet* fetchNew(const char* gseqname) {
+    GMEM_TAG(gmtGFaSeqGet);
+    GTraceSpan tspan("fetch", "seq", gseqname);
+    GFaSeqGet* ms=memSeqs.Find(gseqname);
+    if (ms!=NULL) {
+       __atomic_add_fetch(&cacheHits, 1, __ATOMIC_RELAXED);
+       int slen=ms->getseqlen();
+       char* scopy=NULL;
+       GMALLOC(scopy, slen+1);
+       memcpy(scopy, ms->seq(), slen);
+       scopy[slen]=0;
+       return new GFaSeqGet(gseqname, scopy, slen);
+    }
     if (fastaPath==NULL) return NULL;
-    if (last_seqname!=NULL && (strcmp(gseqname, last_seqname)==0)
-    		&& faseq!=NULL) return faseq;
-    delete faseq;
-    faseq=NULL;
-    //last_fetchid=-1;
-    GFREE(last_seqname);
-    last_seqname=NULL;
-    //char* gseqname=GffObj::names->gseqs.getName(gseq_id);
+    __atomic_add_fetch(&cacheMisses, 1, __ATOMIC_RELAXED);
+    GFaSeqGet* fs=NULL;
     if (faIdx!=NULL) { //fastaPath was the multi-fasta file name and it must have an index
         GFastaRec* farec=faIdx->getRecord(gseqname);
         if (farec!=NULL) {
-             faseq=new GFaSeqGet(fastaPath,farec->seqlen, farec->fpos,
+             fs=new GFaSeqGet(fastaPath,farec->seqlen, farec->fpos,
                                farec->line_len, farec->line_blen);
-             faseq->loadall(); //just cache the whole sequence, it's faster
-             //last_fetchid=gseq_id;
-
-             last_seqname=Gstrdup(gseqname);
+             fs->loadall(); //just cache the whole sequence, it's faster
         }
         else {
           GMessage("Warning: couldn't find fasta record for '%s'!\n",gseqname);
@@ -284,13 +315,35 @@ class GFastaDb {
     else { //directory with FASTA files named as gseqname
         char* sfile=getFastaFile(gseqname);
         if (sfile!=NULL) {
-      	   faseq=new GFaSeqGet(sfile);
-           faseq->loadall();
-           //last_fetchid=gseq_id;
+           fs=new GFaSeqGet(sfile);
+           fs->loadall();
            GFREE(sfile);
            }
     } //one fasta file per contig
+    return fs;
+ }
 
+ GFaSeqGet* fetch(const char* gseqname) {
+    GFaSeqGet* ms=memSeqs.Find(gseqname);
+    if (ms!=NULL) {
+      cacheHits++;
+      return ms;
+    }
+    if (fastaPath==NULL) return NULL;
+    if (last_seqname!=NULL && (strcmp(gseqname, last_seqname)==0)
+    		&& faseq!=NULL) {
+      cacheHits++;
+      return faseq;
+    }
+    delete faseq;
+    faseq=NULL;
+    //last_fetchid=-1;
+    GFREE(last_seqname);
+    last_seqname=NULL;
+    //char* gseqname=GffObj::names->gseqs.getName(gseq_id);
+    faseq=fetchNew(gseqname);
+    if (faseq!=NULL && faIdx!=NULL)
+        last_seqname=Gstrdup(gseqname);
     //else GMessage("Warning: fasta index not available, cannot retrieve sequence %s\n",
     //		gseqname);
     return faseq;
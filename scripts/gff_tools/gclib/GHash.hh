@@ -5,6 +5,9 @@
 #ifndef GHash_HH
 #define GHash_HH
 #include "GBase.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 /**
 * This class maintains a fast-access hash table of entities
@@ -13,22 +16,101 @@
 
 //#define HASH_DBG_PRINT 1
 
-#define GSTR_HASH(s) strhash(s)
-//#define GSTR_HASH(s) djb_hash(s)
-//#define GSTR_HASH(s) fnv1a_hash(s)
+/*
+  Notes:
+  - Open addressing in the "Swiss table" style: besides the entries, the table
+    has an array of control bytes, one per slot: GHASH_EMPTY, GHASH_DELETED,
+    or the low 7 bits of the hash value (h2) of the key stored in the slot.
+  - The slots are probed in aligned groups of GHASH_GROUP (16) slots: all the
+    control bytes of a group are compared with h2 at once (a single SSE2
+    compare when available), so only the slots whose h2 matches are looked at.
+  - The table size is always a power of 2 (a multiple of the group size), so
+    the starting group is just a mask of the high part of the hash value (h1);
+    the next groups are visited in quadratic (triangular) steps, which covers
+    all the groups of a power-of-2 table.
+  - Within its group, a new key takes the first free slot starting at its
+    "home" slot (4 other bits of the hash value). Most keys are found there,
+    and the home entry is checked first: as its address does not depend on
+    the control bytes, it is prefetched (and usually loaded) in parallel with
+    them instead of after them.
+  - The (32-bit) hash value and the length of each key are stored in the
+    entry (24 bytes), so the key bytes are only compared (memcmp) when both
+    match.
+  - The control bytes are kept in their own array (1 byte per slot), which
+    stays in the cache much longer than the entries, so most unsuccessful
+    lookups never touch an entry.
+  - The key hash (FNV-1a, with a final mixing step for the bits used as h1)
+    is computed in the same pass over the key as its length, so a lookup
+    of a NUL-terminated key reads it only once before the table.
+  - Probing stops at the first group having an empty slot, so the table is
+    never allowed to fill up: it is rehashed when the used slots (including
+    the deleted ones) exceed 7/8 of the capacity.
+  - The keys can also be given as (ptr,len), e.g. a token inside a line
+    buffer, without making a NUL-terminated copy (FindN, hasKeyN, AddN).
+*/
+
+// Number of slots in a probing group
+#define GHASH_GROUP        16
+// Initial table size (MUST be a power of 2, multiple of GHASH_GROUP)
+#define GHASH_DEF_SIZE     32
+// Minimum hash table load factor (%) before shrinking
+#define GHASH_MIN_LOAD     10
+// Control byte values; full slots have the 7-bit h2 value (0..127) instead
+#define GHASH_EMPTY        ((signed char)-128)
+#define GHASH_DELETED      ((signed char)-2)
+
+// bit i is set in the result if control byte i of the group equals c
+inline uint GHashMatch(const signed char* grp, signed char c) {
+#if defined(__SSE2__)
+  __m128i g=_mm_loadu_si128((const __m128i*)grp);
+  return (uint)_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8(c)));
+#else
+  uint m=0;
+  for (int i=0;i<GHASH_GROUP;i++)
+    if (grp[i]==c) m|=(1u<<i);
+  return m;
+#endif
+}
+
+// bit i is set in the result if slot i of the group is empty or deleted
+// (the control bytes having the high bit set)
+inline uint GHashMatchFree(const signed char* grp) {
+#if defined(__SSE2__)
+  return (uint)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)grp));
+#else
+  uint m=0;
+  for (int i=0;i<GHASH_GROUP;i++)
+    if (grp[i]<0) m|=(1u<<i);
+  return m;
+#endif
+}
+
+// index of the lowest bit set in m (m>0)
+inline int GHashLowBit(uint m) {
+#if defined(__GNUC__)
+  return __builtin_ctz(m);
+#else
+  int i=0;
+  while ((m & 1)==0) { m>>=1; i++; }
+  return i;
+#endif
+}
 
 template <class OBJ> class GHash {
  protected:
 	struct GHashEntry {
 	     char*   key;              // Key string
-	     bool    keyalloc;         //shared key flag (to not free the key chars)
-	     int     hash;             // Hash value of key
-	     pointer data;              // Data
-	     bool    mark;             // Entry is marked
+	     pointer data;             // Data
+	     uint    hash;             // Hash value of key
+	     uint    keylen:30;        // Key length
+	     uint    keyalloc:1;       //shared key flag (to not free the key chars)
+	     uint    mark:1;           // Entry is marked
 	     };
   GHashEntry* hash;         // Hash
+  signed char* ctrl;        // control bytes, one for each slot
   int         fCapacity;     // table size
   int         fCount;        // number of valid entries
+  int         fDeleted;      // number of deleted slots
   int  fCurrentEntry;
   char* lastkeyptr; //pointer to last key string added
     //---------- Raw data retrieval (including empty entries
@@ -38,6 +120,8 @@ template <class OBJ> class GHash {
   OBJ* Data(uint pos) const { return (OBJ*) hash[pos].data; }
   // Return mark flag of entry at position pos.
   bool Mark(uint pos) const { return hash[pos].mark; }
+  // true if the slot at position pos holds an entry
+  bool isFull(int pos) const { return ctrl[pos]>=0; }
   // Return position of first filled slot, or >= fCapacity
   int First() const;
   // Return position of last filled slot or -1
@@ -49,6 +133,41 @@ template <class OBJ> class GHash {
   //Return position of previous filled slot in hash table
   //or a -1 if no filled slot was found
   int Prev(int pos) const;
+  //position of the entry with the given key, or -1 if not found
+  int findPos(const char* ky, uint klen, uint h) const;
+  //position of the first empty or deleted slot in the probing sequence of h,
+  //starting at the home slot in each group
+  int freePos(uint h) const;
+  //position of the new entry for key (not in the table), after making room
+  int insertPos(uint h);
+  //fill slot pos with a new entry
+  void setEntry(int pos, uint h, char* ky, uint klen, bool kalloc, OBJ* pdata, bool mrk);
+  //move the entries to a table of n slots, dropping the deleted ones
+  void rehash(int n);
+  void init(int n);
+  static uint keyMix(uint64 h) {
+    h^=h>>33;
+    h*=0xff51afd7ed558ccdULL;
+    h^=h>>33;
+    return (uint)h;
+  }
+  //hash value of the first klen characters of ky
+  static uint keyHash(const char* ky, uint klen) {
+    uint64 h=14695981039346656037ULL;
+    for (uint i=0;i<klen;i++) { h^=(unsigned char)ky[i]; h*=1099511628211ULL; }
+    return keyMix(h);
+  }
+  //hash value of the NUL-terminated key ky, also setting klen to its length
+  static uint keyHashLen(const char* ky, uint& klen) {
+    uint64 h=14695981039346656037ULL;
+    const char* p=ky;
+    for (;*p;p++) { h^=(unsigned char)*p; h*=1099511628211ULL; }
+    klen=p-ky;
+    return keyMix(h);
+  }
+  static signed char H2(uint h) { return (signed char)(h & 0x7F); }
+  //home slot of a key in a group
+  static uint Home(uint h) { return h>>28; }
 
 private:
   GHash(const GHash&);
@@ -69,8 +188,12 @@ public:
   int Count() const { return fCount; }// the total number of entries in the table.
 
   // Insert a new entry into the table given key and mark.
-  // If there is already an entry with that key, leave it unchanged
+  // If there is already an entry with that key, its data is replaced
+  // and the previous data pointer is returned
   OBJ* Add(const char* ky, OBJ* ptr=NULL, bool mrk=false);
+  //same with Add, but the key is given as (ptr,len), it does not have to
+  //be NUL-terminated (a NUL-terminated copy is stored in the table)
+  OBJ* AddN(const char* ky, int klen, OBJ* ptr=NULL, bool mrk=false);
 
   //same with Add, but frees the old element if it's a replacement
   OBJ* fAdd(const char* ky, OBJ* ptr=NULL);
@@ -87,7 +210,10 @@ public:
   OBJ* Remove(const char* ky);
   // Find data OBJ* given key.
   OBJ* Find(const char* ky, char** keyptr=NULL);
+  // Find data OBJ* given the first klen characters of ky as the key
+  OBJ* FindN(const char* ky, int klen, char** keyptr=NULL);
   bool hasKey(const char* ky);
+  bool hasKeyN(const char* ky, int klen);
   char* getLastKey() { return lastkeyptr; }
   OBJ* operator[](const char* ky) { return Find(ky); }
   void startIterate(); //iterator-like initialization
@@ -98,7 +224,7 @@ public:
                                 //nextkey is SET to the corresponding key
   GHashEntry* NextEntry() { //returns a pointer to a GHashEntry
   	 int pos=fCurrentEntry;
-  	 while (pos<fCapacity && hash[pos].hash<0) pos++;
+  	 while (pos<fCapacity && !isFull(pos)) pos++;
   	 if (pos==fCapacity) {
   	                 fCurrentEntry=fCapacity;
   	                 return NULL;
@@ -117,426 +243,303 @@ public:
 //
 //======================== method definitions ========================
 //
-/*
-  Notes:
-  - The hash algorithm should yield a fCount in the range [0...GHash::EMPTY)
-     GHash::EMPTY and GHash::UNUSED are needed for flag purposes.
-  - Since the algorithm doubles the table size when exceeding MAX_LOAD,
-    it would be prudent to keep MIN_LOAD less than 1/2 MAX_LOAD;
-    otherwise, the algorithm might hip-hop between halving and doubling,
-    which would be quite expensive!!
-  - Not many people seem to know that hash tables don't have to be prime
-    numbers; in fact, a table size of 2**n and odd probe distance are very
-    easy to arrange, and this works just as well!
-  - We store the hash key, so that 99.999% of the time we can compare hash numbers;
-    only when hash numbers match do we need to compare keys.
-    Thus, with a good hash function, the fCount of calls to strcmp() should be
-    roughly the same as the fCount of successful lookups.
-  - The hash table should NEVER get full, or stuff will loop forever!!
-*/
-
-// Initial table size (MUST be power of 2)
-#define DEF_HASH_SIZE      32
-// Maximum hash table load factor (%)
-#define MAX_LOAD           80
-// Minimum hash table load factor (%)
-#define MIN_LOAD           10
-// Probe Position [0..n-1]
-#define HASH1(x,n) (((unsigned int)(x)*13)%(n))
-// Probe Distance [1..n-1]
-#define HASH2(x,n) (1|(((unsigned int)(x)*17)%((n)-1)))
 
 #define FREEDATA (fFreeProc!=NULL)
 
 /*******************************************************************************/
+template <class OBJ> void GHash<OBJ>::init(int n) {
+  GMEM_TAG(gmtGHash);
+  GMALLOC(hash, sizeof(GHashEntry)*n);
+  GMALLOC(ctrl, n);
+  memset(ctrl, GHASH_EMPTY, n);
+  fCapacity=n;
+  fCount=0;
+  fDeleted=0;
+  }
+
 // Construct empty hash
 template <class OBJ> GHash<OBJ>::GHash(GFreeProc* freeProc) {
-  GMALLOC(hash, sizeof(GHashEntry)*DEF_HASH_SIZE);
   fCurrentEntry=-1;
   fFreeProc=freeProc;
   lastkeyptr=NULL;
-  for (uint i=0; i<DEF_HASH_SIZE; i++)
-         hash[i].hash=-1; //this will be an indicator for 'empty' entries
-  fCapacity=DEF_HASH_SIZE;
-  fCount=0;
+  init(GHASH_DEF_SIZE);
   }
 
 template <class OBJ> GHash<OBJ>::GHash(bool doFree) {
-  GMALLOC(hash, sizeof(GHashEntry)*DEF_HASH_SIZE);
   fCurrentEntry=-1;
   lastkeyptr=NULL;
   fFreeProc = (doFree)?&DefaultFreeProc : NULL;
-  for (uint i=0; i<DEF_HASH_SIZE; i++)
-         hash[i].hash=-1; //this will be an indicator for 'empty' entries
-  fCapacity=DEF_HASH_SIZE;
-  fCount=0;
+  init(GHASH_DEF_SIZE);
   }
 
+template <class OBJ> int GHash<OBJ>::findPos(const char* ky, uint klen, uint h) const {
+  signed char h2=H2(h);
+  uint gmask=(fCapacity/GHASH_GROUP)-1;
+  uint g=(h>>7) & gmask;
+  uint home=Home(h);
+  __builtin_prefetch(&hash[g*GHASH_GROUP+home]);
+#ifdef HASH_DBG_PRINT
+  int iterations=0;
+#endif
+  for (uint step=1;;step++) {
+    const signed char* gctrl=ctrl+g*GHASH_GROUP;
+    uint m=GHashMatch(gctrl, h2);
+    if (m & (1u<<home)) { //usually taken for the keys in the table
+      const GHashEntry& e=hash[g*GHASH_GROUP+home];
+      if (e.hash==h && e.keylen==klen && memcmp(e.key, ky, klen)==0) {
+#ifdef HASH_DBG_PRINT
+        GMessage("Found \t%.*s\t%d\t%d\t%d\n", klen, ky, iterations, fCount, fCapacity);
+#endif
+        return g*GHASH_GROUP+home;
+        }
+      m&=~(1u<<home);
+      }
+    while (m) {
+      int i=GHashLowBit(m);
+      const GHashEntry& e=hash[g*GHASH_GROUP+i];
+      if (e.hash==h && e.keylen==klen && memcmp(e.key, ky, klen)==0) {
+#ifdef HASH_DBG_PRINT
+        GMessage("Found \t%.*s\t%d\t%d\t%d\n", klen, ky, iterations, fCount, fCapacity);
+#endif
+        return g*GHASH_GROUP+i;
+        }
+      m&=m-1;
+      }
+    if (GHashMatch(gctrl, GHASH_EMPTY)) break;
+    g=(g+step) & gmask;
+#ifdef HASH_DBG_PRINT
+    ++iterations;
+#endif
+    }
+#ifdef HASH_DBG_PRINT
+  GMessage("Nfound\t%.*s\t%d\t%d\t%d\n", klen, ky, iterations, fCount, fCapacity);
+#endif
+  return -1;
+  }
+
+template <class OBJ> int GHash<OBJ>::freePos(uint h) const {
+  uint gmask=(fCapacity/GHASH_GROUP)-1;
+  uint g=(h>>7) & gmask;
+  uint home=Home(h);
+  for (uint step=1;;step++) {
+    uint m=GHashMatchFree(ctrl+g*GHASH_GROUP);
+    if (m) { //rotate the free slots so that the home slot comes first
+      m=((m>>home) | (m<<(GHASH_GROUP-home))) & ((1u<<GHASH_GROUP)-1);
+      return g*GHASH_GROUP+((home+GHashLowBit(m)) & (GHASH_GROUP-1));
+      }
+    g=(g+step) & gmask;
+    }
+  }
+
+template <class OBJ> int GHash<OBJ>::insertPos(uint h) {
+  int p=freePos(h);
+  if (ctrl[p]==GHASH_DELETED) { //reuse the deleted slot
+    fDeleted--;
+    return p;
+    }
+  if (8*(fCount+fDeleted+1)>7*fCapacity) { //keep at least 1/8 of the slots empty
+    Resize(fCount+1);
+    p=freePos(h);
+    }
+  return p;
+  }
+
+template <class OBJ> void GHash<OBJ>::setEntry(int pos, uint h, char* ky, uint klen,
+                      bool kalloc, OBJ* pdata, bool mrk) {
+  GASSERT(0<=pos && pos<fCapacity && ctrl[pos]<0);
+  GHashEntry& e=hash[pos];
+  e.key=ky;
+  e.keylen=klen;
+  e.keyalloc=kalloc;
+  e.hash=h;
+  e.data=(pointer)pdata;
+  e.mark=mrk;
+  ctrl[pos]=H2(h);
+  lastkeyptr=ky;
+  fCount++;
+  }
+
+template <class OBJ> void GHash<OBJ>::rehash(int n) {
+  GHashEntry* oldhash=hash;
+  signed char* oldctrl=ctrl;
+  int oldcap=fCapacity;
+  int count=fCount;
+  init(n);
+  for (int i=0;i<oldcap;i++) {
+    if (oldctrl[i]<0) continue;
+    int p=freePos(oldhash[i].hash);
+    hash[p]=oldhash[i];
+    ctrl[p]=oldctrl[i];
+    }
+  fCount=count;
+  GFREE(oldhash);
+  GFREE(oldctrl);
+  }
 
 // Resize table
 template <class OBJ> void GHash<OBJ>::Resize(int m){
-  int i,n,p,x,h;
-  GHashEntry *k;
+  GMEM_TAG(gmtGHash);
+  int n;
   GASSERT(fCount<=fCapacity);
-  if(m<DEF_HASH_SIZE) m=DEF_HASH_SIZE;
+  if(m<fCount) m=fCount;
+  if(m<(GHASH_DEF_SIZE>>1)) m=(GHASH_DEF_SIZE>>1);
   n=fCapacity;
   while((n>>2)>m) n>>=1;            // Shrink until n/4 <= m
   while((n>>1)<m) n<<=1;            // Grow until m <= n/2
   GASSERT(m<=(n>>1));
-  GASSERT(DEF_HASH_SIZE<=n);
-  if(n!=fCapacity){
-    GASSERT(m<=n);
-    GMALLOC(k, sizeof(GHashEntry)*n);
-    for(i=0; i<n; i++) k[i].hash=-1;
-    for(i=0; i<fCapacity; i++){
-      h=hash[i].hash;
-      if(0<=h){
-        p=HASH1(h,n);
-        GASSERT(0<=p && p<n);
-        x=HASH2(h,n);
-        GASSERT(1<=x && x<n);
-        while(k[p].hash!=-1) p=(p+x)%n;
-        GASSERT(k[p].hash<0);
-        k[p]=hash[i];
-        }
-      }
-    GFREE(hash);
-    hash=k;
-    fCapacity=n;
-    }
+  GASSERT(GHASH_DEF_SIZE<=n);
+  if (n!=fCapacity || fDeleted>0) rehash(n);
   }
 
 // add a new entry, or update it if it already exists
-
-
 template <class OBJ> OBJ* GHash<OBJ>::Add(const char* ky,
 	                      OBJ* pdata, bool mrk){
-	  int p,i,x,h,n;
 	  if(!ky) GError("GHash::insert: NULL key argument.\n");
-	  GASSERT(fCount<fCapacity);
-	  h=GSTR_HASH(ky);
-	  GASSERT(0<=h);
-	  p=HASH1(h,fCapacity);
-	  GASSERT(0<=p && p<fCapacity);
-	  x=HASH2(h,fCapacity);
-	  GASSERT(1<=x && x<fCapacity);
-	  i=-1;
-	  n=fCapacity;
-#ifdef HASH_DBG_PRINT
-	  int iterations=0;
-	  int init_p=p;
-	  int init_x=x;
-#endif
-	  while(n && hash[p].hash!=-1) {
-	    if ((i==-1)&&(hash[p].hash==-2)) i=p;
-	    if (hash[p].hash==h && strcmp(hash[p].key,ky)==0) {
+	  return AddN(ky, strlen(ky), pdata, mrk);
+ }
+
+template <class OBJ> OBJ* GHash<OBJ>::AddN(const char* ky, int klen,
+	                      OBJ* pdata, bool mrk){
+	  GMEM_TAG(gmtGHash);
+	  if(!ky) GError("GHash::insert: NULL key argument.\n");
+	  uint h=keyHash(ky, klen);
+	  int p=findPos(ky, klen, h);
+	  if (p>=0) {
 	      //replace hash data for this key!
 	      lastkeyptr=hash[p].key;
 	      OBJ* r = (OBJ*) hash[p].data;
 	      hash[p].data = (void*) pdata;
-#ifdef HASH_DBG_PRINT
-	      GMessage("Add.R\t%s\t%d,%d,%d\t%d\t%d\t%d\n",
-	    		  ky, h,init_p,init_x, iterations,  fCount, fCapacity);
-#endif
-	      //return (OBJ*)hash[p].data;
 	      return r;
 	      }
-	    p=(p+x)%fCapacity;
-	    n--;
-	    }
-	  if(i==-1) i=p;
-#ifdef HASH_DBG_PRINT
-      GMessage("Add.N\t%s\t%d,%d,%d\t%d\t%d\t%d\n",
-    		  ky, h,init_p,init_x, iterations,  fCount, fCapacity);
-#endif
-	  GTRACE(("GHash::insert: key=\"%s\"\n",ky));
-	  //GMessage("GHash::insert: key=\"%s\"\n",ky);
-	  GASSERT(0<=i && i<fCapacity);
-	  GASSERT(hash[i].hash<0);
-	  hash[i].hash=h;
-	  hash[i].mark=mrk;
-	  hash[i].key=Gstrdup(ky);
-	  hash[i].keyalloc=true;
-	  lastkeyptr=hash[i].key;
-	  hash[i].data= (void*) pdata;
-	  fCount++;
-	  if((100*fCount)>=(MAX_LOAD*fCapacity)) Resize(fCount);
-	  GASSERT(fCount<fCapacity);
+	  GTRACE(("GHash::insert: key=\"%.*s\"\n",klen,ky));
+	  p=insertPos(h);
+	  setEntry(p, h, Gstrdup(ky, ky+klen-1), klen, true, pdata, mrk);
 	  return pdata;
  }
 
-/*
-  int p,i,x,h;
-  if(!ky) GError("GHash::insert: NULL key argument.\n");
-  GASSERT(fCount<fCapacity);
-  h=GSTR_HASH(ky);
-  GASSERT(0<=h);
-  p=HASH1(h,fCapacity);
-  GASSERT(0<=p && p<fCapacity);
-  x=HASH2(h,fCapacity);
-  GASSERT(1<=x && x<fCapacity);
-  if (checkReplace(ky, pdata, p, i, h, x)) {
-	  return (OBJ*)hash[p].data;
-  }
-  GTRACE(("GHash::insert: key=\"%s\"\n",ky));
-  //GMessage("GHash::insert: key=\"%s\"\n",ky);
-  GASSERT(0<=i && i<fCapacity);
-  GASSERT(hash[i].hash<0);
-  hash[i].hash=h;
-  hash[i].mark=mrk;
-  hash[i].key=Gstrdup(ky);
-  hash[i].keyalloc=true;
-  lastkeyptr=hash[i].key;
-  hash[i].data= (void*) pdata;
-  fCount++;
-  if((100*fCount)>=(MAX_LOAD*fCapacity)) Resize(fCount);
-  GASSERT(fCount<fCapacity);
-  return pdata;
-  }
-*/
 template <class OBJ> OBJ* GHash<OBJ>::fAdd(const char* ky,
                       OBJ* pdata){
-  int p,i,x,h,n;
+  GMEM_TAG(gmtGHash);
   if(!ky) GError("GHash::insert: NULL key argument.\n");
-  GASSERT(fCount<fCapacity);
-  h=GSTR_HASH(ky);
-  GASSERT(0<=h);
-  p=HASH1(h,fCapacity);
-  GASSERT(0<=p && p<fCapacity);
-  x=HASH2(h,fCapacity);
-  GASSERT(1<=x && x<fCapacity);
-  i=-1;
-  n=fCapacity;
-#ifdef HASH_DBG_PRINT
-  int iterations=0;
-  int init_p=p;
-  int init_x=x;
-#endif
-  while(n && hash[p].hash!=-1) {
-    if ((i==-1)&&(hash[p].hash==-2)) i=p;
-    if (hash[p].hash==h && strcmp(hash[p].key,ky)==0) {
+  uint klen;
+  uint h=keyHashLen(ky, klen);
+  int p=findPos(ky, klen, h);
+  if (p>=0) {
       //replace hash data for this key!
       lastkeyptr=hash[p].key;
       if (FREEDATA) (*fFreeProc)(hash[p].data);
       hash[p].data = (void*) pdata;
-#ifdef HASH_DBG_PRINT
-      GMessage("Add.R\t%s\t%d,%d,%d\t%d\t%d\t%d\n",
-    		  ky, h,init_p,init_x, iterations,  fCount, fCapacity);
-#endif
       return pdata;
       }
-    p=(p+x)%fCapacity;
-#ifdef HASH_DBG_PRINT
-    ++iterations;
-#endif
-    n--;
-    }
-  if(i==-1) i=p;
-#ifdef HASH_DBG_PRINT
-  GMessage("Add.N\t%s\t%d,%d,%d\t%d\t%d\t%d\n",
-		  ky, h,init_p,init_x, iterations,  fCount, fCapacity);
-#endif
   GTRACE(("GHash::insert: key=\"%s\"\n",ky));
-  //GMessage("GHash::insert: key=\"%s\"\n",ky);
-  GASSERT(0<=i && i<fCapacity);
-  GASSERT(hash[i].hash<0);
-  hash[i].hash=h;
-  hash[i].mark=false;
-  hash[i].key=Gstrdup(ky);
-  hash[i].keyalloc=true;
-  lastkeyptr=hash[i].key;
-  hash[i].data= (void*) pdata;
-  fCount++;
-  if((100*fCount)>=(MAX_LOAD*fCapacity)) Resize(fCount);
-  GASSERT(fCount<fCapacity);
+  p=insertPos(h);
+  setEntry(p, h, Gstrdup(ky), klen, true, pdata, false);
   return pdata;
   }
 
-
-
 template <class OBJ> OBJ* GHash<OBJ>::shkAdd(const char* ky,
                       OBJ* pdata,bool mrk){
-  int p,i,x,h,n;
   if(!ky) GError("GHash::insert: NULL key argument.\n");
-  GASSERT(fCount<fCapacity);
-  h=GSTR_HASH(ky);
-  GASSERT(0<=h);
-  p=HASH1(h,fCapacity);
-  GASSERT(0<=p && p<fCapacity);
-  x=HASH2(h,fCapacity);
-  GASSERT(1<=x && x<fCapacity);
-  i=-1;
-  n=fCapacity;
-  while(n && hash[p].hash!=-1){
-    if((i==-1)&&(hash[p].hash==-2)) i=p;
-    if(hash[p].hash==h && strcmp(hash[p].key,ky)==0){
+  uint klen;
+  uint h=keyHashLen(ky, klen);
+  int p=findPos(ky, klen, h);
+  if (p>=0) {
       //replace hash data for this key!
       lastkeyptr=hash[p].key;
       hash[p].data = (void*) pdata;
       return (OBJ*)hash[p].data;
       }
-    p=(p+x)%fCapacity;
-    n--;
-    }
-  if(i==-1) i=p;
   GTRACE(("GHash::insert: key=\"%s\"\n",ky));
-  //GMessage("GHash::insert: key=\"%s\"\n",ky);
-  GASSERT(0<=i && i<fCapacity);
-  GASSERT(hash[i].hash<0);
-  hash[i].hash=h;
-  hash[i].mark=mrk;
-  hash[i].key=(char *)ky;
-  lastkeyptr=hash[i].key;
-  hash[i].keyalloc=false;
-  hash[i].data= (void*) pdata;
-  fCount++;
-  if((100*fCount)>=(MAX_LOAD*fCapacity)) Resize(fCount);
-  GASSERT(fCount<fCapacity);
+  p=insertPos(h);
+  setEntry(p, h, (char*)ky, klen, false, pdata, mrk);
   return pdata;
   }
 
 
 // Add or replace entry
 template <class OBJ>  OBJ* GHash<OBJ>::Replace(const char* ky, OBJ* pdata, bool mrk){
-  int p,i,x,h,n;
+  GMEM_TAG(gmtGHash);
   if(!ky){ GError("GHash::replace: NULL key argument.\n"); }
-  GASSERT(fCount<fCapacity);
-  h=GSTR_HASH(ky);
-  GASSERT(0<=h);
-  p=HASH1(h,fCapacity);
-  GASSERT(0<=p && p<fCapacity);
-  x=HASH2(h,fCapacity);
-  GASSERT(1<=x && x<fCapacity);
-  i=-1;
-  n=fCapacity;
-  while(n && hash[p].hash!=-1){
-    if((i==-1)&&(hash[p].hash==-2)) i=p;
-    if(hash[p].hash==h && strcmp(hash[p].key,ky)==0){
+  uint klen;
+  uint h=keyHashLen(ky, klen);
+  int p=findPos(ky, klen, h);
+  if (p>=0) {
       if(hash[p].mark<=mrk){
         GTRACE(("GHash::replace: %08x: replacing: \"%s\"\n",this,ky));
         if (FREEDATA) (*fFreeProc)(hash[p].data);
         hash[p].mark=mrk;
         hash[p].data=pdata;
         }
-      return hash[p].data;
+      return (OBJ*)hash[p].data;
       }
-    p=(p+x)%fCapacity;
-    n--;
-    }
-  if(i==-1) i=p;
   GTRACE(("GHash::replace: %08x: inserting: \"%s\"\n",this,ky));
-  GASSERT(0<=i && i<fCapacity);
-  GASSERT(hash[i].hash<0);
-  hash[i].hash=h;
-  hash[i].mark=mrk;
-  hash[i].key=Gstrdup(ky);
-  hash[i].data=pdata;
-  fCount++;
-  if((100*fCount)>=(MAX_LOAD*fCapacity)) Resize(fCount);
-  GASSERT(fCount<fCapacity);
+  p=insertPos(h);
+  setEntry(p, h, Gstrdup(ky), klen, true, pdata, mrk);
   return pdata;
   }
 
 
 // Remove entry
 template <class OBJ> OBJ* GHash<OBJ>::Remove(const char* ky){
-  int p,x,h,n;
   if(!ky){ GError("GHash::remove: NULL key argument.\n"); }
   OBJ* removed=NULL;
-  if(0<fCount){
-    h=GSTR_HASH(ky);
-    GASSERT(0<=h);
-    p=HASH1(h,fCapacity);
-    GASSERT(0<=p && p<fCapacity);
-    x=HASH2(h,fCapacity);
-    GASSERT(1<=x && x<fCapacity);
-    GASSERT(fCount<fCapacity);
-    n=fCapacity;
-    while(n && hash[p].hash!=-1){
-      if(hash[p].hash==h && strcmp(hash[p].key,ky)==0){
-        GTRACE(("GHash::remove: %08x removing: \"%s\"\n",this,ky));
-        hash[p].hash=-2;
-        hash[p].mark=false;
-        if (hash[p].keyalloc) GFREE((hash[p].key));
-        if (FREEDATA) (*fFreeProc)(hash[p].data);
-            else removed=(OBJ*)hash[p].data;
-        hash[p].key=NULL;
-        hash[p].data=NULL;
-        fCount--;
-        if((100*fCount)<=(MIN_LOAD*fCapacity)) Resize(fCount);
-        GASSERT(fCount<fCapacity);
-        return removed;
-        }
-      p=(p+x)%fCapacity;
-      n--;
-      }
+  if (fCount==0) return removed;
+  uint klen;
+  int p=findPos(ky, klen, keyHashLen(ky, klen));
+  if (p<0) return removed;
+  GTRACE(("GHash::remove: %08x removing: \"%s\"\n",this,ky));
+  if (hash[p].keyalloc) GFREE((hash[p].key));
+  if (FREEDATA) (*fFreeProc)(hash[p].data);
+      else removed=(OBJ*)hash[p].data;
+  hash[p].key=NULL;
+  hash[p].data=NULL;
+  hash[p].mark=false;
+  //a probing sequence never went past a group which still has an empty
+  //slot, so the slot can be made empty instead of deleted
+  if (GHashMatch(ctrl+(p-p%GHASH_GROUP), GHASH_EMPTY)) ctrl[p]=GHASH_EMPTY;
+  else {
+    ctrl[p]=GHASH_DELETED;
+    fDeleted++;
     }
+  fCount--;
+  if(fCapacity>GHASH_DEF_SIZE && (100*fCount)<=(GHASH_MIN_LOAD*fCapacity)) Resize(fCount);
   return removed;
   }
 
 
 // Find entry
 template <class OBJ> bool GHash<OBJ>::hasKey(const char* ky) {
-  int p,x,h,n;
   if(!ky){ GError("GHash::find: NULL key argument.\n"); }
-  if(0<fCount){
-    h=GSTR_HASH(ky);
-    GASSERT(0<=h);
-    p=HASH1(h,fCapacity);
-    GASSERT(0<=p && p<fCapacity);
-    x=HASH2(h,fCapacity);
-    GASSERT(1<=x && x<fCapacity);
-    GASSERT(fCount<fCapacity);
-    n=fCapacity;
-    while(n && hash[p].hash!=-1){
-      if(hash[p].hash==h && strcmp(hash[p].key,ky)==0){
-        return true;
-        }
-      p=(p+x)%fCapacity;
-      n--;
-      }
-    }
-  return false;
+  if (fCount==0) return false;
+  uint klen;
+  uint h=keyHashLen(ky, klen);
+  return (findPos(ky, klen, h)>=0);
 }
 
+template <class OBJ> bool GHash<OBJ>::hasKeyN(const char* ky, int klen) {
+  if(!ky){ GError("GHash::find: NULL key argument.\n"); }
+  if (fCount==0) return false;
+  return (findPos(ky, klen, keyHash(ky, klen))>=0);
+}
 
 template <class OBJ> OBJ* GHash<OBJ>::Find(const char* ky, char** keyptr){
-  int p,x,h,n;
   if(!ky){ GError("GHash::find: NULL key argument.\n"); }
   if (fCount==0) return NULL;
-  h=GSTR_HASH(ky);
-  GASSERT(0<=h);
-  p=HASH1(h,fCapacity);
-  GASSERT(0<=p && p<fCapacity);
-  x=HASH2(h,fCapacity);
-  GASSERT(1<=x && x<fCapacity);
-  GASSERT(fCount<fCapacity);
-  n=fCapacity;
-#ifdef HASH_DBG_PRINT
-  int iterations=0;
-  int init_p=p;
-  int init_x=x;
-#endif
-  while(n && hash[p].hash!=-1){
-      if(hash[p].hash==h && strcmp(hash[p].key,ky)==0){
-        if (keyptr!=NULL) *keyptr = hash[p].key;
-#ifdef HASH_DBG_PRINT
-         GMessage("Found \t%s\t%d,%d,%d\t%d\t%d\t%d\n",
-             ky, h,init_p,init_x, iterations,  fCount, fCapacity);
-#endif
-        return (OBJ*)hash[p].data;
-        }
-      p=(p+x)%fCapacity;
-      n--;
-#ifdef HASH_DBG_PRINT
-      ++iterations;
-#endif
-  }
-#ifdef HASH_DBG_PRINT
-   GMessage("Nfound\t%s\t%d,%d,%d\t%d\t%d\t%d\n",
-       ky, h,init_p,init_x, iterations,  fCount, fCapacity);
-#endif
-  return NULL;
+  uint klen;
+  uint h=keyHashLen(ky, klen);
+  int p=findPos(ky, klen, h);
+  if (p<0) return NULL;
+  if (keyptr!=NULL) *keyptr = hash[p].key;
+  return (OBJ*)hash[p].data;
+ }
+
+template <class OBJ> OBJ* GHash<OBJ>::FindN(const char* ky, int klen, char** keyptr){
+  if(!ky){ GError("GHash::find: NULL key argument.\n"); }
+  if (fCount==0) return NULL;
+  int p=findPos(ky, klen, keyHash(ky, klen));
+  if (p<0) return NULL;
+  if (keyptr!=NULL) *keyptr = hash[p].key;
+  return (OBJ*)hash[p].data;
  }
 
 template <class OBJ> void GHash<OBJ>::startIterate() {// initialize a key iterator; call
@@ -545,7 +548,7 @@ template <class OBJ> void GHash<OBJ>::startIterate() {// initialize a key iterat
 
 template <class OBJ> char* GHash<OBJ>::NextKey() {
  int pos=fCurrentEntry;
- while (pos<fCapacity && hash[pos].hash<0) pos++;
+ while (pos<fCapacity && !isFull(pos)) pos++;
  if (pos==fCapacity) {
                  fCurrentEntry=fCapacity;
                  return NULL;
@@ -558,7 +561,7 @@ template <class OBJ> char* GHash<OBJ>::NextKey() {
 
 template <class OBJ> OBJ* GHash<OBJ>::NextData() {
  int pos=fCurrentEntry;
- while (pos<fCapacity && hash[pos].hash<0) pos++;
+ while (pos<fCapacity && !isFull(pos)) pos++;
  if (pos==fCapacity) {
                  fCurrentEntry=fCapacity;
                  return NULL;
@@ -572,7 +575,7 @@ template <class OBJ> OBJ* GHash<OBJ>::NextData() {
 
 template <class OBJ> OBJ* GHash<OBJ>::NextData(char* &nextkey) {
  int pos=fCurrentEntry;
- while (pos<fCapacity && hash[pos].hash<0) pos++;
+ while (pos<fCapacity && !isFull(pos)) pos++;
  if (pos==fCapacity) {
                  fCurrentEntry=fCapacity;
                  nextkey=NULL;
@@ -590,16 +593,14 @@ template <class OBJ> OBJ* GHash<OBJ>::NextData(char* &nextkey) {
 // Get first non-empty entry
 template <class OBJ> int GHash<OBJ>::First() const {
   int pos=0;
-  while(pos<fCapacity){ if(0<=hash[pos].hash) break; pos++; }
-  GASSERT(fCapacity<=pos || 0<=hash[pos].hash);
+  while(pos<fCapacity){ if(isFull(pos)) break; pos++; }
   return pos;
   }
 
 // Get last non-empty entry
 template <class OBJ> int GHash<OBJ>::Last() const {
   int pos=fCapacity-1;
-  while(0<=pos){ if(0<=hash[pos].hash) break; pos--; }
-  GASSERT(pos<0 || 0<=hash[pos].hash);
+  while(0<=pos){ if(isFull(pos)) break; pos--; }
   return pos;
   }
 
@@ -607,8 +608,7 @@ template <class OBJ> int GHash<OBJ>::Last() const {
 // Find next valid entry
 template <class OBJ> int GHash<OBJ>::Next(int pos) const {
   GASSERT(0<=pos && pos<fCapacity);
-  while(++pos <= fCapacity-1){ if(0<=hash[pos].hash) break; }
-  GASSERT(fCapacity<=pos || 0<=hash[pos].hash);
+  while(++pos <= fCapacity-1){ if(isFull(pos)) break; }
   return pos;
   }
 
@@ -616,78 +616,36 @@ template <class OBJ> int GHash<OBJ>::Next(int pos) const {
 // Find previous valid entry
 template <class OBJ> int GHash<OBJ>::Prev(int pos) const {
   GASSERT(0<=pos && pos<fCapacity);
-  while(--pos >= 0){ if(0<=hash[pos].hash) break; }
-  GASSERT(pos<0 || 0<=hash[pos].hash);
+  while(--pos >= 0){ if(isFull(pos)) break; }
   return pos;
   }
 
 
 // Remove all
 template <class OBJ> void GHash<OBJ>::Clear(){
-  int i;
-  for(i=0; i<fCapacity; i++){
-    if(hash[i].hash>=0){
+  for(int i=0; i<fCapacity; i++){
+    if(isFull(i)){
       if (hash[i].keyalloc) GFREE((hash[i].key));
       if (FREEDATA)
             (*fFreeProc)(hash[i].data);
       }
     }
   GFREE(hash);
-  GMALLOC(hash, sizeof(GHashEntry)*DEF_HASH_SIZE);
+  GFREE(ctrl);
   //reinitialize it
-  for (i=0; i<DEF_HASH_SIZE; i++)
-         hash[i].hash=-1; //this will be an indicator for 'empty' entries
-  fCapacity=DEF_HASH_SIZE;
-  fCount=0;
+  init(GHASH_DEF_SIZE);
   }
 
-
-// Save data
-/*
-void GHash::Save(Stream& store) const {
-  Object::save(store);
-  store << fCapacity;
-  store << fCount;
-  for(int i=0; i<fCapacity; i++){
-    store << hash[i].hash;
-    if(hash[i].hash>=0){
-      uint len=strlen(hash[i].key);
-      store << len;
-      store << hash[i].mark;
-      store.save(hash[i].key,len);
-      }
-    }
-  }
-
-
-// Load data
-void GHash::Load(Stream& store){
-  Object::load(store);
-  store >> fCapacity;
-  store >> fCount;
-  for(int i=0; i<fCapacity; i++){
-    store >> hash[i].hash;
-    if(hash[i].hash>=0){
-      uint len;
-      store >> len;
-      store >> hash[i].mark;
-      GMALLOC(hash[i].key,len+1);
-      store.load(hash[i].key,len);
-      hash[i].key[len]='\0';
-      }
-    }
-  }
-*/
-
 // Destroy table
 template <class OBJ> GHash<OBJ>::~GHash(){
   for(int i=0; i<fCapacity; i++){
-    if(hash[i].hash>=0){
+    if(isFull(i)){
       if (hash[i].keyalloc) GFREE((hash[i].key));
       if (FREEDATA) (*fFreeProc)(hash[i].data);
       }
     }
   GFREE(hash);
+  GFREE(ctrl);
   }
 
 class GStrSet:public GHash<int> {
@@ -1,6 +1,7 @@
 #ifndef _GHASHT_HH
 #define _GHASHT_HH
 #include "GBase.h"
+#include "GThreads.h"
 //----------------------------------------------
 //  Hash table templates based on Jeff Preshing's code
 // ---------------------------------------------
@@ -42,7 +43,7 @@ public:
 //public:
     void init(uint32 initialSize = 32);
     GHashT(uint32 initialSize = 32):m_cells(NULL),m_arraySize(0),
-       m_population(0),m_zeroUsed(false), m_zeroCell(), m_cur(NULL) { init(initialSize); }
+       m_population(0),m_zeroUsed(false), m_zeroCell(), m_cur(NULL), m_iterFirst(false) { init(initialSize); }
     ~GHashT() {  delete[] m_cells; }
     uint32 Count() { return m_population; }
     // Basic operations
@@ -61,10 +62,12 @@ public:
  //----------------------------------------------
  //protected:
     CELL* m_cur;
+    bool m_iterFirst; //NextCell() was not called yet after startIterate()
  //public:
+    //the first NextCell() call returns the first cell
     void startIterate() {
        m_cur = &m_zeroCell;
-       if (!m_zeroUsed) NextCell();
+       m_iterFirst = true;
     }
     CELL* NextCell();
 };
@@ -175,7 +178,6 @@ public:
 
   void Clear() {
 	if (doFreeItems) {
-		if (ghash.m_zeroUsed) delete ghash.m_zeroCell.value;
 		ghash.startIterate();
 		while (Cell* cell=ghash.NextCell()) {
 			delete cell->value;
@@ -227,7 +229,6 @@ public:
   }
 };
 
-
 // from code.google.com/p/smhasher/wiki/MurmurHash3
 inline uint32_t integerHash(uint32_t h)
 {
@@ -250,6 +251,205 @@ inline uint64_t integerHash(uint64_t k)
 	return k;
 }
 
+//----------------------------------------------
+//  Concurrent variant of GIntHashP, for registries shared by worker threads
+//  (e.g. genomic sequence id -> GenomicSeqData, interned name ids).
+//  Entries can only be added (insert-if-absent), never replaced or deleted
+//  (except by Clear(), which is not thread safe), so that Find() is lock-free:
+//  - Add() claims an empty cell with a CAS on its key, then publishes the value
+//    with a CAS on the value pointer; all the concurrent Add() calls for the
+//    same key return the value published first
+//  - when the table gets 75% full, the writer that notices it migrates the
+//    entries to a table twice as large: each old cell is sealed by setting the
+//    lowest bit of its value pointer, then the new table is published. Writers
+//    finding a sealed cell wait for the new table and retry, while readers
+//    just mask the seal bit, so they never wait for a migration.
+//  The old tables are kept until Clear() or destruction, as readers may still
+//  be probing them (at most as much memory as the current table).
+//  The values must be non-NULL pointers, aligned to at least 2 bytes.
+//----------------------------------------------
+template <class OBJ> class GConcIntHashP {
+  protected:
+	struct Cell {
+		uint32 key;
+		OBJ* value; //NULL while empty, lowest bit set once sealed
+	};
+	struct Table {
+		uint32 size;
+		Table* prev; //older (retired) table
+		Cell* cells;
+	};
+	Table* m_table;
+	uint32 m_population;
+	OBJ* m_zeroValue; //value for key 0
+	bool doFreeItems;
+	GFastMutex m_migrateLock;
+	// cursor for iteration
+	uint32 m_cur;
+	bool m_zeroIter;
+
+	static bool sealed(OBJ* v) { return ((uintptr_t)v & 1)!=0; }
+	static OBJ* unsealed(OBJ* v) { return (OBJ*)((uintptr_t)v & ~(uintptr_t)1); }
+	static Table* newTable(uint32 size) {
+		Table* t=NULL;
+		GMALLOC(t, sizeof(Table));
+		t->size=size;
+		t->prev=NULL;
+		t->cells=NULL;
+		GCALLOC(t->cells, size*sizeof(Cell));
+		return t;
+	}
+	void freeTables() {
+		Table* t=m_table;
+		while (t!=NULL) {
+			Table* p=t->prev;
+			GFREE(t->cells);
+			GFREE(t);
+			t=p;
+		}
+		m_table=NULL;
+	}
+	void init(uint32 initialSize) {
+		GASSERT((initialSize & (initialSize - 1)) == 0);  // Must be a power of 2
+		m_table=newTable(initialSize);
+		m_population=0;
+		m_zeroValue=NULL;
+		m_cur=0;
+		m_zeroIter=false;
+	}
+	//move the entries of table t into a new table, unless another thread
+	//already did it; returns after the new table is published
+	void migrate(Table* t) {
+		GLockGuard<GFastMutex> guard(m_migrateLock);
+		if (__atomic_load_n(&m_table, __ATOMIC_ACQUIRE)!=t) return;
+		uint32 newsize=t->size*2;
+		while (__atomic_load_n(&m_population, __ATOMIC_RELAXED)*4 >= newsize*3) newsize*=2;
+		Table* nt=newTable(newsize);
+		nt->prev=t;
+		uint32 mask=newsize-1;
+		for (uint32 i=0;i<t->size;i++) {
+			Cell& c=t->cells[i];
+			OBJ* v=__atomic_load_n(&c.value, __ATOMIC_ACQUIRE);
+			while (!__atomic_compare_exchange_n(&c.value, &v, (OBJ*)((uintptr_t)v | 1),
+					false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) ;
+			if (v==NULL) continue; //empty, or its key was claimed but not published
+			uint32 key=__atomic_load_n(&c.key, __ATOMIC_ACQUIRE);
+			for (uint32 j=integerHash(key) & mask;;j=(j+1) & mask) {
+				if (nt->cells[j].key==0) {
+					nt->cells[j].key=key;
+					nt->cells[j].value=v;
+					break;
+				}
+			}
+		}
+		__atomic_store_n(&m_table, nt, __ATOMIC_RELEASE);
+	}
+  public:
+	GConcIntHashP(bool freeItems=true, uint32 initialSize=32):m_table(NULL), m_population(0),
+			m_zeroValue(NULL), doFreeItems(freeItems), m_migrateLock(), m_cur(0), m_zeroIter(false) {
+		init(initialSize);
+	}
+	~GConcIntHashP() { Clear(); freeTables(); }
+	uint32 Count() { return __atomic_load_n(&m_population, __ATOMIC_RELAXED); }
+	uint32 Capacity() { return __atomic_load_n(&m_table, __ATOMIC_ACQUIRE)->size; }
+
+	//lock-free lookup, can run concurrently with Add() and table migrations
+	OBJ* Find(uint32 key) {
+		if (key==0) return __atomic_load_n(&m_zeroValue, __ATOMIC_ACQUIRE);
+		Table* t=__atomic_load_n(&m_table, __ATOMIC_ACQUIRE);
+		uint32 mask=t->size-1;
+		uint32 i=integerHash(key) & mask;
+		for (uint32 n=0;n<t->size;n++, i=(i+1) & mask) {
+			uint32 k=__atomic_load_n(&t->cells[i].key, __ATOMIC_ACQUIRE);
+			if (k==key) return unsealed(__atomic_load_n(&t->cells[i].value, __ATOMIC_ACQUIRE));
+			if (k==0) return NULL;
+		}
+		return NULL;
+	}
+	OBJ* operator[](const uint32 ky) { return Find(ky); }
+
+	//add val for key unless key is already present; returns the value stored
+	//for key, which is not val if another thread added key first (val is then
+	//left to the caller)
+	OBJ* Add(uint32 key, OBJ* val) {
+		if (val==NULL || sealed(val))
+			GError("Error: GConcIntHashP values must be non-NULL, 2-byte aligned pointers!\n");
+		if (key==0) {
+			OBJ* v=NULL;
+			if (__atomic_compare_exchange_n(&m_zeroValue, &v, val, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+				__atomic_add_fetch(&m_population, 1, __ATOMIC_RELAXED);
+				return val;
+			}
+			return v;
+		}
+		for (;;) {
+			Table* t=__atomic_load_n(&m_table, __ATOMIC_ACQUIRE);
+			uint32 mask=t->size-1;
+			uint32 i=integerHash(key) & mask;
+			for (uint32 n=0;n<t->size;n++, i=(i+1) & mask) {
+				Cell& c=t->cells[i];
+				uint32 k=__atomic_load_n(&c.key, __ATOMIC_ACQUIRE);
+				if (k==0) {
+					if ((__atomic_load_n(&m_population, __ATOMIC_RELAXED)+1)*4 >= t->size*3)
+						break; //time to resize
+					if (!__atomic_compare_exchange_n(&c.key, &k, key, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+							&& k!=key) continue; //claimed by another key
+				}
+				else if (k!=key) continue;
+				//cell c is ours, or it belongs to another Add() for the same key
+				OBJ* v=NULL;
+				if (__atomic_compare_exchange_n(&c.value, &v, val, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+					__atomic_add_fetch(&m_population, 1, __ATOMIC_RELAXED);
+					return val;
+				}
+				if (v==(OBJ*)1) break; //sealed before any value was published
+				return unsealed(v);
+			}
+			//table too full, or sealed: retry after the migration
+			migrate(t);
+		}
+	}
+
+	//the following are not thread safe
+	void Clear() {
+		Table* t=m_table;
+		if (doFreeItems) {
+			delete m_zeroValue;
+			for (uint32 i=0;i<t->size;i++)
+				if (t->cells[i].value!=NULL) delete unsealed(t->cells[i].value);
+		}
+		uint32 sz=t->size;
+		freeTables();
+		init(sz<32 ? sz : 32);
+	}
+	void startIterate() {
+		m_cur=0;
+		m_zeroIter=(m_zeroValue!=NULL);
+	}
+	OBJ* Next(uint32& nextky) {
+		if (m_zeroIter) {
+			m_zeroIter=false;
+			nextky=0;
+			return m_zeroValue;
+		}
+		Table* t=m_table;
+		while (m_cur<t->size) {
+			Cell& c=t->cells[m_cur++];
+			OBJ* v=unsealed(c.value);
+			if (v!=NULL) {
+				nextky=c.key;
+				return v;
+			}
+		}
+		nextky=0;
+		return NULL;
+	}
+	OBJ* NextValue() {
+		uint32 k;
+		return Next(k);
+	}
+};
+
 #define GIHASH_FIRST_CELL(hash) (m_cells + ((hash) & (m_arraySize - 1)))
 #define GIHASH_CIRCULAR_NEXT(c) ((c) + 1 != m_cells + m_arraySize ? (c) + 1 : m_cells)
 #define GIHASH_CIRCULAR_OFFSET(a, b) ((b) >= (a) ? (b) - (a) : m_arraySize + (b) - (a))
@@ -411,6 +611,10 @@ template <typename OBJ, typename CELL> void GHashT<OBJ,CELL>::Resize(uint32 desi
 template <typename OBJ, typename CELL> CELL* GHashT<OBJ,CELL>::NextCell() {
     // Already finished?
     if (!m_cur) return m_cur;
+    if (m_iterFirst) {
+      m_iterFirst=false;
+      if (m_zeroUsed) return m_cur;
+    }
     // Iterate past zero cell
     if (m_cur == &m_zeroCell) m_cur = & (m_cells[-1]);
     // Iterate through the regular cells
@@ -0,0 +1,173 @@
+//---------------------------------------------------------------------------
+/*
+Augmented interval tree of object pointers
+ OBJ must expose uint start and uint end members (like GSeg)
+ implemented as a treap keyed by (start, object address), each node
+ keeping the maximum end coordinate of its subtree so overlap queries
+ are O(log n + k); nodes are stored in a GVec and recycled on removal
+*/
+#ifndef _GIntervalTree_HH
+#define _GIntervalTree_HH
+
+#include "GVec.hh"
+
+template <class OBJ> class GIntervalTree {
+  protected:
+    struct GITNode {
+      OBJ* item;
+      uint start; //item->start at insertion time (the key)
+      uint end;
+      uint maxend; //maximum end coordinate in this subtree
+      uint prio;
+      int left;
+      int right;
+    };
+    GVec<GITNode> nodes; //node pool
+    GVec<int> freeNodes; //indexes of recycled nodes
+    int root;
+    int fCount;
+    uint rseed; //xorshift state for node priorities (deterministic)
+
+    uint nextPrio() {
+      rseed^=rseed<<13;
+      rseed^=rseed>>17;
+      rseed^=rseed<<5;
+      return rseed;
+    }
+    bool keyLess(uint s1, OBJ* o1, uint s2, OBJ* o2) {
+      return (s1==s2) ? ((char*)o1<(char*)o2) : (s1<s2);
+    }
+    void update(int t) {
+      GITNode& n=nodes[t];
+      n.maxend=n.end;
+      if (n.left>=0 && nodes[n.left].maxend>n.maxend) n.maxend=nodes[n.left].maxend;
+      if (n.right>=0 && nodes[n.right].maxend>n.maxend) n.maxend=nodes[n.right].maxend;
+    }
+    int rotateRight(int t) {
+      int l=nodes[t].left;
+      nodes[t].left=nodes[l].right;
+      nodes[l].right=t;
+      update(t);
+      update(l);
+      return l;
+    }
+    int rotateLeft(int t) {
+      int r=nodes[t].right;
+      nodes[t].right=nodes[r].left;
+      nodes[r].left=t;
+      update(t);
+      update(r);
+      return r;
+    }
+    int insertNode(int t, int n) {
+      if (t<0) return n;
+      if (keyLess(nodes[n].start, nodes[n].item, nodes[t].start, nodes[t].item)) {
+        nodes[t].left=insertNode(nodes[t].left, n);
+        if (nodes[nodes[t].left].prio>nodes[t].prio) t=rotateRight(t);
+      }
+      else {
+        nodes[t].right=insertNode(nodes[t].right, n);
+        if (nodes[nodes[t].right].prio>nodes[t].prio) t=rotateLeft(t);
+      }
+      update(t);
+      return t;
+    }
+    int removeNode(int t, uint start, OBJ* item, bool& found) {
+      if (t<0) return t;
+      GITNode& n=nodes[t];
+      if (n.item==item) {
+        found=true;
+        if (n.left<0 || n.right<0) {
+          int c=(n.left<0) ? n.right : n.left;
+          n.item=NULL;
+          freeNodes.Add(t);
+          return c;
+        }
+        //rotate the higher priority child up, then keep sinking t
+        if (nodes[n.left].prio>nodes[n.right].prio) {
+          int r=rotateRight(t);
+          nodes[r].right=removeNode(nodes[r].right, start, item, found);
+          update(r);
+          return r;
+        }
+        int r=rotateLeft(t);
+        nodes[r].left=removeNode(nodes[r].left, start, item, found);
+        update(r);
+        return r;
+      }
+      if (keyLess(start, item, n.start, n.item))
+        nodes[t].left=removeNode(nodes[t].left, start, item, found);
+      else
+        nodes[t].right=removeNode(nodes[t].right, start, item, found);
+      update(t);
+      return t;
+    }
+    void findOvl(int t, uint s, uint e, GPVec<OBJ>& result) {
+      while (t>=0) {
+        GITNode& n=nodes[t];
+        if (n.maxend<s) return; //nothing in this subtree reaches s
+        findOvl(n.left, s, e, result);
+        if (n.start>e) return; //right subtree starts even higher
+        if (n.end>=s) result.Add(n.item);
+        t=n.right;
+      }
+    }
+    void collect(int t, GPVec<OBJ>& result) {
+      while (t>=0) {
+        collect(nodes[t].left, result);
+        result.Add(nodes[t].item);
+        t=nodes[t].right;
+      }
+    }
+  public:
+    GIntervalTree(int init_capacity=16):nodes(init_capacity), freeNodes(4),
+          root(-1), fCount(0), rseed(2463534242u) { }
+    int Count() { return fCount; }
+    void Clear() {
+      nodes.Clear();
+      freeNodes.Clear();
+      root=-1;
+      fCount=0;
+    }
+    //add an object using its current start-end coordinates;
+    //the coordinates of an object must not change while it is in the tree
+    //(Remove() it first, update it, then Add() it back)
+    void Add(OBJ* item) {
+      GITNode n;
+      n.item=item;
+      n.start=item->start;
+      n.end=item->end;
+      n.maxend=item->end;
+      n.prio=nextPrio();
+      n.left=-1;
+      n.right=-1;
+      int idx;
+      if (freeNodes.Count()>0) {
+        idx=freeNodes.Pop();
+        nodes[idx]=n;
+      }
+      else idx=nodes.Add(n);
+      root=insertNode(root, idx);
+      fCount++;
+    }
+    bool Remove(OBJ* item) {
+      bool found=false;
+      root=removeNode(root, item->start, item, found);
+      if (found) fCount--;
+      return found;
+    }
+    //append to result all the objects overlapping the s..e interval
+    //(in no particular order)
+    int findOverlaps(uint s, uint e, GPVec<OBJ>& result) {
+      int c=result.Count();
+      if (s>e) Gswap(s,e);
+      findOvl(root, s, e, result);
+      return result.Count()-c;
+    }
+    //append all the objects, ordered by start coordinate
+    void getAll(GPVec<OBJ>& result) {
+      collect(root, result);
+    }
+};
+
+#endif
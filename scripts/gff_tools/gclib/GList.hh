@@ -21,6 +21,7 @@ Sortable collections of objects and object pointers
 template <class OBJ> class GArray:public GVec<OBJ> {
   protected:
     bool fUnique;
+    bool fBulk; //bulk loading: Add() appends, the sorting is done by endBulk()
     static int DefaultCompareProc(const pointer item1, const pointer item2) {
       //operator< MUST be defined for OBJ class!
       if (*((OBJ*)item2) < *((OBJ*)item1)) return 1;
@@ -59,6 +60,12 @@ template <class OBJ> class GArray:public GVec<OBJ> {
     void setUnique(bool beUnique) { fUnique = beUnique; };
     void Sort(); //explicit sort may be requested
     bool Sorted() { return fCompareProc!=NULL; }
+    //bulk loading of a sorted array: until endBulk() is called, Add() simply
+    //appends (no binary search and no insertion), then endBulk() sorts
+    //the array once (stable sort) and drops the duplicates if fUnique
+    void beginBulk() { fBulk=true; }
+    void endBulk();
+    bool inBulk() { return fBulk; }
     void Replace(int idx, OBJ& item); //Put, use operator= to copy
     int  Unique() { return fUnique; }
     int IndexOf(OBJ& item);
@@ -77,6 +84,7 @@ template <class OBJ> class GArray:public GVec<OBJ> {
 template <class OBJ> class GList:public GPVec<OBJ> {
   protected:
     bool fUnique;
+    bool fBulk; //bulk loading: Add() appends, the sorting is done by endBulk()
     GCompareProc* fCompareProc; //a pointer to a Compare function
 
     static int DefaultCompareProc(const pointer item1, const pointer item2) {
@@ -142,6 +150,15 @@ template <class OBJ> class GList:public GPVec<OBJ> {
     bool Exists(OBJ* item); //same as above without existing index info
     bool Exists(OBJ& item); //same as above without existing index info
     void Sort(); //explicit sort may be requested using this function
+    //bulk loading of a sorted list: until endBulk() is called, Add() simply
+    //appends (no binary search and no memmove), Found() and the index returned
+    //by Add() are only valid for the unsorted content; endBulk() sorts the list
+    //once (stable sort, equal items keep their order of addition) and, if fUnique,
+    //drops the items equal to an earlier one (without freeing them, so the
+    //caller must keep track of possible duplicates, as with a regular Add())
+    void beginBulk() { fBulk=true; }
+    void endBulk();
+    bool inBulk() { return fBulk; }
     int Remove(OBJ* item); //search for pointer, using binary search if sorted
     void Insert(int idx, OBJ* item); //unsorted only, place item at position idx
     void Move(int curidx, int newidx);
@@ -161,6 +178,7 @@ template <class OBJ> GArray<OBJ>::GArray(GArray<OBJ>& array):GVec<OBJ>(0) { //co
     }
  this->fCount=array.fCount;
  fUnique=array.fUnique;
+ fBulk=false;
  fCompareProc=array.fCompareProc;
  // uses OBJ operator=
  for (int i=0;i<this->fCount;i++) this->fArray[i]=array[i];
@@ -171,6 +189,7 @@ template <class OBJ> const GArray<OBJ>& GArray<OBJ>::operator=(GArray<OBJ>& arra
  GVec<OBJ>::Clear();
  this->fCount=array.fCount;
  this->fUnique=array.fUnique;
+ this->fBulk=false;
  this->fCapacity=array.fCapacity;
  if (this->fCapacity>0) {
     //GMALLOC(this->fArray, this->fCapacity*sizeof(OBJ));
@@ -188,16 +207,19 @@ template <class OBJ> const GArray<OBJ>& GArray<OBJ>::operator=(GArray<OBJ>& arra
 template <class OBJ> GArray<OBJ>::GArray(GCompareProc* cmpFunc):GVec<OBJ>(0) {
   fCompareProc = cmpFunc;
   fUnique = false; //only affects sorted lists
+  fBulk = false;
 }
 
 template <class OBJ> GArray<OBJ>::GArray(bool sorted, bool unique):GVec<OBJ>(0) {
   fUnique=unique;
+  fBulk=false;
   fCompareProc = sorted ? DefaultCompareProc : NULL;
 }
 
 template <class OBJ> GArray<OBJ>::GArray(int init_capacity,
                         bool sorted, bool unique):GVec<OBJ>(init_capacity) {
   fUnique=unique;
+  fBulk=false;
   fCompareProc=sorted ? DefaultCompareProc : NULL;
 }
 
@@ -224,14 +246,14 @@ template <class OBJ> bool GArray<OBJ>::Exists(OBJ& item) {
 template <class OBJ> int GArray<OBJ>::Add(OBJ* item) {
  if (item==NULL) return -1;
  int result;
- if (SORTED) {
+ if (SORTED && !fBulk) {
    if (Found(*item, result))
       if (fUnique) return -1; //cannot add a duplicate!
    //Found sets result to the position where the item should be!
    GVec<OBJ>::Insert(result, *item);
    }
   else {
-   if (fUnique && Found(*item,result)) return -1; //set behaviour
+   if (fUnique && UNSORTED && Found(*item,result)) return -1; //set behaviour
    result = this->fCount;
    if (result==this->fCapacity) GVec<OBJ>::Grow();
    this->fArray[result] = *item; //operator=, copies the item
@@ -263,6 +285,15 @@ template <class OBJ> bool GArray<OBJ>::Found(OBJ& item, int& idx) {
  int i;
  idx=-1;
  if (this->fCount==0) { idx=0;return false;}
+ if (SORTED && fBulk) { //not sorted yet: linear search with fCompareProc
+   for (i=0;i<this->fCount;i++)
+      if ((*fCompareProc)(&(this->fArray[i]), &item)==0) {
+         idx=i;
+         return true;
+         }
+   idx=this->fCount;
+   return false;
+   }
  if (SORTED) { //binary search based on fCompareProc
    //do the simplest tests first:
    if ((*fCompareProc)(&(this->fArray[0]),&item)>0) {
@@ -332,15 +363,32 @@ template <class OBJ> void GArray<OBJ>::Replace(int idx, OBJ& item) {
 
 template <class OBJ> void GArray<OBJ>::Sort() {
  if (fCompareProc==NULL) { fCompareProc=DefaultCompareProc; }
+ if (fBulk) return; //done by endBulk()
  if (this->fArray!=NULL && this->fCount>0)
      this->qSort(0, this->fCount-1, fCompareProc);
 }
 
+template <class OBJ> void GArray<OBJ>::endBulk() {
+ if (!fBulk) return;
+ fBulk=false;
+ if (UNSORTED || this->fCount<2) return;
+ this->StableSort(fCompareProc);
+ if (!fUnique) return;
+ int j=1;
+ for (int i=1;i<this->fCount;i++) {
+    if ((*fCompareProc)(&(this->fArray[j-1]), &(this->fArray[i]))==0) continue;
+    if (i!=j) this->fArray[j]=this->fArray[i];
+    j++;
+    }
+ this->setCount(j);
+}
+
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 //*=> GList implementation -- sortable array of pointers to OBJ
 
 template <class OBJ> GList<OBJ>::GList(GList<OBJ>& list):GPVec<OBJ>(list) { //copy constructor
  fUnique=list.fUnique;
+ fBulk=false;
  fCompareProc=list.fCompareProc;
 }
 
@@ -351,6 +399,7 @@ template <class OBJ> GList<OBJ>::GList(GList<OBJ>* plist):GPVec<OBJ>(0) { //anot
      GMALLOC(this->fList, this->fCapacity*sizeof(OBJ*));
  }
  fUnique=plist->fUnique;
+ fBulk=false;
  fCompareProc=plist->fCompareProc;
  this->fFreeProc=plist->fFreeProc;
  this->fCount=plist->fCount;
@@ -376,16 +425,19 @@ template <class OBJ> GList<OBJ>::GList(GCompareProc* compareProc,
   fCompareProc = compareProc;
   this->fFreeProc    = freeProc;
   fUnique = beUnique; //only affects sorted lists
+  fBulk = false;
 }
 
 template <class OBJ> GList<OBJ>::GList(GCompareProc* compareProc) {
   fCompareProc = compareProc;
   this->fFreeProc = GPVec<OBJ>::DefaultFreeProc;
   fUnique = false; //only affects sorted lists
+  fBulk = false;
 }
 
 template <class OBJ> GList<OBJ>::GList(bool sorted,
     bool free_elements, bool beUnique) {
+  fBulk=false;
   if (sorted) {
      if (free_elements) {
         fCompareProc=&DefaultCompareProc;
@@ -415,6 +467,7 @@ template <class OBJ> GList<OBJ>::GList(bool sorted,
 
 template <class OBJ> GList<OBJ>::GList(int init_capacity, bool sorted,
     bool free_elements, bool beUnique):GPVec<OBJ>(init_capacity, free_elements) {
+  fBulk=false;
   if (sorted) {
       fCompareProc=&DefaultCompareProc;
       fUnique=beUnique;
@@ -465,14 +518,14 @@ template <class OBJ> bool GList<OBJ>::Exists(OBJ* item) {
 template <class OBJ> int GList<OBJ>::Add(OBJ* item) {
  int result;
  if (item==NULL) return -1;
- if (SORTED) {
+ if (SORTED && !fBulk) {
    if (Found(item, result))
       if (fUnique) return -1; //duplicates forbidden
    //Found sets result to the position where the item should be!
    sortInsert(result, item);
    }
   else {
-   if (fUnique && Found(item,result)) return -1; //set behaviour
+   if (fUnique && UNSORTED && Found(item,result)) return -1; //set behaviour
    result = this->fCount;
    if (result==this->fCapacity) GPVec<OBJ>::Grow();
    this->fList[result]=item;
@@ -495,7 +548,7 @@ template <class OBJ> OBJ* GList<OBJ>::AddIfNew(OBJ* item,
     return this->fList[r]; //found
     }
  //not found:
- if (SORTED) {
+ if (SORTED && !fBulk) {
    //Found() set result to the position where the item should be inserted:
    sortInsert(r, item);
    }
@@ -520,7 +573,7 @@ template <class OBJ> int GList<OBJ>::AddedIfNew(OBJ* item) {
     return -1;
     }
  //not found:
- if (SORTED) {
+ if (SORTED && !fBulk) {
    //Found() set r to the position where the item should be inserted:
    sortInsert(r, item);
    }
@@ -542,6 +595,15 @@ template <class OBJ> bool GList<OBJ>::Found(OBJ* item, int& idx) {
  int i;
  idx=-1;
  if (this->fCount==0) { idx=0;return false;}
+ if (SORTED && fBulk) { //not sorted yet: linear search with fCompareProc
+   for (i=0;i<this->fCount;i++)
+      if ((*fCompareProc)(this->fList[i], item)==0) {
+         idx=i;
+         return true;
+         }
+   idx=this->fCount;
+   return false;
+   }
  if (SORTED) { //binary search based on fCompareProc
    //do the simple test first:
 
@@ -631,9 +693,26 @@ template <class OBJ> int GList<OBJ>::Remove(OBJ* item) {
 
 template <class OBJ> void GList<OBJ>::Sort() {
  if (fCompareProc==NULL) fCompareProc = DefaultCompareProc;
+ if (fBulk) return; //done by endBulk()
  if (this->fList!=NULL && this->fCount>0)
      this->qSort(0, this->fCount-1, fCompareProc);
 }
 
+template <class OBJ> void GList<OBJ>::endBulk() {
+ if (!fBulk) return;
+ fBulk=false;
+ if (UNSORTED || this->fCount<2) return;
+ this->StableSort(fCompareProc);
+ if (!fUnique) return;
+ int j=1;
+ for (int i=1;i<this->fCount;i++) {
+    //duplicates are dropped like the ones rejected by a non-bulk Add()
+    if ((*fCompareProc)(this->fList[j-1], this->fList[i])==0) continue;
+    this->fList[j++]=this->fList[i];
+    }
+ for (int i=j;i<this->fCount;i++) this->fList[i]=NULL;
+ this->fCount=j;
+}
+
 //---------------------------------------------------------------------------
 #endif
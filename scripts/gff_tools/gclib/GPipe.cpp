@@ -0,0 +1,252 @@
+#include "GPipe.h"
+
+void GDataBlock::grow(int newcap) {
+  GREALLOC(data, newcap+1);
+  cap=newcap;
+}
+
+//------------------------------------------------------------------------------
+// GBlockPool
+//------------------------------------------------------------------------------
+
+GBlockPool::GBlockPool(int nblocks, int bsize):blocks(NULL), numBlocks(nblocks),
+    blockSize(bsize), freeBlocks(nblocks) {
+  if (numBlocks<2) numBlocks=2;
+  if (blockSize<1024) blockSize=1024;
+  blocks=new GDataBlock[numBlocks];
+  for (int i=0;i<numBlocks;i++) {
+    blocks[i].grow(blockSize);
+    freeBlocks.push(&blocks[i]);
+  }
+}
+
+GBlockPool::~GBlockPool() {
+  for (int i=0;i<numBlocks;i++) GFREE(blocks[i].data);
+  delete[] blocks;
+}
+
+void GPipeStats::print(FILE* f, const char* name) {
+  double secs=busyNs/1e9;
+  double mb=bytes/1048576.0;
+  fprintf(f, "  %-16s %llu blocks, %.1f MB in %.3f s (%.1f MB/s), waited %.3f s for blocks\n",
+      name, (unsigned long long)blocks, mb, secs, secs>0 ? mb/secs : 0.0, waitNs/1e9);
+}
+
+//------------------------------------------------------------------------------
+// GLinePipe
+//------------------------------------------------------------------------------
+
+GLinePipe::GLinePipe(FILE* f, int nblocks, int bsize):file(f), pool(nblocks, bsize),
+    full(nblocks), reader(), started(false), stopping(0), cur(NULL), curpos(0),
+    numLines(0), rstats() {
+}
+
+GLinePipe::~GLinePipe() {
+  if (!started) return;
+  //the consumer may quit before the end of the input: recycle the blocks
+  //until the reader thread notices and closes the queue
+  __atomic_store_n(&stopping, 1, __ATOMIC_RELEASE);
+  if (cur!=NULL) pool.put(cur);
+  GDataBlock* b=NULL;
+  while (full.pop(b)) pool.put(b);
+  reader.join();
+}
+
+void GLinePipe::start() {
+  if (started) return;
+  started=true;
+  reader.kickStart(readerMain, (void*) this);
+}
+
+void GLinePipe::readerMain(void* p) {
+  ((GLinePipe*)p)->readBlocks();
+}
+
+void GLinePipe::readBlocks() {
+  GTrace::setThreadName("input reader");
+  uint64 t0=gthreads_clock_ns();
+  GDataBlock* b=pool.get();
+  rstats.waitNs+=gthreads_clock_ns()-t0;
+  //each block ends after its last '\n', the rest of the data read is
+  //moved to the start of the next block
+  while (!__atomic_load_n(&stopping, __ATOMIC_ACQUIRE)) {
+    size_t toread=b->cap-b->len;
+    t0=gthreads_clock_ns();
+    size_t n=fread(b->data+b->len, 1, toread, file);
+    uint64 t1=gthreads_clock_ns();
+    rstats.busyNs+=t1-t0;
+    if (GTrace::enabled) GTrace::addSpan("read block", "io", t0, t1);
+    b->len+=n;
+    if (n<toread) { //end of file (or read error)
+      if (ferror(file)) GError("Error reading input file!\n");
+      break;
+    }
+    int cut=b->len;
+    while (cut>0 && b->data[cut-1]!='\n') cut--;
+    if (cut==0) { //line longer than the block
+      b->grow(b->cap*2);
+      continue;
+    }
+    t0=gthreads_clock_ns();
+    GDataBlock* nb=pool.get();
+    rstats.waitNs+=gthreads_clock_ns()-t0;
+    nb->len=b->len-cut;
+    if (nb->len>nb->cap) nb->grow(b->cap);
+    memcpy(nb->data, b->data+cut, nb->len);
+    nb->fpos=b->fpos+cut;
+    b->len=cut;
+    b->data[cut]=0;
+    rstats.blocks++;
+    rstats.bytes+=cut;
+    full.push(b);
+    b=nb;
+  }
+  if (b->len>0 && !__atomic_load_n(&stopping, __ATOMIC_ACQUIRE)) {
+    b->data[b->len]=0;
+    rstats.blocks++;
+    rstats.bytes+=b->len;
+    full.push(b);
+  }
+  else pool.put(b);
+  full.close();
+}
+
+char* GLinePipe::getLine(int& linelen, off_t& fpos) {
+  while (true) {
+    if (cur==NULL) {
+      if (!full.pop(cur)) return NULL;
+      curpos=0;
+    }
+    if (curpos<cur->len) {
+      char* s=cur->data+curpos;
+      char* end=cur->data+cur->len;
+      char* p=s;
+      while (p<end && *p!='\n' && *p!='\r') p++;
+      linelen=p-s;
+      int eol=0;
+      if (p<end) {
+        eol=(*p=='\r' && p+1<end && p[1]=='\n') ? 2 : 1;
+        *p=0;
+      }
+      curpos+=linelen+eol;
+      fpos=cur->fpos+curpos;
+      numLines++;
+      return s;
+    }
+    pool.put(cur);
+    cur=NULL;
+  }
+}
+
+void GLinePipe::printStats(FILE* f, const char* name) {
+  rstats.print(f, name);
+  GQueueStats qs=full.getStats();
+  qs.print(f, name);
+}
+
+//------------------------------------------------------------------------------
+// GOutPipe
+//------------------------------------------------------------------------------
+
+GOutPipe::GOutPipe(FILE* f, bool closeFile, GBlockPool* blockPool, int nblocks, int bsize):
+    dest(f), closeDest(closeFile), fh(f), pool(blockPool), ownPool(false),
+    full(blockPool!=NULL ? blockPool->count() : nblocks), writer(), cur(NULL),
+    finished(true), wstats() {
+  if (!supported()) return;
+#if defined(__GLIBC__)
+  if (pool==NULL) {
+    pool=new GBlockPool(nblocks, bsize);
+    ownPool=true;
+  }
+  cookie_io_functions_t iofuncs;
+  memset(&iofuncs, 0, sizeof(iofuncs));
+  iofuncs.write=cookieWrite;
+  iofuncs.close=cookieClose;
+  FILE* cf=fopencookie(this, "w", iofuncs);
+  if (cf==NULL) return;
+  fh=cf;
+  finished=false;
+  writer.kickStart(writerMain, (void*) this);
+#endif
+}
+
+GOutPipe::~GOutPipe() {
+  close();
+  if (ownPool) delete pool;
+}
+
+bool GOutPipe::supported() {
+#if defined(__GLIBC__)
+  return true;
+#else
+  return false;
+#endif
+}
+
+ssize_t GOutPipe::cookieWrite(void* c, const char* buf, size_t size) {
+  GOutPipe& p=*(GOutPipe*)c;
+  size_t left=size;
+  while (left>0) {
+    if (p.cur==NULL) p.cur=p.pool->get();
+    size_t n=p.cur->cap-p.cur->len;
+    if (n>left) n=left;
+    memcpy(p.cur->data+p.cur->len, buf, n);
+    p.cur->len+=n;
+    buf+=n;
+    left-=n;
+    if (p.cur->len==p.cur->cap) {
+      p.full.push(p.cur);
+      p.cur=NULL;
+    }
+  }
+  return size;
+}
+
+int GOutPipe::cookieClose(void* c) {
+  ((GOutPipe*)c)->finish();
+  return 0;
+}
+
+void GOutPipe::finish() {
+  if (cur!=NULL) {
+    if (cur->len>0) full.push(cur);
+    else pool->put(cur);
+    cur=NULL;
+  }
+  full.close();
+  writer.join();
+  if (closeDest) fclose(dest);
+  else fflush(dest);
+  fh=NULL;
+  finished=true;
+}
+
+void GOutPipe::writerMain(void* p) {
+  ((GOutPipe*)p)->writeBlocks();
+}
+
+void GOutPipe::writeBlocks() {
+  GTrace::setThreadName("output writer");
+  GDataBlock* b=NULL;
+  while (true) {
+    uint64 t0=gthreads_clock_ns();
+    bool more=full.pop(b);
+    wstats.waitNs+=gthreads_clock_ns()-t0;
+    if (!more) break;
+    t0=gthreads_clock_ns();
+    if (fwrite(b->data, 1, b->len, dest)<(size_t)b->len)
+      GError("Error writing output file!\n");
+    uint64 t1=gthreads_clock_ns();
+    wstats.busyNs+=t1-t0;
+    if (GTrace::enabled) GTrace::addSpan("write block", "io", t0, t1);
+    wstats.blocks++;
+    wstats.bytes+=b->len;
+    pool->put(b);
+  }
+}
+
+void GOutPipe::printStats(FILE* f, const char* name) {
+  wstats.print(f, name);
+  GQueueStats qs=full.getStats();
+  qs.print(f, name);
+}
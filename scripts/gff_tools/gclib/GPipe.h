@@ -0,0 +1,117 @@
+#ifndef _GPIPE_H
+#define _GPIPE_H
+/*
+ Block based I/O stages for pipelined text processing, running in their own
+ threads and connected to the rest of the program by bounded queues:
+  GLinePipe: a reader thread reads the input file in large blocks,
+             cut at line ends; the consumer (e.g. GffReader) takes the
+             lines out of these blocks
+  GOutPipe : the output written by the program to a stdio stream is
+             collected in blocks which a writer thread writes to the file
+ The blocks come from a GBlockPool with a fixed number of blocks, so a
+ stage which is too fast has to wait for the others instead of buffering
+ more data (backpressure); this caps the memory used by a pipeline.
+*/
+#include "GBase.h"
+#include "GThreads.h"
+#include "GQueue.hh"
+#include "GTrace.h"
+
+struct GDataBlock {
+  char* data; //cap+1 bytes allocated, room for a terminating '\0'
+  int len; //bytes used
+  int cap;
+  off_t fpos; //file offset of data[0] (input blocks)
+  GDataBlock():data(NULL), len(0), cap(0), fpos(0) { }
+  void grow(int newcap);
+};
+
+//fixed set of blocks shared by the stages using them;
+//get() waits while all the blocks are in use
+class GBlockPool {
+  GDataBlock* blocks;
+  int numBlocks;
+  int blockSize;
+  GMPMCQueue<GDataBlock*> freeBlocks;
+ public:
+  GBlockPool(int nblocks=16, int bsize=256*1024);
+  ~GBlockPool();
+  GDataBlock* get() {
+    GDataBlock* b=NULL;
+    freeBlocks.pop(b);
+    b->len=0;
+    b->fpos=0;
+    return b;
+  }
+  void put(GDataBlock* b) { freeBlocks.push(b); }
+  int count() { return numBlocks; }
+  int size() { return blockSize; }
+  GQueueStats getStats() { return freeBlocks.getStats(); }
+};
+
+//throughput counters of an I/O stage
+struct GPipeStats {
+  uint64 blocks;
+  uint64 bytes;
+  uint64 busyNs; //time spent in fread()/fwrite()
+  uint64 waitNs; //time spent waiting for blocks
+  GPipeStats():blocks(0), bytes(0), busyNs(0), waitNs(0) { }
+  void print(FILE* f, const char* name);
+};
+
+class GLinePipe {
+  FILE* file;
+  GBlockPool pool; //only used by this pipe
+  GSPSCQueue<GDataBlock*> full; //blocks read, in file order
+  GThread reader;
+  bool started;
+  int stopping; //set when the consumer quits early
+  GDataBlock* cur; //block being split into lines
+  int curpos; //start of the next line in cur
+  uint64 numLines;
+  GPipeStats rstats; //reader thread
+  static void readerMain(void* p);
+  void readBlocks();
+ public:
+  GLinePipe(FILE* f, int nblocks=8, int bsize=1024*1024);
+  ~GLinePipe();
+  void start(); //start the reader thread
+  //returns the next line (without the line terminator) or NULL at the end
+  //of the input, like fgetline(); fpos is set to the file offset after the
+  //line; the line is valid until the next call
+  char* getLine(int& linelen, off_t& fpos);
+  uint64 lineCount() { return numLines; }
+  void printStats(FILE* f, const char* name="reader");
+};
+
+class GOutPipe {
+  FILE* dest;
+  bool closeDest; //fclose(dest) when done, otherwise just fflush()
+  FILE* fh; //stream written by the program
+  GBlockPool* pool;
+  bool ownPool;
+  GSPSCQueue<GDataBlock*> full; //blocks to write, in order
+  GThread writer;
+  GDataBlock* cur; //block being filled
+  bool finished;
+  GPipeStats wstats; //writer thread
+  static void writerMain(void* p);
+  static ssize_t cookieWrite(void* c, const char* buf, size_t size);
+  static int cookieClose(void* c);
+  void writeBlocks();
+  void finish();
+ public:
+  //blockPool can be shared by several output pipes; it should have at
+  //least 2 blocks for each of them
+  GOutPipe(FILE* f, bool closeFile, GBlockPool* blockPool=NULL, int nblocks=8,
+      int bsize=256*1024);
+  ~GOutPipe(); //calls close()
+  //the stream to write to; fclose(file()) flushes everything and waits
+  //for the writer thread (it is dest itself if not supported)
+  FILE* file() { return fh; }
+  void close() { if (!finished) fclose(fh); }
+  static bool supported(); //stdio streams with custom I/O (glibc)
+  void printStats(FILE* f, const char* name="writer");
+};
+
+#endif
@@ -0,0 +1,233 @@
+//---------------------------------------------------------------------------
+/*
+Bounded ring buffer queues for passing items between threads
+(e.g. the stages of a reader->parser->writer pipeline):
+ GSPSCQueue: single producer, single consumer
+ GMPMCQueue: multiple producers, multiple consumers (D. Vyukov's design,
+             with a sequence number in each cell)
+Both are lock-free; push() and pop() only wait (spinning, then yielding,
+then sleeping) when the queue is full or empty, which is what bounds the
+memory held by a pipeline (backpressure).
+The items are copied with operator=, so they are usually pointers.
+*/
+#ifndef _GQueue_HH
+#define _GQueue_HH
+
+#include "GBase.h"
+#include "GThreads.h"
+
+//occupancy and wait counters of a queue
+struct GQueueStats {
+  int capacity;
+  int maxOccupancy; //largest number of items seen in the queue
+  uint64 pushed;
+  uint64 popped;
+  uint64 fullWaits; //push() calls that had to wait for room (backpressure)
+  uint64 emptyWaits; //pop() calls that had to wait for an item
+  uint64 occupancySum; //sum of the queue lengths seen by push()
+  GQueueStats():capacity(0), maxOccupancy(0), pushed(0), popped(0),
+      fullWaits(0), emptyWaits(0), occupancySum(0) { }
+  double avgOccupancy() { return pushed ? (double)occupancySum/pushed : 0.0; }
+  void print(FILE* f, const char* name) {
+    fprintf(f, "  %-16s queue: capacity %d, max %d, avg %.1f, %llu items, %llu full waits, %llu empty waits\n",
+        name, capacity, maxOccupancy, avgOccupancy(), (unsigned long long)pushed,
+        (unsigned long long)fullWaits, (unsigned long long)emptyWaits);
+  }
+};
+
+//waiting for a queue: spin at first, then yield the CPU, then sleep
+class GQueueBackoff {
+    int n;
+  public:
+    GQueueBackoff():n(0) { }
+    void wait() {
+      if (n>=256) current_thread::sleep_for(1);
+      else if (n>=64) current_thread::yield();
+      n++;
+    }
+};
+
+template <class T> class GSPSCQueue {
+  protected:
+    T* buf;
+    uint64 mask;
+    char pad0[64];
+    uint64 head; //next item to pop, written by the consumer
+    char pad1[64];
+    uint64 tail; //next free slot, written by the producer
+    char pad2[64];
+    int closed;
+    GQueueStats pstats; //producer side counters
+    GQueueStats cstats; //consumer side counters
+  public:
+    GSPSCQueue(int capacity=64):buf(NULL), mask(0), head(0), tail(0), closed(0),
+        pstats(), cstats() {
+      uint32 cap=upper_pow2(capacity<2 ? 2 : capacity);
+      buf=new T[cap];
+      mask=cap-1;
+      pstats.capacity=cap;
+    }
+    ~GSPSCQueue() { delete[] buf; }
+    static uint32 upper_pow2(uint32 v) {
+      v--;
+      v|=v>>1; v|=v>>2; v|=v>>4; v|=v>>8; v|=v>>16;
+      return v+1;
+    }
+    int capacity() { return (int)mask+1; }
+    int size() {
+      return (int)(__atomic_load_n(&tail, __ATOMIC_ACQUIRE)-__atomic_load_n(&head, __ATOMIC_ACQUIRE));
+    }
+    bool tryPush(const T& item) {
+      uint64 t=__atomic_load_n(&tail, __ATOMIC_RELAXED);
+      int len=(int)(t-__atomic_load_n(&head, __ATOMIC_ACQUIRE));
+      if (len>(int)mask) return false;
+      buf[t & mask]=item;
+      __atomic_store_n(&tail, t+1, __ATOMIC_RELEASE);
+      pstats.pushed++;
+      pstats.occupancySum+=len+1;
+      if (len+1>pstats.maxOccupancy) pstats.maxOccupancy=len+1;
+      return true;
+    }
+    void push(const T& item) {
+      if (tryPush(item)) return;
+      pstats.fullWaits++;
+      GQueueBackoff b;
+      while (!tryPush(item)) b.wait();
+    }
+    bool tryPop(T& item) {
+      uint64 h=__atomic_load_n(&head, __ATOMIC_RELAXED);
+      if (h==__atomic_load_n(&tail, __ATOMIC_ACQUIRE)) return false;
+      item=buf[h & mask];
+      __atomic_store_n(&head, h+1, __ATOMIC_RELEASE);
+      cstats.popped++;
+      return true;
+    }
+    //wait for an item; returns false if the queue was closed and is empty
+    bool pop(T& item) {
+      if (tryPop(item)) return true;
+      cstats.emptyWaits++;
+      GQueueBackoff b;
+      while (true) {
+        if (tryPop(item)) return true;
+        if (__atomic_load_n(&closed, __ATOMIC_ACQUIRE)) return tryPop(item);
+        b.wait();
+      }
+    }
+    //the producer is done: pop() returns false once the queue is empty
+    void close() { __atomic_store_n(&closed, 1, __ATOMIC_RELEASE); }
+    bool isClosed() { return __atomic_load_n(&closed, __ATOMIC_ACQUIRE)!=0; }
+    //counters of both sides (only consistent when the queue is not in use)
+    GQueueStats getStats() {
+      GQueueStats s(pstats);
+      s.popped=cstats.popped;
+      s.emptyWaits=cstats.emptyWaits;
+      return s;
+    }
+};
+
+template <class T> class GMPMCQueue {
+  protected:
+    struct Cell {
+      uint64 seq;
+      T data;
+    };
+    Cell* cells;
+    uint64 mask;
+    char pad0[64];
+    uint64 enqPos;
+    char pad1[64];
+    uint64 deqPos;
+    char pad2[64];
+    int closed;
+    GQueueStats stats; //updated atomically
+  public:
+    GMPMCQueue(int capacity=64):cells(NULL), mask(0), enqPos(0), deqPos(0), closed(0), stats() {
+      uint32 cap=GSPSCQueue<T>::upper_pow2(capacity<2 ? 2 : capacity);
+      cells=new Cell[cap];
+      for (uint32 i=0;i<cap;i++) cells[i].seq=i;
+      mask=cap-1;
+      stats.capacity=cap;
+    }
+    ~GMPMCQueue() { delete[] cells; }
+    int capacity() { return (int)mask+1; }
+    int size() {
+      int64 n=(int64)(__atomic_load_n(&enqPos, __ATOMIC_ACQUIRE)-__atomic_load_n(&deqPos, __ATOMIC_ACQUIRE));
+      return n<0 ? 0 : (int)n;
+    }
+    bool tryPush(const T& item) {
+      uint64 pos=__atomic_load_n(&enqPos, __ATOMIC_RELAXED);
+      Cell* c=NULL;
+      while (true) {
+        c=&cells[pos & mask];
+        uint64 seq=__atomic_load_n(&c->seq, __ATOMIC_ACQUIRE);
+        int64 dif=(int64)seq-(int64)pos;
+        if (dif==0) {
+          if (__atomic_compare_exchange_n(&enqPos, &pos, pos+1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            break;
+        }
+        else if (dif<0) return false; //full
+        else pos=__atomic_load_n(&enqPos, __ATOMIC_RELAXED);
+      }
+      c->data=item;
+      __atomic_store_n(&c->seq, pos+1, __ATOMIC_RELEASE);
+      int len=(int)(pos+1-__atomic_load_n(&deqPos, __ATOMIC_RELAXED));
+      __atomic_add_fetch(&stats.pushed, 1, __ATOMIC_RELAXED);
+      __atomic_add_fetch(&stats.occupancySum, (uint64)(len>0 ? len : 0), __ATOMIC_RELAXED);
+      int m=__atomic_load_n(&stats.maxOccupancy, __ATOMIC_RELAXED);
+      while (len>m && !__atomic_compare_exchange_n(&stats.maxOccupancy, &m, len, true,
+          __ATOMIC_RELAXED, __ATOMIC_RELAXED)) ;
+      return true;
+    }
+    void push(const T& item) {
+      if (tryPush(item)) return;
+      __atomic_add_fetch(&stats.fullWaits, 1, __ATOMIC_RELAXED);
+      GQueueBackoff b;
+      while (!tryPush(item)) b.wait();
+    }
+    bool tryPop(T& item) {
+      uint64 pos=__atomic_load_n(&deqPos, __ATOMIC_RELAXED);
+      Cell* c=NULL;
+      while (true) {
+        c=&cells[pos & mask];
+        uint64 seq=__atomic_load_n(&c->seq, __ATOMIC_ACQUIRE);
+        int64 dif=(int64)seq-(int64)(pos+1);
+        if (dif==0) {
+          if (__atomic_compare_exchange_n(&deqPos, &pos, pos+1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            break;
+        }
+        else if (dif<0) return false; //empty
+        else pos=__atomic_load_n(&deqPos, __ATOMIC_RELAXED);
+      }
+      item=c->data;
+      __atomic_store_n(&c->seq, pos+mask+1, __ATOMIC_RELEASE);
+      __atomic_add_fetch(&stats.popped, 1, __ATOMIC_RELAXED);
+      return true;
+    }
+    //wait for an item; returns false if the queue was closed and is empty
+    bool pop(T& item) {
+      if (tryPop(item)) return true;
+      __atomic_add_fetch(&stats.emptyWaits, 1, __ATOMIC_RELAXED);
+      GQueueBackoff b;
+      while (true) {
+        if (tryPop(item)) return true;
+        if (__atomic_load_n(&closed, __ATOMIC_ACQUIRE)) return tryPop(item);
+        b.wait();
+      }
+    }
+    void close() { __atomic_store_n(&closed, 1, __ATOMIC_RELEASE); }
+    bool isClosed() { return __atomic_load_n(&closed, __ATOMIC_ACQUIRE)!=0; }
+    GQueueStats getStats() {
+      GQueueStats s;
+      s.capacity=stats.capacity;
+      s.maxOccupancy=__atomic_load_n(&stats.maxOccupancy, __ATOMIC_RELAXED);
+      s.pushed=__atomic_load_n(&stats.pushed, __ATOMIC_RELAXED);
+      s.popped=__atomic_load_n(&stats.popped, __ATOMIC_RELAXED);
+      s.fullWaits=__atomic_load_n(&stats.fullWaits, __ATOMIC_RELAXED);
+      s.emptyWaits=__atomic_load_n(&stats.emptyWaits, __ATOMIC_RELAXED);
+      s.occupancySum=__atomic_load_n(&stats.occupancySum, __ATOMIC_RELAXED);
+      return s;
+    }
+};
+
+//---------------------------------------------------------------------------
+#endif
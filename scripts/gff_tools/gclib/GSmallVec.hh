@@ -0,0 +1,145 @@
+//---------------------------------------------------------------------------
+/*
+Vector of objects stored by value, with room for the first N items
+inside the vector object itself; the array is only allocated on the heap
+when more than N items are added (e.g. the exons of a transcript,
+which usually has only one or a few of them)
+*/
+#ifndef _GSmallVec_HH
+#define _GSmallVec_HH
+
+#include "GVec.hh"
+#include <new>
+
+//the objects are relocated with memcpy/memmove when the array grows or when
+//items are inserted or deleted, so OBJ must not keep pointers into itself;
+//pointers to items are invalidated by Add(), Insert() and Delete()
+template <class OBJ, int N=1> class GSmallVec {
+  protected:
+    OBJ* fArray; //points to fInline or to the heap allocated array
+    int fCount;
+    int fCapacity;
+    alignas(OBJ) char fInline[N*sizeof(OBJ)];
+    OBJ* inlineArray() { return (OBJ*)fInline; }
+    void Grow() { setCapacity(fCapacity*2); }
+  public:
+    GSmallVec():fArray(NULL), fCount(0), fCapacity(N) {
+      fArray=inlineArray();
+    }
+    GSmallVec(const GSmallVec<OBJ,N>& v):fArray(NULL), fCount(0), fCapacity(N) {
+      fArray=inlineArray();
+      setCapacity(v.fCount);
+      for (int i=0;i<v.fCount;i++) new(&fArray[i]) OBJ(v.fArray[i]);
+      fCount=v.fCount;
+    }
+    const GSmallVec<OBJ,N>& operator=(const GSmallVec<OBJ,N>& v) {
+      if (&v==this) return *this;
+      Clear();
+      setCapacity(v.fCount);
+      for (int i=0;i<v.fCount;i++) new(&fArray[i]) OBJ(v.fArray[i]);
+      fCount=v.fCount;
+      return *this;
+    }
+    ~GSmallVec() { Clear(); }
+    bool isInline() { return fArray==inlineArray(); }
+    int Count() { return fCount; }
+    int Capacity() { return fCapacity; }
+    bool isEmpty() { return fCount==0; }
+    bool notEmpty() { return fCount>0; }
+    OBJ& Get(int idx) {
+      TEST_INDEX(idx);
+      return fArray[idx];
+    }
+    inline OBJ& operator[](int i) {
+      TEST_INDEX(i);
+      return fArray[i];
+    }
+    OBJ& First() {
+      TEST_INDEX(0);
+      return fArray[0];
+    }
+    OBJ& Last() {
+      TEST_INDEX(fCount-1);
+      return fArray[fCount-1];
+    }
+    void setCapacity(int NewCapacity) {
+      if (NewCapacity<fCount || NewCapacity>MAXLISTSIZE)
+        GError(GVEC_CAPACITY_ERR, NewCapacity);
+      if (NewCapacity<=fCapacity) return; //never shrinks
+      if (isInline()) {
+        OBJ* a=NULL;
+        GMALLOC(a, NewCapacity*sizeof(OBJ));
+        if (fCount>0) memcpy((void*)a, (void*)fArray, fCount*sizeof(OBJ));
+        fArray=a;
+      }
+      else GREALLOC(fArray, NewCapacity*sizeof(OBJ));
+      fCapacity=NewCapacity;
+    }
+    //item may be one of our own items: it is copied before the array changes
+    int Add(const OBJ& item) { //append a copy of item
+      Insert(fCount, item);
+      return fCount-1;
+    }
+    void Insert(int idx, const OBJ& item) { //idx can be [0..fCount]
+      if (idx<0 || idx>fCount) GError(GVEC_INDEX_ERR, idx);
+      alignas(OBJ) char t[sizeof(OBJ)];
+      new(t) OBJ(item);
+      if (fCount==fCapacity) Grow();
+      if (idx<fCount)
+        memmove((void*)&fArray[idx+1], (void*)&fArray[idx], (fCount-idx)*sizeof(OBJ));
+      memcpy((void*)&fArray[idx], t, sizeof(OBJ));
+      fCount++;
+    }
+    //insert a copy of item keeping the array sorted (by OBJ operator<),
+    //returning its index
+    int AddSorted(const OBJ& item) {
+      OBJ& o=const_cast<OBJ&>(item);
+      int l=0, h=fCount-1;
+      while (l<=h) {
+        int i=(l+h)>>1;
+        if (fArray[i]<o) l=i+1;
+        else if (o<fArray[i]) h=i-1;
+        else { l=i; break; } //equal item found
+      }
+      Insert(l, item);
+      return l;
+    }
+    void Delete(int idx) {
+      TEST_INDEX(idx);
+      fArray[idx].~OBJ();
+      fCount--;
+      if (idx<fCount)
+        memmove((void*)&fArray[idx], (void*)&fArray[idx+1], (fCount-idx)*sizeof(OBJ));
+    }
+    void Clear() {
+      for (int i=0;i<fCount;i++) fArray[i].~OBJ();
+      if (!isInline()) GFREE(fArray);
+      fArray=inlineArray();
+      fCount=0;
+      fCapacity=N;
+    }
+    void Exchange(int idx1, int idx2) {
+      TEST_INDEX(idx1);
+      TEST_INDEX(idx2);
+      alignas(OBJ) char t[sizeof(OBJ)];
+      memcpy(t, (void*)&fArray[idx1], sizeof(OBJ));
+      memcpy((void*)&fArray[idx1], (void*)&fArray[idx2], sizeof(OBJ));
+      memcpy((void*)&fArray[idx2], t, sizeof(OBJ));
+    }
+    void Swap(int idx1, int idx2) { Exchange(idx1, idx2); }
+    //stable insertion sort by OBJ operator<, the vectors are expected to be short
+    void Sort() {
+      alignas(OBJ) char t[sizeof(OBJ)];
+      for (int i=1;i<fCount;i++) {
+        int j=i;
+        while (j>0 && fArray[i]<fArray[j-1]) j--;
+        if (j==i) continue;
+        memcpy(t, (void*)&fArray[i], sizeof(OBJ));
+        memmove((void*)&fArray[j+1], (void*)&fArray[j], (i-j)*sizeof(OBJ));
+        memcpy((void*)&fArray[j], t, sizeof(OBJ));
+      }
+    }
+};
+
+//---------------------------------------------------------------------------
+#endif
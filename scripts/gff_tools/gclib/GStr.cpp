@@ -16,6 +16,7 @@ GStr::Data GStr::null_data;
 GStr::Data * GStr::new_data(uint len, uint addcap) {
 //static method to return a new Data object (allocate length)
 //content is undefined, but it's null terminated
+    GMEM_TAG(gmtGStr);
     if (len > 0) {
         Data* data;
         GMALLOC(data, sizeof(Data)+len+addcap);
@@ -32,6 +33,7 @@ GStr::Data * GStr::new_data(uint len, uint addcap) {
 GStr::Data* GStr::new_data(const char* str, uint addcap) {
 //static method to return a new Data object (allocate: length+addcap)
 //as a copy of a given string
+ GMEM_TAG(gmtGStr);
  if (str==NULL) return &null_data;
  int len=strlen(str);
  if (len+addcap > 0) {
@@ -49,6 +51,7 @@ GStr::Data* GStr::new_data(const char* str, uint addcap) {
  }
 
 void GStr::prep_data(uint len, uint addcap) {
+	GMEM_TAG(gmtGStr);
 	uint newcap=len+addcap;
     if (newcap > 0 && my_data->ref_count <= 1 &&
     	   my_data->cap>=newcap && my_data->cap-newcap<(newcap>>1)+2) {
@@ -155,7 +158,8 @@ GStr::GStr(const char *s, uint addcap): my_data(&null_data) {
   readbuf=NULL;
   readbufsize=0;
   my_data=new_data(s, addcap);
-  my_data->ref_count = 1;
+  if (my_data!=&null_data) //null_data is shared by all threads
+    my_data->ref_count = 1;
  }
 
 GStr::GStr(const int i): my_data(&null_data) {
@@ -987,6 +991,7 @@ GStr& GStr::insert(const char *s, int idx) {
 //=========================================
 
 GStr& GStr::append(char c) {
+  GMEM_TAG(gmtGStr);
   make_unique(); //edit operation ahead
   uint newlen=my_data->length+1;
   if (my_data->cap==0) {
@@ -1006,6 +1011,7 @@ GStr& GStr::append(char c) {
  }
 
 GStr& GStr::append(const char* s) {
+  GMEM_TAG(gmtGStr);
   make_unique(); //edit operation ahead
   uint len=::strlen(s);
   uint newlen=len+my_data->length;
@@ -1042,6 +1048,7 @@ GStr& GStr::appendQuoted(const char* s, char q, bool onlyIfSpaced) {
 }
 
 GStr& GStr::append(const char* s, int len) {
+  GMEM_TAG(gmtGStr);
   make_unique(); //edit operation ahead
   //uint len=::strlen(s);
   uint newlen=len+my_data->length;
@@ -1069,6 +1076,7 @@ GStr& GStr::append(const char* s, int len) {
 
 
 GStr& GStr::appendmem(const char* m, int len) {
+  GMEM_TAG(gmtGStr);
   if (len<=0) return *this;
   make_unique(); //edit operation ahead
   uint newlen=len+my_data->length;
@@ -1313,6 +1321,7 @@ bool GStr::nextToken(GStr& token) {
 size_t GStr::read(FILE* stream, const char* delimiter, size_t bufsize) {
 //read up to (and including) the given delimiter string
 //if delimiter is NULL or zero length, it will read the whole file
+ GMEM_TAG(gmtGStr);
  if (readbuf==NULL) {
     GMALLOC(readbuf, bufsize);
     readbufsize=bufsize;
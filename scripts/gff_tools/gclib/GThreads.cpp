@@ -22,6 +22,7 @@ freely, subject to the following restrictions:
 */
 
 #include "GThreads.h"
+#include "GTrace.h"
 
 #if defined(_GTHREADS_POSIX_)
   #include <unistd.h>
@@ -30,6 +31,7 @@ freely, subject to the following restrictions:
   #include <process.h>
 #endif
 #include <string.h>
+#include <time.h>
 
 //------------------------------------------------------------------------------
 // condition_variable
@@ -453,3 +455,336 @@ void current_thread::sleep_for(const int32_t mstime) {
 #endif
 }
 
+
+//------------------------------------------------------------------------------
+// GThreadPool
+//------------------------------------------------------------------------------
+
+uint64_t gthreads_clock_ns() { //monotonic time in nanoseconds
+#if defined(_GTHREADS_WIN32_)
+  LARGE_INTEGER freq, cnt;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&cnt);
+  return (uint64_t)(cnt.QuadPart*(1e9/freq.QuadPart));
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec*1000000000ULL+ts.tv_nsec;
+#endif
+}
+
+//pool and queue slot of the current thread, if it is a pool worker
+static thread_local GThreadPool* gpool_tls_pool=NULL;
+static thread_local int gpool_tls_slot=0;
+
+GThreadPool* GThreadPool::globalPool=NULL;
+
+struct GPoolTask {
+  GTaskFunc* func;
+  void* arg;
+  GThreadPool* pool;
+  int* remaining; //counter to decrement when the task is done
+  int ownRemaining; //the counter of a task with a GTaskHandle
+  int refs; //the queue and the GTaskHandle copies
+};
+
+//task queue of a pool thread: the owner takes the tasks from the back,
+//the other threads steal them from the front
+struct GThreadPool::TaskQueue {
+  GMutex lock;
+  GPoolTask** tasks;
+  int head;
+  int tail;
+  int capacity;
+  TaskQueue():lock(), tasks(NULL), head(0), tail(0), capacity(0) { }
+  ~TaskQueue() { free(tasks); }
+  void pushBack(GPoolTask* t) {
+    GLockGuard<GMutex> guard(lock);
+    if (tail==capacity) {
+      if (head>0) {
+        memmove(tasks, tasks+head, (tail-head)*sizeof(GPoolTask*));
+        tail-=head;
+        head=0;
+      }
+      else {
+        capacity=(capacity==0) ? 64 : capacity*2;
+        tasks=(GPoolTask**)realloc(tasks, capacity*sizeof(GPoolTask*));
+        if (tasks==NULL) gthreads_errExit(ENOMEM, "GThreadPool task queue");
+      }
+    }
+    tasks[tail++]=t;
+  }
+  GPoolTask* popBack() {
+    GLockGuard<GMutex> guard(lock);
+    if (tail==head) return NULL;
+    GPoolTask* t=tasks[--tail];
+    if (tail==head) head=tail=0;
+    return t;
+  }
+  GPoolTask* popFront() {
+    GLockGuard<GMutex> guard(lock);
+    if (tail==head) return NULL;
+    GPoolTask* t=tasks[head++];
+    if (tail==head) head=tail=0;
+    return t;
+  }
+};
+
+GTaskHandle::GTaskHandle(GPoolTask* t):task(t) { } //takes over a reference
+
+GTaskHandle::GTaskHandle(const GTaskHandle& h):task(h.task) {
+  if (task) __atomic_add_fetch(&task->refs, 1, __ATOMIC_RELAXED);
+}
+
+GTaskHandle& GTaskHandle::operator=(const GTaskHandle& h) {
+  if (h.task) __atomic_add_fetch(&h.task->refs, 1, __ATOMIC_RELAXED);
+  release();
+  task=h.task;
+  return *this;
+}
+
+void GTaskHandle::release() {
+  if (task && __atomic_sub_fetch(&task->refs, 1, __ATOMIC_ACQ_REL)==0)
+    delete task;
+  task=NULL;
+}
+
+bool GTaskHandle::done() const {
+  return task==NULL || __atomic_load_n(&task->ownRemaining, __ATOMIC_ACQUIRE)==0;
+}
+
+void GTaskHandle::wait() {
+  if (task) task->pool->waitFor(&task->ownRemaining);
+}
+
+GThreadPool::GThreadPool(int n):numThreads(n<1 ? 1 : n), workers(NULL), queues(NULL),
+    lock(), cond(), pending(0), waiters(0), stopping(false), stats(NULL), startNs(0) {
+  queues=new TaskQueue[numThreads];
+  stats=(GPoolThreadStats*)calloc(numThreads, sizeof(GPoolThreadStats));
+  startNs=gthreads_clock_ns();
+  if (numThreads>1) {
+    workers=new GThread[numThreads-1];
+    for (int i=0;i<numThreads-1;i++)
+      workers[i].kickStart(workerMain, (void*)this);
+  }
+}
+
+GThreadPool::~GThreadPool() {
+  lock.lock();
+  stopping=true;
+  cond.notify_all();
+  lock.unlock();
+  for (int i=0;i<numThreads-1;i++)
+    workers[i].join();
+  delete[] workers;
+  delete[] queues;
+  free(stats);
+}
+
+void GThreadPool::workerMain(GThreadData& td) {
+  GThreadPool* pool=(GThreadPool*)td.udata;
+  int slot=(int)(td.thread-pool->workers)+1;
+  gpool_tls_pool=pool;
+  gpool_tls_slot=slot;
+  if (GTrace::enabled) {
+    char tname[32];
+    sprintf(tname, "pool worker %d", slot);
+    GTrace::setThreadName(tname);
+  }
+  while (true) {
+    GPoolTask* t=pool->take(slot);
+    if (t) {
+      pool->run(t, slot);
+      continue;
+    }
+    pool->lock.lock();
+    while (__atomic_load_n(&pool->pending, __ATOMIC_SEQ_CST)==0 && !pool->stopping)
+      pool->cond.wait(pool->lock);
+    bool done=(pool->stopping && __atomic_load_n(&pool->pending, __ATOMIC_SEQ_CST)==0);
+    pool->lock.unlock();
+    if (done) break;
+  }
+  gpool_tls_pool=NULL;
+}
+
+int GThreadPool::currentSlot() {
+  return (gpool_tls_pool==this) ? gpool_tls_slot : 0;
+}
+
+void GThreadPool::push(GPoolTask* t) {
+  queues[currentSlot()].pushBack(t);
+  lock.lock();
+  __atomic_add_fetch(&pending, 1, __ATOMIC_SEQ_CST);
+  cond.notify_one();
+  lock.unlock();
+}
+
+GPoolTask* GThreadPool::take(int slot) {
+  if (__atomic_load_n(&pending, __ATOMIC_SEQ_CST)==0) return NULL;
+  GPoolTask* t=queues[slot].popBack();
+  if (t==NULL) {
+    for (int i=1;i<numThreads;i++) {
+      t=queues[(slot+i)%numThreads].popFront();
+      if (t) {
+        __atomic_add_fetch(&stats[slot].steals, 1, __ATOMIC_RELAXED);
+        break;
+      }
+    }
+    if (t==NULL) return NULL;
+  }
+  __atomic_sub_fetch(&pending, 1, __ATOMIC_SEQ_CST);
+  return t;
+}
+
+void GThreadPool::run(GPoolTask* t, int slot) {
+  uint64_t t0=gthreads_clock_ns();
+  t->func(t->arg);
+  __atomic_add_fetch(&stats[slot].busyNs, gthreads_clock_ns()-t0, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&stats[slot].tasks, 1, __ATOMIC_RELAXED);
+  //the counter may go away as soon as it reaches 0
+  if (__atomic_sub_fetch(t->remaining, 1, __ATOMIC_SEQ_CST)==0 &&
+      __atomic_load_n(&waiters, __ATOMIC_SEQ_CST)>0) {
+    lock.lock();
+    cond.notify_all();
+    lock.unlock();
+  }
+  if (__atomic_sub_fetch(&t->refs, 1, __ATOMIC_ACQ_REL)==0)
+    delete t;
+}
+
+void GThreadPool::waitFor(int* remaining) {
+  int slot=currentSlot();
+  while (__atomic_load_n(remaining, __ATOMIC_SEQ_CST)>0) {
+    GPoolTask* t=take(slot);
+    if (t) {
+      run(t, slot);
+      continue;
+    }
+    lock.lock();
+    __atomic_add_fetch(&waiters, 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(remaining, __ATOMIC_SEQ_CST)>0 &&
+        __atomic_load_n(&pending, __ATOMIC_SEQ_CST)==0)
+      cond.wait(lock);
+    __atomic_sub_fetch(&waiters, 1, __ATOMIC_SEQ_CST);
+    lock.unlock();
+  }
+}
+
+GTaskHandle GThreadPool::submit(GTaskFunc* func, void* arg) {
+  GPoolTask* t=new GPoolTask;
+  t->func=func;
+  t->arg=arg;
+  t->pool=this;
+  t->ownRemaining=1;
+  t->remaining=&(t->ownRemaining);
+  t->refs=2;
+  if (numThreads==1) run(t, currentSlot());
+  else push(t);
+  return GTaskHandle(t);
+}
+
+struct GRangeTask {
+  int from;
+  int to;
+  GRangeFunc* func;
+  void* udata;
+};
+
+static void gpool_runRange(void* p) {
+  GRangeTask* r=(GRangeTask*)p;
+  r->func(r->from, r->to, r->udata);
+}
+
+void GThreadPool::parallel_for(int begin, int end, GRangeFunc* func, void* udata, int grain) {
+  int n=end-begin;
+  if (n<=0) return;
+  if (grain<=0) {
+    grain=n/(numThreads*8);
+    if (grain<1) grain=1;
+  }
+  if (numThreads==1 || n<=grain) {
+    func(begin, end, udata);
+    return;
+  }
+  int nchunks=(n+grain-1)/grain;
+  GRangeTask* ranges=(GRangeTask*)malloc(nchunks*sizeof(GRangeTask));
+  if (ranges==NULL) gthreads_errExit(ENOMEM, "GThreadPool::parallel_for()");
+  int remaining=nchunks;
+  for (int c=0;c<nchunks;c++) {
+    ranges[c].from=begin+c*grain;
+    ranges[c].to=(c==nchunks-1) ? end : ranges[c].from+grain;
+    ranges[c].func=func;
+    ranges[c].udata=udata;
+  }
+  //the first range is run by this thread, the others are queued: the
+  //thieves take them in order, while this thread helps from the end
+  for (int c=1;c<nchunks;c++) {
+    GPoolTask* t=new GPoolTask;
+    t->func=gpool_runRange;
+    t->arg=&ranges[c];
+    t->pool=this;
+    t->ownRemaining=0;
+    t->remaining=&remaining;
+    t->refs=1;
+    push(t);
+  }
+  GPoolTask first;
+  first.func=gpool_runRange;
+  first.arg=&ranges[0];
+  first.pool=this;
+  first.ownRemaining=0;
+  first.remaining=&remaining;
+  first.refs=2; //not to be deleted by run()
+  run(&first, currentSlot());
+  waitFor(&remaining);
+  free(ranges);
+}
+
+GPoolThreadStats GThreadPool::getStats(int i) {
+  GPoolThreadStats s;
+  s.tasks=__atomic_load_n(&stats[i].tasks, __ATOMIC_RELAXED);
+  s.steals=__atomic_load_n(&stats[i].steals, __ATOMIC_RELAXED);
+  s.busyNs=__atomic_load_n(&stats[i].busyNs, __ATOMIC_RELAXED);
+  return s;
+}
+
+double GThreadPool::elapsedTime() {
+  return (gthreads_clock_ns()-startNs)/1e9;
+}
+
+void GThreadPool::resetStats() {
+  for (int i=0;i<numThreads;i++) {
+    __atomic_store_n(&stats[i].tasks, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&stats[i].steals, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&stats[i].busyNs, 0, __ATOMIC_RELAXED);
+  }
+  startNs=gthreads_clock_ns();
+}
+
+void GThreadPool::printStats(FILE* f) {
+  double wall=elapsedTime();
+  fprintf(f, "Thread pool: %d threads, %.3f s elapsed\n", numThreads, wall);
+  fprintf(f, "  thread      tasks     steals    busy(s)  util%%\n");
+  GPoolThreadStats total={0, 0, 0};
+  for (int i=0;i<numThreads;i++) {
+    GPoolThreadStats s=getStats(i);
+    total.tasks+=s.tasks;
+    total.steals+=s.steals;
+    total.busyNs+=s.busyNs;
+    fprintf(f, "  %6d %10llu %10llu %10.3f %6.1f\n", i, (unsigned long long)s.tasks,
+        (unsigned long long)s.steals, s.busyNs/1e9, wall>0 ? 100.0*s.busyNs/1e9/wall : 0.0);
+  }
+  fprintf(f, "  %6s %10llu %10llu %10.3f %6.1f\n", "all", (unsigned long long)total.tasks,
+      (unsigned long long)total.steals, total.busyNs/1e9,
+      wall>0 ? 100.0*total.busyNs/1e9/(wall*numThreads) : 0.0);
+}
+
+GThreadPool& GThreadPool::global() {
+  if (globalPool==NULL) globalPool=new GThreadPool(1);
+  return *globalPool;
+}
+
+void GThreadPool::setGlobal(int numThreads) {
+  delete globalPool;
+  globalPool=new GThreadPool(numThreads);
+}
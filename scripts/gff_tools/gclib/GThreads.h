@@ -106,6 +106,7 @@ freely, subject to the following restrictions:
 #include <stdlib.h>
 #include <stdio.h>
 #include <errno.h>
+#include <stdint.h>
 
 /// TinyThread++ version (major number).
 #define TINYTHREAD_VERSION_MAJOR 1
@@ -827,6 +828,132 @@ namespace current_thread {
   void sleep_for(const int32_t mstime);
 }
 
+/// Monotonic clock, in nanoseconds (for timing the work of threads).
+uint64_t gthreads_clock_ns();
+
+//------------------------------------------------------------------------------
+// GThreadPool: work-stealing thread pool
+//------------------------------------------------------------------------------
+
+/// Function type for the tasks run by a GThreadPool.
+typedef void GTaskFunc(void* arg);
+/// Function type for GThreadPool::parallel_for(): processes the index
+/// range [from, to).
+typedef void GRangeFunc(int from, int to, void* udata);
+
+class GThreadPool;
+struct GPoolTask;
+
+/// Join handle of a task submitted to a GThreadPool (copies refer to the
+/// same task). A handle can be dropped without waiting for its task.
+class GTaskHandle {
+    GPoolTask* task;
+    void release();
+  public:
+    GTaskHandle():task(NULL) {}
+    GTaskHandle(GPoolTask* t);
+    GTaskHandle(const GTaskHandle& h);
+    GTaskHandle& operator=(const GTaskHandle& h);
+    ~GTaskHandle() { release(); }
+    bool valid() const { return task!=NULL; }
+    bool done() const;
+    /// Wait for the task to finish. Meanwhile the calling thread runs other
+    /// queued tasks of the pool, so tasks can wait for the tasks they submit.
+    void wait();
+};
+
+/// Result of a function run as a pool task by GThreadPool::async().
+/// The destructor waits for the task, if it was started.
+template <class T> class GFuture {
+    friend class GThreadPool;
+    T (*func)(void*);
+    void* arg;
+    T value;
+    GTaskHandle handle;
+    static void run(void* p) {
+      GFuture<T>* f=(GFuture<T>*)p;
+      f->value=f->func(f->arg);
+    }
+  public:
+    GFuture():func(NULL), arg(NULL), value(), handle() {}
+    ~GFuture() { if (handle.valid()) handle.wait(); }
+    bool valid() const { return handle.valid(); }
+    bool done() const { return handle.valid() && handle.done(); }
+    void wait() { handle.wait(); }
+    T& get() {
+      handle.wait();
+      return value;
+    }
+    _GTHREADS_DISABLE_ASSIGNMENT(GFuture)
+};
+
+/// Utilization counters of a pool thread (slot 0 is shared by all the
+/// threads outside the pool, e.g. the main thread waiting for its tasks).
+struct GPoolThreadStats {
+  uint64_t tasks; ///< tasks run by this thread
+  uint64_t steals; ///< tasks taken from the queue of another thread
+  uint64_t busyNs; ///< time spent running tasks, in nanoseconds
+};
+
+/// Thread pool with a task queue per thread: a thread runs the tasks it
+/// submitted in LIFO order, and when its own queue is empty it steals the
+/// oldest task from the queue of another thread. A pool of size n starts
+/// n-1 worker threads, as the thread waiting for a task or a parallel_for()
+/// runs queued tasks too; with n==1 the tasks are run right away, in the
+/// calling thread.
+class GThreadPool {
+    friend class GTaskHandle;
+    struct TaskQueue;
+    int numThreads; //pool size, including the calling thread
+    GThread* workers;
+    TaskQueue* queues; //queues[0] for the threads outside the pool
+    GMutex lock; //for the counters below and the condition variable
+    GConditionVar cond; //signals queued tasks, finished waits and shutdown
+    int pending; //tasks queued and not yet taken
+    int waiters; //threads waiting for a task to finish
+    bool stopping;
+    GPoolThreadStats* stats;
+    uint64_t startNs;
+    static GThreadPool* globalPool;
+    static void workerMain(GThreadData& td);
+    int currentSlot();
+    void push(GPoolTask* t);
+    GPoolTask* take(int slot);
+    void run(GPoolTask* t, int slot);
+    void waitFor(int* remaining); //help with queued tasks until *remaining==0
+  public:
+    GThreadPool(int numThreads=1);
+    /// Runs the tasks still queued, then stops the worker threads.
+    ~GThreadPool();
+    int size() { return numThreads; }
+    /// Queue func(arg) for execution.
+    GTaskHandle submit(GTaskFunc* func, void* arg);
+    /// Run func(arg) as a task whose result is stored into f.
+    template <class T> void async(GFuture<T>& f, T (*func)(void*), void* arg) {
+      if (f.handle.valid()) f.handle.wait();
+      f.func=func;
+      f.arg=arg;
+      f.handle=submit(GFuture<T>::run, (void*)&f);
+    }
+    /// Call func on the subranges of [begin, end) in parallel, returning
+    /// after all of them were processed. Each call gets (at most) grain
+    /// indexes; the default grain makes about 8 subranges per thread.
+    void parallel_for(int begin, int end, GRangeFunc* func, void* udata, int grain=0);
+    /// Utilization counters of pool slot i (0..size()-1).
+    GPoolThreadStats getStats(int i);
+    /// Wall time since the pool was created or resetStats() was called.
+    double elapsedTime();
+    void resetStats();
+    /// Print the utilization of each pool thread.
+    void printStats(FILE* f);
+    /// Process-wide pool, a single-thread pool until setGlobal() is called.
+    static GThreadPool& global();
+    /// Replace the process-wide pool with one of numThreads threads
+    /// (should be called before any task is submitted to it).
+    static void setGlobal(int numThreads);
+    _GTHREADS_DISABLE_ASSIGNMENT(GThreadPool)
+};
+
 // Define/macro cleanup
 #undef _GTHREADS_DISABLE_ASSIGNMENT
 
@@ -0,0 +1,110 @@
+#include "GTrace.h"
+
+struct GTraceEvent {
+  const char* name;
+  const char* cat;
+  uint64_t startNs;
+  uint64_t endNs;
+  char* detail;
+};
+
+//events of one thread
+struct GTraceBuf {
+  int tid;
+  char* tname;
+  GTraceEvent* events;
+  int count;
+  int capacity;
+  GTraceBuf* next;
+};
+
+bool GTrace::enabled=false;
+static uint64_t gtrace_startNs=0;
+static GMutex gtrace_lock; //for the list of buffers
+static GTraceBuf* gtrace_bufs=NULL;
+static int gtrace_numbufs=0;
+static thread_local GTraceBuf* gtrace_tbuf=NULL;
+
+static GTraceBuf* gtraceThreadBuf() {
+  if (gtrace_tbuf==NULL) {
+    GTraceBuf* b=NULL;
+    GCALLOC(b, sizeof(GTraceBuf));
+    gtrace_lock.lock();
+    b->tid=++gtrace_numbufs;
+    b->next=gtrace_bufs;
+    gtrace_bufs=b;
+    gtrace_lock.unlock();
+    gtrace_tbuf=b;
+  }
+  return gtrace_tbuf;
+}
+
+void GTrace::start() {
+  gtrace_startNs=gthreads_clock_ns();
+  enabled=true;
+  setThreadName("main");
+}
+
+void GTrace::setThreadName(const char* tname) {
+  if (!enabled) return;
+  GTraceBuf* b=gtraceThreadBuf();
+  GFREE(b->tname);
+  b->tname=Gstrdup(tname);
+}
+
+void GTrace::addSpan(const char* name, const char* cat, uint64_t startNs,
+    uint64_t endNs, const char* detail) {
+  GTraceBuf* b=gtraceThreadBuf();
+  if (b->count==b->capacity) {
+    b->capacity=(b->capacity==0) ? 256 : b->capacity*2;
+    GREALLOC(b->events, b->capacity*sizeof(GTraceEvent));
+  }
+  GTraceEvent& e=b->events[b->count++];
+  e.name=name;
+  e.cat=cat;
+  e.startNs=startNs;
+  e.endNs=endNs;
+  e.detail=(detail!=NULL) ? Gstrdup(detail) : NULL;
+}
+
+//JSON string, without the quotes
+static void writeJSONStr(FILE* f, const char* s) {
+  for (;*s;s++) {
+    unsigned char c=(unsigned char)*s;
+    if (c=='"' || c=='\\') fprintf(f, "\\%c", c);
+    else if (c<0x20) fprintf(f, "\\u%04x", c);
+    else fputc(c, f);
+  }
+}
+
+static double gtraceMicros(uint64_t ns) {
+  return (ns>gtrace_startNs) ? (ns-gtrace_startNs)/1000.0 : 0.0;
+}
+
+void GTrace::write(FILE* f) {
+  gtrace_lock.lock();
+  fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+  fprintf(f, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"gffread\"}}");
+  for (GTraceBuf* b=gtrace_bufs;b!=NULL;b=b->next) {
+    fprintf(f, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"", b->tid);
+    if (b->tname!=NULL) writeJSONStr(f, b->tname);
+    else fprintf(f, "thread %d", b->tid);
+    fprintf(f, "\"}}");
+    //keep the threads in the order they were created
+    fprintf(f, ",\n{\"name\": \"thread_sort_index\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"sort_index\": %d}}",
+        b->tid, b->tid);
+    for (int i=0;i<b->count;i++) {
+      GTraceEvent& e=b->events[i];
+      fprintf(f, ",\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": %d",
+          e.name, e.cat, gtraceMicros(e.startNs), (e.endNs-e.startNs)/1000.0, b->tid);
+      if (e.detail!=NULL) {
+        fprintf(f, ", \"args\": {\"detail\": \"");
+        writeJSONStr(f, e.detail);
+        fprintf(f, "\"}");
+      }
+      fprintf(f, "}");
+    }
+  }
+  fprintf(f, "\n]}\n");
+  gtrace_lock.unlock();
+}
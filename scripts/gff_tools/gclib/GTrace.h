@@ -0,0 +1,49 @@
+#ifndef _GTRACE_H
+#define _GTRACE_H
+/*
+ Timeline of a run in the Chrome trace-event JSON format, which can be
+ opened in chrome://tracing or https://ui.perfetto.dev : the spans of work
+ (GTraceSpan) are recorded as "complete" events with the id of the thread
+ running them.
+ Each thread appends its events to its own buffer, so recording takes no
+ locks; when tracing is not enabled a GTraceSpan only checks a flag.
+*/
+#include "GBase.h"
+#include "GThreads.h"
+
+class GTrace {
+ public:
+  static bool enabled; //set by start()
+  static void start(); //enable the recording; the timestamps start from here
+  //name the calling thread in the timeline (default: "thread <id>")
+  static void setThreadName(const char* tname);
+  //record a span of the calling thread; name and cat must be static
+  //strings, detail (optional) is copied
+  static void addSpan(const char* name, const char* cat, uint64_t startNs,
+      uint64_t endNs, const char* detail=NULL);
+  //write the events recorded so far (the threads recording them should
+  //be idle or finished)
+  static void write(FILE* f);
+};
+
+//records a span for the lifetime of this object;
+//detail should be valid until the end of the span
+class GTraceSpan {
+  const char* name;
+  const char* cat;
+  const char* detail;
+  uint64_t startNs;
+ public:
+  GTraceSpan(const char* sname, const char* scat, const char* sdetail=NULL):
+      name(NULL), cat(scat), detail(sdetail), startNs(0) {
+    if (GTrace::enabled) {
+      name=sname;
+      startNs=gthreads_clock_ns();
+    }
+  }
+  ~GTraceSpan() {
+    if (name!=NULL) GTrace::addSpan(name, cat, startNs, gthreads_clock_ns(), detail);
+  }
+};
+
+#endif
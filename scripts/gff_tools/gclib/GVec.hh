@@ -51,6 +51,85 @@ template <class OBJ> int DefLTCompareProc(pointer p1, pointer p2) {
    else return ((o2 < o1) ? 1 : 0 );
 }
 
+#define GSORT_MINRUN 24
+
+//stable sort of the n items in a[], with cmp(x,y) returning <0, 0 or >0;
+//a natural merge sort: the runs already in order are detected (strictly
+//descending runs are reversed), runs shorter than GSORT_MINRUN are extended by
+//insertion sort, then adjacent runs are merged pairwise until one is left.
+//Mostly sorted input (e.g. records appended in file order) is sorted in ~n compares
+template <class T, class C> void GStableSort(T* a, int n, C& cmp) {
+ if (n<2) return;
+ int* runs=NULL; //end of each run
+ GMALLOC(runs, (n/GSORT_MINRUN+2)*sizeof(int));
+ int nruns=0;
+ int i=0;
+ while (i<n) {
+   int j=i+1;
+   if (j<n && cmp(a[j], a[i])<0) {
+     while (j<n && cmp(a[j], a[j-1])<0) j++;
+     for (int l=i, r=j-1;l<r;l++,r--) { T t=a[l]; a[l]=a[r]; a[r]=t; }
+   }
+   else while (j<n && cmp(a[j], a[j-1])>=0) j++;
+   if (j-i<GSORT_MINRUN && j<n) {
+     int e=(i+GSORT_MINRUN<n) ? i+GSORT_MINRUN : n;
+     for (;j<e;j++) {
+       T t=a[j];
+       int k=j;
+       while (k>i && cmp(t, a[k-1])<0) { a[k]=a[k-1]; k--; }
+       a[k]=t;
+     }
+   }
+   runs[nruns++]=j;
+   i=j;
+ }
+ if (nruns>1) {
+   T* buf=new T[n];
+   T* src=a;
+   T* dst=buf;
+   while (nruns>1) {
+     int k=0, start=0;
+     for (int r=0;r<nruns;r+=2) {
+       int mid=runs[r];
+       int end=(r+1<nruns) ? runs[r+1] : mid;
+       if (mid==end || cmp(src[mid-1], src[mid])<=0) { //already in order
+         for (int x=start;x<end;x++) dst[x]=src[x];
+       }
+       else {
+         int x=start, y=mid, d=start;
+         while (x<mid && y<end) {
+           if (cmp(src[y], src[x])<0) dst[d++]=src[y++];
+                                 else dst[d++]=src[x++]; //ties: left run first
+         }
+         while (x<mid) dst[d++]=src[x++];
+         while (y<end) dst[d++]=src[y++];
+       }
+       runs[k++]=end;
+       start=end;
+     }
+     nruns=k;
+     T* t=src; src=dst; dst=t;
+   }
+   if (src!=a)
+     for (int x=0;x<n;x++) a[x]=src[x];
+   delete[] buf;
+ }
+ GFREE(runs);
+}
+
+//GStableSort() comparators for GVec items and GPVec pointers
+template <class OBJ> struct GVecItemCmp {
+ GCompareProc* proc;
+ GVecItemCmp(GCompareProc* cmpFunc):proc(cmpFunc) { }
+ int operator()(OBJ& a, OBJ& b) { return proc((pointer)&a, (pointer)&b); }
+};
+
+template <class OBJ> struct GPVecItemCmp {
+ GCompareProc* proc;
+ GPVecItemCmp(GCompareProc* cmpFunc):proc(cmpFunc) { }
+ int operator()(OBJ* a, OBJ* b) { return proc((pointer)a, (pointer)b); }
+};
+
 //basic template for array of objects;
 //so it doesn't require comparison operators to be defined
 template <class OBJ> class GVec {
@@ -124,6 +203,7 @@ template <class OBJ> class GVec {
 
     void Sort(GCompareProc* cmpFunc);
     void Sort();
+    void StableSort(GCompareProc* cmpFunc); //equal items keep their relative order
 };
 
 //---- template for dynamic array of object pointers
@@ -193,6 +273,7 @@ template <class OBJ> class GPVec {
     int IndexOf(pointer item); //a linear search for pointer address!
     void Sort(GCompareProc* cmpFunc);
     void Sort();
+    void StableSort(GCompareProc* cmpFunc); //equal items keep their relative order
  };
 
 //-------------------- TEMPLATE IMPLEMENTATION-------------------------------
@@ -552,6 +633,16 @@ template <class OBJ> void GVec<OBJ>::Sort() {
   Sort(cmpFunc);
 }
 
+template <class OBJ> void GVec<OBJ>::StableSort(GCompareProc* cmpFunc) {
+ if (cmpFunc==NULL) {
+   GMessage("Warning: NULL compare function given, useless StableSort() call.\n");
+   return;
+ }
+ GVecItemCmp<OBJ> cmp(cmpFunc);
+ if (this->fArray!=NULL && this->fCount>1)
+     GStableSort(this->fArray, this->fCount, cmp);
+}
+
 
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 //*=> GPVec implementation
@@ -850,8 +941,12 @@ return -1; //not found
 }
 
 template <class OBJ> void GPVec<OBJ>::Pack()  {
- for (int i=fCount-1; i>=0; i--)
-    if (fList[i]==NULL) Delete(i); //shift rest of fList content accordingly
+ //single pass: move the non-NULL pointers down over the NULL ones
+ int j=0;
+ for (int i=0; i<fCount; i++)
+    if (fList[i]!=NULL) fList[j++]=fList[i];
+ for (int i=j; i<fCount; i++) fList[i]=NULL;
+ fCount=j;
 }
 
 template <class OBJ> void GPVec<OBJ>::setCount(int NewCount) {
@@ -904,6 +999,16 @@ template <class OBJ> void GPVec<OBJ>::Sort() {
   Sort(cmpFunc);
 }
 
+template <class OBJ> void GPVec<OBJ>::StableSort(GCompareProc* cmpFunc) {
+ if (cmpFunc==NULL) {
+    GMessage("Warning: NULL compare function given, useless StableSort() call.\n");
+    return;
+    }
+ GPVecItemCmp<OBJ> cmp(cmpFunc);
+ if (this->fList!=NULL && this->fCount>1)
+     GStableSort(this->fList, this->fCount, cmp);
+}
+
 
 //---------------------------------------------------------------------------
 #endif
@@ -0,0 +1,281 @@
+#include "GbkReader.h"
+#include <ctype.h>
+
+GbkFeature::GbkFeature(const char* key, const char* loc):ftype(NULL), location(NULL),
+		strand('+'), segs(), partialStart(false), partialEnd(false), remote(false), quals() {
+	ftype=Gstrdup(key);
+	if (loc!=NULL) location=Gstrdup(loc);
+}
+
+GbkFeature::~GbkFeature() {
+	GFREE(ftype);
+	GFREE(location);
+	for (int i=0;i<quals.Count();i++) {
+		GFREE(quals[i].name);
+		GFREE(quals[i].value);
+	}
+}
+
+void GbkFeature::addQualifier(const char* qname, const char* qvalue) {
+	GbkQualifier q;
+	q.name=Gstrdup(qname);
+	q.value=(qvalue==NULL) ? NULL : Gstrdup(qvalue);
+	quals.Add(q);
+}
+
+const char* GbkFeature::getQualifier(const char* qname) {
+	for (int i=0;i<quals.Count();i++)
+		if (strcmp(quals[i].name, qname)==0) return quals[i].value;
+	return NULL;
+}
+
+bool GbkFeature::hasQualifier(const char* qname) {
+	for (int i=0;i<quals.Count();i++)
+		if (strcmp(quals[i].name, qname)==0) return true;
+	return false;
+}
+
+static int cmpSegs(const pointer p1, const pointer p2) {
+	GSeg& s1=*(GSeg*)p1;
+	GSeg& s2=*(GSeg*)p2;
+	if (s1.start!=s2.start) return (s1.start<s2.start) ? -1 : 1;
+	if (s1.end!=s2.end) return (s1.end<s2.end) ? -1 : 1;
+	return 0;
+}
+
+//ranges like 100..200, <1..>200, 150^151 or single bases, inside any
+//complement(), join() or order() operators; a feature with complement()
+//anywhere in its location is taken to be on the - strand
+bool GbkFeature::parseLocation() {
+	segs.Clear();
+	strand='+';
+	if (location==NULL) return false;
+	if (strchr(location, ':')!=NULL) { //refers to another entry
+		remote=true;
+		return false;
+	}
+	if (strstr(location, "complement(")!=NULL) strand='-';
+	partialStart=(strchr(location, '<')!=NULL);
+	partialEnd=(strchr(location, '>')!=NULL);
+	const char* p=location;
+	while (*p!=0) {
+		if (!isdigit(*p)) { p++; continue; }
+		char* e=NULL;
+		uint a=(uint)strtoul(p, &e, 10);
+		uint b=a;
+		p=e;
+		if ((p[0]=='.' && p[1]=='.') || *p=='^' || (*p=='.' && isdigit(p[1]))) {
+			p+=(p[1]=='.') ? 2 : 1;
+			while (*p=='<' || *p=='>') p++;
+			if (isdigit(*p)) {
+				b=(uint)strtoul(p, &e, 10);
+				p=e;
+			}
+		}
+		if (a>b) Gswap(a, b);
+		GSeg seg(a, b);
+		segs.Add(seg);
+	}
+	segs.Sort(cmpSegs);
+	return segs.Count()>0;
+}
+
+//the part of line after the feature table prefix (5 spaces, or "FT   "
+//for EMBL), or NULL if line is not a feature table line
+char* GbkReader::featureLine(char* line) {
+	if (embl) {
+		if (startsWith(line, "FT   ")) return line+5;
+		return (strcmp(line, "FT")==0) ? line+2 : NULL;
+	}
+	return (startsWith(line, "     ")) ? line+5 : NULL;
+}
+
+//strip the quotes of a qualifier value and add it to f
+void GbkReader::finishQualifier(GbkFeature* f, GStr& qname, GStr& qvalue) {
+	if (qname.is_empty()) return;
+	if (qvalue.is_empty() || qvalue[0]!='"') {
+		f->addQualifier(qname.chars(), qvalue.is_empty() ? NULL : qvalue.chars());
+	}
+	else {
+		GStr v;
+		int vlen=qvalue.length();
+		if (vlen>1 && qvalue[vlen-1]=='"') vlen--;
+		for (int i=1;i<vlen;i++) {
+			v.append(qvalue[i]);
+			if (qvalue[i]=='"' && i+1<vlen && qvalue[i+1]=='"') i++; //"" stands for "
+		}
+		f->addQualifier(qname.chars(), v.chars());
+	}
+	qname="";
+	qvalue="";
+}
+
+bool GbkReader::hasGbkExt(const char* fname) {
+	const char* fext=getFileExt(fname);
+	if (fext==NULL) return false;
+	return (Gstricmp(fext, "gbk")==0 || Gstricmp(fext, "gb")==0 || Gstricmp(fext, "gbff")==0 ||
+			Gstricmp(fext, "genbank")==0 || Gstricmp(fext, "embl")==0);
+}
+
+bool GbkReader::nextEntry() {
+	GFREE(seqname);
+	GFREE(descr);
+	seqlen=0;
+	inFeatures=false;
+	inEntry=false;
+	char* line=NULL;
+	while ((line=lr.getLine())!=NULL) {
+		if (startsWith(line, "LOCUS ")) { embl=false; break; }
+		if (startsWith(line, "ID   ")) { embl=true; break; }
+	}
+	if (line==NULL) return false;
+	inEntry=true;
+	//GenBank: LOCUS <name> <length> bp ..
+	//EMBL:    ID   <name>; SV 1; linear; genomic DNA; STD; PHG; <length> BP.
+	GStr hdr(line+5);
+	hdr.trim();
+	if (embl) {
+		int p=hdr.index(';');
+		GStr name=(p>0) ? hdr.substr(0, p) : hdr;
+		name.trim();
+		seqname=Gstrdup(name.chars());
+	}
+	GStr prevtk, tk;
+	hdr.startTokenize(" \t;", tkCharSet);
+	for (int i=0;hdr.nextToken(tk);i++) {
+		if (i==0 && !embl) seqname=Gstrdup(tk.chars());
+		if ((Gstricmp(tk.chars(), "bp")==0 || Gstricmp(tk.chars(), "bp.")==0) && !prevtk.is_empty())
+			seqlen=(uint)prevtk.asInt();
+		prevtk=tk;
+	}
+	if (seqname==NULL) seqname=Gstrdup("");
+	//header lines, up to the feature table
+	GStr defline;
+	bool indef=false;
+	while ((line=lr.getLine())!=NULL) {
+		if (startsWith(line, "//")) { lr.pushBack(); break; }
+		if (embl) {
+			if (startsWith(line, "DE   ")) {
+				GStr d(line+5);
+				d.trim();
+				if (!defline.is_empty()) defline.append(' ');
+				defline.append(d);
+				continue;
+			}
+			if (startsWith(line, "FT   ")) { lr.pushBack(); inFeatures=true; break; }
+			if (startsWith(line, "SQ ")) { lr.pushBack(); break; }
+		}
+		else {
+			if (indef && line[0]==' ') {
+				GStr d(line);
+				d.trim();
+				defline.append(' ');
+				defline.append(d);
+				continue;
+			}
+			indef=startsWith(line, "DEFINITION");
+			if (indef) {
+				GStr d(line+10);
+				d.trim();
+				defline.append(d);
+				continue;
+			}
+			if (startsWith(line, "FEATURES")) { inFeatures=true; break; }
+			if (startsWith(line, "ORIGIN")) { lr.pushBack(); break; }
+		}
+	}
+	descr=Gstrdup(defline.chars());
+	return true;
+}
+
+GbkFeature* GbkReader::nextFeature() {
+	if (!inFeatures) return NULL;
+	GbkFeature* f=NULL;
+	GStr loc;
+	GStr qname, qvalue;
+	bool inQuals=false; //location done, reading qualifiers
+	bool qopen=false; //inside a quoted qualifier value
+	char* line=NULL;
+	while ((line=lr.getLine())!=NULL) {
+		if (line[0]==0) continue;
+		char* body=featureLine(line);
+		if (body==NULL) { //end of the feature table
+			lr.pushBack();
+			inFeatures=false;
+			break;
+		}
+		if (body[0]!=' ' && body[0]!=0) { //feature key
+			if (f!=NULL) { lr.pushBack(); break; }
+			char* p=body;
+			while (*p!=0 && *p!=' ') p++;
+			char c=*p;
+			*p=0;
+			f=new GbkFeature(body, NULL);
+			*p=c;
+			loc=p;
+			loc.trim();
+			continue;
+		}
+		if (f==NULL) continue;
+		GStr t(body);
+		t.trim();
+		if (t.is_empty()) continue;
+		int vstart=0; //start of the value text in t
+		if (t[0]=='/' && !qopen) {
+			finishQualifier(f, qname, qvalue);
+			inQuals=true;
+			int eq=t.index('=');
+			if (eq<0) {
+				qname=t.substr(1);
+				vstart=t.length();
+			}
+			else {
+				qname=t.substr(1, eq-1);
+				qvalue=t.substr(eq+1);
+				if (qvalue.is_empty()) qvalue="\"\"";
+				vstart=eq+1;
+			}
+		}
+		else if (!inQuals) {
+			loc.append(t);
+			continue;
+		}
+		else {
+			if (qname!="translation") qvalue.append(' ');
+			qvalue.append(t);
+		}
+		for (int i=vstart;i<t.length();i++)
+			if (t[i]=='"') qopen=!qopen;
+	}
+	if (f!=NULL) {
+		finishQualifier(f, qname, qvalue);
+		f->location=Gstrdup(loc.chars());
+		f->parseLocation();
+	}
+	return f;
+}
+
+char* GbkReader::readSequence(uint& len) {
+	len=0;
+	if (!inEntry) return NULL;
+	GbkFeature* f=NULL;
+	while ((f=nextFeature())!=NULL) delete f; //skip the rest of the feature table
+	GDynArray<char> seq((seqlen>0) ? seqlen+1 : 1024);
+	bool inSeq=false;
+	char* line=NULL;
+	while ((line=lr.getLine())!=NULL) {
+		if (startsWith(line, "//")) break;
+		if (!inSeq) {
+			inSeq=embl ? startsWith(line, "SQ ") : startsWith(line, "ORIGIN");
+			continue;
+		}
+		for (char* p=line;*p!=0;p++)
+			if (isalpha(*p)) seq.Add((char)toupper(*p));
+	}
+	inEntry=false;
+	if (seq.Count()==0) return NULL;
+	len=seq.Count();
+	seq.Add('\0');
+	seq.DetachPtr();
+	return seq();
+}
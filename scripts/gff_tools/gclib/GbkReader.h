@@ -0,0 +1,79 @@
+/*
+ * GbkReader.h
+ *
+ *  Streaming reader for GenBank and EMBL flat files (e.g. Prokka's .gbk).
+ *  The entries are read one at a time: nextEntry() parses the header of
+ *  the next entry, nextFeature() returns its features in the order they
+ *  are found in the feature table, then readSequence() returns the entry's
+ *  sequence (ORIGIN or SQ section).
+ */
+
+#ifndef GBKREADER_H_
+#define GBKREADER_H_
+
+#include "GBase.h"
+#include "GStr.h"
+#include "GVec.hh"
+
+struct GbkQualifier {
+	char* name;
+	char* value; //NULL for qualifiers without a value (e.g. /pseudo)
+};
+
+class GbkFeature {
+ public:
+	char* ftype; //feature key (gene, CDS, tRNA..)
+	char* location; //location as given in the feature table
+	char strand; //'-' for complement() locations, '+' otherwise
+	GVec<GSeg> segs; //location segments, sorted by start coordinate
+	bool partialStart; //'<' found in the location
+	bool partialEnd; //'>' found in the location
+	bool remote; //the location refers to another entry (e.g. J00194.1:100..202)
+	GVec<GbkQualifier> quals;
+	GbkFeature(const char* key, const char* loc);
+	~GbkFeature();
+	void addQualifier(const char* qname, const char* qvalue);
+	//value of the first qualifier qname, or NULL if not found
+	//(or if the qualifier has no value, see hasQualifier())
+	const char* getQualifier(const char* qname);
+	bool hasQualifier(const char* qname);
+	//parse location into strand and segs; false if no (local) segments found
+	bool parseLocation();
+};
+
+class GbkReader {
+	GLineReader lr;
+	bool embl; //EMBL format: feature lines start with FT, the sequence with SQ
+	bool inFeatures; //the feature table of the current entry is being read
+	bool inEntry; //the current entry was not read up to its end (//) yet
+	char* seqname; //LOCUS name (GenBank) or ID (EMBL) of the current entry
+	uint seqlen; //sequence length declared in the header
+	char* descr; //DEFINITION (GenBank) or DE (EMBL) of the current entry
+	char* featureLine(char* line);
+	void finishQualifier(GbkFeature* f, GStr& qname, GStr& qvalue);
+ public:
+	GbkReader(FILE* f):lr(f), embl(false), inFeatures(false), inEntry(false),
+			seqname(NULL), seqlen(0), descr(NULL) { }
+	~GbkReader() {
+		GFREE(seqname);
+		GFREE(descr);
+	}
+	//skip to the next entry and parse its header, up to the feature table;
+	//returns false at the end of the input
+	bool nextEntry();
+	//next feature of the current entry, or NULL at the end of the feature table;
+	//the returned object must be deleted by the caller
+	GbkFeature* nextFeature();
+	//read the rest of the current entry, returning its sequence (upper case,
+	//to be freed by the caller) or NULL if the entry has no sequence
+	char* readSequence(uint& len);
+	bool isEMBL() { return embl; }
+	const char* seqName() { return seqname; }
+	uint seqLength() { return seqlen; }
+	const char* description() { return descr; }
+	int lineCount() { return lr.readcount(); }
+	//GenBank/EMBL file name extension (.gbk, .gb, .gbff, .genbank, .embl)
+	static bool hasGbkExt(const char* fname);
+};
+
+#endif /* GBKREADER_H_ */
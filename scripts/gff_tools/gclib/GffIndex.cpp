@@ -0,0 +1,542 @@
+/*
+ * GffIndex.cpp
+ *
+ *  Coordinate index for sorted GFF3/GTF files (see GffIndex.h)
+ */
+
+#include "GffIndex.h"
+#include "GIntHash.hh"
+#include "GStr.h"
+
+#ifdef ENABLE_COMPRESSION
+#include <zlib.h>
+#endif
+
+#define ERR_GXILINE "Error parsing GFF index line: \n%s\n"
+#define GXI_HEADER "##gxi"
+#define BGZF_MAXBLOCK 65536
+
+static const char err_BGZF_NOZLIB[]="Error: %s is BGZF-compressed but compression support was not compiled in!\n";
+
+//sequential or random access reader for plain or BGZF-compressed files;
+//offsets are plain file offsets or BGZF virtual offsets
+// (compressed block offset<<16 | offset in the uncompressed block)
+class GffIdxFile {
+	FILE* f;
+	const char* fname;
+	bool bgzf;
+	char* ubuf; //uncompressed data of the current block
+	int ulen;
+	int upos;
+	int64 blockOfs; //file offset of the current block
+	int64 nextOfs; //file offset of the next block
+	char* line;
+	int linecap;
+#ifdef ENABLE_COMPRESSION
+	char* cbuf;
+	bool readBgzfBlock() {
+		blockOfs=nextOfs;
+		ulen=0;
+		upos=0;
+		unsigned char hdr[18];
+		size_t r=fread(hdr, 1, 18, f);
+		if (r==0) return false;
+		if (r<18 || hdr[0]!=31 || hdr[1]!=139 || (hdr[3] & 4)==0 ||
+				hdr[12]!='B' || hdr[13]!='C')
+			GError("Error: invalid BGZF block in %s (offset %lld)\n", fname, (long long)blockOfs);
+		int bsize=(hdr[16] | (hdr[17]<<8))+1;
+		int xlen=hdr[10] | (hdr[11]<<8);
+		int clen=bsize-18;
+		if (clen<8 || (int)fread(cbuf, 1, clen, f)!=clen)
+			GError("Error: truncated BGZF block in %s (offset %lld)\n", fname, (long long)blockOfs);
+		nextOfs=blockOfs+bsize;
+		//skip any remaining extra subfields after BC (xlen>6)
+		int cstart=xlen-6;
+		int cdlen=clen-cstart-8;
+		unsigned char* ct=(unsigned char*)(cbuf+clen-4);
+		uint isize=ct[0] | (ct[1]<<8) | (ct[2]<<16) | ((uint)ct[3]<<24);
+		if (isize==0) return true; //empty block (EOF marker)
+		z_stream zs;
+		memset(&zs, 0, sizeof(zs));
+		zs.next_in=(Bytef*)(cbuf+cstart);
+		zs.avail_in=cdlen;
+		zs.next_out=(Bytef*)ubuf;
+		zs.avail_out=BGZF_MAXBLOCK;
+		if (inflateInit2(&zs, -15)!=Z_OK)
+			GError("Error: inflateInit2 failed for %s\n", fname);
+		int zr=inflate(&zs, Z_FINISH);
+		inflateEnd(&zs);
+		if (zr!=Z_STREAM_END || zs.total_out!=isize)
+			GError("Error: failed to decompress BGZF block in %s (offset %lld)\n", fname, (long long)blockOfs);
+		ulen=isize;
+		return true;
+	}
+#endif
+	bool readBlock() {
+		if (bgzf) {
+#ifdef ENABLE_COMPRESSION
+			//skip empty blocks
+			while (readBgzfBlock()) {
+				if (ulen>0) return true;
+			}
+#endif
+			return false;
+		}
+		blockOfs=nextOfs;
+		upos=0;
+		ulen=(int)fread(ubuf, 1, BGZF_MAXBLOCK, f);
+		nextOfs=blockOfs+ulen;
+		return (ulen>0);
+	}
+ public:
+	GffIdxFile(const char* fn, bool compressed):f(NULL), fname(fn), bgzf(compressed),
+			ubuf(NULL), ulen(0), upos(0), blockOfs(0), nextOfs(0), line(NULL), linecap(0) {
+#ifdef ENABLE_COMPRESSION
+		cbuf=NULL;
+		GMALLOC(cbuf, BGZF_MAXBLOCK);
+#else
+		if (bgzf) GError(err_BGZF_NOZLIB, fname);
+#endif
+		f=fopen(fname, "rb");
+		if (f==NULL) GError("Error: cannot open file %s!\n", fname);
+		GMALLOC(ubuf, BGZF_MAXBLOCK);
+		linecap=1024;
+		GMALLOC(line, linecap);
+	}
+	~GffIdxFile() {
+		if (f) fclose(f);
+		GFREE(ubuf);
+		GFREE(line);
+#ifdef ENABLE_COMPRESSION
+		GFREE(cbuf);
+#endif
+	}
+	int64 tell() {
+		if (upos==ulen && ulen>0) { //at the end of a block: point to the next one
+			if (bgzf) return (nextOfs<<16);
+			return nextOfs;
+		}
+		return bgzf ? ((blockOfs<<16) | upos) : blockOfs+upos;
+	}
+	void seek(int64 ofs) {
+		int64 fofs = bgzf ? (ofs>>16) : ofs;
+		if (fseeko(f, fofs, SEEK_SET)!=0)
+			GError("Error: cannot seek to offset %lld in %s\n", (long long)fofs, fname);
+		nextOfs=fofs;
+		ulen=0;
+		upos=0;
+		if (!readBlock()) return;
+		if (bgzf) upos=(int)(ofs & 0xFFFF);
+	}
+	//next line without the line terminator, NULL at the end of file;
+	//len is set to the number of bytes consumed (including the terminator)
+	char* nextLine(int& len) {
+		len=0;
+		int n=0;
+		bool eol=false;
+		while (!eol) {
+			if (upos>=ulen && !readBlock()) break;
+			char* p=ubuf+upos;
+			char* e=(char*)memchr(p, '\n', ulen-upos);
+			int chunk= e ? (int)(e-p)+1 : ulen-upos;
+			if (n+chunk+1>linecap) {
+				while (n+chunk+1>linecap) linecap<<=1;
+				GREALLOC(line, linecap);
+			}
+			memcpy(line+n, p, chunk);
+			n+=chunk;
+			upos+=chunk;
+			eol=(e!=NULL);
+		}
+		if (n==0) return NULL;
+		len=n;
+		while (n>0 && (line[n-1]=='\n' || line[n-1]=='\r')) n--;
+		line[n]=0;
+		return line;
+	}
+	//copy len bytes from the current position to fout
+	void copyTo(FILE* fout, uint len) {
+		while (len>0) {
+			if (upos>=ulen && !readBlock())
+				GError("Error: unexpected end of file %s\n", fname);
+			uint chunk=ulen-upos;
+			if (chunk>len) chunk=len;
+			if (fwrite(ubuf+upos, 1, chunk, fout)!=chunk)
+				GError("Error writing temporary GFF data!\n");
+			upos+=chunk;
+			len-=chunk;
+		}
+	}
+};
+
+static uint32 keyHash(const char* s, int len) { //FNV-1a
+	uint32 h=2166136261u;
+	for (int i=0;i<len;i++) {
+		h^=(unsigned char)s[i];
+		h*=16777619u;
+	}
+	return h;
+}
+
+//find the value of a GFF3 attribute (attr is e.g. "Parent=") in the 9th column;
+//returns its length, 0 if not found
+static int gff3AttrValue(const char* attrs, const char* attr, const char*& v) {
+	int alen=strlen(attr);
+	const char* p=attrs;
+	while (*p) {
+		while (*p==' ' || *p==';') p++;
+		if (strncmp(p, attr, alen)==0) {
+			v=p+alen;
+			const char* e=v;
+			while (*e && *e!=';') e++;
+			return (int)(e-v);
+		}
+		while (*p && *p!=';') p++;
+	}
+	return 0;
+}
+
+//value of a GTF attribute (attr is e.g. "transcript_id"), 0 if not found
+static int gtfAttrValue(const char* attrs, const char* attr, const char*& v) {
+	const char* p=strstr(attrs, attr);
+	int alen=strlen(attr);
+	while (p!=NULL) {
+		if ((p==attrs || p[-1]==' ' || p[-1]==';' || p[-1]=='\t') && p[alen]==' ') {
+			v=p+alen;
+			while (*v==' ') v++;
+			if (*v=='"') v++;
+			const char* e=v;
+			while (*e && *e!='"' && *e!=';') e++;
+			return (int)(e-v);
+		}
+		p=strstr(p+alen, attr);
+	}
+	return 0;
+}
+
+void GffIdxSeq::buildBins() {
+	blocks.Sort();
+	bins.Clear();
+	if (blocks.Count()==0) return;
+	uint maxend=0;
+	for (int i=0;i<blocks.Count();i++)
+		if (blocks[i].end>maxend) maxend=blocks[i].end;
+	int nbins=(int)(maxend>>GFFIDX_BINSHIFT)+1;
+	bins.setCount(nbins, -1);
+	for (int i=0;i<blocks.Count();i++) {
+		int b0=(int)(blocks[i].start>>GFFIDX_BINSHIFT);
+		int b1=(int)(blocks[i].end>>GFFIDX_BINSHIFT);
+		for (int b=b0;b<=b1;b++)
+			if (bins[b]<0) bins[b]=i;
+	}
+	//empty bins point to the first block starting after them
+	int next=blocks.Count();
+	for (int b=nbins-1;b>=0;b--) {
+		if (bins[b]<0) bins[b]=next;
+		else next=bins[b];
+	}
+}
+
+int GffIdxSeq::findBlocks(uint start, uint end, GVec<int>& blkidx) {
+	int c=blkidx.Count();
+	int b=(int)(start>>GFFIDX_BINSHIFT);
+	if (b>=bins.Count()) return 0;
+	for (int i=bins[b];i<blocks.Count() && blocks[i].start<=end;i++) {
+		if (blocks[i].end>=start) blkidx.Add(i);
+	}
+	return blkidx.Count()-c;
+}
+
+bool GffIndex::isBGZF(const char* fname) {
+	FILE* f=fopen(fname, "rb");
+	if (f==NULL) return false;
+	unsigned char hdr[14];
+	bool r=(fread(hdr, 1, 14, f)==14 && hdr[0]==31 && hdr[1]==139 &&
+			(hdr[3] & 4)!=0 && hdr[12]=='B' && hdr[13]=='C');
+	fclose(f);
+	return r;
+}
+
+GffIndex::GffIndex(const char* fname, const char* finame):gff_name(NULL), gxi_name(NULL),
+		haveGxi(false), bgzf(false), gffSize(0), seqs() {
+	if (fileExists(fname)!=2) GError("Error: GFF file %s not found!\n", fname);
+	gff_name=Gstrdup(fname);
+	if (finame!=NULL) gxi_name=Gstrdup(finame);
+	else {
+		GMALLOC(gxi_name, strlen(fname)+strlen(GFFIDX_EXT)+1);
+		strcpy(gxi_name, fname);
+		strcat(gxi_name, GFFIDX_EXT);
+	}
+	bgzf=isBGZF(gff_name);
+	if (fileSize(gxi_name)>0) loadIndex(gxi_name);
+}
+
+int GffIndex::loadIndex(const char* finame) {
+	if (finame==NULL) finame=gxi_name;
+	seqs.Clear();
+	haveGxi=false;
+	FILE* fi=fopen(finame, "rb");
+	if (fi==NULL) {
+		GMessage("Warning: cannot open GFF index file: %s!\n", finame);
+		return 0;
+	}
+	GLineReader fl(fi);
+	char* s=NULL;
+	int numblocks=0;
+	GffIdxSeq* iseq=NULL;
+	GStr lastseq;
+	while ((s=fl.nextLine())!=NULL) {
+		if (*s=='#') {
+			if (startsWith(s, GXI_HEADER)) {
+				//##gxi <bgzf:0|1> <gff_size>
+				int z=0;
+				long long gsize=0;
+				sscanf(s+strlen(GXI_HEADER), "%d%lld", &z, &gsize);
+				gffSize=gsize;
+			}
+			continue;
+		}
+		char* p=strchr(s, '\t');
+		if (p==NULL) GError(ERR_GXILINE, s);
+		*p=0; //s is now the genomic sequence name
+		p++;
+		GffIdxBlock blk;
+		long long offset=-1;
+		if (sscanf(p, "%u%u%lld%u", &blk.start, &blk.end, &offset, &blk.len)!=4 || offset<0)
+			GError(ERR_GXILINE, p);
+		blk.offset=offset;
+		if (iseq==NULL || lastseq!=s) {
+			lastseq=s;
+			iseq=seqs.Find(s);
+			if (iseq==NULL) {
+				iseq=new GffIdxSeq();
+				seqs.Add(s, iseq);
+			}
+		}
+		iseq->blocks.Add(blk);
+		numblocks++;
+	}
+	fclose(fi);
+	seqs.startIterate();
+	while ((iseq=seqs.NextData())!=NULL)
+		iseq->buildBins();
+	haveGxi=(numblocks>0);
+	return numblocks;
+}
+
+//split the first 9 columns of a GFF line; returns the number of columns
+static int gffSplitCols(char* line, char* cols[9]) {
+	int ncols=0;
+	char* p=line;
+	cols[ncols++]=p;
+	while (ncols<9 && (p=strchr(p, '\t'))!=NULL) {
+		*p=0;
+		p++;
+		cols[ncols++]=p;
+	}
+	return ncols;
+}
+
+#define GFFIDX_MAXKEYS 8
+
+//hashes of the IDs linking a GFF line to other lines (GTF transcript_id and
+//gene_id, GFF3 ID and Parent), mixed with the hash of the genomic sequence name
+static int gffLineKeys(char* cols[9], int ncols, uint32 seqh, uint32* lkeys) {
+	const char* attrs= (ncols>8) ? cols[8] : "";
+	const char* v=NULL;
+	int vlen=0;
+	int nlkeys=0;
+	if ((vlen=gtfAttrValue(attrs, "transcript_id", v))>0)
+		lkeys[nlkeys++]=keyHash(v, vlen)^seqh;
+	if ((vlen=gtfAttrValue(attrs, "gene_id", v))>0)
+		lkeys[nlkeys++]=keyHash(v, vlen)^seqh;
+	if (nlkeys>0) return nlkeys;
+	if ((vlen=gff3AttrValue(attrs, "ID=", v))>0)
+		lkeys[nlkeys++]=keyHash(v, vlen)^seqh;
+	if ((vlen=gff3AttrValue(attrs, "Parent=", v))>0) {
+		//possibly multiple parents
+		const char* e=v+vlen;
+		while (v<e && nlkeys<GFFIDX_MAXKEYS) {
+			const char* c=(const char*)memchr(v, ',', e-v);
+			if (c==NULL) c=e;
+			lkeys[nlkeys++]=keyHash(v, (int)(c-v))^seqh;
+			v=c+1;
+		}
+	}
+	return nlkeys;
+}
+
+int GffIndex::buildIndex() {
+	seqs.Clear();
+	haveGxi=false;
+	gffSize=fileSize(gff_name);
+	char* cols[9];
+	uint32 lkeys[GFFIDX_MAXKEYS];
+	//1st pass: the last data line of each ID, so a block is kept open until
+	//all the lines of the features it contains were added (the lines of a
+	//transcript can be interleaved with other records); also checks that the
+	//file is sorted: the lines of a genomic sequence are contiguous and the
+	//records (first line of a feature without a known parent) are sorted by start
+	GIntHash<int> lastLine;
+	{
+		GffIdxFile gf(gff_name, bgzf);
+		GHash<int> seqdone; //genomic sequences already passed
+		GStr curseq;
+		uint32 seqh=0;
+		uint recStart=0; //start of the previous record
+		int lnum=0;
+		int rlen=0;
+		char* line=NULL;
+		while ((line=gf.nextLine(rlen))!=NULL) {
+			if (line[0]=='#') {
+				if (startsWith(line, "##FASTA")) break;
+				continue;
+			}
+			int ncols=gffSplitCols(line, cols);
+			if (ncols<8) continue;
+			if (curseq!=cols[0]) {
+				if (seqdone.Find(cols[0])!=NULL)
+					GError("Error: cannot index %s, it is not sorted (the lines of %s are not contiguous)!\n",
+							gff_name, cols[0]);
+				if (!curseq.is_empty()) seqdone.Add(curseq.chars(), new int(1));
+				curseq=cols[0];
+				seqh=keyHash(cols[0], strlen(cols[0]));
+				recStart=0;
+			}
+			lnum++;
+			int nlkeys=gffLineKeys(cols, ncols, seqh, lkeys);
+			bool newrec=true;
+			for (int k=0;k<nlkeys;k++)
+				if (lastLine.Find(lkeys[k])!=NULL) newrec=false;
+			if (newrec) {
+				uint fstart=(uint)strtoul(cols[3], NULL, 10);
+				if (fstart<recStart)
+					GError("Error: cannot index %s, it is not sorted by coordinates (%s:%u found after %s:%u)!\n",
+							gff_name, cols[0], fstart, cols[0], recStart);
+				recStart=fstart;
+			}
+			for (int k=0;k<nlkeys;k++) lastLine.Add(lkeys[k], lnum);
+		}
+	}
+	//2nd pass: build the blocks
+	GffIdxFile gf(gff_name, bgzf);
+	GffIdxSeq* iseq=NULL;
+	GStr curseq;
+	uint32 seqh=0;
+	GffIdxBlock blk;
+	bool inblock=false;
+	int blkLast=0; //last data line of the IDs in the current block
+	int numblocks=0;
+	int lnum=0;
+	while (true) {
+		int64 lofs=gf.tell();
+		int rlen=0;
+		char* line=gf.nextLine(rlen);
+		if (line==NULL) break;
+		if (line[0]=='#') {
+			if (startsWith(line, "##FASTA")) break;
+			if (inblock) blk.len+=rlen;
+			continue;
+		}
+		int ncols=gffSplitCols(line, cols);
+		if (ncols<8) { //not a GFF data line
+			if (inblock) blk.len+=rlen;
+			continue;
+		}
+		lnum++;
+		uint fstart=(uint)strtoul(cols[3], NULL, 10);
+		uint fend=(uint)strtoul(cols[4], NULL, 10);
+		if (fstart==0 || fend==0) GError("Error: invalid GFF coordinates at offset %lld in %s\n",
+				(long long)lofs, gff_name);
+		if (fend<fstart) Gswap(fstart, fend);
+		bool newseq=(curseq!=cols[0]);
+		if (inblock && (newseq || (fstart>blk.end && lnum>blkLast))) {
+			//close the current block
+			iseq->blocks.Add(blk);
+			numblocks++;
+			inblock=false;
+		}
+		if (newseq) {
+			curseq=cols[0];
+			seqh=keyHash(cols[0], strlen(cols[0]));
+			iseq=seqs.Find(cols[0]);
+			if (iseq==NULL) {
+				iseq=new GffIdxSeq();
+				seqs.Add(cols[0], iseq);
+			}
+		}
+		if (!inblock) {
+			blk.start=fstart;
+			blk.end=fend;
+			blk.offset=lofs;
+			blk.len=0;
+			blkLast=0;
+			inblock=true;
+		}
+		else {
+			if (fstart<blk.start) blk.start=fstart;
+			if (fend>blk.end) blk.end=fend;
+		}
+		blk.len+=rlen;
+		int nlkeys=gffLineKeys(cols, ncols, seqh, lkeys);
+		for (int k=0;k<nlkeys;k++) {
+			int* l=lastLine.Find(lkeys[k]);
+			if (l!=NULL && *l>blkLast) blkLast=*l;
+		}
+	}
+	if (inblock) {
+		iseq->blocks.Add(blk);
+		numblocks++;
+	}
+	seqs.startIterate();
+	while ((iseq=seqs.NextData())!=NULL)
+		iseq->buildBins();
+	haveGxi=(numblocks>0);
+	return numblocks;
+}
+
+int GffIndex::storeIndex(const char* finame) {
+	if (finame==NULL) finame=gxi_name;
+	FILE* fo=fopen(finame, "w");
+	if (fo==NULL) GError("Error creating GFF index file %s\n", finame);
+	fprintf(fo, "%s\t%d\t%lld\n", GXI_HEADER, bgzf ? 1 : 0, (long long)gffSize);
+	int numblocks=0;
+	seqs.startIterate();
+	char* seqname=NULL;
+	GffIdxSeq* iseq=NULL;
+	while ((iseq=seqs.NextData(seqname))!=NULL) {
+		for (int i=0;i<iseq->blocks.Count();i++) {
+			GffIdxBlock& b=iseq->blocks[i];
+			fprintf(fo, "%s\t%u\t%u\t%lld\t%u\n", seqname, b.start, b.end,
+					(long long)b.offset, b.len);
+			numblocks++;
+		}
+	}
+	fclose(fo);
+	return numblocks;
+}
+
+static int cmpBlockOffset(const pointer p1, const pointer p2) {
+	int64 o1=((GffIdxBlock*)p1)->offset;
+	int64 o2=((GffIdxBlock*)p2)->offset;
+	return (o1<o2) ? -1 : ((o1>o2) ? 1 : 0);
+}
+
+int GffIndex::fetchRegion(const char* gseq, uint start, uint end, FILE* fout) {
+	GffIdxSeq* iseq=seqs.Find(gseq);
+	if (iseq==NULL) return 0;
+	if (start==0) start=1;
+	GVec<int> blkidx;
+	if (iseq->findBlocks(start, end, blkidx)==0) return 0;
+	//read the blocks in file order
+	GVec<GffIdxBlock> rblocks(blkidx.Count());
+	for (int i=0;i<blkidx.Count();i++)
+		rblocks.Add(iseq->blocks[blkidx[i]]);
+	rblocks.Sort(cmpBlockOffset);
+	GffIdxFile gf(gff_name, bgzf);
+	for (int i=0;i<rblocks.Count();i++) {
+		gf.seek(rblocks[i].offset);
+		gf.copyTo(fout, rblocks[i].len);
+	}
+	return rblocks.Count();
+}
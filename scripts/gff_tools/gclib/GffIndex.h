@@ -0,0 +1,86 @@
+/*
+ * GffIndex.h
+ *
+ *  Coordinate index for sorted GFF3/GTF files (plain or BGZF-compressed),
+ *  used for random access region queries without parsing the whole file.
+ *
+ *  The data lines are grouped into blocks: a block is a contiguous run of
+ *  lines on the same genomic sequence which either overlap each other or
+ *  belong to the same parent feature (GFF3 Parent/ID, GTF transcript_id),
+ *  so fetching the blocks overlapping a region gives all the lines needed
+ *  to rebuild the transcripts/genes found there. The file must be sorted:
+ *  the lines of a genomic sequence together, its records (features without
+ *  a parent in the file) in the order of their start coordinates.
+ *  For each genomic sequence a linear index of GFFIDX_BINSIZE bins points
+ *  to the first block to check for a query starting in that bin.
+ *
+ *  The index is stored in a text file (<gff_file>.gxi) with a header line
+ *  followed by one line per block:
+ *    <seqname> <start> <end> <offset> <length>
+ *  where <offset> is a file offset (or a BGZF virtual offset) and <length>
+ *  is the uncompressed length of the block in bytes.
+ */
+
+#ifndef GFFIDX_H_
+#define GFFIDX_H_
+
+#include "GHash.hh"
+#include "GVec.hh"
+
+#define GFFIDX_EXT ".gxi"
+#define GFFIDX_BINSHIFT 14
+#define GFFIDX_BINSIZE (1<<GFFIDX_BINSHIFT)
+
+struct GffIdxBlock {
+	uint start;
+	uint end;
+	int64 offset; //file offset, or BGZF virtual offset
+	uint len; //uncompressed length in bytes
+	bool operator<(const GffIdxBlock& b) const {
+		return (start==b.start) ? (offset<b.offset) : (start<b.start);
+	}
+	bool operator==(const GffIdxBlock& b) const {
+		return (start==b.start && offset==b.offset);
+	}
+};
+
+class GffIdxSeq { //the blocks on a genomic sequence
+ public:
+	GVec<GffIdxBlock> blocks; //sorted by start coordinate
+	GVec<int> bins; //bins[b] = index of the first block to check for bin b
+	GffIdxSeq():blocks(), bins() { }
+	void buildBins();
+	//append to blkidx the indexes of the blocks overlapping start..end
+	int findBlocks(uint start, uint end, GVec<int>& blkidx);
+};
+
+class GffIndex {
+	char* gff_name;
+	char* gxi_name;
+	bool haveGxi;
+	bool bgzf; //the GFF file is BGZF-compressed
+	int64 gffSize; //size of the GFF file when the index was built
+ public:
+	GHash<GffIdxSeq> seqs;
+	GffIndex(const char* fname, const char* finame=NULL);
+	~GffIndex() {
+		GFREE(gff_name);
+		GFREE(gxi_name);
+	}
+	bool hasIndex() { return haveGxi; }
+	bool isCompressed() { return bgzf; }
+	//false if the GFF file changed (size) after its index was built
+	bool isCurrent() { return (haveGxi && fileSize(gff_name)==gffSize); }
+	const char* indexFileName() { return gxi_name; }
+	int loadIndex(const char* finame=NULL);
+	//parse the whole GFF file and index it in memory (unsorted input is an error)
+	int buildIndex();
+	int storeIndex(const char* finame=NULL);
+	//write to fout all the GFF lines needed to rebuild the records
+	//overlapping start..end on genomic sequence gseq;
+	//returns the number of blocks written
+	int fetchRegion(const char* gseq, uint start, uint end, FILE* fout);
+	static bool isBGZF(const char* fname);
+};
+
+#endif /* GFFIDX_H_ */
@@ -1,18 +1,16 @@
 #include "gff.h"
-
-GffNames* GffObj::names=NULL;
-//global set of feature names, attribute names etc.
-// -- common for all GffObjs in current application!
+#include "GPipe.h"
 
 const uint GFF_MAX_LOCUS = 7000000; //longest known gene in human is ~2.2M, UCSC claims a gene for mouse of ~ 3.1 M
 const uint GFF_MAX_EXON  =   30000; //longest known exon in human is ~11K
 const uint GFF_MAX_INTRON= 6000000; //Ensembl shows a >5MB mouse intron
 const int  GFF_MIN_INTRON = 4; //for mergeCloseExons option
 //bool gff_show_warnings = false; //global setting, set by GffReader->showWarnings()
-int gff_fid_mRNA=0; //mRNA (has CDS)
-int gff_fid_transcript=1; // generic "transcript" feature
-int gff_fid_exon=2; // generic "exon"-like feature (exon,CDS,UTR,start/stop codon)
-int gff_fid_CDS=3; // CDS feature (CDS, start/stop codon)
+//reserved feats indexes, the same in every GffNames dictionary
+const int gff_fid_mRNA=0; //mRNA (has CDS)
+const int gff_fid_transcript=1; // generic "transcript" feature
+const int gff_fid_exon=2; // generic "exon"-like feature (exon,CDS,UTR,start/stop codon)
+const int gff_fid_CDS=3; // CDS feature (CDS, start/stop codon)
 const char* exonTypes[]={ "None", "StartCodon", "StopCodon",
 		  "CDS", "UTR", "CDS+UTR", "exon" };
 
@@ -20,15 +18,69 @@ const GffScore GFFSCORE_NONE;
 //const uint gfo_flag_LEVEL_MSK        = 0x00FF0000;
 //const byte gfo_flagShift_LEVEL           = 16;
 
+GffNameList::GffNameList():fCount(0), table(NULL), lock() {
+  memset(chunks, 0, sizeof(chunks));
+  table=new NameTable();
+  table->size=64;
+  GCALLOC(table->slots, table->size*sizeof(GffNameInfo*));
+  table->prev=NULL;
+}
+
+GffNameList::~GffNameList() {
+  for (int i=0;i<fCount;i++) delete entry(i);
+  for (int k=0;k<MAX_CHUNKS;k++) GFREE(chunks[k]);
+  while (table!=NULL) {
+    NameTable* t=table->prev;
+    GFREE(table->slots);
+    delete table;
+    table=t;
+  }
+}
+
+int GffNameList::add(const char* tname) {
+  int nid=fCount;
+  if ((uint)(nid+1)*4 > table->size*3) { //grow the index
+    NameTable* t=new NameTable();
+    t->size=table->size*2;
+    GCALLOC(t->slots, t->size*sizeof(GffNameInfo*));
+    t->prev=table;
+    uint mask=t->size-1;
+    for (int i=0;i<nid;i++) {
+      GffNameInfo* f=entry(i);
+      uint p=nameHash(f->name) & mask;
+      while (t->slots[p]!=NULL) p=(p+1) & mask;
+      t->slots[p]=f;
+    }
+    __atomic_store_n(&table, t, __ATOMIC_RELEASE);
+  }
+  uint j=((uint)nid>>CHUNK0_BITS)+1;
+  int k=31-__builtin_clz(j);
+  if (k>=MAX_CHUNKS) GError("GffNameList Error: too many names!\n");
+  if (chunks[k]==NULL)
+    GMALLOC(chunks[k], (1<<(k+CHUNK0_BITS))*sizeof(GffNameInfo*));
+  GffNameInfo* f=new GffNameInfo(tname);
+  f->idx=nid;
+  entry(nid)=f;
+  //the id is valid for getName() before the name can be found by getId()
+  __atomic_store_n(&fCount, nid+1, __ATOMIC_RELEASE);
+  uint mask=table->size-1;
+  uint p=nameHash(f->name) & mask;
+  while (table->slots[p]!=NULL) p=(p+1) & mask;
+  __atomic_store_n(&(table->slots[p]), f, __ATOMIC_RELEASE);
+  return nid;
+}
+
 void gffnames_ref(GffNames* &n) {
   if (n==NULL) n=new GffNames();
-  n->numrefs++;
+  __sync_add_and_fetch(&(n->numrefs), 1);
 }
 
 void gffnames_unref(GffNames* &n) {
   if (n==NULL) GError("Error: attempt to remove reference to null GffNames object!\n");
-  n->numrefs--;
-  if (n->numrefs==0) { delete n; n=NULL; }
+  if (__sync_sub_and_fetch(&(n->numrefs), 1)==0) {
+    delete n;
+    n=NULL;
+  }
 }
 
 const int CLASSCODE_OVL_RANK = 15;
@@ -485,7 +537,7 @@ GffLine::GffLine(GffReader* reader, const char* l): _parents(NULL), _parents_len
  else if ((someRNA=endsWith(fnamelc,"rna")) || endsWith(fnamelc,"transcript")) { // || startsWith(fnamelc+1, "rna")) {
 	 is_transcript=true;
 	 is_t_data=true;
-	 if (someRNA) ftype_id=GffObj::names->feats.addName(ftype);
+	 if (someRNA) ftype_id=reader->names->feats.addName(ftype);
  }
  else if (endsWith(fnamelc, "_gene_segment")) {
 	 is_transcript=true;
@@ -811,7 +863,7 @@ void GffObj::setCDS(uint cd_start, uint cd_end, char phase) {
   subftype_id=gff_fid_exon;
   if (monoFeature()) {
      if (exons.Count()==0) addExon(this->start, this->end, exgffExon);
-            else exons[0]->exontype=exgffExon;
+            else exons[0].exontype=exgffExon;
   }
 }
 
@@ -837,14 +889,11 @@ void GffObj::setCDS(GffObj* t) {
 	subftype_id=gff_fid_exon;
 	if (monoFeature()) {
 	   if (exons.Count()==0) addExon(this->start, this->end, exgffExon);
-	          else exons[0]->exontype=exgffExon;
+	          else exons[0].exontype=exgffExon;
 	}
 	if (t->cdss!=NULL) {
        if (this->cdss!=NULL) delete cdss;
-       cdss=new GList<GffExon>(true, true, false);
-       for (int i=0;i<t->cdss->Count();i++) {
-    	   cdss->Add(new GffExon(*(t->cdss->Get(i))));
-       }
+       cdss=new GffExonVec(*(t->cdss)); //copies the segments and their attributes
 	}
 }
 
@@ -875,7 +924,7 @@ int GffObj::readExon(GffReader& reader, GffLine& gl) {
        subftype_id=subf_id;
     else {
        if (subftype_id!=subf_id) {
-         if (subftype_id==ftype_id && exons.Count()==1 && exons[0]->start==start && exons[0]->end==end) {
+         if (subftype_id==ftype_id && exons.Count()==1 && exons[0].start==start && exons[0].end==end) {
             //the existing exon was just a dummy one created by default, discard it?
             exons.Clear();
             covlen=0;
@@ -900,10 +949,10 @@ int GffObj::readExon(GffReader& reader, GffLine& gl) {
     } //new subfeature type
   } //non-mRNA parent
   int eidx=-1;
-  GList<GffExon>* segs=NULL; //either cds or &exons
+  GffExonVec* segs=NULL; //either cds or &exons
   if (gl.is_cds) {
      if (cdss==NULL)
-       cdss=new GList<GffExon>(true, true, false);
+       cdss=new GffExonVec();
      segs=cdss;
   } else {
      segs=&exons;
@@ -918,13 +967,14 @@ int GffObj::readExon(GffReader& reader, GffLine& gl) {
            parseAttrs(attrs, gl.info, true);
      }
      else { //need all exon-level attributes
-         parseAttrs((*segs)[eidx]->attrs, gl.info, true, gl.is_cds);
+         parseAttrs((*segs)[eidx].attrs, gl.info, true, gl.is_cds);
      }
   }
   return eidx;
 }
 
-int GffObj::addExon(GList<GffExon>& segs, GffLine& gl, int8_t exontype_override) {
+int GffObj::addExon(GffExonVec& segs, GffLine& gl, int8_t exontype_override) {
+	GMEM_TAG(gmtGffObj);
 	int ex_type=(exontype_override!=exgffNone) ? exontype_override : gl.exontype;
 	GffScore exon_score(gl.score, gl.score_decimals);
 	int eidx=addExon(gl.fstart, gl.fend, ex_type, gl.phase, exon_score, &segs);
@@ -932,24 +982,24 @@ int GffObj::addExon(GList<GffExon>& segs, GffLine& gl, int8_t exontype_override)
      //special NCBI cases where CDS can be treated as discontiguous features, grouped by their ID
 	 //-- used for genes with X_gene_segment features
 	 //char* cds_id=Gstrdup(gl.ID);
-	 //segs[eidx]->uptr=cds_id;
-	 segs[eidx]->uptr=gl.ID;
+	 //segs[eidx].uptr=cds_id;
+	 segs[eidx].uptr=gl.ID;
 	 gl.ID=NULL;
 	}
 	return eidx;
 }
 
-int GffObj::exonOverlapIdx(GList<GffExon>& segs, uint s, uint e, int* ovlen, int start_idx) {
+int GffObj::exonOverlapIdx(GffExonVec& segs, uint s, uint e, int* ovlen, int start_idx) {
 	//return the exons' index for the overlapping OR ADJACENT exon
 	//ovlen, if given, will return the overlap length
 	//if (s>e) Gswap(s,e);
 	for (int i=start_idx;i<segs.Count();i++) {
-		if (segs[i]->start>e+1) break;
-		if (s-1>segs[i]->end) continue;
+		if (segs[i].start>e+1) break;
+		if (s-1>segs[i].end) continue;
 		//-- overlap/adjacent if we are here:
 		if (ovlen!=NULL) {
-			int ovlend= (segs[i]->end>e) ? e : segs[i]->end;
-			*ovlen= ovlend - ((s>segs[i]->start)? s : segs[i]->start)+1;
+			int ovlend= (segs[i].end>e) ? e : segs[i].end;
+			*ovlen= ovlend - ((s>segs[i].start)? s : segs[i].start)+1;
 		}
 		return i;
 	} //for each exon
@@ -957,14 +1007,15 @@ int GffObj::exonOverlapIdx(GList<GffExon>& segs, uint s, uint e, int* ovlen, int
 	return -1;
 }
 
-void GffObj::transferCDS(GffExon* cds) {
-	//direct adding of a cds to the cdss pointer, without checking
-	 if (cdss==NULL) cdss=new GList<GffExon>(true, true, false);
-	 cdss->Add(cds); //now the caller must forget this exon!
-	 if (CDstart==0 || CDstart>cds->start) CDstart=cds->start;
+void GffObj::transferCDS(GffExon& cds) {
+	//direct adding of a cds copy to cdss, without checking
+	 if (cdss==NULL) cdss=new GffExonVec();
+	 cdss->AddSorted(cds); //now the caller can delete its cds
+	 if (CDstart==0 || CDstart>cds.start) CDstart=cds.start;
 }
 
-int GffObj::addExon(uint segstart, uint segend, int8_t exontype, char phase, GffScore exon_score, GList<GffExon>* segs) {
+int GffObj::addExon(uint segstart, uint segend, int8_t exontype, char phase, GffScore exon_score, GffExonVec* segs) {
+   GMEM_TAG(gmtGffObj);
    if (segstart>segend) { Gswap(segstart, segend); }
    if (segs==NULL) segs=&exons;
 	if (exontype!=exgffNone) { //check for overlaps between exon/CDS-type segments
@@ -973,19 +1024,19 @@ int GffObj::addExon(uint segstart, uint segend, int8_t exontype, char phase, Gff
 		int oi=-1;
 	    while ((oi=exonOverlapIdx(*segs, segstart, segend, &ovlen, oi+1))>=0) {
 	        //note: ovlen==0 for adjacent segments
-		    if ((*segs)[oi]->exontype>exgffNone &&
-		    		(*segs)[oi]->start<=segstart && (*segs)[oi]->end>=segend) {
+		    if ((*segs)[oi].exontype>exgffNone &&
+		    		(*segs)[oi].start<=segstart && (*segs)[oi].end>=segend) {
 		    		//existing feature contains this segment, so we do NOT need to add it
 		    	    //-- unless its the annoying NCBI exception: gene with multiple alternate
 		    	    //        _gene_segment CDS features!
 		    		if (!(this->isGene() && exontype==exgffCDS &&
-		    				(*segs)[oi]->exontype==exgffCDS ))
+		    				(*segs)[oi].exontype==exgffCDS ))
 		    			return oi;
 		    }
-		    if (ovlen==0 || !(exontype==exgffCDS && (*segs)[oi]->exontype==exgffCDS)) {
+		    if (ovlen==0 || !(exontype==exgffCDS && (*segs)[oi].exontype==exgffCDS)) {
 		    	//always merge adjacent features
 		    	//but NEVER merge two overlapping CDS (CDS programmed ribosomal shift aware)
-		    	int8_t segtype=((*segs)[oi]->exontype==exgffCDS || exontype==exgffCDS) ? exgffCDS : exgffExon;
+		    	int8_t segtype=((*segs)[oi].exontype==exgffCDS || exontype==exgffCDS) ? exgffCDS : exgffExon;
 		    	//if expanded upward, may overlap the segment(s) above
 		    	expandSegment(*segs, oi, segstart, segend, segtype);
 		    	return oi;
@@ -993,49 +1044,43 @@ int GffObj::addExon(uint segstart, uint segend, int8_t exontype, char phase, Gff
 	    }
 	} //exon overlap/adjacent check
    //new exon/CDS, not merged in a previous one
-   GffExon* enew=new GffExon(segstart, segend, exontype, phase, exon_score.score, exon_score.precision);
-   int eidx=segs->Add(enew);
-   if (eidx<0) {
-    //this would actually be possible if the object is a "Gene" and "exons" are in fact isoforms
-     delete enew;
-     hasErrors(true);
-     return -1;
-   }
-   if (start>segs->First()->start) start=segs->First()->start;
-   if (end<segs->Last()->end) end=segs->Last()->end;
+   GffExon enew(segstart, segend, exontype, phase, exon_score.score, exon_score.precision);
+   int eidx=segs->AddSorted(enew);
+   if (start>segs->First().start) start=segs->First().start;
+   if (end<segs->Last().end) end=segs->Last().end;
    if (isFinalized() && segs==&exons) {
-	   covlen+=(int)(exons[eidx]->end-exons[eidx]->start)+1;
+	   covlen+=(int)(exons[eidx].end-exons[eidx].start)+1;
    }
    return eidx;
 }
 
-void GffObj::expandSegment(GList<GffExon>& segs, int oi, uint segstart, uint segend, int8_t exontype) {
+void GffObj::expandSegment(GffExonVec& segs, int oi, uint segstart, uint segend, int8_t exontype) {
   //oi is the index of the *first* overlapping segment found that must be enlarged
-  covlen-=segs[oi]->len();
-  if (segstart<segs[oi]->start)
-	  segs[oi]->start=segstart;
-  //if (qs && qs<exons[oi]->qstart) exons[oi]->qstart=qs;
-  if (segend>segs[oi]->end)
-	  segs[oi]->end=segend;
-  //if (qe && qe>exons[oi]->qend) exons[oi]->qend=qe;
+  covlen-=segs[oi].len();
+  if (segstart<segs[oi].start)
+	  segs[oi].start=segstart;
+  //if (qs && qs<exons[oi].qstart) exons[oi].qstart=qs;
+  if (segend>segs[oi].end)
+	  segs[oi].end=segend;
+  //if (qe && qe>exons[oi].qend) exons[oi].qend=qe;
   //warning: score cannot be properly adjusted! e.g. if it's a p-value it's just going to get worse
-  //if (sc!=0) segs[oi]->score=sc;
-  //covlen+=exons[oi]->len();
-  //if (exons[oi]->exontype< exontype) -- always true
-  segs[oi]->exontype = exontype;
-  //if (exontype==exgffCDS) exons[oi]->phase=fr;
+  //if (sc!=0) segs[oi].score=sc;
+  //covlen+=exons[oi].len();
+  //if (exons[oi].exontype< exontype) -- always true
+  segs[oi].exontype = exontype;
+  //if (exontype==exgffCDS) exons[oi].phase=fr;
   //we must check if any more exons are also overlapping this
   int ni=oi+1; //next exon index after oi
-  while (ni<segs.Count() && segs[ni]->start<=segend+1) { // next segment overlaps OR adjacent to newly enlarged segment
-	  if (segs[ni]->exontype>0 &&
-		(segs[ni]->start==segend+1 || segs[ni]->exontype!=exgffCDS || exontype!=exgffCDS)) {
-         if (segs[ni]->start<segs[oi]->start) {
-        	 segs[oi]->start=segs[ni]->start;
-        	 if (strand=='+') segs[oi]->phase=segs[ni]->phase;
+  while (ni<segs.Count() && segs[ni].start<=segend+1) { // next segment overlaps OR adjacent to newly enlarged segment
+	  if (segs[ni].exontype>0 &&
+		(segs[ni].start==segend+1 || segs[ni].exontype!=exgffCDS || exontype!=exgffCDS)) {
+         if (segs[ni].start<segs[oi].start) {
+        	 segs[oi].start=segs[ni].start;
+        	 if (strand=='+') segs[oi].phase=segs[ni].phase;
          }
-         if (segs[ni]->end>segs[oi]->end) {
-        	 segs[oi]->end=segs[ni]->end;
-        	 if (strand=='-') segs[oi]->phase=segs[ni]->phase;
+         if (segs[ni].end>segs[oi].end) {
+        	 segs[oi].end=segs[ni].end;
+        	 if (strand=='-') segs[oi].phase=segs[ni].phase;
          }
 
          segs.Delete(ni);
@@ -1044,43 +1089,43 @@ void GffObj::expandSegment(GList<GffExon>& segs, int oi, uint segstart, uint seg
   // -- make sure any other related boundaries are updated:
   if (isFinalized()) {
 	  if (&segs==&exons) {
-		start=exons.First()->start;
-		end=exons.Last()->end;
+		start=exons.First().start;
+		end=exons.Last().end;
 		//recalculate covlen
 		covlen=0;
-		for (int i=0;i<exons.Count();++i) covlen+=exons[i]->len();
+		for (int i=0;i<exons.Count();++i) covlen+=exons[i].len();
 	  }
   }
   else {
-	  if (start>segs.First()->start) start=segs.First()->start;
-	  if (end<segs.Last()->end) end=segs.Last()->end;
+	  if (start>segs.First().start) start=segs.First().start;
+	  if (end<segs.Last().end) end=segs.Last().end;
   }
 }
 
 void GffObj::removeExon(int idx) {
   if (idx<0 || idx>=exons.Count()) return;
-  int segstart=exons[idx]->start;
-  int segend=exons[idx]->end;
+  int segstart=exons[idx].start;
+  int segend=exons[idx].end;
   exons.Delete(idx);
   if (isFinalized()) {
     covlen -= (int)(segend-segstart)+1;
-    start=exons.First()->start;
-    end=exons.Last()->end;
+    start=exons.First().start;
+    end=exons.Last().end;
     if (isCDSOnly()) { CDstart=start; CDend=end; }
   }
 }
 
-void GffObj::removeExon(GffExon* p) {
+void GffObj::removeExon(GSeg& seg) {
 	for (int idx=0;idx<exons.Count();idx++) {
-		if (exons[idx]==p) {
-			int segstart=exons[idx]->start;
-			int segend=exons[idx]->end;
+		if (exons[idx].start==seg.start && exons[idx].end==seg.end) {
+			int segstart=exons[idx].start;
+			int segend=exons[idx].end;
 			exons.Delete(idx);
 			covlen -= (int)(segend-segstart)+1;
 
 			if (exons.Count() > 0) {
-				start=exons.First()->start;
-				end=exons.Last()->end;
+				start=exons.First().start;
+				end=exons.Last().end;
 				if (isCDSOnly()) { CDstart=start; CDend=end; }
 			}
 			return;
@@ -1089,7 +1134,7 @@ void GffObj::removeExon(GffExon* p) {
 }
 
 GffObj::GffObj(GffReader& gfrd, BEDLine& bedline):GSeg(0,0),
-		exons(true,true,false), cdss(NULL), gscore() {
+		names(gfrd.names), exons(), cdss(NULL), gscore() {
 	uptr=NULL;
 	ulink=NULL;
 	parent=NULL;
@@ -1137,8 +1182,118 @@ GffObj::GffObj(GffReader& gfrd, BEDLine& bedline):GSeg(0,0),
 	if (gfrd.keep_Attrs && bedline.info!=NULL) this->parseAttrs(attrs, bedline.info);
 }
 
+static bool isGbkRNA(const char* key) {
+	static const char* rnakeys[]={ "mRNA", "tRNA", "rRNA", "tmRNA", "ncRNA", "misc_RNA",
+			"precursor_RNA", "prim_transcript", "transcript", NULL };
+	for (int i=0;rnakeys[i]!=NULL;i++)
+		if (strcmp(key, rnakeys[i])==0) return true;
+	return false;
+}
+
+//GFF3 attribute value from a qualifier value: escape the characters
+//with a special meaning in the attribute column
+static void gbkAttrValue(GStr& s, const char* v) {
+	for (const char* p=v;*p!=0;p++) {
+		switch (*p) {
+			case ';': s.append("%3B"); break;
+			case '=': s.append("%3D"); break;
+			case '%': s.append("%25"); break;
+			case '\t': s.append("%09"); break;
+			default: s.append(*p);
+		}
+	}
+}
+
+GffObj::GffObj(GffReader& gfrd, GbkFeature& gbkf, const char* gseqname, const char* id):GSeg(0,0),
+		names(gfrd.names), exons(), cdss(NULL), children(1,false), gscore() {
+	uptr=NULL;
+	ulink=NULL;
+	parent=NULL;
+	udata=0;
+	flags=0;
+	CDstart=0;
+	CDend=0;
+	CDphase=0;
+	attrs=NULL;
+	gffID=NULL;
+	track_id=-1;
+	gseq_id=-1;
+	strand='.';
+	gffnames_ref(names);
+	covlen=0;
+	geneID=NULL;
+	gene_name=NULL;
+	subftype_id=-1;
+	start=gbkf.segs.First().start;
+	end=gbkf.segs.Last().end;
+	for (int i=0;i<gbkf.segs.Count();i++)
+		if (gbkf.segs[i].end>end) end=gbkf.segs[i].end;
+	gseq_id=names->gseqs.addName(gseqname);
+	track_id=names->tracks.addName(gfrd.is_EMBL ? "EMBL" : "GenBank");
+	strand=gbkf.strand;
+	gffID=Gstrdup(id);
+	hasGffID(true);
+	if (strcmp(gbkf.ftype, "CDS")==0) {
+		//like a standalone GFF CDS, this becomes a CDS-only mRNA
+		ftype_id=gff_fid_mRNA;
+		isTranscript(true);
+		addCDSegs(gbkf);
+	}
+	else if (isGbkRNA(gbkf.ftype)) {
+		ftype_id=names->feats.addName(gbkf.ftype);
+		subftype_id=gff_fid_exon;
+		isTranscript(true);
+		for (int i=0;i<gbkf.segs.Count();i++)
+			if (addExon(gbkf.segs[i].start, gbkf.segs[i].end, exgffExon)<0 && gfrd.showWarnings())
+				GMessage("Warning: failed adding segment %d-%d for %s (discarded)!\n",
+						gbkf.segs[i].start, gbkf.segs[i].end, gffID);
+	}
+	else {
+		ftype_id=names->feats.addName(gbkf.ftype);
+		isGene(strcmp(gbkf.ftype, "gene")==0);
+	}
+	setGeneName(gbkf.getQualifier("gene"));
+	if (!gfrd.keep_Attrs) return;
+	//qualifiers become attributes; repeated ones (e.g. /db_xref) are joined by ','
+	for (int i=0;i<gbkf.quals.Count();i++) {
+		const char* qname=gbkf.quals[i].name;
+		if (strcmp(qname, "translation")==0) continue;
+		bool seen=false;
+		for (int j=0;j<i && !seen;j++)
+			seen=(strcmp(gbkf.quals[j].name, qname)==0);
+		if (seen) continue;
+		GStr v;
+		for (int j=i;j<gbkf.quals.Count();j++) {
+			if (strcmp(gbkf.quals[j].name, qname)!=0) continue;
+			if (!v.is_empty()) v.append(',');
+			if (gbkf.quals[j].value==NULL) v.append("true");
+			else gbkAttrValue(v, gbkf.quals[j].value);
+		}
+		addAttr(qname, v.chars());
+	}
+	if (gbkf.partialStart || gbkf.partialEnd) addAttr("partial", "true");
+}
+
+//add the segments of a GenBank CDS feature to cdss; /codon_start gives the phase
+//of the first segment (in the direction of translation)
+void GffObj::addCDSegs(GbkFeature& gbkf) {
+	if (cdss==NULL) cdss=new GffExonVec();
+	int fstart=1;
+	const char* cstart=gbkf.getQualifier("codon_start");
+	if (cstart!=NULL) fstart=atoi(cstart);
+	if (fstart<1 || fstart>3) fstart=1;
+	int sidx=(gbkf.strand=='-') ? gbkf.segs.Count()-1 : 0;
+	for (int i=0;i<gbkf.segs.Count();i++) {
+		char phase=(i==sidx) ? '0'+fstart-1 : '.';
+		addExon(gbkf.segs[i].start, gbkf.segs[i].end, exgffCDS, phase, GFFSCORE_NONE, cdss);
+	}
+	if (gbkf.segs.First().start<start) start=gbkf.segs.First().start;
+	for (int i=0;i<gbkf.segs.Count();i++)
+		if (gbkf.segs[i].end>end) end=gbkf.segs[i].end;
+}
+
 GffObj::GffObj(GffReader &gfrd, GffLine& gffline):
-     GSeg(0,0), exons(true,true,false), cdss(NULL), children(1,false), gscore() {
+     GSeg(0,0), names(gfrd.names), exons(), cdss(NULL), children(1,false), gscore() {
   uptr=NULL;
   ulink=NULL;
   parent=NULL;
@@ -1241,7 +1396,7 @@ GffObj::GffObj(GffReader &gfrd, GffLine& gffline):
 		  if (gffline.phase!=0) CDphase=gffline.phase;
 		  if (gffline.cdss.Count()>0) {
 			    //for compact GFF-like transcript line format (TLF), CDS might be already found as attributes
-			    if (cdss==NULL) cdss=new GList<GffExon>(true, true, false);
+			    if (cdss==NULL) cdss=new GffExonVec();
 				for (int i=0;i<gffline.cdss.Count();++i) {
 					int eidx=this->addExon(gffline.cdss[i].start, gffline.cdss[i].end, exgffCDS, 0, GFFSCORE_NONE, cdss);
 				    if (eidx<0 && gfrd.showWarnings())
@@ -1276,12 +1431,18 @@ GffObj::GffObj(GffReader &gfrd, GffLine& gffline):
   */
 }
 
+char* GffReader::readLine(int& llen) {
+ if (linePipe!=NULL) return linePipe->getLine(llen, fpos);
+ buflen=GFF_LINELEN-1;
+ return fgetline(linebuf, buflen, fh, &fpos, &llen);
+}
+
 BEDLine* GffReader::nextBEDLine() {
+ GMEM_TAG(gmtGffLine);
  if (bedline!=NULL) return bedline; //caller should free gffline after processing
  while (bedline==NULL) {
 	int llen=0;
-	buflen=GFF_LINELEN-1;
-	char* l=fgetline(linebuf, buflen, fh, &fpos, &llen);
+	char* l=readLine(llen);
 	if (l==NULL) return NULL;
 	int ns=0; //first nonspace position
 	while (l[ns]!=0 && isspace(l[ns])) ns++;
@@ -1298,16 +1459,16 @@ BEDLine* GffReader::nextBEDLine() {
 
 
 GffLine* GffReader::nextGffLine() {
+ GMEM_TAG(gmtGffLine);
  if (gffline!=NULL) return gffline; //caller should free gffline after processing
  while (gffline==NULL) {
     int llen=0;
-    buflen=GFF_LINELEN-1;
-    char* l=fgetline(linebuf, buflen, fh, &fpos, &llen);
+    char* l=readLine(llen);
     if (l==NULL) {
          return NULL; //end of file
          }
 #ifdef CUFFLINKS
-     _crc_result.process_bytes( linebuf, llen );
+     _crc_result.process_bytes( l, llen );
 #endif
     int ns=0; //first nonspace position
     bool commentLine=false;
@@ -1315,13 +1476,13 @@ GffLine* GffReader::nextGffLine() {
     if (l[ns]=='#') {
     	commentLine=true;
     	if (llen<10) {
-    		if (commentParser!=NULL) (*commentParser)(l, &gflst);
+    		if (commentParser!=NULL) (*commentParser)(l, &gflst, commentData);
     		continue;
     	}
     }
     gffline=new GffLine(this, l);
     if (gffline->skipLine) {
-       if (commentLine && commentParser!=NULL) (*commentParser)(gffline->dupline, &gflst);
+       if (commentLine && commentParser!=NULL) (*commentParser)(gffline->dupline, &gflst, commentData);
        delete gffline;
        gffline=NULL;
        continue;
@@ -1427,7 +1588,8 @@ GffObj* GffReader::updateParent(GffObj* newgfo, GffObj* parent) {
   return newgfo;
 }
 
-GffObj* GffReader::newGffRec(GffLine* gffline, GffObj* parent, GffExon* pexon, GPVec<GffObj>* glst, bool replace_parent) {
+GffObj* GffReader::newGffRec(GffLine* gffline, GffObj* parent, GSeg* pexon, GPVec<GffObj>* glst, bool replace_parent) {
+  GMEM_TAG(gmtGffObj);
   GffObj* newgfo=new GffObj(*this, *gffline);
   GffObj* r=NULL;
   gflst.Add(newgfo);
@@ -1445,13 +1607,14 @@ GffObj* GffReader::newGffRec(GffLine* gffline, GffObj* parent, GffExon* pexon, G
 	  r=(glst) ? gfoAdd(*glst, newgfo) : gfoAdd(newgfo);
 	  if (parent!=NULL) {
 		updateParent(r, parent);
-		if (pexon!=NULL) parent->removeExon(pexon);
+		if (pexon!=NULL) parent->removeExon(*pexon);
 	  }
   }
   return r;
 }
 
 GffObj* GffReader::newGffRec(BEDLine* bedline, GPVec<GffObj>* glst) {
+  GMEM_TAG(gmtGffObj);
   GffObj* newgfo=new GffObj(*this, *bedline);
   GffObj* r=NULL;
   gflst.Add(newgfo);
@@ -1459,6 +1622,83 @@ GffObj* GffReader::newGffRec(BEDLine* bedline, GPVec<GffObj>* glst) {
   return r;
 }
 
+GffObj* GffReader::newGffRec(GbkFeature* gbkf, const char* gseqname, const char* id, GffObj* parent) {
+  GMEM_TAG(gmtGffObj);
+  GffObj* newgfo=new GffObj(*this, *gbkf, gseqname, id);
+  gflst.Add(newgfo);
+  if (parent!=NULL) updateParent(newgfo, parent);
+  return gfoAdd(newgfo);
+}
+
+//load the features of the current GenBank/EMBL entry; genes, transcripts and
+//CDS sharing the same /locus_tag are linked: a CDS found after an mRNA is
+//added to that mRNA, a transcript found after a gene becomes its child
+void GffReader::readGbkEntry(GbkReader& gbkr) {
+	const char* gseqname=gbkr.seqName();
+	is_EMBL=gbkr.isEMBL();
+	GHash<GffObj> bytag(false); //last gene or transcript seen for a locus_tag
+	GbkFeature* gbkf=NULL;
+	int fcount=0;
+	while ((gbkf=gbkr.nextFeature())!=NULL) {
+		fcount++;
+		if (strcmp(gbkf->ftype, "source")==0 || gbkf->segs.Count()==0) {
+			if (gbkf->remote && gff_warns)
+				GMessage("Warning: %s feature at line %d of %s refers to another entry (%s), skipped\n",
+						gbkf->ftype, gbkr.lineCount(), gseqname, gbkf->location);
+			delete gbkf;
+			continue;
+		}
+		const char* ltag=gbkf->getQualifier("locus_tag");
+		bool isCDS=(strcmp(gbkf->ftype, "CDS")==0);
+		bool isGene=(strcmp(gbkf->ftype, "gene")==0);
+		GStr tkey;
+		if (ltag!=NULL) {
+			tkey=ltag;
+			if (isGene) tkey+=":gene";
+		}
+		GffObj* prev=tkey.is_empty() ? NULL : bytag.Find(tkey.chars());
+		if (isCDS && prev!=NULL && prev->isTranscript() && prev->cdss==NULL &&
+				prev->strand==gbkf->strand) {
+			//CDS of the preceding mRNA
+			prev->addCDSegs(*gbkf);
+			delete gbkf;
+			continue;
+		}
+		if (isGene && transcripts_Only && !keep_Genes) {
+			delete gbkf;
+			continue;
+		}
+		GStr id;
+		if (ltag!=NULL) {
+			id=ltag;
+			if (isGene) id+="_gene";
+			else if (strcmp(gbkf->ftype, "mRNA")==0) id+="_mRNA";
+		}
+		else id.format("%s_%s_%d", gseqname, gbkf->ftype, fcount);
+		if (phash.Find(id.chars())!=NULL) { //duplicate ID
+			GStr uid;
+			for (int n=2;;n++) {
+				uid.format("%s.%d", id.chars(), n);
+				if (phash.Find(uid.chars())==NULL) break;
+			}
+			id=uid;
+		}
+		GffObj* gparent=NULL;
+		if (!isGene && ltag!=NULL) {
+			GStr gkey(ltag);
+			gkey+=":gene";
+			gparent=bytag.Find(gkey.chars());
+		}
+		GffObj* gfo=newGffRec(gbkf, gseqname, id.chars(), gparent);
+		if (!tkey.is_empty() && (isGene || gfo->isTranscript())) bytag.Add(tkey.chars(), gfo);
+		delete gbkf;
+	}
+	if (gbkSeqs==NULL) return;
+	uint seqlen=0;
+	char* seq=gbkr.readSequence(seqlen);
+	if (seq!=NULL) gbkSeqs->addSeq(gseqname, seq, seqlen);
+}
+
 GffObj* GffReader::updateGffRec(GffObj* prevgfo, GffLine* gffline) {
  if (prevgfo==NULL) return NULL;
  //prevgfo->gffobj->createdByExon(false);
@@ -1540,7 +1780,7 @@ GffObj* GffReader::promoteFeature(CNonExon* subp, char*& subp_name, GHash<CNonEx
   //if (prevp!=gflst[subp->idx])
   //  GError("Error promoting subfeature %s, gflst index mismatch?!\n", subp->gffline->ID);
   subp->gffline->discardParent();
-  GffObj* gfoh=newGffRec(subp->gffline, prevp, subp->exon);
+  GffObj* gfoh=newGffRec(subp->gffline, prevp, &(subp->exon));
   pex.Remove(subp_name); //no longer a potential parent, moved it to phash already
   prevp->promotedChildren(true);
   return gfoh; //returns the holder of newly promoted feature
@@ -1655,6 +1895,11 @@ void GffReader::readAll() {
 			bedline=NULL;
 		}
 	}
+	else if (is_GBK) {
+		GbkReader gbkr(fh);
+		while (gbkr.nextEntry())
+			readGbkEntry(gbkr);
+	}
 	else { //regular GFF/GTF or perhaps TLF?
 		//loc_debug=false;
 		GHash<CNonExon> pex; //keep track of any parented (i.e. exon-like) features that have an ID
@@ -1864,25 +2109,28 @@ void GfList::finalize(GffReader* gfr) { //if set, enforce sort by locus
           this->Pack();
   }
   if (gfr->sortByLoc) {
+    //records are mostly in input order already: one stable sort in endBulk()
+    this->beginBulk();
     this->setSorted(false);
     if (gfr->refAlphaSort)
       this->setSorted((GCompareProc*)gfo_cmpByLoc);
     else
       this->setSorted((GCompareProc*)gfo_cmpRefByID);
+    this->endBulk();
   }
 }
 
-bool GffObj::reduceExonAttrs(GList<GffExon>& segs) {
+bool GffObj::reduceExonAttrs(GffExonVec& segs) {
 	bool attrs_discarded=false;
-	for (int a=0;a<segs[0]->attrs->Count();a++) {
-		int attr_id=segs[0]->attrs->Get(a)->attr_id;
+	for (int a=0;a<segs[0].attrs->Count();a++) {
+		int attr_id=segs[0].attrs->Get(a)->attr_id;
 		char* attr_name=names->attrs.getName(attr_id);
-		char* attr_val =segs[0]->attrs->Get(a)->attr_val;
+		char* attr_val =segs[0].attrs->Get(a)->attr_val;
 		bool sameExonAttr=true;
 		bool discardAll=(GstrEq("exon_id", attr_name) || GstrEq("exon_number", attr_name));
 		if (!discardAll)
 			for (int i=1;i<segs.Count();i++) {
-				char* ov=segs[i]->getAttr(attr_id);
+				char* ov=segs[i].getAttr(attr_id);
 				if (ov==NULL || (strcmp(ov,attr_val)!=0)) {
 					sameExonAttr=false;
 					break;
@@ -1918,25 +2166,25 @@ bool GffObj::reduceExonAttrs(GList<GffExon>& segs) {
 				}
 			}
 			for (int i=1;i<segs.Count();i++) {
-				removeExonAttr(*(segs[i]), attr_id);
+				removeExonAttr(segs[i], attr_id);
 			}
-			segs[0]->attrs->freeItem(a);
+			segs[0].attrs->freeItem(a);
 		} //sameExonAttr
 	}
-	if (attrs_discarded) segs[0]->attrs->Pack();
+	if (attrs_discarded) segs[0].attrs->Pack();
 	return attrs_discarded;
 }
 //return the segs index of segment containing coord:
-int GffObj::whichExon(uint coord, GList<GffExon>* segs) {
+int GffObj::whichExon(uint coord, GffExonVec* segs) {
 	 //segs MUST be sorted by GSeg order (start coordinate)
 	if (segs==NULL) segs=&exons;
 	if (segs->Count()==0) return -1;
-	if (coord<segs->First()->start || coord>segs->Last()->end)
+	if (coord<segs->First().start || coord>segs->Last().end)
 		return -1;
 	if (segs->Count()<6) {
 		//simple scan
 		for (int i=0;i<segs->Count();i++)
-			if ((*segs)[i]->overlap(coord))
+			if ((*segs)[i].overlap(coord))
 				return i;
 		return -1;
 	}
@@ -1946,13 +2194,13 @@ int GffObj::whichExon(uint coord, GList<GffExon>* segs) {
 		int h=segs->Count()-1; //higher boundary
 		while (l<=h) {
 			i = (l+h) >> 1; //range midpoint
-			if (coord > segs->Get(i)->end)
+			if (coord > segs->Get(i).end)
 				l=i+1;
-			else { //coord <= segs->Get(i)->end
-				if (coord >= segs->Get(i)->start) {
+			else { //coord <= segs->Get(i).end
+				if (coord >= segs->Get(i).start) {
 					return i;
 				}
-				//here: coord < segs->Get(i)->start
+				//here: coord < segs->Get(i).start
 				h = i-1;
 			}
 		}
@@ -1990,23 +2238,23 @@ bool GffObj::processGeneSegments(GffReader* gfr) {
     }
     //group CDSs into CDS chains by their ID:
     for (int i=0;i<cdss->Count();i++) {
-    	char* id=(char*)(cdss->Get(i)->uptr);
+    	char* id=(char*)(cdss->Get(i).uptr);
     	if (id==NULL) continue; //should never happen
     	GeneCDSChain *gcc=cdsChainById.Find(id);
     	if (gcc!=NULL)
-             gcc->addCDS(i, cdss->Get(i)->start, cdss->Get(i)->end);
+             gcc->addCDS(i, cdss->Get(i).start, cdss->Get(i).end);
     	else { //new CDS chain:
-    	     gcc=new GeneCDSChain(i, cdss->Get(i)->start, cdss->Get(i)->end);
+    	     gcc=new GeneCDSChain(i, cdss->Get(i).start, cdss->Get(i).end);
     	     cdsChains.Add(gcc);
     	     cdsChainById.shkAdd(id, gcc);
     	}
     }
     for (int i=0;i<cdss->Count();i++) {
- 	   GFREE(cdss->Get(i)->uptr); //no CDS ID no longer needed
+ 	   GFREE(cdss->Get(i).uptr); //no CDS ID no longer needed
     }
 
     //collect _gene_segment containers for each CDS chain
-    int cds_moved=0;
+    GVec<int> cds_moved; //indexes of the CDS segments transferred
     for (int i=0;i<cdsChains.Count();i++) {
     	GeneCDSChain &gc=*(cdsChains[i]);
         for (int si=0;si<geneSegs.Count();si++) {
@@ -2025,15 +2273,16 @@ bool GffObj::processGeneSegments(GffReader* gfr) {
         GffObj* t=children[gc.mxs.First().child_idx];
 		for (int c=0;c<gc.cdsList.Count();c++) {
 			t->transferCDS(cdss->Get(gc.cdsList[c].idx));
-			cdss->Forget(gc.cdsList[c].idx);
-			cds_moved++;
+			cds_moved.Add(gc.cdsList[c].idx);
 		}
 		// also remove it from the list of gene_segments to be mapped
 		geneSegs.Delete(gc.mxs.First().gsegidx); //assigned, should no longer be checked against other CDS chains
 		if (t->isFinalized()) t->finalize(gfr);
 
     }
-    if (cds_moved>0) cdss->Pack();
+    cds_moved.Sort();
+    for (int i=cds_moved.Count()-1;i>=0;i--)
+    	cdss->Delete(cds_moved[i]);
     if (cdss->Count()==0) {
     	delete cdss;
     	cdss=NULL;
@@ -2074,7 +2323,7 @@ GffObj* GffObj::finalize(GffReader* gfr) {
 	}
 	if (cdss!=NULL && isGene()) //in case we stored IDs for gene_segment features
 		for (int i=0;i<cdss->Count();i++) {
-			GFREE(cdss->Get(i)->uptr);
+			GFREE(cdss->Get(i).uptr);
 		}
 	if (gfr->transcripts_Only && !isTranscript() &&
 			!(gfr->keep_Genes && isGene())) {
@@ -2094,13 +2343,13 @@ GffObj* GffObj::finalize(GffReader* gfr) {
 		subftype_id=isCDSOnly() ? gff_fid_CDS : gff_fid_exon;
 	}
 	if (cdss!=NULL && cdss->Count()>0) {
-		CDstart=cdss->First()->start;
-		CDend=cdss->Last()->end;
-		CDphase=(strand=='-')? cdss->Last()->phase : cdss->First()->phase;
+		CDstart=cdss->First().start;
+		CDend=cdss->Last().end;
+		CDphase=(strand=='-')? cdss->Last().phase : cdss->First().phase;
 		bool updatePhase=(CDphase=='.' || CDphase==0);
 		if (!updatePhase)
 			for (int i=0;i<cdss->Count();++i)
-				if ((*cdss)[i]->phase<'0') {
+				if ((*cdss)[i].phase<'0') {
 					updatePhase=true;
 					break;
 				}
@@ -2108,9 +2357,9 @@ GffObj* GffObj::finalize(GffReader* gfr) {
 		//there are GFFs out there which only provide UTR and CDS records instead of full exons
 		//so make sure we add all CDS segments to exons, if they are not already there
 		for (int i=0;i<cdss->Count();++i) {
-			int eidx=addExon((*cdss)[i]->start, (*cdss)[i]->end, exgffExon, 0, (*cdss)[i]->score);
+			int eidx=addExon((*cdss)[i].start, (*cdss)[i].end, exgffExon, 0, (*cdss)[i].score);
 			if (eidx<0) GError("Error: could not reconcile CDS %d-%d with exons of transcript %s\n",
-					(*cdss)[i]->start, (*cdss)[i]->end, gffID);
+					(*cdss)[i].start, (*cdss)[i].end, gffID);
 		}
 	}
 	else if (CDstart==0) {//no CDS, no phase
@@ -2120,7 +2369,7 @@ GffObj* GffObj::finalize(GffReader* gfr) {
 	//-- attribute reduction for some records which
 	//   repeat the exact same attr=value for every exon
 	bool reduceAttributes=(gfr->keep_Attrs && !gfr->noExonAttrs &&
-			!gfr->keep_AllExonAttrs && exons.Count()>0 && exons[0]->attrs!=NULL);
+			!gfr->keep_AllExonAttrs && exons.Count()>0 && exons[0].attrs!=NULL);
 	if (reduceAttributes) {
 		//for each attribute of the 1st exon, if it has the
 		//same value for all other exons, move it to transcript level
@@ -2128,7 +2377,7 @@ GffObj* GffObj::finalize(GffReader* gfr) {
 			GMessage("Info: duplicate exon attributes reduced for %s\n", gffID);
 		}
 		//do the same for CDS segments, if any
-		if (cdss!=NULL && cdss->Count()>0 && (*cdss)[0]->attrs!=NULL) {
+		if (cdss!=NULL && cdss->Count()>0 && (*cdss)[0].attrs!=NULL) {
 			if (reduceExonAttrs(*cdss) && gfr->showWarnings())
 				GMessage("Info: duplicate CDS attributes reduced for %s\n", gffID);
 		}
@@ -2138,22 +2387,22 @@ GffObj* GffObj::finalize(GffReader* gfr) {
 		if (gfr->merge_CloseExons) {
 			for (int i=0;i<exons.Count()-1;i++) {
 				int ni=i+1;
-				uint mend=exons[i]->end;
+				uint mend=exons[i].end;
 				while (ni<exons.Count()) {
-					int dist=(int)(exons[ni]->start-mend-1); //<0 = overlap, 0 = adjacent, >0 = bases apart
+					int dist=(int)(exons[ni].start-mend-1); //<0 = overlap, 0 = adjacent, >0 = bases apart
 					if (dist>GFF_MIN_INTRON) break; //no merging with next segment
-					if (gfr!=NULL && gfr->gff_warns && dist!=0 && (exons[ni]->exontype!=exgffUTR && exons[i]->exontype!=exgffUTR)) {
+					if (gfr!=NULL && gfr->gff_warns && dist!=0 && (exons[ni].exontype!=exgffUTR && exons[i].exontype!=exgffUTR)) {
 						GMessage("Warning: merging adjacent/overlapping segments (distance=%d) of %s on %s (%d-%d, %d-%d)\n",
-								dist, gffID, getGSeqName(), exons[i]->start, exons[i]->end,exons[ni]->start, exons[ni]->end);
+								dist, gffID, getGSeqName(), exons[i].start, exons[i].end,exons[ni].start, exons[ni].end);
 					}
-					mend=exons[ni]->end;
-					exons[i]->end=mend;
-					if (exons[ni]->attrs!=NULL && (exons[i]->attrs==NULL ||
-							exons[i]->attrs->Count()<exons[ni]->attrs->Count())) {
+					mend=exons[ni].end;
+					exons[i].end=mend;
+					if (exons[ni].attrs!=NULL && (exons[i].attrs==NULL ||
+							exons[i].attrs->Count()<exons[ni].attrs->Count())) {
 						//use the other exon attributes, if it has more
-						delete(exons[i]->attrs);
-						exons[i]->attrs=exons[ni]->attrs;
-						exons[ni]->attrs=NULL;
+						delete(exons[i].attrs);
+						exons[i].attrs=exons[ni].attrs;
+						exons[ni].attrs=NULL;
 					}
 					exons.Delete(ni);
 				} //check for merge with next exon
@@ -2165,23 +2414,23 @@ GffObj* GffObj::finalize(GffReader* gfr) {
 	//-- check features vs their exons' span
 	if (isTranscript()) {
 	   if (exons.Count()>0) {
-		 if (gfr->gff_warns && (this->start!=exons.First()->start ||
-				 this->end!=exons.Last()->end) )
+		 if (gfr->gff_warns && (this->start!=exons.First().start ||
+				 this->end!=exons.Last().end) )
 			 GMessage("Warning: adjusted transcript %s boundaries according to terminal exons.\n",
 					 gffID);
-	     this->start=exons.First()->start;
-	     this->end=exons.Last()->end;
+	     this->start=exons.First().start;
+	     this->end=exons.Last().end;
 	   }
 	}
 	else { //non-transcripts just have to be at least as wide as their sub-features
 	  if (exons.Count()>0) {
 		  bool adj=false;
-		  if (this->start>exons.First()->start) {
-			  this->start=exons.First()->start;
+		  if (this->start>exons.First().start) {
+			  this->start=exons.First().start;
 			  adj=true;
 		  }
-		  if (this->end<exons.Last()->end) {
-			  this->end=exons.First()->end;
+		  if (this->end<exons.Last().end) {
+			  this->end=exons.First().end;
 			  adj=true;
 		  }
 		  if (gfr->gff_warns && adj)
@@ -2191,7 +2440,7 @@ GffObj* GffObj::finalize(GffReader* gfr) {
 	}
 	//-- update covlen
 	covlen=0;
-	for (int i=0;i<exons.Count();++i) covlen+=exons[i]->len();
+	for (int i=0;i<exons.Count();++i) covlen+=exons[i].len();
 	//-- check if CDS segments are different from exons and thus worth keeping separately in cdss
 	if (cdss!=NULL && cdss->Count()>0) {
 		bool cds_exComp=true; //CDSs are exon-compatible (no need to keep them separately)
@@ -2200,12 +2449,12 @@ GffObj* GffObj::finalize(GffReader* gfr) {
 			int start_eidx=-1;
 			int end_eidx=-1;
 			for (int i=0;i<exons.Count();i++) {
-				//GMessage("[DBG:] checking if CDS %d-%d is within exon %d-%d\n", CDstart, CDend, exons[i]->start,
-				//		exons[i]->end);
-				if (CDstart>=exons[i]->start && CDstart<=exons[i]->end) {
+				//GMessage("[DBG:] checking if CDS %d-%d is within exon %d-%d\n", CDstart, CDend, exons[i].start,
+				//		exons[i].end);
+				if (CDstart>=exons[i].start && CDstart<=exons[i].end) {
 					start_eidx=i;
 				}
-				if (CDend>=exons[i]->start || CDend<=exons[i]->end ) {
+				if (CDend>=exons[i].start || CDend<=exons[i].end ) {
 					end_eidx=i;
 				}
 				if (start_eidx>=0 && end_eidx>=0) break;
@@ -2225,13 +2474,13 @@ GffObj* GffObj::finalize(GffReader* gfr) {
 				int j=0;
 				//find which exon has CDstart
 				for (i=0;i<=imax;++i)
-					if (CDstart>=exons[i]->start
-							&& CDstart<=exons[i]->end) break;
+					if (CDstart>=exons[i].start
+							&& CDstart<=exons[i].end) break;
 				if (i>imax) cds_exComp=false;
 				else { //check the introns now
 					while (i<imax && j<jmax) {
-						if (exons[i]->end!=(*cdss)[j]->end ||
-								exons[i+1]->start!=(*cdss)[j+1]->start) {
+						if (exons[i].end!=(*cdss)[j].end ||
+								exons[i+1].start!=(*cdss)[j+1].start) {
 							cds_exComp=false;
 							break;
 						}
@@ -2240,7 +2489,7 @@ GffObj* GffObj::finalize(GffReader* gfr) {
 					}
 					//now j must be the last segment of cdss and CDend must be within exon[i]
 					if (cds_exComp)
-						if (j!=jmax || CDend>exons[i]->end || CDend<exons[i]->start)
+						if (j!=jmax || CDend>exons[i].end || CDend<exons[i].start)
 							cds_exComp=false;
 				}
 			}
@@ -2248,22 +2497,23 @@ GffObj* GffObj::finalize(GffReader* gfr) {
 		if (cds_exComp) {
 			if (isCDSOnly() && cdss->Count()==exons.Count())
 				for (int i=0;i<cdss->Count();i++)
-					exons[i]->phase=cdss->Get(i)->phase;
+					exons[i].phase=cdss->Get(i).phase;
 			if (gfr->keep_Attrs && !gfr->noExonAttrs) {
-				int eidx=whichExon((*cdss)[0]->start, &exons);
+				int eidx=whichExon((*cdss)[0].start, &exons);
 				if (eidx<0)
 					GError("Error finding CDS coordinate inside exons (?) for %s\n",
 						    gffID);
 				for (int i=0;i<cdss->Count();i++) {
 					if (isCDSOnly()) //eidx should be the same with i
-						exons[eidx]->phase=cdss->Get(i)->phase;
-					if ((*cdss)[i]->attrs!=NULL && (*cdss)[i]->attrs->Count()>0) {
-						if (exons[eidx]->attrs==NULL)
-							exons[eidx]->attrs=new GffAttrs();
-						exons[eidx]->attrs->copyAttrs((*cdss)[i]->attrs, true);
-						if (exons[eidx]->attrs->Count()==0) {
-							delete exons[eidx]->attrs;
-							exons[eidx]->attrs=NULL;
+						exons[eidx].phase=cdss->Get(i).phase;
+					if ((*cdss)[i].attrs!=NULL && (*cdss)[i].attrs->Count()>0) {
+						GMEM_TAG(gmtGffAttr);
+						if (exons[eidx].attrs==NULL)
+							exons[eidx].attrs=new GffAttrs();
+						exons[eidx].attrs->copyAttrs((*cdss)[i].attrs, true);
+						if (exons[eidx].attrs->Count()==0) {
+							delete exons[eidx].attrs;
+							exons[eidx].attrs=NULL;
 						}
 					}
 					++eidx;
@@ -2302,7 +2552,7 @@ void GffObj::printExonList(FILE* fout) {
 	//print comma delimited list of exon intervals
 	for (int i=0;i<exons.Count();++i) {
 		if (i>0) fprintf(fout, ",");
-		fprintf(fout, "%d-%d",exons[i]->start, exons[i]->end);
+		fprintf(fout, "%d-%d",exons[i].start, exons[i].end);
 	}
 }
 
@@ -2338,10 +2588,10 @@ void GffObj::printBED(FILE* fout, bool cvtChars, char* dbuf, int dbuf_len) {
 	 int i;
 	 fprintf(fout, "\t%d\t", exons.Count());
 	 for (i=0;i<exons.Count();++i)
-		 fprintf(fout,"%d,",exons[i]->len());
+		 fprintf(fout,"%d,",exons[i].len());
 	 fprintf(fout, "\t");
 	 for (i=0;i<exons.Count();++i)
-		 fprintf(fout,"%d,",exons[i]->start-start);
+		 fprintf(fout,"%d,",exons[i].start-start);
  } else { //no-exon feature(!), shouldn't happen
 	 fprintf(fout, "\t1\t%d,\t0,", len());
  }
@@ -2373,6 +2623,7 @@ void GffObj::printBED(FILE* fout, bool cvtChars, char* dbuf, int dbuf_len) {
 }
 
 void GffObj::parseAttrs(GffAttrs*& atrlist, char* info, bool isExon, bool CDSsrc) {
+  GMEM_TAG(gmtGffAttr);
   if (names==NULL)
      GError(ERR_NULL_GFNAMES, "parseAttrs()");
   if (atrlist==NULL) {
@@ -2416,6 +2667,7 @@ void GffObj::parseAttrs(GffAttrs*& atrlist, char* info, bool isExon, bool CDSsrc
 }
 
 void GffObj::addAttr(const char* attrname, const char* attrvalue) {
+  GMEM_TAG(gmtGffAttr);
   if (this->attrs==NULL)
       this->attrs=new GffAttrs();
   //this->attrs->Add(new GffAttr(names->attrs.addName(attrname),attrvalue));
@@ -2551,8 +2803,8 @@ char* GffObj::getUnspliced(GFaSeqGet* faseq, int* rlen, GMapSegments* seglst) {
     }
     char* unspliced=NULL;
 
-    int seqstart=exons.First()->start;
-    int seqend=exons.Last()->end;
+    int seqstart=exons.First().start;
+    int seqend=exons.Last().end;
 
     int unsplicedlen = 0;
     if (seglst)
@@ -2590,8 +2842,8 @@ char* GffObj::getUnspliced(GFaSeqGet* faseq, int* rlen, GMapSegments* seglst) {
 	 this->start-=padLeft;
 	 this->end+=padRight;
 	 if (exons.Count()>0) {
-		 exons[0]->start-=padLeft;
-		 exons.Last()->end+=padRight;
+		 exons[0].start-=padLeft;
+		 exons.Last().end+=padRight;
 	 }
 	 covlen+=padLeft+padRight;
  }
@@ -2600,8 +2852,8 @@ char* GffObj::getUnspliced(GFaSeqGet* faseq, int* rlen, GMapSegments* seglst) {
 	 this->start+=padLeft;
 	 this->end-=padRight;
 	 if (exons.Count()>0) {
-		 exons[0]->start+=padLeft;
-		 exons.Last()->end-=padRight;
+		 exons[0].start+=padLeft;
+		 exons.Last().end-=padRight;
 	 }
 	 covlen-=padLeft+padRight;
  }
@@ -2618,7 +2870,7 @@ char* GffObj::getSpliced(GFaSeqGet* faseq, bool CDSonly, int* rlen, uint* cds_st
 	  GMessage("Warning: getSpliced() called with uninitialized GFaSeqGet object!\n"); //should never happen
       return NULL;
   }
-  GList<GffExon>* xsegs=&exons;
+  GffExonVec* xsegs=&exons;
   if (CDSonly && this->cdss!=NULL)
 	  xsegs=this->cdss;
   if (xsegs->Count()==0) return NULL;
@@ -2633,9 +2885,9 @@ char* GffObj::getSpliced(GFaSeqGet* faseq, bool CDSonly, int* rlen, uint* cds_st
      uint prevend=end;
      end-=endadj;
      if (CDend>end) CDend=end;
-     if (xsegs->Last()->end>end) {
-         xsegs->Last()->end=end; //this could be trouble if exon start is also > end
-         if (xsegs->Last()->start>xsegs->Last()->end) {
+     if (xsegs->Last().end>end) {
+         xsegs->Last().end=end; //this could be trouble if exon start is also > end
+         if (xsegs->Last().start>xsegs->Last().end) {
             GError("GffObj::getSpliced() error: improper genomic coordinate %d on %s for %s\n",
                   prevend,getGSeqName(), getID());
          }
@@ -2662,20 +2914,20 @@ char* GffObj::getSpliced(GFaSeqGet* faseq, bool CDSonly, int* rlen, uint* cds_st
     	 GMessage("Warning: CDS %d-%d too short for %s, check your data.\n",
     			 g_start, g_end, gffID);
   } else { //all exon content, not just CDS
-    g_start=xsegs->First()->start;
-    g_end=xsegs->Last()->end;
+    g_start=xsegs->First().start;
+    g_end=xsegs->Last().end;
     cds_open=false; //override mistaken user request
   }
   if (seglst!=NULL) seglst->Clear(strand);
   int s=0; //resulting nucleotide counter
   if (strand=='-') {
     if (cds_open) {// appending 3'UTR
-    	g_start=xsegs->First()->start;
+    	g_start=xsegs->First().start;
     	//CDS_start=g_start;
     }
     for (int x=xsegs->Count()-1;x>=0;x--) {
-       uint sgstart=xsegs->Get(x)->start;
-       uint sgend=xsegs->Get(x)->end;
+       uint sgstart=xsegs->Get(x).start;
+       uint sgend=xsegs->Get(x).end;
        if (g_end<sgstart || g_start>sgend) continue;
        if (g_start>=sgstart && g_start<=sgend)
           sgstart=g_start; //3' end within this segment
@@ -2700,12 +2952,12 @@ char* GffObj::getSpliced(GFaSeqGet* faseq, bool CDSonly, int* rlen, uint* cds_st
     } // - strand
    else { // + strand
     if (cds_open) { // appending 3'UTR
-      	g_end=xsegs->Last()->end;
+      	g_end=xsegs->Last().end;
       	//CDS_stop=g_end;
     }
     for (int x=0;x<xsegs->Count();x++) {
-      uint sgstart=xsegs->Get(x)->start;
-      uint sgend=xsegs->Get(x)->end;
+      uint sgstart=xsegs->Get(x).start;
+      uint sgend=xsegs->Get(x).end;
       if (g_end<sgstart || g_start>sgend) continue;
       if (g_start>=sgstart && g_start<=sgend)
             sgstart=g_start; //seqstart within this segment
@@ -2900,14 +3152,14 @@ void GffObj::printGxf(FILE* fout, GffPrintMode gffp,
  const int DBUF_LEN=1024; //there should not be attribute values longer than 1K!
  char dbuf[DBUF_LEN];
  if (tlabel==NULL) {
-    tlabel=track_id>=0 ? names->tracks.Get(track_id)->name :
+    tlabel=track_id>=0 ? names->tracks.getName(track_id) :
          (char*)"gffobj" ;
     }
  if (gffp==pgffBED) {
 	 printBED(fout, cvtChars, dbuf, DBUF_LEN);
 	 return;
  }
- const char* gseqname=names->gseqs.Get(gseq_id)->name;
+ const char* gseqname=names->gseqs.getName(gseq_id);
  bool gff3 = (gffp>=pgffAny && gffp<=pgffTLF);
  bool showCDS = (gffp==pgtfAny || gffp==pgtfCDS || gffp==pgffCDS || gffp==pgffAny || gffp==pgffBoth);
  bool showExon = (gffp<=pgtfExon || gffp==pgffAny || gffp==pgffExon || gffp==pgffBoth);
@@ -2984,9 +3236,9 @@ void GffObj::printGxf(FILE* fout, GffPrintMode gffp,
    if (gffp==pgffTLF) {
 	   fprintf(fout, ";exonCount=%d",exons.Count());
 	   if (exons.Count()>0)
-		   fprintf(fout, ";exons=%d-%d", exons[0]->start, exons[0]->end);
+		   fprintf(fout, ";exons=%d-%d", exons[0].start, exons[0].end);
 	   for (int i=1;i<exons.Count();++i) {
-		   fprintf(fout, ",%d-%d",exons[i]->start, exons[i]->end);
+		   fprintf(fout, ",%d-%d",exons[i].start, exons[i].end);
 	   }
    }
    if (CDstart>0 && (gffp==pgffTLF || !showCDS)) {
@@ -2995,7 +3247,7 @@ void GffObj::printGxf(FILE* fout, GffPrintMode gffp,
 		   fprintf(fout, ";CDS=");
 		   for (int i=0;i<cdss->Count();++i) {
 			   if (i>0) fprintf(fout, ",");
-			   fprintf(fout, "%d-%d", (*cdss)[i]->start, (*cdss)[i]->end);
+			   fprintf(fout, "%d-%d", (*cdss)[i].start, (*cdss)[i].end);
 		   }
 	   }
    }
@@ -3027,7 +3279,7 @@ void GffObj::printGxf(FILE* fout, GffPrintMode gffp,
  if (showExon) {
     //print exons
     for (int i=0;i<exons.Count();i++) {
-      printGxfExon(fout, tlabel, gseqname, is_cds_only, exons[i], gff3, cvtChars, dbuf, DBUF_LEN);
+      printGxfExon(fout, tlabel, gseqname, is_cds_only, &(exons[i]), gff3, cvtChars, dbuf, DBUF_LEN);
     }
  }//printing exons
  if (showCDS && !is_cds_only && CDstart>0) {
@@ -3039,7 +3291,7 @@ void GffObj::printGxf(FILE* fout, GffPrintMode gffp,
   } //showCDS
 }
 
-void GffObj::updateCDSPhase(GList<GffExon>& segs) {
+void GffObj::updateCDSPhase(GffExonVec& segs) {
   int cdsacc=0;
   if (CDphase=='1' || CDphase=='2') {
       cdsacc+= 3-(CDphase-'0');
@@ -3047,14 +3299,14 @@ void GffObj::updateCDSPhase(GList<GffExon>& segs) {
   else CDphase='0';
   if (strand=='-') { //reverse strand
      for (int i=segs.Count()-1;i>=0;i--) {
-         segs[i]->phase='0'+ (3-cdsacc%3)%3;
-         cdsacc+=segs[i]->end-segs[i]->start+1;
+         segs[i].phase='0'+ (3-cdsacc%3)%3;
+         cdsacc+=segs[i].end-segs[i].start+1;
      }
   }
     else { //forward strand
      for (int i=0;i<segs.Count();i++) {
-         segs[i]->phase='0'+ (3-cdsacc%3)%3;
-         cdsacc+=segs[i]->end-segs[i]->start+1;
+         segs[i].phase='0'+ (3-cdsacc%3)%3;
+         cdsacc+=segs[i].end-segs[i].start+1;
      }
   }
 }
@@ -3066,7 +3318,7 @@ void GffObj::getCDSegs(GVec<GffExon>& cds) {
   if (cdss!=NULL) {
 	//copy directly from cdss list
 	for (int i=0;i<cdss->Count();i++) {
-		cdseg=(*cdss->Get(i));
+		cdseg=cdss->Get(i);
 		cdseg.sharedAttrs=true;
 		cds.Add(cdseg);
 	}
@@ -3078,8 +3330,8 @@ void GffObj::getCDSegs(GVec<GffExon>& cds) {
   }
   if (strand=='-') {
      for (int x=exons.Count()-1;x>=0;x--) {
-        uint sgstart=exons[x]->start;
-        uint sgend=exons[x]->end;
+        uint sgstart=exons[x].start;
+        uint sgend=exons[x].end;
         if (CDend<sgstart || CDstart>sgend) continue;
         if (CDstart>=sgstart && CDstart<=sgend)
               sgstart=CDstart; //cdstart within this segment
@@ -3090,7 +3342,7 @@ void GffObj::getCDSegs(GVec<GffExon>& cds) {
         //cdseg.phase='0'+(cdsacc>0 ? (3-cdsacc%3)%3 : 0);
         cdseg.phase='0'+ (3-cdsacc%3)%3;
         cdsacc+=sgend-sgstart+1;
-        cdseg.attrs=exons[x]->attrs;
+        cdseg.attrs=exons[x].attrs;
         cdseg.sharedAttrs=true;
         cds.Add(cdseg);
        } //for each exon
@@ -3098,8 +3350,8 @@ void GffObj::getCDSegs(GVec<GffExon>& cds) {
      } // - strand
     else { // + strand
      for (int x=0;x<exons.Count();x++) {
-       uint sgstart=exons[x]->start;
-       uint sgend=exons[x]->end;
+       uint sgstart=exons[x].start;
+       uint sgend=exons[x].end;
        if (CDend<sgstart || CDstart>sgend) continue;
        if (CDstart>=sgstart && CDstart<=sgend)
              sgstart=CDstart; //seqstart within this segment
@@ -3110,7 +3362,7 @@ void GffObj::getCDSegs(GVec<GffExon>& cds) {
        //cdseg.phase='0'+(cdsacc>0 ? (3-cdsacc%3)%3 : 0);
        cdseg.phase='0' + (3-cdsacc%3)%3 ;
        cdsacc+=sgend-sgstart+1;
-       cdseg.attrs=exons[x]->attrs;
+       cdseg.attrs=exons[x].attrs;
        cdseg.sharedAttrs=true;
        cds.Add(cdseg);
        } //for each exon
@@ -3149,8 +3401,8 @@ char getOvlCode(GffObj& m, GffObj& r, int& ovlen, bool strictMatch) {
 		if (jmax==0) { //also single-exon ref
 			//ovlen=mseg.overlapLen(r.start,r.end);
 			if (singleExonTMatch(m, r, ovlen)) {
-				if (strictMatch) return (r.exons[0]->start==m.exons[0]->start &&
-						r.exons[0]->end==m.exons[0]->end) ? '=' : '~';
+				if (strictMatch) return (r.exons[0].start==m.exons[0].start &&
+						r.exons[0].end==m.exons[0].end) ? '=' : '~';
 				else return '=';
 			}
 			if (m.covlen<r.covlen)
@@ -3162,7 +3414,7 @@ char getOvlCode(GffObj& m, GffObj& r, int& ovlen, bool strictMatch) {
 		//-- single-exon qry overlaping multi-exon ref
 		//check full pre-mRNA case (all introns retained): code 'm'
 
-		if (m.start<=r.exons[0]->end && m.end>=r.exons[jmax]->start)
+		if (m.start<=r.exons[0].end && m.end>=r.exons[jmax].start)
 			return 'm';
 
 		for (int j=0;j<=jmax;j++) {
@@ -3170,20 +3422,20 @@ char getOvlCode(GffObj& m, GffObj& r, int& ovlen, bool strictMatch) {
 			int exovlen=mseg.overlapLen(r.exons[j]);
 			if (exovlen>0) {
 				ovlen+=exovlen;
-				if (m.start>r.exons[j]->start-4 && m.end<r.exons[j]->end+4) {
+				if (m.start>r.exons[j].start-4 && m.end<r.exons[j].end+4) {
 					return 'c'; //close enough to be considered contained in this exon
 				}
 			}
 			if (j==jmax) break; //last exon here, no intron to check
 			//check if it fully covers an intron (retained intron)
-			if (m.start<r.exons[j]->end && m.end>r.exons[j+1]->start)
+			if (m.start<r.exons[j].end && m.end>r.exons[j+1].start)
 				return 'n';
 			//check if it's fully contained by an intron
-			if (m.end<r.exons[j+1]->start && m.start>r.exons[j]->end)
+			if (m.end<r.exons[j+1].start && m.start>r.exons[j].end)
 				return 'i';
 			// check if it's a potential pre-mRNA transcript
 			// (if overlaps this intron at least 10 bases)
-			uint introvl=mseg.overlapLen(r.exons[j]->end+1, r.exons[j+1]->start-1);
+			uint introvl=mseg.overlapLen(r.exons[j].end+1, r.exons[j+1].start-1);
 			//iovlen+=introvl;
 			if (introvl>=10 && mseg.len()>introvl+10) { rcode='e'; }
 		} //for each ref exon
@@ -3200,33 +3452,33 @@ char getOvlCode(GffObj& m, GffObj& r, int& ovlen, bool strictMatch) {
 			int exovlen=rseg.overlapLen(m.exons[i]);
 			if (exovlen>0) {
 				ovlen+=exovlen;
-				if (r.start>m.exons[i]->start-4 && r.end<m.exons[i]->end+4) {
+				if (r.start>m.exons[i].start-4 && r.end<m.exons[i].end+4) {
 					return 'k'; //reference contained in this assembled exon
 				}
 			}
 			if (i==imax) break;
-			if (r.end<m.exons[i+1]->start && r.start>m.exons[i]->end)
+			if (r.end<m.exons[i+1].start && r.start>m.exons[i].end)
 				return 'y'; //ref contained in this transfrag intron
 		}
 		return 'o';
 	}
 	// * check if transfrag contained by a ref intron
 	for (int j=0;j<jmax;j++) {
-		if (m.end<r.exons[j+1]->start && m.start>r.exons[j]->end)
+		if (m.end<r.exons[j+1].start && m.start>r.exons[j].end)
 			return 'i';
 	}
-	if (m.exons[imax]->start<r.exons[0]->end) {
+	if (m.exons[imax].start<r.exons[0].end) {
 		//qry intron chain ends before ref intron chain starts
 		//check if last qry exon plugs the 1st ref intron
-		if (m.exons[imax]->start<=r.exons[0]->end &&
-			m.exons[imax]->end>=r.exons[1]->start) return 'n';
+		if (m.exons[imax].start<=r.exons[0].end &&
+			m.exons[imax].end>=r.exons[1].start) return 'n';
 		return 'o'; //only terminal exons overlap
 	}
-	else if (r.exons[jmax]->start<m.exons[0]->end) {
+	else if (r.exons[jmax].start<m.exons[0].end) {
 		//qry intron chain starts after ref intron chain ends
 		//check if first qry exon plugs the last ref intron
-		if (m.exons[0]->start<=r.exons[jmax-1]->end &&
-			m.exons[0]->end>=r.exons[jmax]->start) return 'n';
+		if (m.exons[0].start<=r.exons[jmax-1].end &&
+			m.exons[0].end>=r.exons[jmax].start) return 'n';
 		return 'o'; //only terminal exons overlap
 	}
 	//check intron chain overlap (match, containment, intron retention etc.)
@@ -3244,14 +3496,14 @@ char getOvlCode(GffObj& m, GffObj& r, int& ovlen, bool strictMatch) {
 	int jmlast=0;  //index of first intron match in reference
 	//check for intron matches
 	while (i<=imax && j<=jmax) {
-		uint mstart=m.exons[i-1]->end;
-		uint mend=m.exons[i]->start;
-		uint rstart=r.exons[j-1]->end;
-		uint rend=r.exons[j]->start;
+		uint mstart=m.exons[i-1].end;
+		uint mend=m.exons[i].start;
+		uint rstart=r.exons[j-1].end;
+		uint rend=r.exons[j].start;
 		if (rend<mstart) { //qry intron starts after ref intron ends
-			if (!intron_conflict && r.exons[j]->overlap(mstart+1, mend-1))
+			if (!intron_conflict && r.exons[j].overlap(mstart+1, mend-1))
 				intron_conflict=true;
-			if (!intron_retention && rstart>=m.exons[i-1]->start)
+			if (!intron_retention && rstart>=m.exons[i-1].start)
 				intron_retention=true;
 			if (intron_ovl) ichain_match=false;
 			j++;
@@ -3259,9 +3511,9 @@ char getOvlCode(GffObj& m, GffObj& r, int& ovlen, bool strictMatch) {
 		} //no intron overlap, skipping ref intron
 		if (rstart>mend) { //qry intron ends before ref intron starts
 			//if qry intron overlaps the exon on the left, we have an intron conflict
-			if (!intron_conflict && r.exons[j-1]->overlap(mstart+1, mend-1))
+			if (!intron_conflict && r.exons[j-1].overlap(mstart+1, mend-1))
 				intron_conflict=true;
-			if (!intron_retention && rend<=m.exons[i]->end)
+			if (!intron_retention && rend<=m.exons[i].end)
 				intron_retention=true;
 			if (intron_ovl) ichain_match=false;
 			i++;
@@ -3291,31 +3543,31 @@ char getOvlCode(GffObj& m, GffObj& r, int& ovlen, bool strictMatch) {
 	if (ichain_match) { //intron sub-chain match
 		if (imfirst==1 && imlast==imax) { // qry full intron chain match
 			if (jmfirst==1 && jmlast==jmax) {//identical intron chains
-				if (strictMatch) return (r.exons[0]->start==m.exons[0]->start &&
-						              r.exons.Last()->end && m.exons.Last()->end) ? '=' : '~';
+				if (strictMatch) return (r.exons[0].start==m.exons[0].start &&
+						              r.exons.Last().end && m.exons.Last().end) ? '=' : '~';
 				else return '=';
 			}
 			// -- qry intron chain is shorter than ref intron chain --
 			int l_iovh=0;   // overhang of leftmost q exon left boundary beyond the end of ref intron to the left
 			int r_iovh=0;   // same type of overhang through the ref intron on the right
-			if (jmfirst>1 && r.exons[jmfirst-1]->start>m.start)
-				l_iovh = r.exons[jmfirst-1]->start - m.start;
-			if (jmlast<jmax && m.end > r.exons[jmlast]->end)
-				r_iovh = m.end - r.exons[jmlast]->end;
+			if (jmfirst>1 && r.exons[jmfirst-1].start>m.start)
+				l_iovh = r.exons[jmfirst-1].start - m.start;
+			if (jmlast<jmax && m.end > r.exons[jmlast].end)
+				r_iovh = m.end - r.exons[jmlast].end;
 			if (l_iovh<4 && r_iovh<4) return 'c';
 		} else if ((jmfirst==1 && jmlast==jmax)) {//ref full intron chain match
 			//check if the reference i-chain is contained in qry i-chain
 			int l_jovh=0;   // overhang of leftmost q exon left boundary beyond the end of ref intron to the left
 			int r_jovh=0;   // same type of overhang through the ref intron on the right
-			if (imfirst>1 && m.exons[imfirst-1]->start>r.start)
-				l_jovh = m.exons[imfirst-1]->start - r.start;
-			if (imlast<imax && r.end > m.exons[imlast]->end)
-				r_jovh = r.end - m.exons[imlast]->end;
+			if (imfirst>1 && m.exons[imfirst-1].start>r.start)
+				l_jovh = m.exons[imfirst-1].start - r.start;
+			if (imlast<imax && r.end > m.exons[imlast].end)
+				r_jovh = r.end - m.exons[imlast].end;
 			if (l_jovh<4 && r_jovh<4) return 'k'; //reverse containment
 		}
 	}
 	//'=', 'c' and 'k' were checked and assigned, check for 'm' and 'n' before falling back to 'j'
-	if (!intron_conflict && (m.start<=r.exons[0]->end && m.end>=r.exons[jmax]->start)) {
+	if (!intron_conflict && (m.start<=r.exons[0].end && m.end>=r.exons[jmax].start)) {
 			return 'm';
 	}
 	if (intron_retention) return 'n';
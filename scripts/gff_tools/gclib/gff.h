@@ -7,17 +7,20 @@
 #include "gdna.h"
 #include "codons.h"
 #include "GFaSeqGet.h"
+#include "GbkReader.h"
 #include "GList.hh"
+#include "GSmallVec.hh"
 #include "GHash.hh"
+#include "GThreads.h"
 
 #ifdef CUFFLINKS
 #include <boost/crc.hpp>  // for boost::crc_32_type
 #endif
 
 //reserved Gffnames::feats entries -- basic feature types
-extern int gff_fid_mRNA; // "mRNA" feature name
-extern int gff_fid_transcript; // *RNA, *transcript feature name
-extern int gff_fid_exon;
+extern const int gff_fid_mRNA; // "mRNA" feature name
+extern const int gff_fid_transcript; // *RNA, *transcript feature name
+extern const int gff_fid_exon;
 
 extern const uint GFF_MAX_LOCUS;
 extern const uint GFF_MAX_EXON;
@@ -48,12 +51,14 @@ extern const char* exonTypes[];
 const char* strExonType(char xtype);
 class GfList;
 
-typedef void GFFCommentParser(const char* cmline, GfList* gflst); //comment parser callback
+//comment parser callback; udata is the pointer given to GffReader::setCommentParser()
+typedef void GFFCommentParser(const char* cmline, GfList* gflst, void* udata);
 //Useful for parsing/maintaining ref seq info from comment lines like this:
 //##sequence-region chr1 1 24895642
 
 class GffReader;
 class GffObj;
+class GLinePipe;
 
 //---transcript overlapping - utility functions:
 int classcode_rank(char c); //returns priority value for class codes
@@ -396,69 +401,83 @@ class GffNameInfo {
      }
 };
 
-class GffNameList:public GPVec<GffNameInfo> {
+//append-only name dictionary: getName(), getId() and Count() take no lock,
+//so the records of one GffNames dictionary can be parsed, edited and printed
+//by several threads at once; only the additions are serialized
+class GffNameList {
   friend class GffNameInfo;
   friend class GffNames;
 protected:
-  GHash<GffNameInfo> byName;//hash with shared keys
-  int idlast; //fList index of last added/reused name
-  int addStatic(const char* tname) {// fast add
-     GffNameInfo* f=new GffNameInfo(tname);
-     idlast=this->Add(f);
-     f->idx=idlast;
-     byName.shkAdd(f->name,f);
-     return idlast;
-     }
-public:
- //GffNameList(int init_capacity=6):GList<GffNameInfo>(init_capacity, false,true,true), byName(false) {
-  GffNameList(int init_capacity=6):GPVec<GffNameInfo>(init_capacity, true), byName(false) {
-    idlast=-1;
-    setCapacity(init_capacity);
-    }
- char* lastNameUsed() { return idlast<0 ? NULL : Get(idlast)->name; }
- int lastNameId() { return idlast; }
- char* getName(int nid) { //retrieve name by its ID
-   if (nid<0 || nid>=fCount)
-         GError("GffNameList Error: invalid index (%d)\n",nid);
-   return fList[nid]->name;
-   }
-
- int addName(const char* tname) {//returns or create an id for the given name
-   //check idlast first, chances are it's the same feature name checked
-   /*if (idlast>=0 && strcmp(fList[idlast]->name,tname)==0)
-       return idlast;*/
-   GffNameInfo* f=byName.Find(tname);
-   int fidx=-1;
-   if (f!=NULL) fidx=f->idx;
-     else {//add new entry
-      f=new GffNameInfo(tname);
-      fidx=this->Add(f);
-      f->idx=fidx;
-      byName.shkAdd(f->name,f);
-      }
-   idlast=fidx;
-   return fidx;
-   }
-
- int addNewName(const char* tname) {
-    GffNameInfo* f=new GffNameInfo(tname);
-    int fidx=this->Add(f);
-    f->idx=fidx;
-    byName.shkAdd(f->name,f);
-    return fidx;
-    }
-
- int getId(const char* tname) { //only returns a name id# if found
-    GffNameInfo* f=byName.Find(tname);
-    if (f==NULL) return -1;
-    return f->idx;
+  enum { CHUNK0_BITS=6, MAX_CHUNKS=26 };
+  //chunk k holds the names with ids from (2^k-1)<<CHUNK0_BITS, 64<<k of them;
+  //the chunks are never moved or reallocated
+  GffNameInfo** chunks[MAX_CHUNKS];
+  int fCount; //number of names, published after the name is stored
+  //open addressing index of the names: a slot only changes from NULL to
+  //a name, and a grown table replaces the previous one, which is kept
+  //(in prev) until destruction as readers may still be probing it
+  struct NameTable {
+    uint size; //power of 2
+    GffNameInfo** slots;
+    NameTable* prev;
+  };
+  NameTable* table;
+  GMutex lock; //serializes the additions
+  static uint nameHash(const char* s) { //FNV-1a
+    uint h=2166136261U;
+    for (;*s;s++) { h^=(unsigned char)*s; h*=16777619U; }
+    return h^(h>>15);
+  }
+  GffNameInfo*& entry(int nid) {
+    uint j=((uint)nid>>CHUNK0_BITS)+1;
+    int k=31-__builtin_clz(j);
+    return chunks[k][nid-(((1<<k)-1)<<CHUNK0_BITS)];
+  }
+  GffNameInfo* find(const char* tname, uint h) {
+    NameTable* t=__atomic_load_n(&table, __ATOMIC_ACQUIRE);
+    uint mask=t->size-1;
+    for (uint i=h & mask;;i=(i+1) & mask) {
+      GffNameInfo* f=__atomic_load_n(&(t->slots[i]), __ATOMIC_ACQUIRE);
+      if (f==NULL) return NULL;
+      if (strcmp(f->name, tname)==0) return f;
     }
- int removeName() {
-   GError("Error: removing names from GffNameList not allowed!\n");
-   return -1;
-   }
+  }
+  int add(const char* tname); //caller holds the lock, tname not found
+  int addStatic(const char* tname) { return addName(tname); }
+public:
+  GffNameList();
+  ~GffNameList();
+  int Count() { return __atomic_load_n(&fCount, __ATOMIC_ACQUIRE); }
+  GffNameInfo* Get(int nid) {
+    if (nid<0 || nid>=Count())
+      GError("GffNameList Error: invalid index (%d)\n",nid);
+    return entry(nid);
+  }
+  char* getName(int nid) { return Get(nid)->name; } //retrieve name by its ID
+  int getId(const char* tname) { //only returns a name id# if found
+    GffNameInfo* f=find(tname, nameHash(tname));
+    return (f==NULL) ? -1 : f->idx;
+  }
+  int addName(const char* tname) { //returns or create an id for the given name
+    uint h=nameHash(tname);
+    GffNameInfo* f=find(tname, h);
+    if (f!=NULL) return f->idx;
+    GLockGuard<GMutex> guard(lock);
+    //another thread may have added it meanwhile
+    f=find(tname, h);
+    if (f!=NULL) return f->idx;
+    return add(tname);
+  }
+  int addNewName(const char* tname) { return addName(tname); }
+  int removeName() {
+    GError("Error: removing names from GffNameList not allowed!\n");
+    return -1;
+  }
 };
 
+//name dictionaries of a set of GffObj records, usually the ones loaded by
+//one GffReader; reference counted (atomically), so records can be created
+//and deleted by any thread
 class GffNames {
  public:
    int numrefs;
@@ -470,9 +489,9 @@ class GffNames {
     numrefs=0;
     //the order below is critical!
     //has to match: gff_fid_mRNA, gff_fid_exon
-    gff_fid_mRNA = feats.addStatic("mRNA");//index 0=gff_fid_mRNA
-    gff_fid_transcript=feats.addStatic("transcript");//index 1=gff_fid_transcript
-    gff_fid_exon=feats.addStatic("exon");//index 1=gff_fid_exon
+    feats.addStatic("mRNA");//index 0=gff_fid_mRNA
+    feats.addStatic("transcript");//index 1=gff_fid_transcript
+    feats.addStatic("exon");//index 2=gff_fid_exon
     //feats.addStatic("CDS"); //index 2=gff_fid_CDS
     }
 };
@@ -669,6 +688,10 @@ class GffExon : public GSeg {
 
 };
 
+//exon/CDS segments are stored by value, sorted by coordinates; most records
+//have a single segment, which is kept inside the GffObj (no allocation)
+typedef GSmallVec<GffExon, 1> GffExonVec;
+
 //only for mapping to spliced coding sequence:
 class GffCDSeg:public GSeg {
  public:
@@ -711,14 +734,16 @@ class GffObj:public GSeg {
    friend class GffReader;
    friend class GffExon;
 public:
-  static GffNames* names; // dictionary storage that holds the various attribute names etc.
+  //dictionary storage that holds the various attribute names etc.,
+  //shared with the GffReader that created this record
+  GffNames* names;
   int track_id; // index of track name in names->tracks
   int gseq_id; // index of genomic sequence name in names->gseqs
   int ftype_id; // index of this record's feature name in names->feats, or the special gff_fid_mRNA value
   int subftype_id; //index of child subfeature name in names->feats (subfeatures stored in "exons")
                    //if ftype_id==gff_fid_mRNA then this value is ignored
-  GList<GffExon> exons; //for non-mRNA entries, these can be any subfeature of type subftype_id
-  GList<GffExon>* cdss; //only !NULL for cases of "programmed frameshift" when CDS boundaries do not match
+  GffExonVec exons; //for non-mRNA entries, these can be any subfeature of type subftype_id
+  GffExonVec* cdss; //only !NULL for cases of "programmed frameshift" when CDS boundaries do not match
                       //exons boundaries
   GPVec<GffObj> children;
   GffObj* parent;
@@ -767,43 +792,46 @@ public:
   }
 
   //return the index of exon containing coordinate coord, or -1 if not
-  int whichExon(uint coord, GList<GffExon>* segs=NULL);
+  int whichExon(uint coord, GffExonVec* segs=NULL);
   int readExon(GffReader& reader, GffLine& gl);
 
-  int addExon(GList<GffExon>& segs, GffLine& gl, int8_t exontype_override=exgffNone); //add to cdss or exons
+  int addExon(GffExonVec& segs, GffLine& gl, int8_t exontype_override=exgffNone); //add to cdss or exons
 
   int addExon(uint segstart, uint segend, int8_t exontype=exgffNone, char phase='.',
-		      GffScore exon_score=GFFSCORE_NONE, GList<GffExon>* segs=NULL);
+		      GffScore exon_score=GFFSCORE_NONE, GffExonVec* segs=NULL);
 
 protected:
-  bool reduceExonAttrs(GList<GffExon>& segs);
+  bool reduceExonAttrs(GffExonVec& segs);
   //utility segment-merging function for addExon()
-  void expandSegment(GList<GffExon>&segs, int oi, uint segstart, uint segend,
+  void expandSegment(GffExonVec&segs, int oi, uint segstart, uint segend,
        int8_t exontype);
   bool processGeneSegments(GffReader* gfr); //for genes that have _gene_segment features (NCBI annotation)
-  void transferCDS(GffExon* cds);
+  void transferCDS(GffExon& cds);
 public:
   void removeExon(int idx);
-  void removeExon(GffExon* p);
+  void removeExon(GSeg& seg); //remove the exon with the same coordinates
   char  strand; //true if features are on the reverse complement strand
   GffScore gscore;
   int covlen; //total coverage of reference genomic sequence (sum of maxcf segment lengths)
   GffAttrs* attrs; //other gff3 attributes found for the main mRNA feature
    //constructor by gff line parsing:
   GffObj(GffReader& gfrd, BEDLine& bedline);
+  GffObj(GffReader& gfrd, GbkFeature& gbkf, const char* gseqname, const char* id);
+  void addCDSegs(GbkFeature& gbkf); //add the segments of a GenBank CDS feature
   GffObj(GffReader& gfrd, GffLine& gffline);
    //if gfline->Parent!=NULL then this will also add the first sub-feature
    // otherwise, only the main feature is created
   void copyAttrs(GffObj* from);
   void clearAttrs() {
     if (attrs!=NULL) {
-      bool sharedattrs=(exons.Count()>0 && exons[0]->attrs==attrs);
+      bool sharedattrs=(exons.Count()>0 && exons[0].attrs==attrs);
       delete attrs; attrs=NULL;
-      if (sharedattrs) exons[0]->attrs=NULL;
+      if (sharedattrs) exons[0].attrs=NULL;
       }
     }
-  GffObj(char* anid=NULL):GSeg(0,0), exons(true,true,false), cdss(NULL), children(1,false), gscore() {
-                                   //exons: sorted, free, non-unique
+  GffObj(GffNames* gnames, char* anid=NULL):GSeg(0,0), names(gnames), exons(), cdss(NULL),
+		  children(1,false), gscore() {
+                                   //exons: sorted, non-unique
        gffID=NULL;
        uptr=NULL;
        ulink=NULL;
@@ -848,7 +876,7 @@ public:
    bool monoFeature() {
      return (exons.Count()==0 ||
           (exons.Count()==1 &&  //exon_ftype_id==ftype_id &&
-              exons[0]->end==this->end && exons[0]->start==this->start));
+              exons[0].end==this->end && exons[0].start==this->start));
      }
 
    bool hasCDS() { return (CDstart>0); }
@@ -878,7 +906,7 @@ public:
          r=attrs->getAttr(names, attrname);
      if (r!=NULL) return r;
      if (checkFirstExon && exons.Count()>0) {
-        r=exons.First()->getAttr(names, attrname);
+        r=exons.First().getAttr(names, attrname);
      }
      return r;
    }
@@ -890,7 +918,7 @@ public:
 
    char* getExonAttr(int exonidx, const char* attrname) {
       if (exonidx<0 || exonidx>=exons.Count() || attrname==NULL) return NULL;
-      return exons[exonidx]->getAttr(names, attrname);
+      return exons[exonidx].getAttr(names, attrname);
       }
 
    char* getAttrValue(int i) {
@@ -913,7 +941,7 @@ public:
       //ignores strand!
       if (s>e) Gswap(s,e);
       for (int i=0;i<exons.Count();i++) {
-         if (exons[i]->overlap(s,e)) return true;
+         if (exons[i].overlap(s,e)) return true;
          }
       return false;
    }
@@ -922,8 +950,8 @@ public:
      // ignores strand and gseq_id, must check in advance
      for (int i=0;i<exons.Count();i++) {
          for (int j=0;j<m.exons.Count();j++) {
-            if (exons[i]->start>m.exons[j]->end) continue;
-            if (m.exons[j]->start>exons[i]->end) break;
+            if (exons[i].start>m.exons[j].end) continue;
+            if (m.exons[j].start>exons[i].end) break;
             //-- overlap if we are here:
             return true;
          }
@@ -931,7 +959,7 @@ public:
      return false;
    }
 
-   int exonOverlapIdx(GList<GffExon>& segs, uint s, uint e, int* ovlen=NULL, int start_idx=0);
+   int exonOverlapIdx(GffExonVec& segs, uint s, uint e, int* ovlen=NULL, int start_idx=0);
 
    int exonOverlapLen(GffObj& m) {
       if (start>m.end || m.start>end) return 0;
@@ -939,10 +967,10 @@ public:
       int j=0;
       int ovlen=0;
       while (i<exons.Count() && j<m.exons.Count()) {
-        uint istart=exons[i]->start;
-        uint iend=exons[i]->end;
-        uint jstart=m.exons[j]->start;
-        uint jend=m.exons[j]->end;
+        uint istart=exons[i].start;
+        uint iend=exons[i].end;
+        uint jstart=m.exons[j].start;
+        uint jend=m.exons[j].end;
         if (istart>jend) { j++; continue; }
         if (jstart>iend) { i++; continue; }
         //exon overlap
@@ -1001,7 +1029,7 @@ public:
    int addSeg(int fnid, GffLine* gfline);
    void getCDSegs(GVec<GffExon>& cds);
 
-   void updateCDSPhase(GList<GffExon>& segs); //for CDS-only features, updates GffExon::phase
+   void updateCDSPhase(GffExonVec& segs); //for CDS-only features, updates GffExon::phase
    void printGTab(FILE* fout, char** extraAttrs=NULL);
    void printGxfExon(FILE* fout, const char* tlabel, const char* gseqname,
           bool iscds, GffExon* exon, bool gff3, bool cvtChars, char* dbuf, int dbuf_len);
@@ -1117,12 +1145,11 @@ class CNonExon { //utility class used in subfeature promotion
  public:
    //int idx;
    GffObj* parent;
-   GffExon* exon;
+   GSeg exon; //coordinates of the parent's exon created for this subfeature
    GffLine* gffline;
    //CNonExon(int i, GffObj* p, GffExon* e, GffLine* gl) {
-   CNonExon(GffObj* p, GffExon* e, GffLine& gl) {
+   CNonExon(GffObj* p, GffExon& e, GffLine& gl):exon(e.start, e.end) {
      parent=p;
-     exon=e;
      //idx=i;
      gffline=new GffLine(gl);
      }
@@ -1150,6 +1177,8 @@ class GffReader {
        bool gtf_gene:1; //has "gene" features (3-level GTF ..Ensembl?)
        bool is_BED:1; //input is BED-12 format, possibly with attributes in 13th field
        bool is_TLF:1; //input is GFF3-like Transcript Line Format with exons= attribute
+       bool is_GBK:1; //input is a GenBank or EMBL flat file
+       bool is_EMBL:1; //the current GBK input entry is in EMBL format
        //--other flags
        bool transcripts_Only:1; //default ; only keep recognized transcript features
        bool keep_Genes:1; //for transcriptsOnly, do not discard genes from gflst
@@ -1167,10 +1196,13 @@ class GffReader {
   };
   //char* lastReadNext;
   FILE* fh;
+  GLinePipe* linePipe; //if set, the lines are taken from here instead of fh
   char* fname;  //optional fasta file with the underlying genomic sequence to be attached to this reader
   GFFCommentParser* commentParser;
+  void* commentData; //passed to commentParser
   GffLine* gffline;
   BEDLine* bedline;
+  GffNames* names; //name dictionary of the records loaded by this reader
   //bool transcriptsOnly; //keep only transcripts w/ their exon/CDS features
   //bool gene2exon;  // for childless genes: add an exon as the entire gene span
   GHash<int> discarded_ids; //for transcriptsOnly mode, keep track
@@ -1189,29 +1221,33 @@ class GffReader {
   CNonExon* subfPoolCheck(GffLine* gffline, GHash<CNonExon>& pex, char*& subp_name);
   void subfPoolAdd(GHash<CNonExon>& pex, GffObj* newgfo);
   GffObj* promoteFeature(CNonExon* subp, char*& subp_name, GHash<CNonExon>& pex);
+  void readGbkEntry(GbkReader& gbkr);
+  char* readLine(int& llen);
 
 #ifdef CUFFLINKS
      boost::crc_32_type  _crc_result;
 #endif
  public:
   GPVec<GSeqStat> gseqtable; //table with all genomic sequences, but only current GXF gseq ID indices will have non-NULL
-  //GffNames* names; //just a pointer to the global static Gff names repository
   GfList gflst; //keeps track of all GffObj records being read (when readAll() is used)
-  GffObj* newGffRec(GffLine* gffline, GffObj* parent=NULL, GffExon* pexon=NULL,
+  GffObj* newGffRec(GffLine* gffline, GffObj* parent=NULL, GSeg* pexon=NULL,
 		       GPVec<GffObj>* glst=NULL, bool replace_parent=false);
   GffObj* newGffRec(BEDLine* bedline, GPVec<GffObj>* glst=NULL);
+  GffObj* newGffRec(GbkFeature* gbkf, const char* gseqname, const char* id, GffObj* parent=NULL);
+  GFastaDb* gbkSeqs; //if set, the sequences of the GenBank/EMBL entries are added here
   //GffObj* replaceGffRec(GffLine* gffline, bool keepAttr, bool noExonAttr, int replaceidx);
   GffObj* updateGffRec(GffObj* prevgfo, GffLine* gffline);
   GffObj* updateParent(GffObj* newgfh, GffObj* parent);
   bool readExonFeature(GffObj* prevgfo, GffLine* gffline, GHash<CNonExon>* pex=NULL);
   GPVec<GSeqStat> gseqStats; //populated after finalize() with only the ref seqs in this file
-  GffReader(FILE* f=NULL, bool t_only=false, bool sort=false):linebuf(NULL), fpos(0),
-		  buflen(0), flags(0), fh(f), fname(NULL), commentParser(NULL), gffline(NULL),
-		  bedline(NULL), discarded_ids(true), phash(true), gseqtable(1,true),
-		  gflst(), gseqStats(1, false) {
+  //the records are added to the gnames dictionary, or to a new one if NULL
+  GffReader(FILE* f=NULL, bool t_only=false, bool sort=false, GffNames* gnames=NULL):linebuf(NULL), fpos(0),
+		  buflen(0), flags(0), fh(f), linePipe(NULL), fname(NULL), commentParser(NULL), commentData(NULL), gffline(NULL),
+		  bedline(NULL), names(gnames), discarded_ids(true), phash(true), gseqtable(1,true),
+		  gflst(), gbkSeqs(NULL), gseqStats(1, false) {
       GMALLOC(linebuf, GFF_LINELEN);
       buflen=GFF_LINELEN-1;
-      gffnames_ref(GffObj::names);
+      gffnames_ref(names);
       //gff_warns=gff_show_warnings;
       transcripts_Only=t_only;
       sortByLoc=sort;
@@ -1230,11 +1266,15 @@ class GffReader {
       gene2exon=g2exon;
   }
   */
+  //read the GFF/BED lines from a started GLinePipe reading fh
+  void setLinePipe(GLinePipe* lpipe) { linePipe=lpipe; }
+  off_t getFilePos() { return fpos; } //input bytes parsed so far
   void gene2Exon(bool v) { gene2exon=v;}
   void enableSorting(bool sorting=true) { sortByLoc=sorting; }
   bool getSorting() { return sortByLoc; }
   void isBED(bool v=true) { is_BED=v; } //should be set before any parsing!
   void isTLF(bool v=true) { is_TLF=v; } //should be set before any parsing!
+  void isGBK(bool v=true) { is_GBK=v; } //should be set before any parsing!
   void keepAttrs(bool keep_attrs=true, bool discardExonAttrs=true, bool preserve_exon_attrs=false) {
 	  keep_Attrs=keep_attrs;
 	  noExonAttrs=discardExonAttrs;
@@ -1261,16 +1301,17 @@ class GffReader {
 	refAlphaSort=v;
 	if (v) sortByLoc=true;
   }
-  void setCommentParser(GFFCommentParser* cmParser=NULL) {
+  void setCommentParser(GFFCommentParser* cmParser=NULL, void* udata=NULL) {
 	  commentParser=cmParser;
+	  commentData=udata;
   }
 
-  GffReader(const char* fn, bool t_only=false, bool sort=false):linebuf(NULL), fpos(0),
-	  		  buflen(0), flags(0), fh(NULL), fname(NULL), commentParser(NULL),
-			  gffline(NULL), bedline(NULL), discarded_ids(true),
-			  phash(true), gseqtable(1,true), gflst(), gseqStats(1,false) {
+  GffReader(const char* fn, bool t_only=false, bool sort=false, GffNames* gnames=NULL):linebuf(NULL), fpos(0),
+	  		  buflen(0), flags(0), fh(NULL), linePipe(NULL), fname(NULL), commentParser(NULL),
+			  commentData(NULL), gffline(NULL), bedline(NULL), names(gnames), discarded_ids(true),
+			  phash(true), gseqtable(1,true), gflst(), gbkSeqs(NULL), gseqStats(1,false) {
       //gff_warns=gff_show_warnings;
-      gffnames_ref(GffObj::names);
+      gffnames_ref(names);
       noExonAttrs=true;
       transcripts_Only=t_only;
       sortByLoc=sort;
@@ -1293,7 +1334,7 @@ class GffReader {
       GFREE(fname);
       GFREE(linebuf);
       //GFREE(lastReadNext);
-      gffnames_unref(GffObj::names);
+      gffnames_unref(names);
       }
 
 
@@ -1376,16 +1417,16 @@ class GeneCDSChain: public GSeg { //keep track of CDS chains of the gene and the
 	    int nc=0;
 	    bool match=false;
 	    for (int i=0;i<t.exons.Count();i++) {
-	    	if (t.exons[i]->overlap(cdsList[0])) {
-	    	   if (cdsList[0].start>=t.exons[i]->start &&
-	    			cdsList[0].end<=t.exons[i]->end) {
+	    	if (t.exons[i].overlap(cdsList[0])) {
+	    	   if (cdsList[0].start>=t.exons[i].start &&
+	    			cdsList[0].end<=t.exons[i].end) {
 	    		  match=true;
-	    		  nc+=cdsList[0].start-t.exons[i]->start+t.exons[i]->end+cdsList[0].end;
+	    		  nc+=cdsList[0].start-t.exons[i].start+t.exons[i].end+cdsList[0].end;
 	    	   } //contained in this exon
 	    	   else return false; //overlap, but not contained
 	    	   continue;
 	    	}
-	    	nc+=t.exons[i]->len();
+	    	nc+=t.exons[i].len();
 	    }
 	    if (!match) return false;
 	    ncov=nc;
@@ -1401,13 +1442,13 @@ class GeneCDSChain: public GSeg { //keep track of CDS chains of the gene and the
 	    int mintrons=0; //matched introns
 	    while (e<emax && c<cmax) {
 	    	if (mintrons>0 &&
-	    			(cdsList[c].end!=t.exons[e]->end ||
-	    					cdsList[c+1].start!=t.exons[e+1]->start))
+	    			(cdsList[c].end!=t.exons[e].end ||
+	    					cdsList[c+1].start!=t.exons[e+1].start))
 	    		return false;
 	    	GSeg cintron(cdsList[c].end+1, cdsList[c+1].start-1);
-	    	GSeg eintron(t.exons[e]->end+1, t.exons[e+1]->start-1);
+	    	GSeg eintron(t.exons[e].end+1, t.exons[e+1].start-1);
 	    	if (cintron.start>eintron.end) {
-	    		nc+=t.exons[e]->len();
+	    		nc+=t.exons[e].len();
 	    		e++;
 	    		continue;
 	    	}
@@ -1417,8 +1458,8 @@ class GeneCDSChain: public GSeg { //keep track of CDS chains of the gene and the
 	    				cintron.end==eintron.end) {
 	    			//intron match
 	    			if (mintrons==0) {
-	    				if (cdsList[c].start<t.exons[e]->start) return false;
-	    				nc+=cdsList[c].start-t.exons[e]->start;
+	    				if (cdsList[c].start<t.exons[e].start) return false;
+	    				nc+=cdsList[c].start-t.exons[e].start;
 	    			}
 	    			mintrons++;
 	    			c++;e++;
@@ -1430,9 +1471,9 @@ class GeneCDSChain: public GSeg { //keep track of CDS chains of the gene and the
 	    }
 	    if (mintrons<cdsList.Count()-1) return false;
         //c should be cmax, e should be the last exon with CDS
-	    nc+=t.exons[e]->end-cdsList[c].end;
+	    nc+=t.exons[e].end-cdsList[c].end;
 	    for(int i=e+1;i<t.exons.Count();i++)
-	    	nc+=t.exons[i]->len();
+	    	nc+=t.exons[i].len();
 	    ncov=nc;
 	    return true;
 	}
@@ -1446,10 +1487,10 @@ class GeneCDSChain: public GSeg { //keep track of CDS chains of the gene and the
                //no exons defined, just check boundaries
                return singleExonCDSMatch(t.start, t.end, ncov);
            else //single-exon
-               return singleExonCDSMatch(t.exons[0]->start, t.exons[0]->end, ncov);
+               return singleExonCDSMatch(t.exons[0].start, t.exons[0].end, ncov);
 	    } //single or no exon
 	    else { //multi-exon transcript
-	    	if (start<t.exons.First()->start || end>t.exons.Last()->end)
+	    	if (start<t.exons.First().start || end>t.exons.Last().end)
 	    		return false; //no containment possible;
 	    	if (cdsList.Count()==1)
 	    		return singleCDStoExon(t, ncov);
@@ -33,6 +33,14 @@ static void fillAddr(const GStr &address, unsigned short port,
 // GSocket Code
 
 GSocket::GSocket(int type, int protocol) {
+  init(PF_INET, type, protocol);
+}
+
+GSocket::GSocket(int domain, int type, int protocol) {
+  init(domain, type, protocol);
+}
+
+void GSocket::init(int domain, int type, int protocol) {
   #ifdef WIN32
     if (!initialized) {
       WORD wVersionRequested;
@@ -47,7 +55,7 @@ GSocket::GSocket(int type, int protocol) {
   #endif
 
   // Make a new socket
-  if ((sockDesc = socket(PF_INET, type, protocol)) < 0) {
+  if ((sockDesc = socket(domain, type, protocol)) < 0) {
     GSocketErr("GSocket creation failed (socket())", true);
   }
 }
@@ -61,6 +69,14 @@ GSocket::~GSocket() {
   sockDesc = -1;
 }
 
+void GSocket::shutdown() {
+  #ifdef WIN32
+    ::shutdown(sockDesc, SD_BOTH);
+  #else
+    ::shutdown(sockDesc, SHUT_RDWR);
+  #endif
+}
+
 GStr GSocket::getLocalAddress() {
   sockaddr_in addr;
   unsigned int addr_len = sizeof(addr);
@@ -159,6 +175,24 @@ void GCommSocket::send(const void *buffer, int bufferLen)  {
   }
 }
 
+bool GCommSocket::sendAll(const void *buffer, int bufferLen) {
+  const char* p=(const char*)buffer;
+  while (bufferLen>0) {
+  #ifdef MSG_NOSIGNAL
+    int rtn = ::send(sockDesc, (raw_type *) p, bufferLen, MSG_NOSIGNAL);
+  #else
+    int rtn = ::send(sockDesc, (raw_type *) p, bufferLen, 0);
+  #endif
+    if (rtn<0) {
+      if (errno==EINTR) continue;
+      return false;
+    }
+    p+=rtn;
+    bufferLen-=rtn;
+  }
+  return true;
+}
+
 int GCommSocket::recv(void *buffer, int bufferLen) {
   int rtn;
   if ((rtn = ::recv(sockDesc, (raw_type *) buffer, bufferLen, 0)) < 0) {
@@ -186,6 +220,28 @@ GStr GCommSocket::recvline() {
 }
 
 
+bool GCommSocket::recvline(GStr& line) {
+  line="";
+  char buf[1024];
+  while (true) {
+    //peek first, then consume only up to the end of the line
+    int rtn = ::recv(sockDesc, (raw_type *) buf, 1024, MSG_PEEK);
+    if (rtn<0 && errno==EINTR) continue;
+    if (rtn<=0) return (rtn==0 && !line.is_empty());
+    char* p=(char*)memchr((void*)buf, '\n', rtn);
+    int toread=(p==NULL) ? rtn : (p-buf)+1;
+    rtn = ::recv(sockDesc, (raw_type *) buf, toread, 0);
+    if (rtn<=0) return false;
+    if (p!=NULL) {
+      int llen=rtn-1;
+      if (llen>0 && buf[llen-1]=='\r') llen--;
+      line.appendmem(buf, llen);
+      return true;
+    }
+    line.appendmem(buf, rtn);
+  }
+}
+
 GStr GCommSocket::getForeignAddress() {
   sockaddr_in addr;
   unsigned int addr_len = sizeof(addr);
@@ -224,6 +280,70 @@ void GTCPServerSocket::setListen(int queueLen) {
     GSocketErr("Set listening socket failed (listen())", true);
 }
 
+void GTCPServerSocket::setReuseAddress() {
+  int reuse = 1;
+  setsockopt(sockDesc, SOL_SOCKET, SO_REUSEADDR, (raw_type *) &reuse, sizeof(reuse));
+}
+
+#ifndef WIN32
+// Function to fill in a Unix domain address structure given a socket file path
+static void fillUnixAddr(const GStr &path, sockaddr_un &addr) {
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (path.length() >= (int)sizeof(addr.sun_path))
+    GSocketErr("Unix socket path too long: "+path);
+  strcpy(addr.sun_path, path.chars());
+}
+
+// GUnixSocket Code
+
+void GUnixSocket::connect(const GStr &path) {
+  sockaddr_un destAddr;
+  fillUnixAddr(path, destAddr);
+  if (::connect(sockDesc, (sockaddr *) &destAddr, sizeof(destAddr)) < 0) {
+    GSocketErr("Connect failed (connect())", true);
+  }
+}
+
+// GUnixServerSocket Code
+
+GUnixServerSocket::GUnixServerSocket(const GStr &path, int queueLen)
+          : GSocket(AF_UNIX, SOCK_STREAM, 0), sockPath(path) {
+  sockaddr_un localAddr;
+  fillUnixAddr(path, localAddr);
+  struct stat st;
+  if (lstat(path.chars(), &st)==0) {
+    //only a stale socket file is removed: not a regular file,
+    //nor the socket of a server still running on that path
+    if (!S_ISSOCK(st.st_mode))
+      GSocketErr("Socket path exists and is not a socket: "+path);
+    int sd=socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sd<0) GSocketErr("Socket creation failed (socket())", true);
+    bool inUse=(::connect(sd, (sockaddr *) &localAddr, sizeof(localAddr))==0);
+    ::close(sd);
+    if (inUse) GSocketErr("A server is already listening on "+path);
+    unlink(path.chars());
+  }
+  if (bind(sockDesc, (sockaddr *) &localAddr, sizeof(localAddr)) < 0) {
+    GSocketErr("Set of socket file failed (bind())", true);
+  }
+  if (listen(sockDesc, queueLen) < 0)
+    GSocketErr("Set listening socket failed (listen())", true);
+}
+
+GUnixServerSocket::~GUnixServerSocket() {
+  unlink(sockPath.chars());
+}
+
+GUnixSocket *GUnixServerSocket::accept() {
+  int newConnSD;
+  while ((newConnSD = ::accept(sockDesc, NULL, 0)) < 0) {
+    if (errno!=EINTR) GSocketErr("Accept failed (accept())", true);
+  }
+  return new GUnixSocket(newConnSD);
+}
+#endif
+
 // GUDPSocket Code
 
 void GUDPSocket::setBroadcast() {
@@ -14,6 +14,7 @@
   #include <arpa/inet.h>       // For inet_addr()
   #include <unistd.h>          // For close()
   #include <netinet/in.h>      // For sockaddr_in
+  #include <sys/un.h>          // For sockaddr_un
   typedef void raw_type;       // Type used for raw data on this platform
 #endif
 
@@ -85,6 +86,13 @@ public:
   static unsigned short resolveService(const GStr &service,
                                        const GStr &protocol = "tcp");
 
+  //  Socket descriptor, e.g. for poll()
+  int getDescriptor() { return sockDesc; }
+
+  //  Shut down both directions of the connection; a recv() blocked
+  //  on this socket in another thread returns 0
+  void shutdown();
+
 private:
   // Prevent the user from trying to use value semantics on this object
   GSocket(const GSocket &sock);
@@ -93,6 +101,8 @@ private:
 protected:
   int sockDesc;              // Socket descriptor
   GSocket(int type, int protocol);
+  GSocket(int domain, int type, int protocol);
+  void init(int domain, int type, int protocol);
   GSocket(int sockDesc) { this->sockDesc = sockDesc; }
 };
 
@@ -119,6 +129,14 @@ public:
   void send(const void *buffer, int bufferLen);
   void send(const GStr& str) { send(str.chars(), str.length()); }
 
+  /**
+   *   Write the whole buffer to this socket, like send(), but failures
+   *   (e.g. the peer closed the connection) are not fatal and do not
+   *   raise SIGPIPE; a server should use this for its replies
+   *   @return false if the data could not be sent
+   */
+  bool sendAll(const void *buffer, int bufferLen);
+
   /**
    *   Read into the given buffer up to bufferLen bytes data from this
    *   socket.  Call connect() before calling recv()
@@ -128,6 +146,14 @@ public:
    */
   int recv(void *buffer, int bufferLen);
   GStr recvline();
+
+  /**
+   *   Read the next line (without the line terminator) into line; only
+   *   the bytes up to and including the '\n' are consumed, so pipelined
+   *   lines are not lost
+   *   @return false at EOF or on error (not fatal)
+   */
+  bool recvline(GStr& line);
   /**
    *   Get the foreign address.  Call connect() before calling recv()
    *   @return foreign address
@@ -142,6 +168,7 @@ public:
 
 protected:
   GCommSocket(int type, int protocol) : GSocket(type, protocol) { }
+  GCommSocket(int domain, int type, int protocol) : GSocket(domain, type, protocol) { }
   GCommSocket(int newConnSD) : GSocket(newConnSD) { }
 };
 
@@ -182,6 +209,7 @@ public:
    */
   GTCPServerSocket(unsigned short localPort, int queueLen = 5)
           : GSocket(SOCK_STREAM, IPPROTO_TCP) {
+     setReuseAddress();
      setLocalPort(localPort);
      setListen(queueLen);
   }
@@ -197,6 +225,7 @@ public:
    */
   GTCPServerSocket(const GStr &localAddress, unsigned short localPort,
       int queueLen = 5) : GSocket(SOCK_STREAM, IPPROTO_TCP) {
+    setReuseAddress();
     setLocalAddressAndPort(localAddress, localPort);
     setListen(queueLen);
   }
@@ -207,8 +236,52 @@ public:
 
 private:
   void setListen(int queueLen);
+  // allow a restarted server to bind again to a port in TIME_WAIT state
+  void setReuseAddress();
+};
+
+#ifndef WIN32
+//   Unix domain (local) socket, connected to a socket file
+class GUnixSocket : public GCommSocket {
+public:
+  //   Construct a Unix domain socket connected to the given socket file
+  GUnixSocket(const GStr &path) : GCommSocket(AF_UNIX, SOCK_STREAM, 0) {
+     connect(path);
+  }
+  void connect(const GStr &path);
+
+private:
+  // Access for GUnixServerSocket::accept() connection creation
+  friend class GUnixServerSocket;
+  GUnixSocket(int newConnSD) : GCommSocket(newConnSD) { }
 };
 
+//  Unix domain socket class for local servers
+class GUnixServerSocket : public GSocket {
+public:
+  /**
+   *   Construct a Unix domain socket listening on the socket file path;
+   *   a stale socket file left at that path is removed first (it is an
+   *   error if the path is not a socket, or a server is listening on it),
+   *   and the socket file is removed again by the destructor
+   *   @param path socket file path
+   *   @param queueLen maximum queue length for outstanding
+   *                   connection requests (default 5)
+   */
+  GUnixServerSocket(const GStr &path, int queueLen = 5);
+  ~GUnixServerSocket();
+
+  //  Blocks until a new connection is established on this socket or error
+  //  @return new connection socket
+  GUnixSocket *accept();
+
+  const char* getPath() { return sockPath.chars(); }
+
+private:
+  GStr sockPath;
+};
+#endif
+
 /**
   *   UDP socket class
   */
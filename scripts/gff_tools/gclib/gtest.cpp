@@ -4,9 +4,16 @@
 #include "GBitVec.h"
 #include "GList.hh"
 #include "GHash.hh"
+#include "GIntHash.hh"
+#include "GThreads.h"
+#include "GQueue.hh"
+#include "GCdbYank.h"
+#include "gstopwatch.h"
 
 #define USAGE "Usage:\n\
 gtest [--bit-test|-g|--genomic-fasta <genomic_seqs_fasta>] [-c|COV=<cov%>] \n\
+ [--hash-bench <n>] [--conc-hash-test <threads>] [--conc-hash-bench <threads>] \n\
+ [--pool-test <threads>] [--queue-test <threads>] [--cdb-test <threads>] \n\
  [-s|--seq <seq_info.fsize>] [-o|--out <outfile.gff>] [--disable-flag] [-t|--test <string>]\n\
  [-p|PID=<pid%>] file1 [file2 file3 ..]\n\
  "
@@ -20,7 +27,13 @@ enum {
  OPT_TEST,
  OPT_PID,
  OPT_BITVEC,
- OPT_NUM
+ OPT_NUM,
+ OPT_HASHBENCH,
+ OPT_CHASHTEST,
+ OPT_CHASHBENCH,
+ OPT_POOLTEST,
+ OPT_QUEUETEST,
+ OPT_CDBTEST
 };
 
 GArgsDef opts[] = {
@@ -34,6 +47,12 @@ GArgsDef opts[] = {
 {"PID",           'p', 1, OPT_PID},
 {"bit-test",      'B', 0, OPT_BITVEC},
 {"bignum",        'n', 1, OPT_NUM},
+{"hash-bench",     0,  1, OPT_HASHBENCH},
+{"conc-hash-test", 0,  1, OPT_CHASHTEST},
+{"conc-hash-bench", 0, 1, OPT_CHASHBENCH},
+{"pool-test",      0,  1, OPT_POOLTEST},
+{"queue-test",     0,  1, OPT_QUEUETEST},
+{"cdb-test",       0,  1, OPT_CDBTEST},
 {0,0,0,0}
 };
 
@@ -65,12 +84,803 @@ void testGPVec() {
  GMessage("Added to vecs[2]:%d\n", vecs[2][0]->val());
 }
 
+//--- GHash microbenchmark (--hash-bench)
+//reference copy of the previous GHash probing: ELF strhash() and
+//HASH1/HASH2 double hashing modulo the table size, 80% max load
+struct OldHashEntry {
+  char* key;
+  int hash; //-1 for empty slots
+  pointer data;
+};
+
+class OldHash {
+  OldHashEntry* hash;
+  int fCapacity;
+  int fCount;
+  static uint hash1(int x, int n) { return ((uint)x*13)%n; }
+  static uint hash2(int x, int n) { return 1|(((uint)x*17)%(n-1)); }
+  void resize(int n) {
+    OldHashEntry* k;
+    GMALLOC(k, sizeof(OldHashEntry)*n);
+    for (int i=0;i<n;i++) k[i].hash=-1;
+    for (int i=0;i<fCapacity;i++) {
+      int h=hash[i].hash;
+      if (h<0) continue;
+      int p=hash1(h,n), x=hash2(h,n);
+      while (k[p].hash!=-1) p=(p+x)%n;
+      k[p]=hash[i];
+    }
+    GFREE(hash);
+    hash=k;
+    fCapacity=n;
+  }
+ public:
+  OldHash():hash(NULL), fCapacity(32), fCount(0) {
+    GMALLOC(hash, sizeof(OldHashEntry)*fCapacity);
+    for (int i=0;i<fCapacity;i++) hash[i].hash=-1;
+  }
+  ~OldHash() {
+    for (int i=0;i<fCapacity;i++)
+      if (hash[i].hash>=0) GFREE(hash[i].key);
+    GFREE(hash);
+  }
+  void Add(const char* ky, pointer data) {
+    int h=strhash(ky);
+    int p=hash1(h,fCapacity), x=hash2(h,fCapacity);
+    while (hash[p].hash!=-1) {
+      if (hash[p].hash==h && strcmp(hash[p].key,ky)==0) {
+        hash[p].data=data;
+        return;
+      }
+      p=(p+x)%fCapacity;
+    }
+    hash[p].hash=h;
+    hash[p].key=Gstrdup(ky);
+    hash[p].data=data;
+    fCount++;
+    if (100*fCount>=80*fCapacity) resize(fCapacity*2);
+  }
+  pointer Find(const char* ky) {
+    int h=strhash(ky);
+    int p=hash1(h,fCapacity), x=hash2(h,fCapacity);
+    int n=fCapacity;
+    while (n && hash[p].hash!=-1) {
+      if (hash[p].hash==h && strcmp(hash[p].key,ky)==0) return hash[p].data;
+      p=(p+x)%fCapacity;
+      n--;
+    }
+    return NULL;
+  }
+};
+
+static double benchNs(GStopWatch& sw, int n) {
+  sw.stopTimer();
+  return sw.getElapsedTime()*1e9/n;
+}
+
+template<class H> void benchTable(const char* label, H& h, char** keys, char** qkeys,
+		char** missing, int n) {
+  GStopWatch sw;
+  int found=0;
+  sw.startTimer();
+  for (int i=0;i<n;i++) h.Add(keys[i], keys[i]);
+  double tadd=benchNs(sw, n);
+  sw.startTimer();
+  for (int r=0;r<4;r++)
+    for (int i=0;i<n;i++) if (h.Find(qkeys[i])!=NULL) found++;
+  double tfind=benchNs(sw, 4*n);
+  sw.startTimer();
+  for (int r=0;r<4;r++)
+    for (int i=0;i<n;i++) if (h.Find(missing[i])!=NULL) found++;
+  double tmiss=benchNs(sw, 4*n);
+  if (found!=4*n) GError("Error: %s found %d keys instead of %d!\n", label, found, 4*n);
+  GMessage("%-10s add: %7.1f ns/op  find: %7.1f ns/op  find-missing: %7.1f ns/op\n",
+      label, tadd, tfind, tmiss);
+}
+
+//GFF-like ID keys (e.g. "gene-PHAGE_00123", "rna-XM_000123.1")
+void hashBench(int n) {
+  if (n<=0) n=1000000;
+  char** keys=NULL;
+  char** missing=NULL;
+  GMALLOC(keys, n*sizeof(char*));
+  GMALLOC(missing, n*sizeof(char*));
+  char buf[64];
+  for (int i=0;i<n;i++) {
+    if (i%2) sprintf(buf, "rna-XM_%06d.%d", i, 1+i%3);
+    else sprintf(buf, "gene-PHAGE_%05d", i);
+    keys[i]=Gstrdup(buf);
+    sprintf(buf, "cds-YP_%06d.%d", i, 1+i%3);
+    missing[i]=Gstrdup(buf);
+  }
+  //look the keys up in a different (shuffled) order than they were added
+  char** qkeys=NULL;
+  GMALLOC(qkeys, n*sizeof(char*));
+  memcpy(qkeys, keys, n*sizeof(char*));
+  uint64 rnd=88172645463325252ULL;
+  for (int i=n-1;i>0;i--) {
+    rnd^=rnd<<13; rnd^=rnd>>7; rnd^=rnd<<17;
+    Gswap(qkeys[i], qkeys[rnd%(i+1)]);
+  }
+  GMessage("GHash benchmark with %d keys:\n", n);
+  {
+    OldHash oh;
+    benchTable("old GHash", oh, keys, qkeys, missing, n);
+  }
+  {
+    GHash<char> gh(false);
+    benchTable("GHash", gh, keys, qkeys, missing, n);
+    //lookup of the same keys as (ptr,len) tokens inside a larger buffer
+    GStopWatch sw;
+    int found=0;
+    sw.startTimer();
+    for (int r=0;r<4;r++)
+      for (int i=0;i<n;i++) {
+        const char* k=qkeys[i];
+        int klen=strlen(k);
+        if (gh.FindN(k, klen>4 ? klen-2 : klen)!=NULL) found++; //mostly prefixes, not found
+      }
+    GMessage("%-10s findN (prefix tokens): %7.1f ns/op (%d found)\n", "GHash", benchNs(sw, 4*n), found);
+  }
+  for (int i=0;i<n;i++) {
+    GFREE(keys[i]);
+    GFREE(missing[i]);
+  }
+  GFREE(keys);
+  GFREE(qkeys);
+  GFREE(missing);
+}
+
+//--- GConcIntHashP stress test (--conc-hash-test <threads>)
+struct CHashItem {
+  uint32 key;
+  int owner; //thread which made this item
+};
+
+static uint32 chashKey(int i) { return (uint32)i*2654435761U; } //key 0 included
+
+struct CHashTest {
+  GConcIntHashP<CHashItem> h;
+  int numThreads;
+  int numKeys;
+  CHashItem** items; //items[t][i]: item made by thread t for key i
+  CHashItem*** res; //res[t][i]: item returned by Add() in thread t for key i
+  int errors;
+  int nextId;
+  GMutex lock;
+  CHashTest(int nt, int nk):h(false, 16), numThreads(nt), numKeys(nk), items(NULL),
+      res(NULL), errors(0), nextId(0), lock() {
+    GMALLOC(items, nt*sizeof(CHashItem*));
+    GMALLOC(res, nt*sizeof(CHashItem**));
+    for (int t=0;t<nt;t++) {
+      GMALLOC(items[t], nk*sizeof(CHashItem));
+      GCALLOC(res[t], nk*sizeof(CHashItem*));
+      for (int i=0;i<nk;i++) {
+        items[t][i].key=chashKey(i);
+        items[t][i].owner=t;
+      }
+    }
+  }
+  ~CHashTest() {
+    for (int t=0;t<numThreads;t++) {
+      GFREE(items[t]);
+      GFREE(res[t]);
+    }
+    GFREE(items);
+    GFREE(res);
+  }
+  void addErrors(int e) {
+    GLockGuard<GMutex> guard(lock);
+    errors+=e;
+  }
+};
+
+//each thread adds all the keys, starting at a different offset, and looks up
+//one of the keys it added earlier after each Add()
+static void chashTestWorker(void* p) {
+  CHashTest& d=*(CHashTest*)p;
+  int tid=0;
+  {
+    GLockGuard<GMutex> guard(d.lock);
+    tid=d.nextId++;
+  }
+  int n=d.numKeys;
+  int ofs=(int)(((int64)n*tid)/d.numThreads);
+  int errors=0;
+  for (int j=0;j<n;j++) {
+    int i=(j+ofs)%n;
+    CHashItem* v=d.h.Add(d.items[tid][i].key, &(d.items[tid][i]));
+    d.res[tid][i]=v;
+    if (v==NULL || v->key!=chashKey(i)) errors++;
+    int e=(j/2+ofs)%n;
+    CHashItem* f=d.h.Find(chashKey(e));
+    if (f==NULL || f->key!=chashKey(e)) errors++;
+  }
+  d.addErrors(errors);
+}
+
+void concHashTest(int numThreads) {
+  if (numThreads<=0) numThreads=4;
+  int n=200000;
+  CHashTest d(numThreads, n);
+  GMessage("GConcIntHashP stress test: %d threads adding the same %d keys\n", numThreads, n);
+  GThread* threads=new GThread[numThreads];
+  for (int t=0;t<numThreads;t++)
+    threads[t].kickStart(chashTestWorker, (void*) &d);
+  for (int t=0;t<numThreads;t++)
+    threads[t].join();
+  delete[] threads;
+  //all the Add() calls for a key must have returned the item found now
+  int errors=d.errors;
+  for (int i=0;i<n;i++) {
+    CHashItem* f=d.h.Find(chashKey(i));
+    if (f==NULL || f->key!=chashKey(i) || f!=&(d.items[f->owner][i])) {
+      errors++;
+      continue;
+    }
+    for (int t=0;t<numThreads;t++)
+      if (d.res[t][i]!=f) errors++;
+  }
+  uint32 k=0;
+  int iterCount=0;
+  d.h.startIterate();
+  while (d.h.Next(k)!=NULL) iterCount++;
+  if ((int)d.h.Count()!=n || iterCount!=n) errors++;
+  GMessage("  %u entries (table capacity %u), %d errors\n", d.h.Count(), d.h.Capacity(), errors);
+  if (errors) GError("Error: GConcIntHashP stress test failed!\n");
+  //the single threaded GIntHashP iteration must visit every entry,
+  //with and without the zero key (key 0 is chashKey(0))
+  for (int z=0;z<2;z++) {
+    GIntHashP<CHashItem> lh(false);
+    for (int i=z;i<n;i++) lh.Add(chashKey(i), &(d.items[0][i]));
+    iterCount=0;
+    lh.startIterate();
+    while (lh.Next(k)!=NULL) iterCount++;
+    if (iterCount!=n-z) errors++;
+  }
+  if (errors) GError("Error: GIntHashP iteration test failed!\n");
+  GMessage("  OK.\n");
+}
+
+//--- shared lookup table benchmark (--conc-hash-bench <threads>):
+//GConcIntHashP vs GIntHashP guarded by a mutex
+struct CHashBench {
+  GConcIntHashP<CHashItem>* ch;
+  GIntHashP<CHashItem>* lh;
+  GMutex lhLock;
+  CHashItem* items;
+  int numKeys;
+  int numOps; //lookups per thread
+  int numThreads;
+  int nextId;
+  int found;
+  CHashBench(int nk, int nops, int nt):ch(NULL), lh(NULL), lhLock(), items(NULL), numKeys(nk),
+      numOps(nops), numThreads(nt), nextId(0), found(0) {
+    GMALLOC(items, nk*sizeof(CHashItem));
+    for (int i=0;i<nk;i++) {
+      items[i].key=chashKey(i);
+      items[i].owner=0;
+    }
+  }
+  ~CHashBench() { GFREE(items); }
+  int threadId() {
+    GLockGuard<GMutex> guard(lhLock);
+    return nextId++;
+  }
+  void addFound(int f) {
+    GLockGuard<GMutex> guard(lhLock);
+    found+=f;
+  }
+};
+
+static void cbenchFindConc(void* p) {
+  CHashBench& b=*(CHashBench*)p;
+  int tid=b.threadId();
+  int f=0;
+  for (int j=0;j<b.numOps;j++)
+    if (b.ch->Find(chashKey((j*7+tid)%b.numKeys))!=NULL) f++;
+  b.addFound(f);
+}
+
+static void cbenchFindLocked(void* p) {
+  CHashBench& b=*(CHashBench*)p;
+  int tid=b.threadId();
+  int f=0;
+  for (int j=0;j<b.numOps;j++) {
+    GLockGuard<GMutex> guard(b.lhLock);
+    if (b.lh->Find(chashKey((j*7+tid)%b.numKeys))!=NULL) f++;
+  }
+  b.addFound(f);
+}
+
+//each thread adds its own slice of the keys
+static void cbenchAddConc(void* p) {
+  CHashBench& b=*(CHashBench*)p;
+  int tid=b.threadId();
+  for (int i=tid;i<b.numKeys;i+=b.numThreads)
+    b.ch->Add(b.items[i].key, &(b.items[i]));
+}
+
+static void cbenchAddLocked(void* p) {
+  CHashBench& b=*(CHashBench*)p;
+  int tid=b.threadId();
+  for (int i=tid;i<b.numKeys;i+=b.numThreads) {
+    GLockGuard<GMutex> guard(b.lhLock);
+    if (b.lh->Find(b.items[i].key)==NULL) b.lh->Add(b.items[i].key, &(b.items[i]));
+  }
+}
+
+static double cbenchRun(CHashBench& b, void (*worker)(void*), int numThreads) {
+  GThread* threads=new GThread[numThreads];
+  b.nextId=0;
+  GStopWatch sw;
+  sw.startTimer();
+  for (int t=0;t<numThreads;t++)
+    threads[t].kickStart(worker, (void*) &b);
+  for (int t=0;t<numThreads;t++)
+    threads[t].join();
+  sw.stopTimer();
+  delete[] threads;
+  return sw.getElapsedTime();
+}
+
+void concHashBench(int numThreads) {
+  if (numThreads<=0) numThreads=4;
+  int n=1000000;
+  int nops=2000000;
+  CHashBench b(n, nops, numThreads);
+  GMessage("Shared integer hash benchmark with %d threads, %d keys:\n", numThreads, n);
+  b.ch=new GConcIntHashP<CHashItem>(false);
+  b.lh=new GIntHashP<CHashItem>(false);
+  double tc=cbenchRun(b, cbenchAddConc, numThreads);
+  double tl=cbenchRun(b, cbenchAddLocked, numThreads);
+  if ((int)b.ch->Count()!=n || (int)b.lh->Count()!=n)
+    GError("Error: %u and %u keys were added instead of %d!\n", b.ch->Count(), b.lh->Count(), n);
+  GMessage("%-22s add: %7.2f Mops/s\n", "GConcIntHashP", n/tc/1e6);
+  GMessage("%-22s add: %7.2f Mops/s\n", "GIntHashP+GMutex", n/tl/1e6);
+  double total=(double)nops*numThreads;
+  b.found=0;
+  tc=cbenchRun(b, cbenchFindConc, numThreads);
+  if (b.found!=total) GError("Error: %d keys found instead of %.0f!\n", b.found, total);
+  b.found=0;
+  tl=cbenchRun(b, cbenchFindLocked, numThreads);
+  if (b.found!=total) GError("Error: %d keys found instead of %.0f!\n", b.found, total);
+  GMessage("%-22s find: %7.2f Mops/s\n", "GConcIntHashP", total/tc/1e6);
+  GMessage("%-22s find: %7.2f Mops/s\n", "GIntHashP+GMutex", total/tl/1e6);
+  delete b.ch;
+  delete b.lh;
+}
+
+//--- GThreadPool stress test (--pool-test <threads>)
+struct PoolTest {
+  GThreadPool* pool;
+  int numOuter;
+  int numInner;
+  int* hits; //hits[o*numInner+i]: times the inner index i of outer index o was run
+  int counter;
+  PoolTest(GThreadPool* p, int no, int ni):pool(p), numOuter(no), numInner(ni),
+      hits(NULL), counter(0) {
+    GCALLOC(hits, no*ni*sizeof(int));
+  }
+  ~PoolTest() { GFREE(hits); }
+};
+
+struct PoolInnerRange {
+  PoolTest* t;
+  int outer;
+};
+
+static void poolInnerRange(int from, int to, void* p) {
+  PoolInnerRange& r=*(PoolInnerRange*)p;
+  int* h=r.t->hits+r.outer*r.t->numInner;
+  for (int i=from;i<to;i++)
+    __atomic_add_fetch(&h[i], 1, __ATOMIC_RELAXED);
+}
+
+//each outer index runs a parallel_for of its own on the same pool
+static void poolOuterRange(int from, int to, void* p) {
+  PoolTest& t=*(PoolTest*)p;
+  for (int o=from;o<to;o++) {
+    PoolInnerRange r;
+    r.t=&t;
+    r.outer=o;
+    t.pool->parallel_for(0, t.numInner, poolInnerRange, (void*) &r, (o%3)*7);
+  }
+}
+
+static void poolCount(void* p) {
+  __atomic_add_fetch(&((PoolTest*)p)->counter, 1, __ATOMIC_RELAXED);
+}
+
+//a task which submits subtasks and waits for them
+static void poolParentTask(void* p) {
+  PoolTest& t=*(PoolTest*)p;
+  GTaskHandle subs[8];
+  for (int i=0;i<8;i++)
+    subs[i]=t.pool->submit(poolCount, p);
+  for (int i=0;i<8;i++)
+    subs[i].wait();
+  for (int i=0;i<8;i++)
+    if (!subs[i].done()) GError("Error: subtask not done after wait()!\n");
+  poolCount(p);
+}
+
+static int poolSquare(void* p) {
+  int v=(int)(intptr_t)p;
+  return v*v;
+}
+
+static void poolSlowCount(void* p) {
+  if ((__atomic_load_n(&((PoolTest*)p)->counter, __ATOMIC_RELAXED) & 15)==0)
+    current_thread::sleep_for(1);
+  poolCount(p);
+}
+
+void poolTest(int numThreads) {
+  if (numThreads<=0) numThreads=4;
+  GMessage("GThreadPool stress test with %d threads\n", numThreads);
+  int errors=0;
+  {
+    //nested parallel_for
+    GThreadPool pool(numThreads);
+    PoolTest t(&pool, 64, 1000);
+    for (int round=0;round<20;round++)
+      pool.parallel_for(0, t.numOuter, poolOuterRange, (void*) &t, 1);
+    for (int i=0;i<t.numOuter*t.numInner;i++)
+      if (t.hits[i]!=20) errors++;
+    GMessage("  nested parallel_for: %d errors\n", errors);
+  }
+  {
+    //submit/wait, with tasks waiting for the tasks they submitted, and futures
+    GThreadPool pool(numThreads);
+    PoolTest t(&pool, 0, 0);
+    int e=0;
+    for (int round=0;round<20;round++) {
+      GTaskHandle h[100];
+      for (int i=0;i<100;i++)
+        h[i]=pool.submit(poolParentTask, (void*) &t);
+      for (int i=0;i<100;i++)
+        h[i].wait();
+      GFuture<int> f[50];
+      for (int i=0;i<50;i++)
+        pool.async(f[i], poolSquare, (void*)(intptr_t)i);
+      for (int i=0;i<50;i++)
+        if (f[i].get()!=i*i) e++;
+    }
+    if (t.counter!=20*100*9) e++;
+    GMessage("  submit/wait: %d tasks run, %d errors\n", t.counter, e);
+    errors+=e;
+  }
+  {
+    //shutdown with queued tasks whose handles were dropped: the
+    //destructor runs them all before stopping the threads
+    int e=0;
+    for (int round=0;round<50;round++) {
+      GThreadPool* pool=new GThreadPool(numThreads);
+      PoolTest t(pool, 0, 0);
+      for (int i=0;i<200;i++)
+        pool->submit(poolSlowCount, (void*) &t);
+      delete pool;
+      if (t.counter!=200) e++;
+    }
+    GMessage("  shutdown: %d errors\n", e);
+    errors+=e;
+  }
+  if (errors) GError("Error: GThreadPool stress test failed!\n");
+  GMessage("  OK.\n");
+}
+
+//--- GSPSCQueue/GMPMCQueue stress test (--queue-test <threads>)
+struct QueueTest {
+  GMPMCQueue<uint64> mq;
+  GSPSCQueue<uint64> sq;
+  int numProducers;
+  int numItems; //per producer
+  int* got; //got[p*numItems+i]: times item i of producer p was popped
+  int errors;
+  int nextProd;
+  int nextCons;
+  GMutex lock;
+  QueueTest(int np, int ni):mq(16), sq(8), numProducers(np), numItems(ni), got(NULL),
+      errors(0), nextProd(0), nextCons(0), lock() {
+    GCALLOC(got, np*ni*sizeof(int));
+  }
+  ~QueueTest() { GFREE(got); }
+  void addErrors(int e) {
+    GLockGuard<GMutex> guard(lock);
+    errors+=e;
+  }
+};
+
+static void mqProducer(void* p) {
+  QueueTest& q=*(QueueTest*)p;
+  int pid=0;
+  {
+    GLockGuard<GMutex> guard(q.lock);
+    pid=q.nextProd++;
+  }
+  for (int i=0;i<q.numItems;i++)
+    q.mq.push(((uint64)pid<<32) | (uint64)i);
+}
+
+//the items of a producer must come out in the order they were pushed
+static void mqConsumer(void* p) {
+  QueueTest& q=*(QueueTest*)p;
+  int* last=NULL;
+  GMALLOC(last, q.numProducers*sizeof(int));
+  for (int i=0;i<q.numProducers;i++) last[i]=-1;
+  int errors=0;
+  uint64 v=0;
+  while (q.mq.pop(v)) {
+    int pid=(int)(v>>32);
+    int i=(int)(v & 0xFFFFFFFF);
+    if (pid>=q.numProducers || i>=q.numItems) {
+      errors++;
+      continue;
+    }
+    if (i<=last[pid]) errors++;
+    last[pid]=i;
+    __atomic_add_fetch(&q.got[pid*q.numItems+i], 1, __ATOMIC_RELAXED);
+  }
+  GFREE(last);
+  q.addErrors(errors);
+}
+
+static void sqProducer(void* p) {
+  QueueTest& q=*(QueueTest*)p;
+  for (int i=0;i<q.numItems;i++)
+    q.sq.push((uint64)i);
+  q.sq.close();
+}
+
+static void sqConsumer(void* p) {
+  QueueTest& q=*(QueueTest*)p;
+  int errors=0;
+  uint64 v=0;
+  uint64 expected=0;
+  while (q.sq.pop(v)) {
+    if (v!=expected) errors++;
+    expected=v+1;
+  }
+  if (expected!=(uint64)q.numItems) errors++;
+  q.addErrors(errors);
+}
+
+void queueTest(int numThreads) {
+  if (numThreads<=0) numThreads=4;
+  int n=200000;
+  int errors=0;
+  //SPSC: items in order, none lost
+  {
+    QueueTest q(1, n);
+    GMessage("GSPSCQueue stress test: %d items through a queue of capacity %d\n", n, q.sq.capacity());
+    GThread prod, cons;
+    cons.kickStart(sqConsumer, (void*) &q);
+    prod.kickStart(sqProducer, (void*) &q);
+    prod.join();
+    cons.join();
+    GQueueStats st=q.sq.getStats();
+    if (st.pushed!=(uint64)n || st.popped!=(uint64)n) q.errors++;
+    GMessage("  %llu pushed, %llu popped, %llu full waits, %d errors\n", (unsigned long long)st.pushed,
+        (unsigned long long)st.popped, (unsigned long long)st.fullWaits, q.errors);
+    errors+=q.errors;
+  }
+  //MPMC: every item popped once, the items of a producer in order for each consumer
+  {
+    QueueTest q(numThreads, n);
+    GMessage("GMPMCQueue stress test: %d producers and %d consumers, %d items each, capacity %d\n",
+        numThreads, numThreads, n, q.mq.capacity());
+    GThread* producers=new GThread[numThreads];
+    GThread* consumers=new GThread[numThreads];
+    for (int t=0;t<numThreads;t++)
+      consumers[t].kickStart(mqConsumer, (void*) &q);
+    for (int t=0;t<numThreads;t++)
+      producers[t].kickStart(mqProducer, (void*) &q);
+    for (int t=0;t<numThreads;t++)
+      producers[t].join();
+    q.mq.close(); //the consumers stop when the queue is empty
+    for (int t=0;t<numThreads;t++)
+      consumers[t].join();
+    delete[] producers;
+    delete[] consumers;
+    for (int i=0;i<numThreads*n;i++)
+      if (q.got[i]!=1) q.errors++;
+    GQueueStats st=q.mq.getStats();
+    uint64 total=(uint64)numThreads*n;
+    if (st.pushed!=total || st.popped!=total || q.mq.size()!=0) q.errors++;
+    GMessage("  %llu pushed, %llu popped, %llu full waits, %llu empty waits, %d errors\n",
+        (unsigned long long)st.pushed, (unsigned long long)st.popped,
+        (unsigned long long)st.fullWaits, (unsigned long long)st.emptyWaits, q.errors);
+    errors+=q.errors;
+  }
+  if (errors) GError("Error: queue stress test failed!\n");
+  GMessage("  OK.\n");
+}
+
+//--- GCdbYank::getRecords() test (--cdb-test <threads>)
+struct CdbTestRec {
+  GStr name;
+  GStr seq;
+  off_t fpos; //offset in the FASTA file
+};
+
+struct CdbTest {
+  CdbTestRec* recs;
+  int numRecs;
+  GVec<int> calls; //key indexes in the order of the callbacks
+  GStr* got; //got[k]: "<id> <sequence>" of the record passed for key k
+  CdbTest(int n, int nkeys):recs(NULL), numRecs(n), calls(nkeys), got(NULL) {
+    recs=new CdbTestRec[n];
+    got=new GStr[nkeys];
+  }
+  ~CdbTest() {
+    delete[] recs;
+    delete[] got;
+  }
+};
+
+static void cdbTestRecord(int idx, const char* key, FastaSeq& rec, void* udata) {
+  CdbTest& t=*(CdbTest*)udata;
+  t.calls.Add(idx);
+  t.got[idx]=rec.getId();
+  t.got[idx].append(' ');
+  t.got[idx].append(rec.getSeq());
+  if (strcmp(key, rec.getId())!=0) t.got[idx].append(" (wrong key)");
+}
+
+//write a FASTA file and its cdbfasta index (<fasta>.cidx)
+static void cdbTestWrite(CdbTest& t, const char* fasta) {
+  FILE* f=fopen(fasta, "wb");
+  if (f==NULL) GError("Error creating %s\n", fasta);
+  GStr fidx(fasta);
+  fidx+=".cidx";
+  GCdbWrite* cdbw=new GCdbWrite((char*)fidx.chars());
+  uint64 rnd=88172645463325252ULL;
+  for (int i=0;i<t.numRecs;i++) {
+    CdbTestRec& r=t.recs[i];
+    r.name.format("seq%d", i);
+    rnd^=rnd<<13; rnd^=rnd>>7; rnd^=rnd<<17;
+    int len=1+(int)(rnd%2000);
+    for (int j=0;j<len;j++) r.seq.append("ACGT"[(rnd>>(j%60)) & 3]);
+    r.fpos=ftello(f);
+    fprintf(f, ">%s test record %d\n", r.name.chars(), i);
+    for (int j=0;j<len;j+=60)
+      fprintf(f, "%.*s\n", (len-j<60) ? len-j : 60, r.seq.chars()+j);
+    CIdxData32 d;
+    d.fpos=(uint32)r.fpos;
+    d.reclen=(uint32)(ftello(f)-r.fpos);
+    cdbw->add(r.name.chars(), (char*)&d, sizeof(d));
+  }
+  cdbInfo info;
+  memset(&info, 0, sizeof(info));
+  info.num_keys=t.numRecs;
+  info.num_records=t.numRecs;
+  info.dbsize=ftello(f);
+  info.dbnamelen=strlen(fasta);
+  memcpy(info.tag, "CDBX", 4);
+  fclose(f);
+  cdbw->finish();
+  delete cdbw;
+  //the info chunk: database name and cdbInfo
+  f=fopen(fidx.chars(), "ab");
+  if (f==NULL) GError("Error opening %s\n", fidx.chars());
+  fwrite(fasta, 1, info.dbnamelen, f);
+  fwrite(&info, 1, cdbInfoSIZE, f);
+  fclose(f);
+}
+
+//the records of all the keys found must be passed once, in database order
+static int cdbTestCheck(CdbTest& t, GCdbYank& cdby, const char** keys, int* keyrec,
+    int numKeys, int numThreads) {
+  int errors=0;
+  t.calls.Clear();
+  for (int k=0;k<numKeys;k++) t.got[k]="";
+  int found=cdby.getRecords(keys, numKeys, cdbTestRecord, (void*) &t, numThreads);
+  int expected=0;
+  for (int k=0;k<numKeys;k++) {
+    if (keyrec[k]<0) {
+      if (!t.got[k].is_empty()) errors++;
+      continue;
+    }
+    expected++;
+    CdbTestRec& r=t.recs[keyrec[k]];
+    GStr e(r.name);
+    e.append(' ');
+    e.append(r.seq);
+    if (t.got[k]!=e) errors++;
+  }
+  if (found!=expected || t.calls.Count()!=expected) errors++;
+  for (int i=1;i<t.calls.Count();i++) {
+    off_t prev=t.recs[keyrec[t.calls[i-1]]].fpos;
+    off_t cur=t.recs[keyrec[t.calls[i]]].fpos;
+    if (cur<prev || (cur==prev && t.calls[i]<=t.calls[i-1])) errors++;
+  }
+  GMessage("  %d threads: %d of %d keys found, %d errors\n", numThreads, found, numKeys, errors);
+  return errors;
+}
+
+void cdbTest(int numThreads) {
+  if (numThreads<=0) numThreads=4;
+  int n=3000;
+  GStr fasta;
+  fasta.format("/tmp/gtest_cdb_%d.fa", (int)getpid());
+  GStr fidx(fasta);
+  fidx+=".cidx";
+  //the keys: all the records in shuffled order, some twice, and some missing
+  int numKeys=n+n/10+20;
+  CdbTest t(n, numKeys);
+  cdbTestWrite(t, fasta.chars());
+  GStr* kstr=new GStr[numKeys];
+  const char** keys=new const char*[numKeys];
+  int* keyrec=new int[numKeys];
+  uint64 rnd=2463534242ULL;
+  for (int k=0;k<numKeys;k++) {
+    rnd^=rnd<<13; rnd^=rnd>>7; rnd^=rnd<<17;
+    if (k<n) keyrec[k]=k;
+    else if (k<n+n/10) keyrec[k]=(int)(rnd%n);
+    else keyrec[k]=-1;
+    if (keyrec[k]>=0) kstr[k]=t.recs[keyrec[k]].name;
+    else kstr[k].format("missing%d", k);
+  }
+  for (int k=numKeys-1;k>0;k--) {
+    rnd^=rnd<<13; rnd^=rnd>>7; rnd^=rnd<<17;
+    int j=(int)(rnd%(k+1));
+    Gswap(kstr[k], kstr[j]);
+    Gswap(keyrec[k], keyrec[j]);
+  }
+  for (int k=0;k<numKeys;k++) keys[k]=kstr[k].chars();
+  GMessage("GCdbYank::getRecords() test with %d records\n", n);
+  int errors=0;
+  {
+    GCdbYank cdby(fidx.chars());
+    errors+=cdbTestCheck(t, cdby, keys, keyrec, numKeys, 1);
+    GThreadPool::setGlobal(numThreads);
+    errors+=cdbTestCheck(t, cdby, keys, keyrec, numKeys, numThreads);
+    //a single record, and no records found
+    errors+=cdbTestCheck(t, cdby, keys, keyrec, 1, numThreads);
+    int m=0;
+    while (keyrec[m]>=0) m++;
+    errors+=cdbTestCheck(t, cdby, keys+m, keyrec+m, 1, numThreads);
+  }
+  delete[] kstr;
+  delete[] keys;
+  delete[] keyrec;
+  unlink(fasta.chars());
+  unlink(fidx.chars());
+  if (errors) GError("Error: GCdbYank::getRecords() test failed!\n");
+  GMessage("  OK.\n");
+}
+
 int main(int argc, char* argv[]) {
  //GArgs args(argc, argv, "hg:c:s:t:o:p:help;genomic-fasta=COV=PID=seq=out=disable-flag;test=");
  GArgs args(argc, argv, opts);
  fprintf(stderr, "Command line was:\n");
  args.printCmdLine(stderr);
  args.printError(USAGE, true);
+ if (args.getOpt(OPT_HASHBENCH)) {
+   hashBench(GStr(args.getOpt(OPT_HASHBENCH)).asInt());
+   exit(0);
+ }
+ if (args.getOpt(OPT_CHASHTEST)) {
+   concHashTest(GStr(args.getOpt(OPT_CHASHTEST)).asInt());
+   exit(0);
+ }
+ if (args.getOpt(OPT_CHASHBENCH)) {
+   concHashBench(GStr(args.getOpt(OPT_CHASHBENCH)).asInt());
+   exit(0);
+ }
+ if (args.getOpt(OPT_POOLTEST)) {
+   poolTest(GStr(args.getOpt(OPT_POOLTEST)).asInt());
+   exit(0);
+ }
+ if (args.getOpt(OPT_QUEUETEST)) {
+   queueTest(GStr(args.getOpt(OPT_QUEUETEST)).asInt());
+   exit(0);
+ }
+ if (args.getOpt(OPT_CDBTEST)) {
+   cdbTest(GStr(args.getOpt(OPT_CDBTEST)).asInt());
+   exit(0);
+ }
  //if (args.getOpt('h') || args.getOpt("help"))
  GVec<int> transcripts(true);
  transcripts.cAdd(0);
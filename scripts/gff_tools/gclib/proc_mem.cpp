@@ -1,6 +1,7 @@
 #include "proc_mem.h"
 #ifdef __APPLE__
 #include<mach/mach.h>
+#include <sys/resource.h>
 void get_mem_usage(double& vm_usage, double& resident_set) {
   vm_usage=0;
   resident_set=0;
@@ -18,6 +19,12 @@ void get_mem_usage(double& vm_usage, double& resident_set) {
 // virtual size is in t_info.virtual_size;
 }
 
+double get_peak_rss() {
+  struct rusage ru;
+  if (getrusage(RUSAGE_SELF, &ru)!=0) return 0;
+  return double(ru.ru_maxrss)/1024; //bytes on OS X
+}
+
 #elif defined(_WIN32) || defined(_WIN64)
 #include "windows.h"
 #include "psapi.h"
@@ -30,8 +37,15 @@ void get_mem_usage(double& vm_usage, double& resident_set) {
     resident_set=(double)pmc.WorkingSetSize;
 }
 
+double get_peak_rss() {
+	PROCESS_MEMORY_COUNTERS pmc;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return 0;
+	return double(pmc.PeakWorkingSetSize)/1024;
+}
+
 #else //assume Linux
 #include <unistd.h>
+#include <sys/resource.h>
 #include <string>
 #include <ios>
 #include <fstream>
@@ -65,6 +79,12 @@ void get_mem_usage(double& vm_usage, double& resident_set) {
    vm_usage     = vsize / 1024.0;
    resident_set = rss * page_size_kb;
 }
+
+double get_peak_rss() {
+   struct rusage ru;
+   if (getrusage(RUSAGE_SELF, &ru)!=0) return 0.0;
+   return (double)ru.ru_maxrss; //already in KB on Linux
+}
 #endif
 
 //////////////////////////////////////////////////////////////////////////////
@@ -6,4 +6,7 @@ void get_mem_usage(double& vm_usage, double& resident_set);
 
 void print_mem_usage(FILE* fout=stderr);
 
+// peak resident set size of the current process so far, in KB
+double get_peak_rss();
+
 #endif
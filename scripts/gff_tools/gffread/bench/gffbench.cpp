@@ -0,0 +1,360 @@
+#include "GArgs.h"
+#include "gff_utils.h"
+#include "gdna.h"
+#include "codons.h"
+#include "GHash.hh"
+#include "GThreads.h"
+#include "gffgen.h"
+
+#define USAGE "Usage:\n\
+gffbench [--profile phage|euk] [<generator options>] [--time <seconds>]\n\
+   [--only <benchmark>[,<benchmark>..]]\n\
+ Run the microbenchmarks on synthetic data and print the time per operation\n\
+ and the throughput of each of them: gffline (GffLine parsing), ghash-add,\n\
+ ghash-find, glist-sorted-add, getspliced, translate, revcompl, printgxf,\n\
+ printfasta\n\
+ \n\
+gffbench --gen <prefix> [--profile phage|euk] [<generator options>] [--no-fasta]\n\
+ Write the synthetic annotation to <prefix>.gff3 (<prefix>.gtf with --gtf)\n\
+ and the genomic sequences to <prefix>.fa\n\
+ \n\
+Generator options (the same options always generate the same data):\n\
+ --profile : phage (default) is a batch of small genomes with single exon\n\
+      CDS genes on both strands, euk has chromosomes with multi-exon genes,\n\
+      alternative transcripts and UTRs\n\
+ --size    : genome size in bases (phage: 200000, euk: 20000000)\n\
+ --seqs    : number of genomic sequences the genome is split into (4)\n\
+ --density : genes per kb (phage: 1.5, euk: 0.04)\n\
+ --exons   : maximum number of exons per transcript (euk: 20)\n\
+ --isoforms: maximum number of transcripts per gene (euk: 3)\n\
+ --attrs   : attribute verbosity, 0=IDs only, 1=typical (default), 2=verbose\n\
+ --gc      : GC content of the genomic sequences (phage: 0.45, euk: 0.41)\n\
+ --seed    : random seed (1)\n\
+ --gtf     : generate GTF instead of GFF3\n\
+"
+
+//data shared by the benchmarks
+struct GBenchData {
+	GffGenerator* gen;
+	GVec<char*> lines; //feature lines of the annotation
+	uint64 lineBytes;
+	GffReader* reader; //the parsed annotation
+	GPVec<GFaSeqGet> faseqs; //copies of the generated genomic sequences
+	GVec<GffObj*> tdata; //transcripts with a genomic sequence
+	GVec<GFaSeqGet*> tseqs; //..and their genomic sequence
+	GVec<GffObj*> shuffled; //the same transcripts in random order
+	GVec<char*> spliced; //transcript sequences
+	GVec<int> splicedLen;
+	GVec<char*> cds; //CDS sequences
+	GVec<int> cdsLen;
+	char* rcbuf; //a genome chunk for reverseComplement()
+	int rcLen;
+	GHash<int> idhash; //for ghash-find
+	FILE* fout; //output of the print benchmarks
+	uint64 gxfBytes; //bytes written by a pass of printgxf
+	uint64 fastaBytes; //..and by a pass of printfasta
+	GBenchData():gen(NULL), lines(), lineBytes(0), reader(NULL), faseqs(), tdata(), tseqs(),
+			shuffled(), spliced(), splicedLen(), cds(), cdsLen(), rcbuf(NULL), rcLen(0),
+			idhash(false), fout(NULL), gxfBytes(0), fastaBytes(0) { }
+	~GBenchData() {
+		for (int i=0;i<lines.Count();i++) GFREE(lines[i]);
+		for (int i=0;i<spliced.Count();i++) GFREE(spliced[i]);
+		for (int i=0;i<cds.Count();i++) GFREE(cds[i]);
+		GFREE(rcbuf);
+		delete reader;
+		delete gen;
+		if (fout!=NULL) fclose(fout);
+	}
+};
+
+//a pass of a benchmark over its data: returns the number of operations
+//done and adds the number of bytes processed to bytes
+typedef uint64 GBenchFunc(GBenchData& d, uint64& bytes);
+
+static int dummyValue=1;
+
+uint64 benchGffLine(GBenchData& d, uint64& bytes) {
+	for (int i=0;i<d.lines.Count();i++) {
+		GffLine* gl=new GffLine(d.reader, d.lines[i]);
+		delete gl;
+	}
+	bytes+=d.lineBytes;
+	return d.lines.Count();
+}
+
+uint64 benchGHashAdd(GBenchData& d, uint64& bytes) {
+	GHash<int> h(false);
+	for (int i=0;i<d.tdata.Count();i++) {
+		const char* id=d.tdata[i]->getID();
+		h.Add(id, &dummyValue);
+		bytes+=strlen(id);
+	}
+	return d.tdata.Count();
+}
+
+uint64 benchGHashFind(GBenchData& d, uint64& bytes) {
+	int found=0;
+	for (int i=0;i<d.tdata.Count();i++) {
+		const char* id=d.tdata[i]->getID();
+		if (d.idhash.Find(id)!=NULL) found++;
+		bytes+=strlen(id);
+	}
+	if (found!=d.tdata.Count()) GError("Error: ghash-find lost keys!\n");
+	return d.tdata.Count();
+}
+
+uint64 benchGListSortedAdd(GBenchData& d, uint64& bytes) {
+	GList<GffObj> l(true, false, false);
+	for (int i=0;i<d.shuffled.Count();i++)
+		l.Add(d.shuffled[i]);
+	bytes+=d.shuffled.Count()*sizeof(GffObj*);
+	return d.shuffled.Count();
+}
+
+uint64 benchGetSpliced(GBenchData& d, uint64& bytes) {
+	for (int i=0;i<d.tdata.Count();i++) {
+		int slen=0;
+		char* s=d.tdata[i]->getSpliced(d.tseqs[i], false, &slen);
+		GFREE(s);
+		bytes+=slen;
+	}
+	return d.tdata.Count();
+}
+
+uint64 benchTranslate(GBenchData& d, uint64& bytes) {
+	for (int i=0;i<d.cds.Count();i++) {
+		int aalen=0;
+		char* aa=translateDNA(d.cds[i], aalen, d.cdsLen[i]);
+		GFREE(aa);
+		bytes+=d.cdsLen[i];
+	}
+	return d.cds.Count();
+}
+
+//reverse complement the genome chunk in 10kb pieces
+uint64 benchRevCompl(GBenchData& d, uint64& bytes) {
+	const int piece=10000;
+	uint64 ops=0;
+	for (int p=0;p<d.rcLen;p+=piece) {
+		int plen=(d.rcLen-p<piece) ? d.rcLen-p : piece;
+		reverseComplement(d.rcbuf+p, plen);
+		ops++;
+	}
+	bytes+=d.rcLen;
+	return ops;
+}
+
+uint64 benchPrintGxf(GBenchData& d, uint64& bytes) {
+	for (int i=0;i<d.tdata.Count();i++)
+		d.tdata[i]->printGxf(d.fout, pgffBoth);
+	fflush(d.fout);
+	bytes+=d.gxfBytes;
+	return d.tdata.Count();
+}
+
+uint64 benchPrintFasta(GBenchData& d, uint64& bytes) {
+	GStr defline;
+	for (int i=0;i<d.spliced.Count();i++) {
+		defline=d.tdata[i]->getID();
+		printFasta(d.fout, defline, d.spliced[i], d.splicedLen[i]);
+	}
+	fflush(d.fout);
+	bytes+=d.fastaBytes;
+	return d.spliced.Count();
+}
+
+//generate the data and prepare the inputs of each benchmark
+void prepareData(GBenchData& d, GffGenParams& params) {
+	d.gen=new GffGenerator(params);
+	FILE* fgff=tmpfile();
+	if (fgff==NULL) GError("Error creating a temporary file!\n");
+	d.gen->generate(fgff, NULL, true);
+	rewind(fgff);
+	char* line=NULL;
+	int buflen=0, llen=0;
+	while (fgetline(line, buflen, fgff, NULL, &llen)!=NULL) {
+		if (llen==0 || line[0]=='#') continue;
+		char* l=Gstrdup(line);
+		d.lines.Add(l);
+		d.lineBytes+=llen+1;
+	}
+	GFREE(line);
+	rewind(fgff);
+	d.reader=new GffReader(fgff, true, true); //closes fgff when deleted
+	d.reader->readAll();
+	GHash<GFaSeqGet> byname(false);
+	for (int s=0;s<d.gen->numSeqs();s++) {
+		uint slen=d.gen->getSeqLen(s);
+		char* seq=NULL;
+		GMALLOC(seq, slen+1);
+		memcpy(seq, d.gen->getSeq(s), slen+1);
+		GFaSeqGet* fs=new GFaSeqGet(d.gen->seqName(s), seq, slen);
+		d.faseqs.Add(fs);
+		byname.Add(d.gen->seqName(s), fs);
+	}
+	GList<GffObj>& gflst=d.reader->gflst;
+	for (int i=0;i<gflst.Count();i++) {
+		GffObj* t=gflst[i];
+		if (!t->isTranscript() || t->exons.Count()==0) continue;
+		GFaSeqGet* fs=byname.Find(t->getGSeqName());
+		if (fs==NULL) continue;
+		d.tdata.Add(t);
+		d.tseqs.Add(fs);
+		d.idhash.Add(t->getID(), &dummyValue);
+	}
+	if (d.tdata.Count()==0) GError("Error: no transcripts were generated, increase --size or --density!\n");
+	//deterministic shuffle for the sorted insertion
+	GRandGen rnd(params.seed);
+	for (int i=0;i<d.tdata.Count();i++) d.shuffled.Add(d.tdata[i]);
+	for (int i=d.shuffled.Count()-1;i>0;i--) {
+		int j=(int)(rnd.next()%(uint64)(i+1));
+		GffObj* t=d.shuffled[i];
+		d.shuffled[i]=d.shuffled[j];
+		d.shuffled[j]=t;
+	}
+	for (int i=0;i<d.tdata.Count();i++) {
+		int slen=0;
+		char* s=d.tdata[i]->getSpliced(d.tseqs[i], false, &slen);
+		d.spliced.Add(s);
+		d.splicedLen.Add(slen);
+		if (d.tdata[i]->hasCDS()) {
+			int clen=0;
+			char* c=d.tdata[i]->getSpliced(d.tseqs[i], true, &clen);
+			if (c!=NULL && clen>=3) {
+				d.cds.Add(c);
+				d.cdsLen.Add(clen);
+			}
+			else GFREE(c);
+		}
+	}
+	//up to 4MB of the first genomic sequence
+	d.rcLen=d.gen->getSeqLen(0);
+	if (d.rcLen>4*1024*1024) d.rcLen=4*1024*1024;
+	GMALLOC(d.rcbuf, d.rcLen+1);
+	memcpy(d.rcbuf, d.gen->getSeq(0), d.rcLen);
+	d.rcbuf[d.rcLen]=0;
+	//size of the print benchmarks output
+	d.fout=tmpfile();
+	if (d.fout==NULL) GError("Error creating a temporary file!\n");
+	uint64 b=0;
+	benchPrintGxf(d, b);
+	d.gxfBytes=ftello(d.fout);
+	rewind(d.fout);
+	benchPrintFasta(d, b);
+	d.fastaBytes=ftello(d.fout);
+	fclose(d.fout);
+	d.fout=fopen("/dev/null", "w");
+	if (d.fout==NULL) d.fout=tmpfile();
+}
+
+static GStr onlyList; //benchmarks to run (all if empty)
+
+bool benchSelected(const char* name) {
+	if (onlyList.is_empty()) return true;
+	GStr lst(",");
+	lst.append(onlyList);
+	lst.append(',');
+	GStr n(",");
+	n.append(name);
+	n.append(',');
+	return lst.index(n)>=0;
+}
+
+//run passes of the benchmark (after a warm-up one) for at least minTime seconds
+void runBench(const char* name, GBenchFunc* func, GBenchData& d, double minTime) {
+	if (!benchSelected(name)) return;
+	uint64 bytes=0;
+	func(d, bytes);
+	bytes=0;
+	uint64 ops=0;
+	int passes=0;
+	uint64 t0=gthreads_clock_ns();
+	uint64 elapsed=0;
+	do {
+		ops+=func(d, bytes);
+		passes++;
+		elapsed=gthreads_clock_ns()-t0;
+	} while (elapsed<minTime*1e9);
+	double secs=elapsed/1e9;
+	printf("%-18s %8d %12llu %12.1f %10.1f\n", name, passes, (unsigned long long)ops,
+			ops ? elapsed/(double)ops : 0.0, bytes/secs/1048576.0);
+	fflush(stdout);
+}
+
+int main(int argc, char* argv[]) {
+	GArgs args(argc, argv,
+			"help;gen=;profile=;size=;seqs=;density=;exons=;isoforms=;attrs=;gc=;seed=;gtf;no-fasta;time=;only=;h");
+	args.printError(USAGE, true);
+	if (args.getOpt('h') || args.getOpt("help")) {
+		GMessage("%s", USAGE);
+		exit(1);
+	}
+	GffGenParams params;
+	GStr s=args.getOpt("profile");
+	if (!s.is_empty() && !params.setProfile(s.chars()))
+		GError("Error: unknown profile %s (should be phage or euk)!\n", s.chars());
+	s=args.getOpt("size");
+	if (!s.is_empty()) params.genomeSize=(uint64)s.asDouble();
+	s=args.getOpt("seqs");
+	if (!s.is_empty()) params.numSeqs=s.asInt();
+	s=args.getOpt("density");
+	if (!s.is_empty()) params.density=s.asDouble();
+	s=args.getOpt("exons");
+	if (!s.is_empty()) params.maxExons=s.asInt();
+	s=args.getOpt("isoforms");
+	if (!s.is_empty()) params.maxIsoforms=s.asInt();
+	s=args.getOpt("attrs");
+	if (!s.is_empty()) params.attrLevel=s.asInt();
+	s=args.getOpt("gc");
+	if (!s.is_empty()) params.gcContent=s.asDouble();
+	s=args.getOpt("seed");
+	if (!s.is_empty()) params.seed=(uint64)s.asDouble();
+	params.gtf=(args.getOpt("gtf")!=NULL);
+	if (params.genomeSize==0) GError("Error: invalid --size value!\n");
+	GStr prefix=args.getOpt("gen");
+	if (!prefix.is_empty()) {
+		GStr fname(prefix);
+		fname.append(params.gtf ? ".gtf" : ".gff3");
+		FILE* fgff=fopen(fname.chars(), "w");
+		if (fgff==NULL) GError("Error creating file: %s\n", fname.chars());
+		FILE* ffa=NULL;
+		GStr faname(prefix);
+		faname.append(".fa");
+		if (args.getOpt("no-fasta")==NULL) {
+			ffa=fopen(faname.chars(), "w");
+			if (ffa==NULL) GError("Error creating file: %s\n", faname.chars());
+		}
+		GffGenerator gen(params);
+		gen.generate(fgff, ffa);
+		fclose(fgff);
+		if (ffa!=NULL) fclose(ffa);
+		GMessage("%s: %llu genes, %llu transcripts, %llu exons (%llu bytes)\n", fname.chars(),
+				(unsigned long long)gen.counts.genes, (unsigned long long)gen.counts.transcripts,
+				(unsigned long long)gen.counts.exons, (unsigned long long)gen.counts.gffBytes);
+		if (ffa!=NULL)
+			GMessage("%s: %d sequences, %llu bases\n", faname.chars(), gen.numSeqs(),
+					(unsigned long long)gen.counts.bases);
+		return 0;
+	}
+	double minTime=0.5;
+	s=args.getOpt("time");
+	if (!s.is_empty()) minTime=s.asDouble();
+	onlyList=args.getOpt("only");
+	GBenchData d;
+	prepareData(d, params);
+	printf("# profile %s%s, %llu bases in %d sequences, %d lines, %d transcripts, %d CDS\n",
+			(params.profile==ggpPhage) ? "phage" : "euk", params.gtf ? " (GTF)" : "",
+			(unsigned long long)d.gen->counts.bases, d.gen->numSeqs(), d.lines.Count(),
+			d.tdata.Count(), d.cds.Count());
+	printf("%-18s %8s %12s %12s %10s\n", "# benchmark", "passes", "ops", "ns/op", "MB/s");
+	runBench("gffline", benchGffLine, d, minTime);
+	runBench("ghash-add", benchGHashAdd, d, minTime);
+	runBench("ghash-find", benchGHashFind, d, minTime);
+	runBench("glist-sorted-add", benchGListSortedAdd, d, minTime);
+	runBench("getspliced", benchGetSpliced, d, minTime);
+	runBench("translate", benchTranslate, d, minTime);
+	runBench("revcompl", benchRevCompl, d, minTime);
+	runBench("printgxf", benchPrintGxf, d, minTime);
+	runBench("printfasta", benchPrintFasta, d, minTime);
+	return 0;
+}
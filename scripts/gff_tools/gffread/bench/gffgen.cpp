@@ -0,0 +1,398 @@
+#include "gffgen.h"
+
+//longest genomic sequence generated (coordinates must stay well within uint)
+static const uint64 maxSeqLen=250000000;
+
+static const char* phageProducts[]={"hypothetical protein", "terminase large subunit",
+		"terminase small subunit", "portal protein", "major capsid protein",
+		"head maturation protease", "tail tape measure protein", "tail fiber protein",
+		"baseplate wedge protein", "holin", "endolysin", "DNA polymerase",
+		"DNA primase/helicase", "single-stranded DNA-binding protein", "HNH endonuclease",
+		"integrase", "repressor protein CI", "anti-repressor protein"};
+static const char* eukProducts[]={"uncharacterized protein", "zinc finger protein",
+		"serine/threonine-protein kinase", "60S ribosomal protein", "transcription factor",
+		"transmembrane protein", "E3 ubiquitin-protein ligase", "ABC transporter"};
+#define NUM_ITEMS(a) ((uint)(sizeof(a)/sizeof(a[0])))
+
+void GffGenParams::setProfile(GffGenProfile p) {
+	profile=p;
+	gtf=false;
+	attrLevel=1;
+	seed=1;
+	if (p==ggpPhage) { //a batch of small phage genomes
+		genomeSize=200000;
+		numSeqs=4;
+		density=1.5;
+		maxExons=1;
+		maxIsoforms=1;
+		gcContent=0.45;
+	}
+	else {
+		genomeSize=20000000;
+		numSeqs=4;
+		density=0.04;
+		maxExons=20;
+		maxIsoforms=3;
+		gcContent=0.41;
+	}
+}
+
+bool GffGenParams::setProfile(const char* pname) {
+	if (strcmp(pname, "phage")==0) setProfile(ggpPhage);
+	else if (strcmp(pname, "euk")==0 || strcmp(pname, "eukaryote")==0)
+		setProfile(ggpEukaryote);
+	else return false;
+	return true;
+}
+
+//the bases and the gene layout use separate random streams, so the
+//annotation does not depend on whether the sequences are generated
+GffGenerator::GffGenerator(GffGenParams& p):rnd(p.seed), seqRnd(p.seed ^ 0x5EEDF00DULL),
+		seqNames(), seqLens(), seqs(), geneNum(0), params(p), counts() {
+	if (params.maxExons<1) params.maxExons=1;
+	if (params.maxIsoforms<1) params.maxIsoforms=1;
+	if (params.density<=0) params.density=0.001;
+}
+
+GffGenerator::~GffGenerator() {
+	for (int i=0;i<seqs.Count();i++)
+		GFREE(seqs[i]);
+}
+
+void GffGenerator::randomSeq(char* seq, uint len) {
+	static const char at[2]={'A','T'};
+	static const char gc[2]={'G','C'};
+	uint gcmax=(uint)(params.gcContent*128);
+	uint i=0;
+	while (i<len) {
+		uint64 r=seqRnd.next();
+		for (int b=0;b<8 && i<len;b++, r>>=8) {
+			uint v=(uint)(r & 0xFF);
+			seq[i++]=((v>>1)<gcmax) ? gc[v&1] : at[v&1];
+		}
+	}
+}
+
+static char complementBase(char c) {
+	switch (c) {
+		case 'A': return 'T';
+		case 'C': return 'G';
+		case 'G': return 'C';
+		default: return 'A';
+	}
+}
+
+//pos is the coordinate of the first codon base in the transcript direction
+void GffGenerator::setCodon(char* seq, uint len, uint pos, const char* codon, char strand) {
+	if (seq==NULL) return;
+	if (strand=='-') {
+		if (pos<3 || pos>len) return;
+		for (int k=0;k<3;k++) seq[pos-1-k]=complementBase(codon[k]);
+	}
+	else {
+		if (pos<1 || pos+2>len) return;
+		memcpy(seq+pos-1, codon, 3);
+	}
+}
+
+void GffGenerator::addAttr(GStr& attrs, const char* name, const char* value) {
+	if (params.gtf) {
+		if (!attrs.is_empty()) attrs.append(' ');
+		attrs.append(name);
+		attrs.append(" \"");
+		attrs.append(value);
+		attrs.append("\";");
+	}
+	else {
+		if (!attrs.is_empty()) attrs.append(';');
+		attrs.append(name);
+		attrs.append('=');
+		attrs.append(value);
+	}
+}
+
+void GffGenerator::writeFeature(FILE* f, const char* gseq, const char* ftype, uint start,
+		uint end, char strand, int phase, GStr& attrs) {
+	if (f==NULL) return;
+	int n=fprintf(f, "%s\tgffgen\t%s\t%u\t%u\t.\t%c\t%c\t%s\n", gseq, ftype, start, end,
+			strand, (phase<0) ? '.' : (char)('0'+phase), attrs.chars());
+	if (n>0) counts.gffBytes+=n;
+}
+
+void GffGenerator::genPhageGenes(FILE* f, const char* gseq, char* seq, uint len) {
+	double spacing=1000.0/params.density; //average distance between gene starts
+	uint meanlen=(uint)(spacing*0.85);
+	if (meanlen>800) meanlen=800;
+	if (meanlen<120) meanlen=120;
+	uint maxgap=(spacing>meanlen) ? (uint)(2*(spacing-meanlen))+1 : 1;
+	GStr attrs;
+	char locus[32], gid[40], buf[64];
+	uint pos=rnd.range(1, maxgap);
+	while (true) {
+		uint glen=rnd.range(30, 2*meanlen/3-30)*3;
+		uint end=pos+glen-1;
+		if (end>len) break;
+		char strand=rnd.chance(0.5) ? '+' : '-';
+		const char* product=rnd.chance(0.6) ? phageProducts[0] :
+				phageProducts[rnd.range(1, NUM_ITEMS(phageProducts)-1)];
+		geneNum++;
+		sprintf(locus, "PHG_%05d", geneNum);
+		sprintf(gid, "%s_gene", locus);
+		setCodon(seq, len, (strand=='+') ? pos : end, "ATG", strand);
+		setCodon(seq, len, (strand=='+') ? end-2 : pos+2, "TAA", strand);
+		if (params.gtf) {
+			attrs.clear();
+			addAttr(attrs, "transcript_id", locus);
+			addAttr(attrs, "gene_id", gid);
+			if (params.attrLevel>0) addAttr(attrs, "product", product);
+			writeFeature(f, gseq, "transcript", pos, end, strand, -1, attrs);
+			writeFeature(f, gseq, "exon", pos, end, strand, -1, attrs);
+			if (params.attrLevel>1) {
+				sprintf(buf, "%s_prot", locus);
+				addAttr(attrs, "protein_id", buf);
+				addAttr(attrs, "transl_table", "11");
+			}
+			writeFeature(f, gseq, "CDS", pos, end, strand, 0, attrs);
+		}
+		else {
+			attrs.clear();
+			addAttr(attrs, "ID", gid);
+			if (params.attrLevel>0) addAttr(attrs, "locus_tag", locus);
+			if (params.attrLevel>1) addAttr(attrs, "gene_biotype", "protein_coding");
+			writeFeature(f, gseq, "gene", pos, end, strand, -1, attrs);
+			attrs.clear();
+			addAttr(attrs, "ID", locus);
+			addAttr(attrs, "Parent", gid);
+			if (params.attrLevel>0) {
+				addAttr(attrs, "locus_tag", locus);
+				addAttr(attrs, "product", product);
+				addAttr(attrs, "inference", "ab initio prediction:Prodigal:002006");
+			}
+			if (params.attrLevel>1) {
+				sprintf(buf, "UniProtKB:Q%05u,COG:COG%04u", rnd.range(1, 99999), rnd.range(1, 5000));
+				addAttr(attrs, "Dbxref", buf);
+				addAttr(attrs, "note", "predicted by synthetic annotation, similar to a phage protein family");
+				addAttr(attrs, "codon_start", "1");
+				addAttr(attrs, "transl_table", "11");
+			}
+			writeFeature(f, gseq, "CDS", pos, end, strand, 0, attrs);
+		}
+		counts.genes++;
+		counts.transcripts++;
+		counts.exons++;
+		//phage genes are often packed, overlapping by a few bases (e.g. ATGA)
+		if (rnd.chance(0.1) && end>pos+6) pos=end-3;
+		else pos=end+rnd.range(1, maxgap);
+	}
+}
+
+void GffGenerator::genEukTranscript(FILE* f, const char* gseq, char* seq, uint len, char strand,
+		GVec<GSeg>& exons, const char* gid, int tnum, bool coding) {
+	char tid[48], buf[64];
+	sprintf(tid, "%s.t%d", gid, tnum);
+	int nex=exons.Count();
+	uint exlen=0;
+	for (int e=0;e<nex;e++) exlen+=exons[e].len();
+	//CDS range in transcript coordinates (0-based, inclusive)
+	uint cdsfrom=0, cdsto=0;
+	if (coding && exlen>=150) {
+		uint utr5=rnd.range(0, exlen/5);
+		uint utr3=rnd.range(0, exlen/5);
+		uint cdslen=(exlen-utr5-utr3)/3*3;
+		cdsfrom=utr5;
+		cdsto=utr5+cdslen-1;
+	}
+	else coding=false;
+	const char* product=eukProducts[rnd.range(0, NUM_ITEMS(eukProducts)-1)];
+	GStr attrs;
+	if (params.gtf) {
+		addAttr(attrs, "transcript_id", tid);
+		addAttr(attrs, "gene_id", gid);
+		if (params.attrLevel>0) {
+			addAttr(attrs, "gene_name", gid);
+			addAttr(attrs, "transcript_biotype", coding ? "protein_coding" : "lncRNA");
+		}
+		if (params.attrLevel>1) {
+			if (coding) addAttr(attrs, "product", product);
+			addAttr(attrs, "tag", "basic");
+			sprintf(buf, "%u", rnd.range(1, 5));
+			addAttr(attrs, "transcript_support_level", buf);
+		}
+		writeFeature(f, gseq, "transcript", exons[0].start, exons.Last().end, strand, -1, attrs);
+	}
+	else {
+		addAttr(attrs, "ID", tid);
+		addAttr(attrs, "Parent", gid);
+		if (params.attrLevel>0) {
+			addAttr(attrs, "Name", tid);
+			if (coding) addAttr(attrs, "product", product);
+		}
+		if (params.attrLevel>1) {
+			addAttr(attrs, "transcript_biotype", coding ? "protein_coding" : "lncRNA");
+			addAttr(attrs, "tag", "basic");
+			sprintf(buf, "GenBank:XM_%09u.1", rnd.range(1, 999999999));
+			addAttr(attrs, "Dbxref", buf);
+		}
+		writeFeature(f, gseq, coding ? "mRNA" : "lnc_RNA", exons[0].start, exons.Last().end,
+				strand, -1, attrs);
+	}
+	for (int e=0;e<nex;e++) {
+		int exnum=(strand=='+') ? e+1 : nex-e;
+		attrs.clear();
+		sprintf(buf, "%d", exnum);
+		if (params.gtf) {
+			addAttr(attrs, "transcript_id", tid);
+			addAttr(attrs, "gene_id", gid);
+			if (params.attrLevel>0) addAttr(attrs, "exon_number", buf);
+		}
+		else {
+			if (params.attrLevel>0) {
+				GStr eid(tid);
+				eid.append(".exon");
+				eid.append(buf);
+				addAttr(attrs, "ID", eid.chars());
+			}
+			addAttr(attrs, "Parent", tid);
+			if (params.attrLevel>1) addAttr(attrs, "exon_number", buf);
+		}
+		writeFeature(f, gseq, "exon", exons[e].start, exons[e].end, strand, -1, attrs);
+	}
+	counts.transcripts++;
+	counts.exons+=nex;
+	if (!coding) return;
+	attrs.clear();
+	if (params.gtf) {
+		addAttr(attrs, "transcript_id", tid);
+		addAttr(attrs, "gene_id", gid);
+	}
+	else {
+		sprintf(buf, "cds-%s", tid);
+		addAttr(attrs, "ID", buf);
+		addAttr(attrs, "Parent", tid);
+	}
+	if (params.attrLevel>1) {
+		sprintf(buf, "XP_%09u.1", rnd.range(1, 999999999));
+		addAttr(attrs, "protein_id", buf);
+	}
+	//map the CDS range to the exons, in the transcript direction
+	uint acc=0, cdsdone=0;
+	for (int k=0;k<nex;k++) {
+		GSeg& ex=(strand=='+') ? exons[k] : exons[nex-1-k];
+		uint elen=ex.len();
+		uint a=acc, b=acc+elen-1;
+		acc+=elen;
+		if (b<cdsfrom || a>cdsto) continue;
+		uint sa=((a>cdsfrom) ? a : cdsfrom)-a;
+		uint sb=((b<cdsto) ? b : cdsto)-a;
+		uint gs, ge;
+		if (strand=='+') { gs=ex.start+sa; ge=ex.start+sb; }
+		else { ge=ex.end-sa; gs=ex.end-sb; }
+		int phase=(3-cdsdone%3)%3;
+		writeFeature(f, gseq, "CDS", gs, ge, strand, phase, attrs);
+		if (a<=cdsfrom && ge-gs>=2) //start codon in this exon
+			setCodon(seq, len, (strand=='+') ? gs : ge, "ATG", strand);
+		if (b>=cdsto && ge-gs>=2) //stop codon
+			setCodon(seq, len, (strand=='+') ? ge-2 : gs+2, "TGA", strand);
+		cdsdone+=sb-sa+1;
+	}
+}
+
+void GffGenerator::genEukGenes(FILE* f, const char* gseq, char* seq, uint len) {
+	double spacing=1000.0/params.density;
+	GStr attrs;
+	char gid[32];
+	GVec<GSeg> exons(params.maxExons);
+	GVec<GSeg> texons(params.maxExons);
+	uint pos=rnd.range(1, (uint)spacing);
+	while (true) {
+		int nex=rnd.range(1, params.maxExons);
+		exons.Clear();
+		uint p=pos;
+		for (int e=0;e<nex;e++) {
+			if (e>0) p+=(rnd.chance(0.7) ? rnd.range(70, 800) : rnd.range(800, 6000)); //intron
+			uint elen=rnd.range(50, 400);
+			GSeg ex(p, p+elen-1);
+			exons.Add(ex);
+			p+=elen;
+		}
+		uint end=p-1;
+		if (end>len) break;
+		char strand=rnd.chance(0.5) ? '+' : '-';
+		bool coding=rnd.chance(0.85);
+		int niso=rnd.range(1, params.maxIsoforms);
+		geneNum++;
+		sprintf(gid, "G%07d", geneNum);
+		if (!params.gtf) {
+			attrs.clear();
+			addAttr(attrs, "ID", gid);
+			if (params.attrLevel>0) {
+				addAttr(attrs, "Name", gid);
+				addAttr(attrs, "gene_biotype", coding ? "protein_coding" : "lncRNA");
+			}
+			if (params.attrLevel>1) {
+				char buf[32];
+				sprintf(buf, "GeneID:%u", 100000+geneNum);
+				addAttr(attrs, "Dbxref", buf);
+				addAttr(attrs, "description", coding ? "synthetic protein coding gene" :
+						"synthetic long non-coding RNA");
+			}
+			writeFeature(f, gseq, "gene", pos, end, strand, -1, attrs);
+		}
+		counts.genes++;
+		for (int t=1;t<=niso;t++) {
+			//alternative transcripts skip some of the internal exons;
+			//only the first one gets start/stop codons in the genome sequence
+			texons.Clear();
+			for (int e=0;e<nex;e++)
+				if (t==1 || e==0 || e==nex-1 || rnd.chance(0.7))
+					texons.Add(exons[e]);
+			genEukTranscript(f, gseq, (t==1) ? seq : NULL, len, strand, texons, gid, t, coding);
+		}
+		uint span=end-pos+1;
+		uint maxgap=(spacing>span) ? (uint)(2*(spacing-span)) : 200;
+		pos=end+rnd.range(100, maxgap>100 ? maxgap : 100);
+	}
+}
+
+void GffGenerator::generate(FILE* fgff, FILE* ffasta, bool keepSeqs) {
+	int nseqs=(params.numSeqs<1) ? 1 : params.numSeqs;
+	if (params.genomeSize/nseqs>maxSeqLen)
+		nseqs=(int)((params.genomeSize+maxSeqLen-1)/maxSeqLen);
+	uint64 seqlen=params.genomeSize/nseqs;
+	if (fgff!=NULL && !params.gtf) {
+		int n=fprintf(fgff, "##gff-version 3\n");
+		if (n>0) counts.gffBytes+=n;
+	}
+	char sname[32];
+	for (int s=0;s<nseqs;s++) {
+		uint len=(uint)((s<nseqs-1) ? seqlen : params.genomeSize-seqlen*(nseqs-1));
+		sprintf(sname, (params.profile==ggpPhage) ? "phage%d" : "chr%d", s+1);
+		seqNames.Add(new GStr(sname));
+		seqLens.Add(len);
+		if (fgff!=NULL && !params.gtf) {
+			int n=fprintf(fgff, "##sequence-region %s 1 %u\n", sname, len);
+			if (n>0) counts.gffBytes+=n;
+		}
+		char* seq=NULL;
+		if (ffasta!=NULL || keepSeqs) {
+			GMALLOC(seq, len+1);
+			randomSeq(seq, len);
+			seq[len]=0;
+		}
+		if (params.profile==ggpPhage) genPhageGenes(fgff, sname, seq, len);
+		else genEukGenes(fgff, sname, seq, len);
+		if (ffasta!=NULL) {
+			int n=fprintf(ffasta, ">%s\n", sname);
+			if (n>0) counts.fastaBytes+=n;
+			for (uint i=0;i<len;i+=70) {
+				uint llen=(len-i<70) ? len-i : 70;
+				fwrite(seq+i, 1, llen, ffasta);
+				fputc('\n', ffasta);
+				counts.fastaBytes+=llen+1;
+			}
+		}
+		if (keepSeqs) seqs.Add(seq);
+		else GFREE(seq);
+		counts.bases+=len;
+	}
+}
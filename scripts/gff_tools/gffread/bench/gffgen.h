@@ -0,0 +1,94 @@
+#ifndef GFFGEN_H
+#define GFFGEN_H
+#include "GBase.h"
+#include "GStr.h"
+#include "GList.hh"
+
+//deterministic synthetic genome annotation (GFF3 or GTF) and genome sequence
+//(FASTA) for benchmarking: the same parameters always give the same files
+
+//pseudo-random generator (splitmix64), the same on every platform
+class GRandGen {
+	uint64 state;
+ public:
+	GRandGen(uint64 seed=1):state(seed) { }
+	uint64 next() {
+		uint64 z=(state+=0x9E3779B97F4A7C15ULL);
+		z=(z^(z>>30))*0xBF58476D1CE4E5B9ULL;
+		z=(z^(z>>27))*0x94D049BB133111EBULL;
+		return z^(z>>31);
+	}
+	uint range(uint lo, uint hi) { //uniform in [lo, hi]
+		return (hi>lo) ? lo+(uint)(next()%(uint64)(hi-lo+1)) : lo;
+	}
+	double uniform() { return (next()>>11)*(1.0/9007199254740992.0); }
+	bool chance(double p) { return uniform()<p; }
+};
+
+enum GffGenProfile {
+	ggpPhage=0, //compact genomes: single exon CDS genes on both strands (Prokka-like GFF3)
+	ggpEukaryote //chromosomes with multi-exon genes, alternative transcripts, UTRs
+};
+
+struct GffGenParams {
+	GffGenProfile profile;
+	bool gtf; //write GTF instead of GFF3
+	uint64 genomeSize; //total bases
+	int numSeqs; //genomic sequences the bases are split into
+	double density; //genes per kb
+	int maxExons; //per transcript (eukaryote profile)
+	int maxIsoforms; //transcripts per gene (eukaryote profile)
+	int attrLevel; //attribute verbosity: 0 = IDs only, 1 = typical, 2 = verbose
+	double gcContent;
+	uint64 seed;
+	GffGenParams() { setProfile(ggpPhage); }
+	//default parameters of a profile
+	void setProfile(GffGenProfile p);
+	//"phage" or "euk"/"eukaryote"; returns false if not recognized
+	bool setProfile(const char* pname);
+};
+
+//summary of the generated data
+struct GffGenCounts {
+	uint64 bases;
+	uint64 genes;
+	uint64 transcripts;
+	uint64 exons;
+	uint64 gffBytes;
+	uint64 fastaBytes;
+	GffGenCounts():bases(0), genes(0), transcripts(0), exons(0), gffBytes(0), fastaBytes(0) { }
+};
+
+class GffGenerator {
+	GRandGen rnd; //gene layout
+	GRandGen seqRnd; //genomic sequence bases
+	GPVec<GStr> seqNames;
+	GVec<uint> seqLens;
+	GVec<char*> seqs; //kept only when requested
+	int geneNum; //genes written so far
+	void randomSeq(char* seq, uint len);
+	void setCodon(char* seq, uint len, uint pos, const char* codon, char strand);
+	void addAttr(GStr& attrs, const char* name, const char* value);
+	void writeFeature(FILE* f, const char* gseq, const char* ftype, uint start, uint end,
+			char strand, int phase, GStr& attrs);
+	void genPhageGenes(FILE* f, const char* gseq, char* seq, uint len);
+	void genEukGenes(FILE* f, const char* gseq, char* seq, uint len);
+	void genEukTranscript(FILE* f, const char* gseq, char* seq, uint len, char strand,
+			GVec<GSeg>& exons, const char* gid, int tnum, bool coding);
+ public:
+	GffGenParams params;
+	GffGenCounts counts;
+	GffGenerator(GffGenParams& p);
+	~GffGenerator();
+	//write the annotation to fgff and the genomic sequences to ffasta;
+	//either file can be NULL; with keepSeqs the sequences stay in memory
+	//(needed for the sequence benchmarks)
+	void generate(FILE* fgff, FILE* ffasta, bool keepSeqs=false);
+	int numSeqs() { return seqNames.Count(); }
+	const char* seqName(int s) { return seqNames[s]->chars(); }
+	//sequence s, if kept (ownership stays with the generator)
+	char* getSeq(int s) { return (s<seqs.Count()) ? seqs[s] : NULL; }
+	uint getSeqLen(int s) { return seqLens[s]; }
+};
+
+#endif
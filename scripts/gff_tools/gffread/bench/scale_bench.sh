@@ -0,0 +1,181 @@
+#!/bin/bash -e
+# End to end scaling benchmark: runs gffread on synthetic inputs of several
+# size tiers with several thread counts, records the wall time, throughput
+# and peak RSS of each run (CSV and JSON) and compares them to a baseline.
+# Run it from the gffread directory with 'make scale-bench', or directly.
+
+usage() {
+  cat <<EOF
+Usage: bench/scale_bench.sh [-t "<tiers>"] [-p "<threads>"] [-r <reps>]
+   [-d <datadir>] [-o <outprefix>] [-b <baseline.csv>] [-x <max_pct>]
+   [-m <max_rss_pct>] [-B]
+ -t size tiers to run (default: "phage20m euk100m"):
+      phage20m : --batch of 400 phage genomes (20 MB of FASTA), -w/-y output
+      euk100m  : 100 Mbp eukaryote genome with GFF3, -w/-y/-o output
+      gtf1g    : 1 GB GTF converted to GFF3 (no sequences)
+      gtf10g   : 10 GB GTF converted to GFF3 (no sequences)
+ -p thread counts (-p option of gffread) to run each tier with (default: "1 2 4")
+ -r runs of each test, the fastest one is kept (default: 3)
+ -d directory for the generated inputs, kept between runs (default: bench/data)
+ -o prefix of the result files <outprefix>.csv and <outprefix>.json
+    (default: bench/scale_results)
+ -b baseline results (default: bench/scale_baseline.csv)
+ -x fail if the wall time of a test is more than max_pct percent above
+    its baseline (default: 10); differences under 0.05s are not counted,
+    as they are within the timing noise of the shortest tests
+ -m fail if the peak RSS of a test is more than max_rss_pct percent above
+    its baseline (default: 20)
+ -B save the results as the new baseline instead of comparing them
+EOF
+  exit 1
+}
+
+cd "$(dirname "$0")/.."
+tiers="phage20m euk100m"
+threads="1 2 4"
+reps=3
+datadir=bench/data
+outprefix=bench/scale_results
+baseline=bench/scale_baseline.csv
+maxpct=10
+maxrsspct=20
+savebase=0
+while getopts "t:p:r:d:o:b:x:m:Bh" opt; do
+  case $opt in
+    t) tiers=$OPTARG ;;
+    p) threads=$OPTARG ;;
+    r) reps=$OPTARG ;;
+    d) datadir=$OPTARG ;;
+    o) outprefix=$OPTARG ;;
+    b) baseline=$OPTARG ;;
+    x) maxpct=$OPTARG ;;
+    m) maxrsspct=$OPTARG ;;
+    B) savebase=1 ;;
+    *) usage ;;
+  esac
+done
+
+gffread=./gffread
+gffbench=./bench/gffbench
+for p in $gffread $gffbench; do
+  if [ ! -x $p ]; then
+    echo "Error: $p not found, build it first ('make release bench/gffbench')" >&2
+    exit 1
+  fi
+done
+
+# generate the input of a tier, unless already there
+# (the generator is deterministic, so the files are the same on every machine)
+gen_tier() {
+  local tier=$1 d=$datadir/$1
+  if [ -f $d/.done ]; then return; fi
+  echo "Generating the $tier input in $d .." >&2
+  rm -rf $d
+  mkdir -p $d
+  case $tier in
+    phage20m)
+      for i in $(seq 1 400); do
+        $gffbench --gen $d/phage$i --profile phage --size 50000 --seqs 1 --seed $i 2>/dev/null
+        echo "$d/phage$i.gff3 $d/phage$i.fa $d/out/phage$i" >> $d/manifest.txt
+      done ;;
+    euk100m)
+      $gffbench --gen $d/euk --profile euk --size 100000000 2>/dev/null ;;
+    gtf1g)
+      $gffbench --gen $d/ann --profile euk --gtf --no-fasta --size 7350000000 2>/dev/null ;;
+    gtf10g)
+      $gffbench --gen $d/ann --profile euk --gtf --no-fasta --size 73500000000 2>/dev/null ;;
+    *)
+      echo "Error: unknown tier $tier" >&2
+      exit 1 ;;
+  esac
+  touch $d/.done
+}
+
+# the gffread command line of a tier
+tier_cmd() {
+  local tier=$1 d=$datadir/$1
+  case $tier in
+    phage20m) echo "$gffread --batch $d/manifest.txt -w .fna -y .faa" ;;
+    euk100m) echo "$gffread $d/euk.gff3 -g $d/euk.fa -w $d/out/tx.fa -y $d/out/prot.fa -o $d/out/out.gff3" ;;
+    gtf*) echo "$gffread $d/ann.gtf -o $d/out/out.gff3" ;;
+  esac
+}
+
+# value of a top level number in the --stats report
+stat_value() {
+  sed -n "s/^  \"$2\": \([0-9.]*\),*$/\1/p" $1
+}
+
+now() {
+  date +%s.%N
+}
+
+csv=$outprefix.csv
+json=$outprefix.json
+stats=$(mktemp)
+log=$(mktemp)
+trap "rm -f $stats $log" EXIT
+echo "tier,threads,input_bytes,wall_s,mb_per_s,peak_rss_mb" > $csv
+for tier in $tiers; do
+  gen_tier $tier
+  cmd=$(tier_cmd $tier)
+  for t in $threads; do
+    best=""
+    rss=0
+    for r in $(seq 1 $reps); do
+      rm -rf $datadir/$tier/out
+      mkdir -p $datadir/$tier/out
+      t0=$(now)
+      if ! $cmd -p $t --stats $stats 2>$log; then
+        cat $log >&2
+        echo "Error: the $tier test failed: $cmd -p $t" >&2
+        exit 1
+      fi
+      t1=$(now)
+      wall=$(awk -v a=$t0 -v b=$t1 'BEGIN { printf "%.3f", b-a }')
+      if [ -z "$best" ] || awk -v a=$wall -v b=$best 'BEGIN { exit !(a<b) }'; then
+        best=$wall
+      fi
+      r_rss=$(stat_value $stats peak_rss_kb)
+      rss=$(awk -v a=$rss -v b=$r_rss 'BEGIN { print (b>a) ? b : a }')
+      inbytes=$(sed -n 's/^  "input": {"files": [0-9]*, "bytes": \([0-9]*\)}.*/\1/p' $stats)
+    done
+    rm -rf $datadir/$tier/out
+    awk -v tier=$tier -v t=$t -v b=$inbytes -v w=$best -v rss=$rss 'BEGIN {
+      printf "%s,%d,%.0f,%.3f,%.2f,%.1f\n", tier, t, b, w, (w>0) ? b/w/1048576 : 0, rss/1024 }' >> $csv
+    tail -1 $csv >&2
+  done
+done
+
+# the same results as JSON
+awk -F, 'NR==1 { next }
+  { rows[n++]=sprintf("  {\"tier\": \"%s\", \"threads\": %s, \"input_bytes\": %s, \"wall_s\": %s, \"mb_per_s\": %s, \"peak_rss_mb\": %s}",
+       $1, $2, $3, $4, $5, $6) }
+  END { print "["; for (i=0;i<n;i++) print rows[i] (i<n-1 ? "," : ""); print "]" }' $csv > $json
+echo "Results written to $csv and $json" >&2
+
+if [ $savebase -eq 1 ]; then
+  cp $csv $baseline
+  echo "Saved as the new baseline: $baseline" >&2
+  exit 0
+fi
+if [ ! -f $baseline ]; then
+  echo "No baseline ($baseline) to compare with; use -B to save these results as one." >&2
+  exit 0
+fi
+# compare with the baseline, for the tests found in both
+awk -F, -v maxpct=$maxpct -v maxrsspct=$maxrsspct '
+  FNR==1 { next }
+  NR==FNR { bwall[$1","$2]=$4; brss[$1","$2]=$6; next }
+  {
+    k=$1","$2
+    if (!(k in bwall)) { printf "%-16s %-3s no baseline\n", $1, $2; next }
+    dw=(bwall[k]>0) ? ($4-bwall[k])*100/bwall[k] : 0
+    dr=(brss[k]>0) ? ($6-brss[k])*100/brss[k] : 0
+    st="ok"
+    if (dw>maxpct && $4-bwall[k]>=0.05) { st="REGRESSION (time)"; fail=1 }
+    if (dr>maxrsspct) { st="REGRESSION (memory)"; fail=1 }
+    printf "%-16s %-3s wall %8.3fs (baseline %8.3fs, %+6.1f%%)  RSS %8.1fMB (%+6.1f%%)  %s\n",
+      $1, $2, $4, bwall[k], dw, $6, dr, st
+  }
+  END { exit fail }' $baseline $csv >&2
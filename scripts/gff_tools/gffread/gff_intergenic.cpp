@@ -0,0 +1,120 @@
+#include "gff_intergenic.h"
+
+struct GIGRegion {
+	uint start;
+	uint end;
+	char strand;
+	char* seq; //NULL if the genomic sequence was not found
+};
+
+struct GIGJobs {
+	GffIntergenic* ig;
+	GList<GenomicSeqData>* seqdata;
+	GFastaDb* gfasta;
+	GVec<GIGRegion>* regions; //intergenic regions of each genomic sequence
+};
+
+bool GffIntergenic::setStrandMode(const char* mode) {
+	if (strcmp(mode, "split")==0) strandMode=igsSplit;
+	else if (strcmp(mode, "rc")==0) strandMode=igsRevCompl;
+	else if (strcmp(mode, "any")==0) strandMode=igsAny;
+	else return false;
+	return true;
+}
+
+static int cmpSegStart(const pointer p1, const pointer p2) {
+	GSeg& s1=*(GSeg*)p1;
+	GSeg& s2=*(GSeg*)p2;
+	if (s1.start!=s2.start) return (s1.start<s2.start) ? -1 : 1;
+	if (s1.end!=s2.end) return (s1.end<s2.end) ? -1 : 1;
+	return 0;
+}
+
+//collect the CDS spans of the records in gfl, by strand
+static void addCDSpans(GList<GffObj>& gfl, GVec<GSeg>& fwd, GVec<GSeg>& rev) {
+	for (int i=0;i<gfl.Count();i++) {
+		GffObj& t=*(gfl[i]);
+		if (!t.hasCDS()) continue;
+		GSeg cds(t.CDstart, t.CDend);
+		if (t.strand=='-') rev.Add(cds);
+		else fwd.Add(cds); //no strand: assumed +
+	}
+}
+
+//add the gaps of at least minLen bases between the CDS spans
+static void addGaps(GVec<GSeg>& cds, char strand, uint minLen, GVec<GIGRegion>& gaps) {
+	cds.Sort(cmpSegStart);
+	uint maxend=0; //contained or overlapping CDS do not end a gap
+	for (int i=0;i<cds.Count();i++) {
+		if (i>0 && cds[i].start>maxend+minLen) {
+			GIGRegion r;
+			r.start=maxend+1;
+			r.end=cds[i].start-1;
+			r.strand=strand;
+			r.seq=NULL;
+			gaps.Add(r);
+		}
+		if (cds[i].end>maxend) maxend=cds[i].end;
+	}
+}
+
+static void findIntergenic(GenomicSeqData* gdata, void* udata) {
+	GIGJobs& jobs=*(GIGJobs*)udata;
+	GVec<GIGRegion>& gaps=jobs.regions[jobs.seqdata->IndexOf(gdata)];
+	GVec<GSeg> fwd;
+	GVec<GSeg> rev;
+	addCDSpans(gdata->rnas, fwd, rev);
+	addCDSpans(gdata->gfs, fwd, rev);
+	uint minLen=jobs.ig->minLen;
+	if (jobs.ig->strandMode==igsAny) {
+		fwd.Add(rev);
+		addGaps(fwd, '.', minLen, gaps);
+	}
+	else {
+		addGaps(fwd, '+', minLen, gaps);
+		addGaps(rev, '-', minLen, gaps);
+	}
+	if (gaps.Count()==0) return;
+	//each thread loads its own copy of the genomic sequence
+	GFaSeqGet* faseq=jobs.gfasta->fetchNew(gdata->gseq_name);
+	if (faseq==NULL) {
+		GMessage("Warning: genomic sequence %s not found, no intergenic regions extracted\n",
+				gdata->gseq_name);
+		return;
+	}
+	bool revCompl=(jobs.ig->strandMode==igsRevCompl);
+	for (int i=0;i<gaps.Count();i++) {
+		GIGRegion& r=gaps[i];
+		r.seq=faseq->copyRange(r.start, r.end, revCompl && r.strand=='-', false);
+	}
+	delete faseq;
+}
+
+int GffIntergenic::write(FILE* f, GList<GenomicSeqData>& seqdata, GFastaDb& gfasta, int numThreads) {
+	if (seqdata.Count()==0) return 0;
+	GIGJobs jobs;
+	jobs.ig=this;
+	jobs.seqdata=&seqdata;
+	jobs.gfasta=&gfasta;
+	jobs.regions=new GVec<GIGRegion>[seqdata.Count()];
+	forEachGSeqData(seqdata, findIntergenic, &jobs, numThreads);
+	//write the regions in the order of the genomic sequences
+	int numwritten=0;
+	for (int g=0;g<seqdata.Count();g++) {
+		const char* gseqname=seqdata[g]->gseq_name;
+		GVec<GIGRegion>& gaps=jobs.regions[g];
+		int n=0;
+		for (int i=0;i<gaps.Count();i++) {
+			GIGRegion& r=gaps[i];
+			if (r.seq==NULL) continue;
+			GStr defline(gseqname);
+			defline.appendfmt("-ign-%d %s %u-%u %c", n, gseqname, r.start, r.end, r.strand);
+			printFasta(f, defline, r.seq, r.end-r.start+1);
+			GFREE(r.seq);
+			n++;
+		}
+		numwritten+=n;
+	}
+	delete[] jobs.regions;
+	return numwritten;
+}
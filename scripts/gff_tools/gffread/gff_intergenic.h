@@ -0,0 +1,27 @@
+#ifndef GFF_INTERGENIC_H
+#define GFF_INTERGENIC_H
+#include "gff_utils.h"
+
+//extraction of the intergenic sequences (the gaps between consecutive CDS)
+//used as input for the promoter and terminator prediction
+
+enum GIGStrandMode {
+	igsSplit=0, //gaps between the CDS found on the same strand (get_intergene.py)
+	igsRevCompl, //like igsSplit, but the - strand gaps are reverse complemented
+	igsAny //gaps between the CDS found on either strand
+};
+
+class GffIntergenic {
+ public:
+	int minLen; //minimum length of an intergenic region
+	GIGStrandMode strandMode;
+	GffIntergenic():minLen(50), strandMode(igsSplit) { }
+	//parse a strand mode name (split, rc, any), false if not valid
+	bool setStrandMode(const char* mode);
+	//write the intergenic regions of all the genomic sequences in seqdata
+	//as FASTA records <gseq>-ign-<n>, using up to numThreads threads;
+	//returns the number of regions written
+	int write(FILE* f, GList<GenomicSeqData>& seqdata, GFastaDb& gfasta, int numThreads=1);
+};
+
+#endif
@@ -0,0 +1,376 @@
+#include "gff_merge.h"
+
+//split a tab delimited line in place, keeping the empty fields
+static int splitTabs(char* line, GDynArray<char*>& fields) {
+  fields.Reset();
+  fields.Add(line);
+  for (char* p=line;*p!=0;p++) {
+    if (*p=='\t') {
+      *p=0;
+      fields.Add(p+1);
+    }
+  }
+  return fields.Count();
+}
+
+//index of column cname in a table header, or defidx if not found
+static int columnIdx(GDynArray<char*>& hdr, const char* cname, int defidx) {
+  for (uint i=0;i<hdr.Count();i++) {
+    const char* h=hdr[i];
+    if (h[0]=='#') h++;
+    if (Gstricmp(h, cname)==0) return i;
+  }
+  return defidx;
+}
+
+//escape the characters reserved in GFF3 attribute values
+static void gff3Escape(GStr& s, const char* v) {
+  for (const char* p=v;*p!=0;p++) {
+    switch (*p) {
+      case ';': s.append("%3B"); break;
+      case '=': s.append("%3D"); break;
+      case '&': s.append("%26"); break;
+      case ',': s.append("%2C"); break;
+      case '\t': s.append(' '); break;
+      default: s.append(*p);
+    }
+  }
+}
+
+//value of attribute aname in a GFF3 attribute column (quotes removed), or NULL
+static char* gff3AttrValue(const char* attrs, const char* aname, GStr& v) {
+  int alen=strlen(aname);
+  const char* p=attrs;
+  while (*p!=0) {
+    while (*p==' ' || *p==';') p++;
+    if (strncmp(p, aname, alen)==0 && p[alen]=='=') {
+      p+=alen+1;
+      const char* e=strchr(p, ';');
+      if (e==NULL) e=p+strlen(p);
+      v.clear();
+      for (;p<e;p++)
+        if (*p!='"') v.append(*p);
+      v.trim();
+      return (char*)v.chars();
+    }
+    p=strchr(p, ';');
+    if (p==NULL) break;
+  }
+  return NULL;
+}
+
+void GffAnnMerge::indexProteins() {
+  byProtID.Clear();
+  for (int g=0;g<seqdata->Count();g++) {
+    GenomicSeqData* gdata=seqdata->Get(g);
+    for (int i=0;i<gdata->rnas.Count();i++) {
+      GffObj* t=gdata->rnas[i];
+      GStr id(t->getID());
+      if (!byProtID.hasKey(id.chars())) byProtID.Add(id.chars(), t);
+      if (endsWith(id.chars(), "_mRNA")) { //Prokka --addmrna
+        id.cut(id.length()-5);
+        if (!byProtID.hasKey(id.chars())) byProtID.Add(id.chars(), t);
+      }
+      const char* ltag=t->getAttr("locus_tag");
+      if (ltag!=NULL && !byProtID.hasKey(ltag)) byProtID.Add(ltag, t);
+    }
+  }
+}
+
+GffObj* GffAnnMerge::findProtein(const char* protid) {
+  GffObj* t=byProtID.Find(protid);
+  if (t==NULL && verbose)
+    GMessage("Warning: protein %s not found in the annotation!\n", protid);
+  return t;
+}
+
+void GffAnnMerge::indexLocations() {
+  locIdx.Clear();
+  for (int g=0;g<seqdata->Count();g++) {
+    GenomicSeqData* gdata=seqdata->Get(g);
+    if (gdata->rnas.Count()==0) continue;
+    GIntervalTree<GffObj>* itree=new GIntervalTree<GffObj>(gdata->rnas.Count());
+    for (int i=0;i<gdata->rnas.Count();i++)
+      itree->Add(gdata->rnas[i]);
+    locIdx.Add(gdata->gseqId(), itree);
+  }
+}
+
+//the transcript with the largest overlap with start-end on gseq
+//(same strand preferred, ties resolved by location order), or NULL
+GffObj* GffAnnMerge::findByLocation(const char* gseq, uint start, uint end, char strand) {
+  int gseq_id=names->gseqs.getId(gseq);
+  if (gseq_id<0) return NULL;
+  GIntervalTree<GffObj>* itree=locIdx.Find(gseq_id);
+  if (itree==NULL) return NULL;
+  GPVec<GffObj> ovls(false);
+  if (itree->findOverlaps(start, end, ovls)==0) return NULL;
+  if (start>end) Gswap(start, end);
+  GffObj* best=NULL;
+  uint bovl=0;
+  bool bstrand=false;
+  for (int i=0;i<ovls.Count();i++) {
+    GffObj* t=ovls[i];
+    uint ovl=GMIN(t->end, end)-GMAX(t->start, start)+1;
+    bool samestrand=(strand!='+' && strand!='-') || t->strand==strand;
+    if (best==NULL || (samestrand && !bstrand) ||
+        (samestrand==bstrand && (ovl>bovl || (ovl==bovl && gfo_cmpByLoc(t, best)<0)))) {
+      best=t;
+      bovl=ovl;
+      bstrand=samestrand;
+    }
+  }
+  return best;
+}
+
+//append a note to the note attribute of t, unless already there
+bool GffAnnMerge::addNote(GffObj* t, const char* note) {
+  GStr key(t->getID());
+  key.append('\t');
+  key.append(note);
+  if (notesAdded.has(key.chars())) return false;
+  notesAdded.Add(key.chars());
+  GStr v;
+  const char* prev=t->getAttr("note");
+  if (prev!=NULL) {
+    v=prev;
+    v.append(',');
+  }
+  gff3Escape(v, note);
+  t->addAttr("note", v.chars());
+  numNotes++;
+  return true;
+}
+
+//add the comma delimited xrefs to attribute attr of t, skipping duplicates
+void GffAnnMerge::addXref(GffObj* t, const char* attr, const char* xrefs) {
+  GStr v;
+  const char* prev=t->getAttr(attr);
+  if (prev!=NULL) v=prev;
+  GStr xlst(xrefs);
+  GStr x;
+  xlst.startTokenize(",");
+  while (xlst.nextToken(x)) {
+    x.trim();
+    if (x.is_empty()) continue;
+    GStr vx(",");
+    vx.append(v);
+    vx.append(',');
+    GStr xx(",");
+    xx.append(x);
+    xx.append(',');
+    if (vx.index(xx)>=0) continue;
+    if (!v.is_empty()) v.append(',');
+    v.append(x);
+  }
+  if (!v.is_empty()) t->addAttr(attr, v.chars());
+}
+
+//create a new (non-transcript) feature and add it to the genomic sequence data,
+//unless the same feature was added already
+GffObj* GffAnnMerge::addFeature(const char* gseq, const char* source, const char* ftype,
+		uint start, uint end, char strand, const char* note) {
+  if (start>end) Gswap(start, end);
+  if (start<1) start=1;
+  GStr key(gseq);
+  key.appendfmt("\t%s\t%u\t%u\t%c", ftype, start, end, strand);
+  if (featsAdded.has(key.chars())) return NULL;
+  featsAdded.Add(key.chars());
+  numFeats++;
+  GStr id(gseq);
+  id.appendfmt("_%s%d", ftype, numFeats);
+  GffObj* f=new GffObj(names, (char*)id.chars());
+  f->gseq_id=names->gseqs.addName(gseq);
+  f->track_id=names->tracks.addName(source);
+  f->setFeatureName(ftype);
+  f->start=start;
+  f->end=end;
+  f->strand=strand;
+  f->isUsed(true);
+  if (note!=NULL) {
+    GStr v;
+    gff3Escape(v, note);
+    f->addAttr("note", v.chars());
+  }
+  GenomicSeqData* gdata=getGSeqData(*seqdata, f->gseq_id, names);
+  gdata->gfs.Add(f);
+  return f;
+}
+
+void GffAnnMerge::merge(GList<GenomicSeqData>& gseqdata, GffNames* gnames) {
+  seqdata=&gseqdata;
+  names=gnames;
+  indexProteins();
+  if (!iprFile.is_empty()) loadInterPro(iprFile.chars());
+  if (!pvogFile.is_empty()) loadPVOG(pvogFile.chars());
+  if (!amrFile.is_empty()) loadAMRFinder(amrFile.chars());
+  if (!abricateFiles.is_empty()) {
+    indexLocations();
+    GStr f;
+    abricateFiles.startTokenize(",");
+    while (abricateFiles.nextToken(f))
+      loadAbricate(f.chars());
+  }
+  if (!btssFile.is_empty()) loadBTSS(btssFile.chars());
+  if (!ttermFile.is_empty()) loadTransTerm(ttermFile.chars());
+  if (verbose)
+    GMessage("%d notes attached, %d new features added by merging\n", numNotes, numFeats);
+}
+
+//InterProScan GFF3: protein_match lines, until the ##FASTA section
+int GffAnnMerge::loadInterPro(const char* fname) {
+  GLineReader lr(fname);
+  GDynArray<char*> t;
+  char* line=NULL;
+  GStr name, desc, xref;
+  int c=0;
+  while ((line=lr.nextLine())!=NULL) {
+    if (startsWith(line, "##FASTA")) break;
+    if (line[0]=='#' || line[0]==0) continue;
+    if (splitTabs(line, t)<9 || strcmp(t[2], "protein_match")!=0) continue;
+    GffObj* p=findProtein(t[0]);
+    if (p==NULL) continue;
+    const char* analysis=t[1];
+    if (strcmp(analysis, "TMHMM")==0) {
+      addNote(p, "Region of a membrane-bound protein predicted to be embedded "
+          "in the membrane as predicted by TMHMM");
+    }
+    else if (gff3AttrValue(t[8], "Name", name)!=NULL) {
+      GStr note(analysis);
+      note.append(' ');
+      note.append(name);
+      if (gff3AttrValue(t[8], "signature_desc", desc)!=NULL && !desc.is_empty()) {
+        note.append(": ");
+        note.append(desc);
+      }
+      addNote(p, note.chars());
+    }
+    if (gff3AttrValue(t[8], "Dbxref", xref)!=NULL) addXref(p, "Dbxref", xref.chars());
+    if (gff3AttrValue(t[8], "Ontology_term", xref)!=NULL) addXref(p, "Ontology_term", xref.chars());
+    c++;
+  }
+  return c;
+}
+
+//hmmsearch --domtblout: target (protein) in column 1, query (pVOG family) in column 4
+int GffAnnMerge::loadPVOG(const char* fname) {
+  GLineReader lr(fname);
+  GDynArray<char*> t;
+  char* line=NULL;
+  int c=0;
+  while ((line=lr.nextLine())!=NULL) {
+    if (line[0]=='#' || line[0]==0) continue;
+    if (strsplit(line, t, 5)<4) continue;
+    GffObj* p=findProtein(t[0]);
+    if (p==NULL) continue;
+    GStr note("pVOG family ");
+    note.append(t[3]);
+    if (addNote(p, note.chars())) c++;
+  }
+  return c;
+}
+
+//AMRFinderPlus (protein mode) tab delimited output, with a header line
+int GffAnnMerge::loadAMRFinder(const char* fname) {
+  GLineReader lr(fname);
+  GDynArray<char*> t;
+  char* line=NULL;
+  int cprot=0, cname=2, ctype=4, cacc=14;
+  int c=0;
+  while ((line=lr.nextLine())!=NULL) {
+    if (line[0]==0) continue;
+    int nt=splitTabs(line, t);
+    if (startsWith(line, "Protein identifier") || line[0]=='#') {
+      cprot=columnIdx(t, "Protein identifier", cprot);
+      cname=columnIdx(t, "Sequence name", cname);
+      ctype=columnIdx(t, "Element type", ctype);
+      cacc=columnIdx(t, "Accession of closest sequence", cacc);
+      continue;
+    }
+    if (nt<=cprot || nt<=cname || nt<=ctype || nt<=cacc) continue;
+    GffObj* p=findProtein(t[cprot]);
+    if (p==NULL) continue;
+    GStr note(t[ctype]);
+    note.appendfmt(" gene similar to %s, %s predicted by NCBI AMRFinder Plus", t[cacc], t[cname]);
+    if (addNote(p, note.chars())) c++;
+  }
+  return c;
+}
+
+//Abricate tab delimited output: hits on the genome, attached by location
+int GffAnnMerge::loadAbricate(const char* fname) {
+  GLineReader lr(fname);
+  GDynArray<char*> t;
+  char* line=NULL;
+  int cseq=1, cstart=2, cend=3, cstrand=4, cprod=13, cdb=11;
+  int c=0;
+  while ((line=lr.nextLine())!=NULL) {
+    if (line[0]==0) continue;
+    int nt=splitTabs(line, t);
+    if (line[0]=='#') {
+      cseq=columnIdx(t, "SEQUENCE", cseq);
+      cstart=columnIdx(t, "START", cstart);
+      cend=columnIdx(t, "END", cend);
+      cstrand=columnIdx(t, "STRAND", cstrand);
+      cprod=columnIdx(t, "PRODUCT", cprod);
+      cdb=columnIdx(t, "DATABASE", cdb);
+      continue;
+    }
+    if (nt<=cseq || nt<=cstart || nt<=cend || nt<=cstrand || nt<=cprod) continue;
+    uint hstart=0, hend=0;
+    if (!strToUInt(t[cstart], hstart) || !strToUInt(t[cend], hend)) continue;
+    GffObj* p=findByLocation(t[cseq], hstart, hend, t[cstrand][0]);
+    if (p==NULL) continue;
+    bool vfdb=(nt>cdb && strcmp(t[cdb], "vfdb")==0);
+    GStr note(vfdb ? "Virulence factor" : "Resistance gene");
+    note.appendfmt(" similar to %s predicted by Abricate", t[cprod]);
+    if (addNote(p, note.chars())) c++;
+  }
+  return c;
+}
+
+//bTSSfinder GFF: the promoter region is placed upstream of the reported TSS;
+//only the forward strand predictions are kept, as in the former pipeline
+int GffAnnMerge::loadBTSS(const char* fname) {
+  GLineReader lr(fname);
+  GDynArray<char*> t;
+  char* line=NULL;
+  GStr v;
+  int c=0;
+  while ((line=lr.nextLine())!=NULL) {
+    if (line[0]=='#' || line[0]==0) continue;
+    if (splitTabs(line, t)<9 || t[6][0]!='+') continue;
+    uint tstart=0, tend=0;
+    if (!strToUInt(t[3], tstart) || !strToUInt(t[4], tend)) continue;
+    uint pstart=(tstart>36) ? tstart-36 : 1;
+    uint pend=(tend>6) ? tend-6 : 1;
+    GStr note(gff3AttrValue(t[8], "promoter", v)!=NULL ? v.chars() : "sigma70");
+    note.append(" promoter predicted by bTSSfinder");
+    const char* boxes[4]={"box10pos", "box35pos", "box10seq", "box35seq"};
+    for (int b=0;b<4;b++)
+      if (gff3AttrValue(t[8], boxes[b], v)!=NULL)
+        note.appendfmt(" %s:%s", boxes[b], v.chars());
+    if (addFeature(t[0], "bTSSfinder", "promoter", pstart, pend, '+', note.chars())) c++;
+  }
+  return c;
+}
+
+//TransTermHP --bag-output: <gene> <start> .. <end> <strand> ..., or <gene> NONE;
+//the terminators are placed on the genomic sequence of their gene
+int GffAnnMerge::loadTransTerm(const char* fname) {
+  GLineReader lr(fname);
+  GDynArray<char*> t;
+  char* line=NULL;
+  int c=0;
+  while ((line=lr.nextLine())!=NULL) {
+    if (line[0]==0) continue;
+    if (strsplit(line, t, 6)<5 || strcmp(t[2], "..")!=0) continue;
+    uint tstart=0, tend=0;
+    if (!strToUInt(t[1], tstart) || !strToUInt(t[3], tend)) continue;
+    GffObj* p=findProtein(t[0]);
+    if (p==NULL) continue;
+    if (addFeature(p->getGSeqName(), "TransTermHP", "terminator", tstart, tend, t[4][0],
+        "Rho-independent terminator predicted by TransTermHP")) c++;
+  }
+  return c;
+}
@@ -0,0 +1,52 @@
+#ifndef GFF_MERGE_H
+#define GFF_MERGE_H
+#include "gff_utils.h"
+
+//merging of the phage annotation results into the Prokka GFF records:
+// notes and attributes from the protein based tools (InterProScan, pVOG,
+// AMRFinder) are attached to the CDS/transcript records by protein ID,
+// Abricate hits are attached by coordinate lookup, and the bTSSfinder
+// promoters and TransTermHP terminators are added as new features
+
+class GffAnnMerge {
+ protected:
+  GHash<GffObj> byProtID; //transcripts by protein ID (ID, ID without _mRNA, locus_tag)
+  GIntHashP< GIntervalTree<GffObj> > locIdx; //overlap index of transcripts, by gseq id
+  GList<GenomicSeqData>* seqdata;
+  GffNames* names; //name dictionary of the loaded records
+  GStrSet notesAdded; //"<record ID>\t<note>" already attached
+  GStrSet featsAdded; //"<gseq>\t<type>\t<start>\t<end>\t<strand>" already added
+  int numNotes;
+  int numFeats;
+  void indexProteins();
+  void indexLocations();
+  GffObj* findProtein(const char* protid);
+  GffObj* findByLocation(const char* gseq, uint start, uint end, char strand);
+  bool addNote(GffObj* t, const char* note);
+  void addXref(GffObj* t, const char* attr, const char* xrefs);
+  GffObj* addFeature(const char* gseq, const char* source, const char* ftype,
+		  uint start, uint end, char strand, const char* note);
+ public:
+  GStr iprFile; //InterProScan GFF3 output (.faa.gff3)
+  GStr pvogFile; //hmmsearch --domtblout against the pVOG HMMs
+  GStr amrFile; //AMRFinderPlus protein mode output
+  GStr abricateFiles; //Abricate output file(s), comma delimited
+  GStr btssFile; //bTSSfinder GFF output
+  GStr ttermFile; //TransTermHP --bag-output
+  GffAnnMerge():byProtID(false), locIdx(), seqdata(NULL), names(NULL), notesAdded(), featsAdded(),
+		  numNotes(0), numFeats(0) { }
+  bool enabled() {
+    return !(iprFile.is_empty() && pvogFile.is_empty() && amrFile.is_empty() &&
+		abricateFiles.is_empty() && btssFile.is_empty() && ttermFile.is_empty());
+  }
+  //read the result tables and merge them into the loaded records
+  void merge(GList<GenomicSeqData>& gseqdata, GffNames* gnames);
+  int loadInterPro(const char* fname);
+  int loadPVOG(const char* fname);
+  int loadAMRFinder(const char* fname);
+  int loadAbricate(const char* fname);
+  int loadBTSS(const char* fname);
+  int loadTransTerm(const char* fname);
+};
+
+#endif
@@ -0,0 +1,276 @@
+#include "gff_server.h"
+#include "codons.h"
+#include <signal.h>
+#include <poll.h>
+
+//per-thread state of a server worker
+struct GSrvWorker {
+	GffServer* srv;
+	GFaSeqGet* faseq; //genomic sequence of the last sequence request
+	GStr faseqName;
+	GSrvWorker(GffServer* s):srv(s), faseq(NULL), faseqName() { }
+	~GSrvWorker() { delete faseq; }
+};
+
+static char srvSockPath[1024]={0}; //Unix socket file to remove on exit
+static int srvStopPipe[2]={-1, -1}; //written by the signal handler to stop run()
+static volatile sig_atomic_t srvStopping=0;
+
+static void srvStop(int) {
+	if (srvStopping) { //second signal: do not wait for the clients
+		if (srvSockPath[0]!=0) unlink(srvSockPath);
+		_exit(1);
+	}
+	srvStopping=1;
+	char c=0;
+	if (write(srvStopPipe[1], &c, 1)<0) _exit(1);
+}
+
+GffServer::GffServer(GList<GenomicSeqData>& gdata, GFastaDb& gfdb):seqdata(gdata), gfasta(gfdb),
+		ids(false), gseqtrees(true), gseqidx(true), conns(false),
+		active(false), stopping(false), connLock(), connReady(), numThreads(1), tlabel(NULL),
+		tableRow(NULL), starStop(false) {
+	//the overlap and ID indexes are built once, then only read by the workers
+	for (int g=0;g<seqdata.Count();g++) {
+		GenomicSeqData& gd=*(seqdata[g]);
+		GIntervalTree<GffObj>* tree=new GIntervalTree<GffObj>();
+		GList<GffObj>* lsts[2]={ &gd.rnas, &gd.gfs };
+		for (int l=0;l<2;l++)
+			for (int i=0;i<lsts[l]->Count();i++) {
+				GffObj* t=lsts[l]->Get(i);
+				tree->Add(t);
+				if (t->getID()!=NULL && ids.Find(t->getID())==NULL)
+					ids.Add(t->getID(), t);
+			}
+		gseqtrees.Add(tree);
+		gseqidx.Add(gd.gseq_name, new int(g));
+	}
+}
+
+void GffServer::addConnection(GCommSocket* sock) {
+	GLockGuard<GMutex> guard(connLock);
+	conns.Add(sock);
+	connReady.notify_one();
+}
+
+//next accepted connection, or NULL when the server is stopping
+GCommSocket* GffServer::nextConnection() {
+	GLockGuard<GMutex> guard(connLock);
+	while (conns.Count()==0 && !stopping)
+		connReady.wait(connLock);
+	if (stopping) return NULL;
+	GCommSocket* sock=conns[0];
+	conns.Delete(0);
+	active.Add(sock);
+	return sock;
+}
+
+void GffServer::doneConnection(GCommSocket* sock) {
+	GLockGuard<GMutex> guard(connLock);
+	active.RemovePtr(sock);
+	delete sock;
+}
+
+//wake up the idle workers and disconnect the clients being served
+void GffServer::stop() {
+	GLockGuard<GMutex> guard(connLock);
+	stopping=true;
+	for (int i=0;i<active.Count();i++)
+		active[i]->shutdown();
+	connReady.notify_all();
+}
+
+void GffServer::worker(void* p) {
+	GffServer& srv=*(GffServer*)p;
+	GSrvWorker w(&srv);
+	GCommSocket* sock=NULL;
+	while ((sock=srv.nextConnection())!=NULL) {
+		srv.serve(w, *sock);
+		srv.doneConnection(sock);
+	}
+}
+
+//answer the requests of a client until it disconnects or sends "quit"
+bool GffServer::serve(GSrvWorker& w, GCommSocket& sock) {
+	GStr line;
+	while (sock.recvline(line)) {
+		line.trim();
+		if (line.is_empty()) continue;
+		if (line=="quit") return true;
+		char* rbuf=NULL;
+		size_t rlen=0;
+		FILE* f=open_memstream(&rbuf, &rlen);
+		if (f==NULL) GError("Error: open_memstream() failed!\n");
+		GStr err;
+		bool ok=request(w, line, f, err);
+		if (ok) fprintf(f, "#OK\n");
+		fclose(f);
+		bool sent=ok ? sock.sendAll(rbuf, rlen) :
+				sock.sendAll(("#ERR "+err+"\n").chars(), err.length()+6);
+		free(rbuf);
+		if (!sent) return false;
+	}
+	return true;
+}
+
+void GffServer::queryRegion(FILE* f, const char* gseq, uint rstart, uint rend) {
+	int* gi=gseqidx.Find(gseq);
+	if (gi==NULL) return;
+	GPVec<GffObj> ovl(false);
+	gseqtrees[*gi]->findOverlaps(rstart, rend, ovl);
+	ovl.Sort(gfo_cmpByLoc);
+	for (int i=0;i<ovl.Count();i++)
+		ovl[i]->printGff(f, tlabel);
+}
+
+bool GffServer::writeSeq(GSrvWorker& w, GffObj& t, const char* what, FILE* f, GStr& err) {
+	const char* gseq=t.getGSeqName();
+	if (w.faseq==NULL || w.faseqName!=gseq) {
+		delete w.faseq;
+		w.faseq=gfasta.fetchNew(gseq);
+		w.faseqName=gseq;
+	}
+	if (w.faseq==NULL) {
+		err.format("genomic sequence %s not available", gseq);
+		return false;
+	}
+	bool cdsOnly=(strcmp(what, "transcript")!=0);
+	if (cdsOnly && !t.hasCDS()) {
+		err.format("%s has no CDS", t.getID());
+		return false;
+	}
+	int seqlen=0;
+	char* s=t.getSpliced(w.faseq, cdsOnly, &seqlen);
+	if (s==NULL) {
+		err.format("could not extract the sequence of %s", t.getID());
+		return false;
+	}
+	GStr defline(t.getID());
+	if (strcmp(what, "protein")==0) {
+		int aalen=0;
+		char* aa=translateDNA(s, aalen, seqlen);
+		printFasta(f, defline, aa, aalen, starStop);
+		GFREE(aa);
+	}
+	else printFasta(f, defline, s, seqlen);
+	GFREE(s);
+	return true;
+}
+
+bool GffServer::request(GSrvWorker& w, GStr& line, FILE* f, GStr& err) {
+	GStr cmd, arg;
+	line.startTokenize(" \t", tkCharSet);
+	line.nextToken(cmd);
+	line.nextToken(arg);
+	if (cmd=="ping") return true;
+	if (arg.is_empty()) {
+		err.format("missing argument for %s", cmd.chars());
+		return false;
+	}
+	if (cmd=="region") {
+		uint rstart=1, rend=MAX_UINT;
+		int p=arg.rindex(':');
+		if (p>0) {
+			GStr range=arg.substr(p+1);
+			arg.cut(p);
+			GStr rgend=(range.index("..")>=0) ? range.split("..") : range.split('-');
+			if (!range.is_empty()) rstart=(uint)range.asInt();
+			if (!rgend.is_empty()) rend=(uint)rgend.asInt();
+			if (rstart==0 || rend<rstart) {
+				err="invalid region range";
+				return false;
+			}
+		}
+		queryRegion(f, arg.chars(), rstart, rend);
+		return true;
+	}
+	if (cmd!="gff" && cmd!="table" && cmd!="transcript" && cmd!="cds" && cmd!="protein") {
+		err.format("unknown request %s", cmd.chars());
+		return false;
+	}
+	GffObj* t=ids.Find(arg.chars());
+	if (t==NULL) {
+		err.format("ID %s not found", arg.chars());
+		return false;
+	}
+	if (cmd=="gff") {
+		t->printGff(f, tlabel);
+		return true;
+	}
+	if (cmd=="table") {
+		if (tableRow==NULL) {
+			err="no table format";
+			return false;
+		}
+		tableRow(f, *t);
+		return true;
+	}
+	return writeSeq(w, *t, cmd.chars(), f, err);
+}
+
+void GffServer::run(const char* address) {
+	signal(SIGPIPE, SIG_IGN);
+	if (pipe(srvStopPipe)!=0) GError("Error: pipe() failed: %s\n", strerror(errno));
+	signal(SIGINT, srvStop);
+	signal(SIGTERM, srvStop);
+	GStr addr(address);
+	bool unixSock=(startsWith(address, "unix:") || addr.index('/')>=0);
+	if (startsWith(address, "unix:")) addr.cut(0, 5);
+	GUnixServerSocket* usrv=NULL;
+	GTCPServerSocket* tsrv=NULL;
+	if (unixSock) {
+		if (addr.length()>=(int)sizeof(srvSockPath))
+			GError("Error: socket file path too long: %s\n", addr.chars());
+		usrv=new GUnixServerSocket(addr);
+		strcpy(srvSockPath, addr.chars());
+		GMessage("gffread server listening on %s (%d records)\n", addr.chars(), ids.Count());
+	}
+	else {
+		int p=addr.index(':');
+		if (p>=0) {
+			GStr port=addr.substr(p+1);
+			addr.cut(p);
+			tsrv=new GTCPServerSocket(addr, GSocket::resolveService(port), 64);
+		}
+		else tsrv=new GTCPServerSocket(GSocket::resolveService(addr), 64);
+		GMessage("gffread server listening on %s:%d (%d records)\n", tsrv->getLocalAddress().chars(),
+				tsrv->getLocalPort(), ids.Count());
+	}
+	if (numThreads<1) numThreads=1;
+	GThread* threads=new GThread[numThreads];
+	for (int i=0;i<numThreads;i++)
+		threads[i].kickStart(worker, (void*) this);
+	GSocket* lsock=(usrv!=NULL) ? (GSocket*)usrv : (GSocket*)tsrv;
+	struct pollfd pfd[2];
+	pfd[0].fd=lsock->getDescriptor();
+	pfd[1].fd=srvStopPipe[0];
+	pfd[0].events=pfd[1].events=POLLIN;
+	while (true) {
+		pfd[0].revents=pfd[1].revents=0;
+		if (poll(pfd, 2, -1)<0) {
+			if (errno==EINTR) continue;
+			GError("Error: poll() failed: %s\n", strerror(errno));
+		}
+		if (pfd[1].revents!=0) break; //SIGINT or SIGTERM
+		if (pfd[0].revents==0) continue;
+		GCommSocket* sock=NULL;
+		if (usrv!=NULL) sock=usrv->accept();
+		else sock=tsrv->accept();
+		addConnection(sock);
+	}
+	GMessage("gffread server stopping\n");
+	stop();
+	for (int i=0;i<numThreads;i++)
+		threads[i].join();
+	delete[] threads;
+	for (int i=0;i<conns.Count();i++) //accepted, never served
+		delete conns[i];
+	conns.Clear();
+	delete usrv; //also removes the socket file
+	delete tsrv;
+	srvSockPath[0]=0;
+	close(srvStopPipe[0]);
+	close(srvStopPipe[1]);
+	signal(SIGINT, SIG_DFL);
+	signal(SIGTERM, SIG_DFL);
+}
@@ -0,0 +1,58 @@
+#ifndef GFF_SERVER_H
+#define GFF_SERVER_H
+#include "gff_utils.h"
+#include "GThreads.h"
+#include "gsocket.h"
+
+//query server (--server): the annotation and the genomic sequences are loaded
+//once, then the requests of the clients are answered over a Unix or TCP socket.
+//Each request is a single line, the reply ends with a "#OK" line, or it is a
+//single "#ERR <message>" line:
+//  region <chr>[:<start>-<end>]  GFF3 records overlapping the region
+//  gff <id>                      GFF3 record with the given ID
+//  transcript <id>               spliced exon sequence (FASTA)
+//  cds <id>                      spliced CDS sequence (FASTA)
+//  protein <id>                  CDS translation (FASTA)
+//  table <id>                    --table row(s) for the record
+//  ping                          just the #OK line
+//  quit                          close the connection
+
+typedef void GffTableRowFunc(FILE* f, GffObj& gfo);
+
+struct GSrvWorker;
+
+class GffServer {
+	GList<GenomicSeqData>& seqdata;
+	GFastaDb& gfasta;
+	GHash<GffObj> ids; //all the loaded records by ID
+	GPVec< GIntervalTree<GffObj> > gseqtrees; //records overlap index, by seqdata index
+	GHash<int> gseqidx; //seqdata index by genomic sequence name
+	//accepted connections waiting for a worker
+	GPVec<GCommSocket> conns;
+	GPVec<GCommSocket> active; //connections being served by the workers
+	bool stopping; //set on shutdown, the workers return
+	GMutex connLock;
+	GConditionVar connReady;
+	void addConnection(GCommSocket* sock);
+	GCommSocket* nextConnection();
+	void doneConnection(GCommSocket* sock);
+	void stop();
+	bool serve(GSrvWorker& w, GCommSocket& sock);
+	bool request(GSrvWorker& w, GStr& line, FILE* f, GStr& err);
+	void queryRegion(FILE* f, const char* gseq, uint rstart, uint rend);
+	bool writeSeq(GSrvWorker& w, GffObj& t, const char* what, FILE* f, GStr& err);
+	static void worker(void* p);
+ public:
+	int numThreads; //number of worker threads serving the connections
+	const char* tlabel; //-t track label for the GFF output
+	GffTableRowFunc* tableRow; //writes a --table row
+	bool starStop; //-S: use '*' for the stop codon translation
+	GffServer(GList<GenomicSeqData>& gdata, GFastaDb& gfdb);
+	//serve the clients connecting to address, which is either a Unix socket
+	//file path (containing '/' or prefixed by "unix:") or [<host>:]<port>;
+	//returns after SIGINT or SIGTERM, once the client connections were closed
+	//and the worker threads finished
+	void run(const char* address);
+};
+
+#endif
@@ -0,0 +1,128 @@
+#include "gff_stats.h"
+#include "GThreads.h"
+#include "proc_mem.h"
+#include <time.h>
+
+GffRunStats gffStats;
+
+static const char* gffStageNames[gstNumStages]={"parse", "finalize", "cluster",
+		"seqfetch", "translate", "output"};
+
+static double cpuSeconds() {
+	return (double)clock()/CLOCKS_PER_SEC;
+}
+
+GffRunStats::GffRunStats():depth(0), spanNs(0), spanCpu(0), startNs(0), startCpu(0),
+		enabled(false), timing(false), inputFiles(0), inputBytes(0), features(0),
+		transcripts(0), loci(0), gseqs(0), seqHits(0), seqMisses(0) {
+	memset(stages, 0, sizeof(stages));
+}
+
+void GffRunStats::enable() {
+	enabled=true;
+	timing=true;
+	startNs=gthreads_clock_ns();
+	startCpu=cpuSeconds();
+}
+
+void GffRunStats::account(uint64_t now, double cpu) {
+	if (depth>0) {
+		GffStageTime& st=stages[active[depth-1]];
+		st.wall+=(now-spanNs)/1e9;
+		st.cpu+=cpu-spanCpu;
+	}
+	spanNs=now;
+	spanCpu=cpu;
+}
+
+void GffRunStats::enter(GffRunStage stage) {
+	if (depth==(int)(sizeof(active)/sizeof(active[0])))
+		GError("Error: stage timers nested too deep!\n");
+	account(gthreads_clock_ns(), cpuSeconds());
+	active[depth++]=stage;
+}
+
+void GffRunStats::leave() {
+	if (depth==0) return;
+	account(gthreads_clock_ns(), cpuSeconds());
+	depth--;
+	stages[active[depth]].count++;
+}
+
+void GffRunStats::addInput(uint64 bytes) {
+	if (!enabled) return;
+	__atomic_add_fetch(&inputFiles, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&inputBytes, bytes, __ATOMIC_RELAXED);
+}
+
+void GffRunStats::addCounts(GList<GenomicSeqData>& seqdata) {
+	if (!enabled) return;
+	uint64 nf=0, nt=0, nl=0;
+	for (int g=0;g<seqdata.Count();g++) {
+		GenomicSeqData& gd=*(seqdata[g]);
+		nt+=gd.rnas.Count();
+		nf+=gd.rnas.Count()+gd.gfs.Count();
+		nl+=gd.loci.Count();
+	}
+	__atomic_add_fetch(&features, nf, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&transcripts, nt, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&loci, nl, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&gseqs, (uint64)seqdata.Count(), __ATOMIC_RELAXED);
+}
+
+void GffRunStats::addSeqCache(GFastaDb& gfasta) {
+	if (!enabled) return;
+	__atomic_add_fetch(&seqHits, gfasta.cacheHits, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&seqMisses, gfasta.cacheMisses, __ATOMIC_RELAXED);
+}
+
+void GffRunStats::writeJSON(FILE* f, int numThreads) {
+	double wall=(gthreads_clock_ns()-startNs)/1e9;
+	double cpu=cpuSeconds()-startCpu;
+	fprintf(f, "{\n");
+	fprintf(f, "  \"program\": \"gffread\",\n");
+	fprintf(f, "  \"threads\": %d,\n", numThreads);
+	fprintf(f, "  \"wall_time\": %.6f,\n", wall);
+	fprintf(f, "  \"cpu_time\": %.6f,\n", cpu);
+	fprintf(f, "  \"peak_rss_kb\": %.0f,\n", get_peak_rss());
+	if (timing) {
+		fprintf(f, "  \"stages\": {");
+		double swall=0, scpu=0;
+		for (int i=0;i<gstNumStages;i++) {
+			GffStageTime& st=stages[i];
+			fprintf(f, "%s\n    \"%s\": {\"wall_time\": %.6f, \"cpu_time\": %.6f, \"count\": %llu}",
+					i ? "," : "", gffStageNames[i], st.wall, st.cpu, (unsigned long long)st.count);
+			swall+=st.wall;
+			scpu+=st.cpu;
+		}
+		//anything not covered by the stages (option parsing, merging, freeing memory..)
+		fprintf(f, ",\n    \"other\": {\"wall_time\": %.6f, \"cpu_time\": %.6f}\n  },\n",
+				wall>swall ? wall-swall : 0.0, cpu>scpu ? cpu-scpu : 0.0);
+	}
+	fprintf(f, "  \"input\": {\"files\": %llu, \"bytes\": %llu},\n",
+			(unsigned long long)inputFiles, (unsigned long long)inputBytes);
+	fprintf(f, "  \"counts\": {\"features\": %llu, \"transcripts\": %llu, \"loci\": %llu, \"genomic_sequences\": %llu},\n",
+			(unsigned long long)features, (unsigned long long)transcripts,
+			(unsigned long long)loci, (unsigned long long)gseqs);
+	fprintf(f, "  \"throughput\": {\"bytes_per_sec\": %.1f, \"records_per_sec\": %.1f",
+			wall>0 ? inputBytes/wall : 0.0, wall>0 ? features/wall : 0.0);
+	double ptime=stages[gstParse].wall;
+	if (timing) fprintf(f, ", \"parse_bytes_per_sec\": %.1f", ptime>0 ? inputBytes/ptime : 0.0);
+	fprintf(f, "},\n");
+	fprintf(f, "  \"seq_cache\": {\"hits\": %llu, \"misses\": %llu}",
+			(unsigned long long)seqHits, (unsigned long long)seqMisses);
+#ifdef GMEMSTATS
+	fprintf(f, ",\n  \"allocations\": {");
+	for (int t=0;t<=gmtNumTags;t++) {
+		GMemTagStats st;
+		GMemGetStats(t, st);
+		fprintf(f, "%s\n    \"%s\": {\"allocs\": %llu, \"frees\": %llu, \"bytes\": %llu, \"live\": %llu, \"peak\": %llu}",
+				t ? "," : "", GMemTagName(t), (unsigned long long)st.allocs,
+				(unsigned long long)st.frees, (unsigned long long)st.bytes,
+				(unsigned long long)st.live, (unsigned long long)st.peak);
+	}
+	fprintf(f, "\n  }");
+#endif
+	fprintf(f, "\n");
+	fprintf(f, "}\n");
+}
@@ -0,0 +1,69 @@
+#ifndef GFF_STATS_H
+#define GFF_STATS_H
+#include "gff_utils.h"
+
+//--stats: where the time and the memory of a gffread run go
+
+//the stages of a run; a stage started while another one is running
+//(e.g. a sequence fetch during the output) pauses the outer one, so the
+//stage times do not overlap
+enum GffRunStage {
+	gstParse=0, //reading and parsing the input lines
+	gstFinalize, //building the records and their parent/child relations
+	gstCluster, //placing the records in loci (-M, --cluster-only)
+	gstSeqFetch, //loading genomic sequences and extracting the spliced ones
+	gstTranslate, //CDS translation
+	gstOutput, //validating, formatting and writing the output records
+	gstNumStages
+};
+
+struct GffStageTime {
+	double wall; //elapsed seconds
+	double cpu; //CPU seconds used by the process (all threads) meanwhile
+	uint64 count; //number of timed spans
+};
+
+class GffRunStats {
+	GffStageTime stages[gstNumStages];
+	int active[16]; //the stages started and not finished yet
+	int depth;
+	uint64_t spanNs; //when the stage on top of active[] was (re)started
+	double spanCpu;
+	uint64_t startNs; //start of the run
+	double startCpu;
+	void account(uint64_t now, double cpu);
+ public:
+	bool enabled; //only collect counters when set
+	bool timing; //time the stages; only used by the main thread
+	//counters (updated atomically, they are summed over the --batch samples)
+	uint64 inputFiles;
+	uint64 inputBytes;
+	uint64 features; //records loaded
+	uint64 transcripts;
+	uint64 loci;
+	uint64 gseqs; //genomic sequences with records
+	uint64 seqHits; //GFastaDb requests served from memory
+	uint64 seqMisses; //GFastaDb sequences loaded from the FASTA file(s)
+	GffRunStats();
+	void enable(); //the run is timed from here
+	void enter(GffRunStage stage);
+	void leave();
+	void addInput(uint64 bytes);
+	void addCounts(GList<GenomicSeqData>& seqdata);
+	void addSeqCache(GFastaDb& gfasta);
+	void writeJSON(FILE* f, int numThreads); //the report
+};
+
+extern GffRunStats gffStats;
+
+//times a stage for the lifetime of this object
+class GffStageTimer {
+	bool on;
+ public:
+	GffStageTimer(GffRunStage stage):on(gffStats.timing) {
+		if (on) gffStats.enter(stage);
+	}
+	~GffStageTimer() { if (on) gffStats.leave(); }
+};
+
+#endif
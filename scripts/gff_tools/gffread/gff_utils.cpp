@@ -1,4 +1,7 @@
 #include "gff_utils.h"
+#include "GThreads.h"
+#include "GPipe.h"
+#include "gff_stats.h"
 
 bool verbose=false; //same with GffReader::showWarnings and GffLoader::beVserbose
 
@@ -34,17 +37,19 @@ void printFasta(FILE* f, GStr& defline, char* seq, int seqlen, bool useStar) {
  if (len<=0) return;
  if (!defline.is_empty())
      fprintf(f, ">%s\n",defline.chars());
- int ilen=0;
- for (int i=0; i < len; i++, ilen++) {
-   if (ilen == 70) {
-     fputc('\n', f);
-     ilen = 0;
-     }
-   if (useStar && seq[i]=='.')
-        putc('*', f);
-   else putc(seq[i], f);
+ //one fwrite() per line: with several threads running, each stdio call
+ //takes the stream lock
+ char line[72];
+ for (int i=0; i < len; i+=70) {
+   int llen=(len-i<70) ? len-i : 70;
+   if (useStar) {
+     for (int j=0;j<llen;j++)
+       line[j]=(seq[i+j]=='.') ? '*' : seq[i+j];
+   }
+   else memcpy(line, seq+i, llen);
+   line[llen]='\n';
+   fwrite(line, 1, llen+1, f);
    } //for
- fputc('\n', f);
 }
 
 int qsearch_gloci(uint x, GList<GffLocus>& loci) {
@@ -135,25 +140,25 @@ bool tMatch(GffObj& a, GffObj& b) {
     //if (equnspl) {
       //fuzz match for single-exon transfrags:
       // it's a match if they overlap at least 80% of max len
-      ovlen=a.exons[0]->overlapLen(b.exons[0]);
+      ovlen=a.exons[0].overlapLen(b.exons[0]);
       int maxlen=GMAX(a.covlen,b.covlen);
       return (ovlen>=maxlen*0.8);
     /*}
     else {
       //only exact match
       ovlen=a.covlen;
-      return (a.exons[0]->start==b.exons[0]->start &&
-          a.exons[0]->end==b.exons[0]->end);
+      return (a.exons[0].start==b.exons[0].start &&
+          a.exons[0].end==b.exons[0].end);
 
        }*/
      }
   //check intron overlaps
-  ovlen=a.exons[0]->end-(GMAX(a.start,b.start))+1;
-  ovlen+=(GMIN(a.end,b.end))-a.exons.Last()->start;
+  ovlen=a.exons[0].end-(GMAX(a.start,b.start))+1;
+  ovlen+=(GMIN(a.end,b.end))-a.exons.Last().start;
   for (int i=1;i<=imax;i++) {
-    if (i<imax) ovlen+=a.exons[i]->len();
-    if ((a.exons[i-1]->end!=b.exons[i-1]->end) ||
-      (a.exons[i]->start!=b.exons[i]->start)) {
+    if (i<imax) ovlen+=a.exons[i].len();
+    if ((a.exons[i-1].end!=b.exons[i-1].end) ||
+      (a.exons[i].start!=b.exons[i].start)) {
             return false; //intron mismatch
     }
   }
@@ -173,21 +178,21 @@ bool GffLoader::unsplContained(GffObj& ti, GffObj&  tj) {
     for (int j=0;j<=jmax;j++) {
        bool exonOverlap=false;
        if (dOvlSET) {
-    	   exonOverlap= (tj.exons[j]->overlapLen(ti.start-1, ti.end+1) > 0);
+    	   exonOverlap= (tj.exons[j].overlapLen(ti.start-1, ti.end+1) > 0);
        } else {
     	   exonOverlap=(ti.overlapLen(tj.exons[j])>=0.8 * ti.len());
        }
        if (exonOverlap) {
           //must not overlap the introns
-          if ((j>0 && ti.start+maxIntronOvl<tj.exons[j]->start)
-             || (j<jmax && ti.end>tj.exons[j]->end+maxIntronOvl))
+          if ((j>0 && ti.start+maxIntronOvl<tj.exons[j].start)
+             || (j<jmax && ti.end>tj.exons[j].end+maxIntronOvl))
              return false;
           return true;
        }
     } //for each exon
   } else { // not fuzzSpan, strict containment required
     for (int j=0;j<=jmax;j++) {
-        if (ti.end<=tj.exons[j]->end && ti.start>=tj.exons[j]->start)
+        if (ti.end<=tj.exons[j].end && ti.start>=tj.exons[j].start)
           return true;
     }
  }
@@ -229,8 +234,8 @@ GffObj* GffLoader::redundantTranscripts(GffObj& ti, GffObj&  tj) {
    }
    //check that all introns really match
    for (int i=0;i<imax;i++) {
-     if (ti.exons[i]->end!=tj.exons[i]->end ||
-         ti.exons[i+1]->start!=tj.exons[i+1]->start) return NULL;
+     if (ti.exons[i].end!=tj.exons[i].end ||
+         ti.exons[i+1].start!=tj.exons[i+1].start) return NULL;
      }
    return bigger;
  }
@@ -263,9 +268,9 @@ GffObj* GffLoader::redundantTranscripts(GffObj& ti, GffObj&  tj) {
      //single-exon transcripts: if fuzzSpan, at least 80% of the shortest one must be overlapped by the other
      if (fuzzSpan) {
        if (dOvlSET) {
-           return (ti.exons[0]->overlapLen(tj.exons[0]->start-1, tj.exons[0]->end+1)>0) ? bigger : NULL;
+           return (ti.exons[0].overlapLen(tj.exons[0].start-1, tj.exons[0].end+1)>0) ? bigger : NULL;
        } else {
-          return (ti.exons[0]->overlapLen(tj.exons[0])>=minlen*0.8) ? bigger : NULL;
+          return (ti.exons[0].overlapLen(tj.exons[0])>=minlen*0.8) ? bigger : NULL;
        }
      } else { //boundary containment required
        return (smaller->start>=bigger->start && smaller->end<=bigger->end) ? bigger : NULL;
@@ -279,8 +284,8 @@ GffObj* GffLoader::redundantTranscripts(GffObj& ti, GffObj&  tj) {
  }
 
  //--- from here on: both are multi-exon transcripts: imax>0 && jmax>0
-  if (ti.exons[imax]->start<tj.exons[0]->end ||
-     tj.exons[jmax]->start<ti.exons[0]->end )
+  if (ti.exons[imax].start<tj.exons[0].end ||
+     tj.exons[jmax].start<ti.exons[0].end )
          return NULL; //intron chains do not overlap at all
  //checking full intron chain containment
  uint eistart=0, eiend=0, ejstart=0, ejend=0; //exon boundaries
@@ -288,10 +293,10 @@ GffObj* GffLoader::redundantTranscripts(GffObj& ti, GffObj&  tj) {
  int j=1; //exon idx to the right of the current intron of tj
  //find the first intron overlap:
  while (i<=imax && j<=jmax) {
-    eistart=ti.exons[i-1]->end;
-    eiend=ti.exons[i]->start;
-    ejstart=tj.exons[j-1]->end;
-    ejend=tj.exons[j]->start;
+    eistart=ti.exons[i-1].end;
+    eiend=ti.exons[i].start;
+    ejstart=tj.exons[j-1].end;
+    ejend=tj.exons[j].start;
     if (ejend<eistart) { j++; continue; }
     if (eiend<ejstart) { i++; continue; }
     //we found an intron overlap
@@ -306,26 +311,26 @@ GffObj* GffLoader::redundantTranscripts(GffObj& ti, GffObj&  tj) {
  int maxIntronOvl=dOvlSET ? 25 : 0;
  if (j>i) {
    //i==1, ti's start must not conflict with the previous intron of tj
-   if (ti.start+maxIntronOvl<tj.exons[j-1]->start) return NULL;
+   if (ti.start+maxIntronOvl<tj.exons[j-1].start) return NULL;
    //comment out the line above if you just want "intron compatibility" (i.e. extension of intron chains )
    //so i's first intron starts AFTER j's first intron
    // then j must contain i, so i's last intron must end with or before j's last intron
-   if (ti.exons[imax]->start>tj.exons[jmax]->start) return NULL;
+   if (ti.exons[imax].start>tj.exons[jmax].start) return NULL;
  }
  else if (i>j) {
    //j==1, tj's start must not conflict with the previous intron of ti
-   if (tj.start+maxIntronOvl<ti.exons[i-1]->start) return NULL;
+   if (tj.start+maxIntronOvl<ti.exons[i-1].start) return NULL;
    //comment out the line above for just "intronCompatible()" check (allowing extension of intron chain)
    //so j's intron chain starts AFTER i's
    // then i must contain j, so j's last intron must end with or before j's last intron
-   if (tj.exons[jmax]->start>ti.exons[imax]->start) return NULL;
+   if (tj.exons[jmax].start>ti.exons[imax].start) return NULL;
  }
  //now check if the rest of the introns overlap, in the same sequence
  i++;
  j++;
  while (i<=imax && j<=jmax) {
-   if (ti.exons[i-1]->end!=tj.exons[j-1]->end ||
-      ti.exons[i]->start!=tj.exons[j]->start) return NULL;
+   if (ti.exons[i-1].end!=tj.exons[j-1].end ||
+      ti.exons[i].start!=tj.exons[j].start) return NULL;
    i++;
    j++;
  }
@@ -333,15 +338,48 @@ GffObj* GffLoader::redundantTranscripts(GffObj& ti, GffObj&  tj) {
  j--;
  if (i==imax && j<jmax) {
    // tj has more introns to the right, check if ti's end doesn't conflict with the current tj exon boundary
-   if (ti.end>tj.exons[j]->end+maxIntronOvl) return NULL;
+   if (ti.end>tj.exons[j].end+maxIntronOvl) return NULL;
    }
  else if (j==jmax && i<imax) {
-   if (tj.end>ti.exons[i]->end+maxIntronOvl) return NULL;
+   if (tj.end>ti.exons[i].end+maxIntronOvl) return NULL;
    }
  return bigger;
 }
 
 
+int gloc_cmpRevLoc(const pointer p1, const pointer p2) {
+ //descending order of location
+ GffLocus& l1=*(GffLocus*)p1;
+ GffLocus& l2=*(GffLocus*)p2;
+ if (l1.start!=l2.start) return (l1.start>l2.start) ? -1 : 1;
+ if (l1.end!=l2.end) return (l1.end>l2.end) ? -1 : 1;
+ return -gloc_cmpByLoc(p1, p2);
+}
+
+int gloc_cmpByLoc(const pointer p1, const pointer p2) {
+ GffLocus& l1=*(GffLocus*)p1;
+ GffLocus& l2=*(GffLocus*)p2;
+ if (l1.start!=l2.start) return (l1.start<l2.start) ? -1 : 1;
+ if (l1.end!=l2.end) return (l1.end<l2.end) ? -1 : 1;
+ if (l1.strand!=l2.strand) return (l1.strand<l2.strand) ? -1 : 1;
+ return gfo_cmpByLoc(l1.t_maxcov, l2.t_maxcov);
+}
+
+void GenomicSeqData::packLoci() {
+ int j=0;
+ for (int i=0;i<loci.Count();i++) {
+   GffLocus* loc=loci[i];
+   if (loc->merged) {
+     delete loc;
+     continue;
+   }
+   loci.Put(j, loc);
+   j++;
+ }
+ loci.setCount(j);
+ loci.GPVec<GffLocus>::Sort(gloc_cmpByLoc);
+}
+
 int gseqCmpName(const pointer p1, const pointer p2) {
  return strcmp(((GenomicSeqData*)p1)->gseq_name, ((GenomicSeqData*)p2)->gseq_name);
 }
@@ -370,9 +408,112 @@ bool exonOverlap2Gene(GffObj* t, GffObj& g) {
 	}
 	else return g.overlap(*t);
 }
-bool GffLoader::placeGf(GffObj* t, GenomicSeqData* gdata) {
+//mark t or o as redundant, if they are
+void GffLoader::checkRedundant(GffObj* t, GTData* tdata, GffObj* o) {
+  GTData* odata=(GTData*)(o->uptr);
+  //GMessage("  ..redundant check vs overlapping transcript %s\n",o->getID());
+  GffObj* container=NULL;
+  if (odata->replaced_by==NULL &&
+       (container=redundantTranscripts(*t, *o))!=NULL) {
+      if (container==t) {
+         odata->replaced_by=t;
+         preserveContainedCDS(t, o);
+      }
+      else {// t is being replaced by previously defined transcript
+         tdata->replaced_by=o;
+         preserveContainedCDS(o, t);
+      }
+  }
+}
+
+static inline uint32 intronHash(uint istart, uint iend) {
+  uint64 h=(((uint64)istart)<<32) | iend;
+  h^=h>>33;
+  h*=0xff51afd7ed558ccdULL;
+  h^=h>>33;
+  h*=0xc4ceb9fe1a85ec53ULL;
+  h^=h>>33;
+  return (uint32)h;
+}
+
+//canonical hash of the intron chain of a multi-exon transcript
+static uint32 intronChainHash(GffObj& t) {
+  uint64 h=t.exons.Count();
+  for (int i=1;i<t.exons.Count();i++)
+    h=(h^intronHash(t.exons[i-1].end, t.exons[i].start))*0x9E3779B97F4A7C15ULL;
+  return (uint32)(h^(h>>32));
+}
+
+static void addToBucket(GIntHashP< GPVec<GffObj> >& idx, uint32 key, GffObj* t) {
+  GPVec<GffObj>* bucket=idx.Find(key);
+  if (bucket==NULL) {
+    bucket=new GPVec<GffObj>(false);
+    idx.Add(key, bucket);
+  }
+  bucket->Add(t);
+}
+
+//index of t in a locus' sorted rnas list
+static int rnaIndex(GList<GffObj>& rnas, GffObj* t) {
+  int idx=-1;
+  if (!rnas.Found(t, idx)) return rnas.IndexOf(t);
+  //equal records (e.g. loaded twice) are next to each other
+  for (int i=idx;i>=0 && *(rnas[i])==*t;i--)
+    if (rnas[i]==t) return i;
+  for (int i=idx+1;i<rnas.Count() && *(rnas[i])==*t;i++)
+    if (rnas[i]==t) return i;
+  return rnas.IndexOf(t);
+}
+
+//collect the transcripts already placed on gdata which could be redundant
+//with t (a superset: hash collisions are weeded out by redundantTranscripts());
+//returns false if all the transcripts in the overlapping loci must be checked
+//- matchAllIntrons: multi-exon transcripts need the same intron chain, and
+//  single-exon transcripts can only match overlapping single-exon transcripts
+//- otherwise a multi-exon transcript must have its first intron in t's chain,
+//  or have t's first intron in its chain (the first shared intron must be
+//  the first intron of one of them); single-exon ones must overlap t
+bool GffLoader::redundancyCandidates(GffObj* t, GenomicSeqData* gdata, GPVec<GffObj>& cands) {
+  if (t->exons.Count()==1) {
+    if (!matchAllIntrons) return false; //could be contained in any overlapping transcript
+    gdata->tsingle.findOverlaps(t->start-1, t->end+1, cands);
+    return true;
+  }
+  if (matchAllIntrons) {
+    GPVec<GffObj>* bucket=gdata->tchains.Find(intronChainHash(*t));
+    if (bucket!=NULL) cands.Add(*bucket);
+    return true;
+  }
+  GPVec<GffObj>* bucket=gdata->tintrons.Find(intronHash(t->exons[0].end, t->exons[1].start));
+  if (bucket!=NULL) cands.Add(*bucket);
+  for (int i=1;i<t->exons.Count();i++) {
+    bucket=gdata->tfirst.Find(intronHash(t->exons[i-1].end, t->exons[i].start));
+    if (bucket!=NULL) cands.Add(*bucket);
+  }
+  gdata->tsingle.findOverlaps(t->start-1, t->end+1, cands);
+  return true;
+}
+
+//make t available to redundancyCandidates()
+void GffLoader::indexRedundancy(GffObj* t, GenomicSeqData* gdata) {
+  if (t->exons.Count()==1) {
+    gdata->tsingle.Add(t);
+    return;
+  }
+  if (matchAllIntrons)
+    addToBucket(gdata->tchains, intronChainHash(*t), t);
+  else {
+    addToBucket(gdata->tfirst, intronHash(t->exons[0].end, t->exons[1].start), t);
+    for (int i=1;i<t->exons.Count();i++)
+      addToBucket(gdata->tintrons, intronHash(t->exons[i-1].end, t->exons[i].start), t);
+  }
+}
+
+//add t to gdata->rnas or gdata->gfs (adopting it into a container gene if requested);
+//returns false if t is not going to be kept
+bool GffLoader::storeGf(GffObj* t, GenomicSeqData* gdata, GTData*& tdata, bool& noexon_gfs) {
   bool keep=false;
-  GTData* tdata=NULL;
+  tdata=NULL;
   //int tidx=-1;
   /*
   if (debug) {
@@ -422,9 +563,9 @@ bool GffLoader::placeGf(GffObj* t, GenomicSeqData* gdata) {
   		--gidx;
   	}
   }
-  bool noexon_gfs=false;
+  noexon_gfs=false;
   if (t->exons.Count()>0) { //treating this entry as a transcript
-	gdata->rnas.Add(t); //added it in sorted order
+	gdata->rnas.Add(t); //added it in sorted order (appended when bulk loading)
 	if (tdata==NULL) {
 	   tdata=new GTData(t); //additional transcript data
 	   gdata->tdata.Add(tdata);
@@ -446,225 +587,490 @@ bool GffLoader::placeGf(GffObj* t, GenomicSeqData* gdata) {
        return false; //nothing to do with these non-transcript objects
     }
   }
-  if (!doCluster) return keep;
-
-  if (!keep) return false;
+  return keep;
+}
 
-  //---- place into a locus
+//get the range where t may overlap existing loci
+void GffLoader::locusSpan(GffObj* t, uint& t_start, uint& t_end) {
   if (dOvlSET && t->exons.Count()==1) {
 	  //for single exon transcripts temporarily set the strand to '.'
 	  //so we can check both strands for overlap/locus
       T_SET_OSTRAND(t->udata, t->strand);
       t->strand='.';
   }
-  if (gdata->loci.Count()==0) {
-       gdata->loci.Add(new GffLocus(t));
-       return true; //new locus on this ref seq
-  }
-  //--- look for any existing loci overlapping t
-  uint t_end=t->end;
-  uint t_start=t->start;
+  t_end=t->end;
+  t_start=t->start;
   if (dOvlSET) {
 	  t_end++;
 	  t_start--;
   }
-  int nidx=qsearch_gloci(t_end, gdata->loci); //get index of nearest locus starting just ABOVE t->end
-  //GMessage("\tlooking up end coord %d in gdata->loci.. (qsearch got nidx=%d)\n", t->end, nidx);
-  if (nidx==0) {
+}
+
+bool GffLoader::placeGf(GffObj* t, GenomicSeqData* gdata) {
+  GTData* tdata=NULL;
+  bool noexon_gfs=false;
+  if (!storeGf(t, gdata, tdata, noexon_gfs)) return false;
+  if (!doCluster) return true;
+
+  //---- place into a locus
+  uint t_start=0, t_end=0;
+  locusSpan(t, t_start, t_end);
+  //--- look for any existing loci overlapping t
+  GPVec<GffLocus> tloci(false); //candidate parent loci to adopt this
+  if (gdata->loctree.findOverlaps(t_start, t_end, tloci)==0) {
      //cannot have any overlapping loci
-     //if (debug) GMessage("  <<no ovls possible, create locus %d-%d \n",t->start, t->end);
-     gdata->loci.Add(new GffLocus(t));
-     return true;
+     GffLocus* newloc=new GffLocus(t);
+     gdata->loci.Add(newloc);
+     gdata->loctree.Add(newloc);
+     if (collapseRedundant && !noexon_gfs) indexRedundancy(t, gdata);
+     return true; //new locus on this ref seq
+  }
+  tloci.Sort(gloc_cmpRevLoc);
+  addToLoci(t, tdata, noexon_gfs, gdata, tloci, true);
+  return true;
+}
+
+//add t to the overlapping loci among the candidate loci tloci (which must be
+//sorted by gloc_cmpRevLoc), merging them if t bridges several of them, or
+//create a new locus for t; gdata->loctree is only updated if useIndex is true
+//returns the locus holding t
+GffLocus* GffLoader::addToLoci(GffObj* t, GTData* tdata, bool noexon_gfs,
+		GenomicSeqData* gdata, GPVec<GffLocus>& tloci, bool useIndex) {
+  //check candidates from the highest to the lowest location,
+  //so the last one found is the lowest in the final loci order
+  bool checkRedundancy=(collapseRedundant && !noexon_gfs);
+  GPVec<GffObj> tcands(false); //transcripts which could be redundant with t
+  bool scanAll=false; //check against all the transcripts in the locus
+  if (checkRedundancy) {
+     scanAll=!redundancyCandidates(t, gdata, tcands);
+     for (int c=0;c<tcands.Count();c++) //mark them (also drops duplicates)
+        ((GTData*)(tcands[c]->uptr))->flag=1;
   }
-  if (nidx==-1) nidx=gdata->loci.Count();//all loci start below t->end
+  GffLocus* tloc=NULL; //the locus t ends up in
   int lfound=0; //count of parent loci
-  GArray<int> mrgloci(false);
-  GList<GffLocus> tloci(true); //candidate parent loci to adopt this
-  //if (debug) GMessage("\tchecking all loci from %d to 0\n",nidx-1);
-  for (int l=nidx-1;l>=0;l--) {
-      GffLocus& loc=*(gdata->loci[l]);
+  GPVec<GffLocus> mrgloci(false);
+  for (int l=0;l<tloci.Count();l++) {
+      GffLocus& loc=*(tloci[l]);
       if ((loc.strand=='+' || loc.strand=='-') && t->strand!='.'&& loc.strand!=t->strand) continue;
-      if (t_start>loc.end) {
-           if (t->start-loc.start>GFF_MAX_LOCUS) break; //give up already
-           continue;
-      }
-      if (loc.start>t_end) {
-               //this should never be the case if nidx was found correctly
-               GMessage("Warning: qsearch_gloci found loc.start>t.end!(t=%s)\n", t->getID());
-               continue;
-      }
-
+      //loc could be extended by t, so take it out of the index until the merge is done
+      if (useIndex) gdata->loctree.Remove(&loc);
       if (loc.add_gfobj(t, dOvlSET)) {
          //will add this transcript to loc
          lfound++;
-         mrgloci.Add(l);
-         if (collapseRedundant && !noexon_gfs) {
-           //compare to every single transcript in this locus
-           for (int ti=0;ti<loc.rnas.Count();ti++) {
+         mrgloci.Add(&loc);
+         if (checkRedundancy) {
+           if (scanAll) {
+             //compare to every single transcript in this locus
+             for (int ti=0;ti<loc.rnas.Count();ti++) {
                  if (loc.rnas[ti]==t) continue;
-                 GTData* odata=(GTData*)(loc.rnas[ti]->uptr);
-                 //GMessage("  ..redundant check vs overlapping transcript %s\n",loc.rnas[ti]->getID());
-                 GffObj* container=NULL;
-                 if (odata->replaced_by==NULL &&
-                      (container=redundantTranscripts(*t, *(loc.rnas[ti])))!=NULL) {
-                     if (container==t) {
-                        odata->replaced_by=t;
-                        preserveContainedCDS(t, loc.rnas[ti]);
-                     }
-                     else {// t is being replaced by previously defined transcript
-                        tdata->replaced_by=loc.rnas[ti];
-                        preserveContainedCDS(loc.rnas[ti], t);
-                     }
+                 checkRedundant(t, tdata, loc.rnas[ti]);
+             }
+           }
+           else if (tcands.Count()*16>loc.rnas.Count()) {
+             //many candidates: just skip the unmarked transcripts
+             for (int ti=0;ti<loc.rnas.Count();ti++) {
+                 if (loc.rnas[ti]==t || ((GTData*)(loc.rnas[ti]->uptr))->flag==0) continue;
+                 checkRedundant(t, tdata, loc.rnas[ti]);
+             }
+           }
+           else {
+             //only the candidates in this locus, in the same order as in loc.rnas
+             GVec<int> ridx(tcands.Count());
+             for (int c=0;c<tcands.Count();c++) {
+                 if (((GTData*)(tcands[c]->uptr))->locus==&loc) {
+                     int r=rnaIndex(loc.rnas, tcands[c]);
+                     ridx.Add(r);
                  }
-           }//for each transcript in the exon-overlapping locus
+             }
+             ridx.Sort();
+             for (int r=0;r<ridx.Count();r++) {
+                 if (r>0 && ridx[r]==ridx[r-1]) continue; //found through more than one index
+                 checkRedundant(t, tdata, loc.rnas[ridx[r]]);
+             }
+           }
          } //if doCollapseRedundant
       } //overlapping locus
+      else if (useIndex) gdata->loctree.Add(&loc); //unchanged
   } //for each existing locus
   if (lfound==0) {
       //overlapping loci not found, create a locus with only this mRNA
-      int addidx=gdata->loci.Add(new GffLocus(t));
-      if (addidx<0) {
-         //should never be the case!
-         GMessage("  WARNING: new GffLocus(%s:%d-%d) not added!\n",t->getID(), t->start, t->end);
-      }
+      tloc=new GffLocus(t);
+      gdata->loci.Add(tloc);
+      if (useIndex) gdata->loctree.Add(tloc);
    }
    else { //found at least one overlapping locus
      lfound--;
-     int locidx=mrgloci[lfound];
-     GffLocus& loc=*(gdata->loci[locidx]);
-     //last locus index found is also the smallest index
+     tloc=mrgloci[lfound];
+     //last locus found is also the lowest one
      if (lfound>0) {
        //more than one loci found parenting this mRNA, merge loci
-       /* if (debug)
-          GMessage(" merging %d loci \n",lfound);
-       */
        for (int l=0;l<lfound;l++) {
-          int mlidx=mrgloci[l];
-          loc.addMerge(*(gdata->loci[mlidx]), t);
-          gdata->loci.Delete(mlidx); //highest indices first, so it's safe to remove
+          tloc->addMerge(*(mrgloci[l]), t);
+          //leave it in gdata->loci until packLoci(), no need to shift the list now
+          mrgloci[l]->merged=true;
        }
      }
-     int i=locidx;
-     while (i>0 && loc<*(gdata->loci[i-1])) {
-       //bubble down until it's in the proper order
-       i--;
-       gdata->loci.Swap(i,i+1);
-     }
+     if (useIndex) gdata->loctree.Add(tloc);
   }//found at least one overlapping locus
-  return true;
+  if (checkRedundancy) {
+     for (int c=0;c<tcands.Count();c++)
+        ((GTData*)(tcands[c]->uptr))->flag=0;
+     indexRedundancy(t, gdata);
+  }
+  return tloc;
 }
 
-void collectLocusData(GList<GenomicSeqData>& ref_data, bool covInfo) {
-	int locus_num=0;
-	for (int g=0;g<ref_data.Count();g++) {
-		GenomicSeqData* gdata=ref_data[g];
-		for (int l=0;l<gdata->loci.Count();l++) {
-			GffLocus& loc=*(gdata->loci[l]);
-			GHash<int> gnames(true); //gene names in this locus
-			//GHash<int> geneids(true); //Entrez GeneID: numbers
-			GHash<int> geneids(true);
-			int fstrand=0,rstrand=0,ustrand=0;
-			for (int i=0;i<loc.rnas.Count();i++) {
-				GffObj& t=*(loc.rnas[i]);
-				char tstrand=(char) T_OSTRAND(t.udata);
-				if (tstrand==0) tstrand=t.strand;
-				if (tstrand=='+') fstrand++;
-				 else if (tstrand=='-') rstrand++;
-				   else ustrand++;
-				GStr gname(t.getGeneName());
+//LSD radix sort of n packed 64-bit keys, 8 bits per pass;
+//the passes where all keys share the same digit are skipped
+static void radixSortKeys(uint64* keys, int n) {
+  if (n<2) return;
+  int* counts=NULL;
+  GCALLOC(counts, 8*256*sizeof(int));
+  for (int i=0;i<n;i++) {
+    uint64 k=keys[i];
+    for (int d=0;d<8;d++)
+      counts[(d<<8)+((k>>(d<<3)) & 0xFF)]++;
+  }
+  uint64* buf=NULL;
+  GMALLOC(buf, n*sizeof(uint64));
+  uint64* src=keys;
+  uint64* dest=buf;
+  for (int d=0;d<8;d++) {
+    int* c=counts+(d<<8);
+    int shift=d<<3;
+    if (c[(src[0]>>shift) & 0xFF]==n) continue; //same digit everywhere
+    int pos=0;
+    for (int b=0;b<256;b++) {
+      int bc=c[b];
+      c[b]=pos;
+      pos+=bc;
+    }
+    for (int i=0;i<n;i++)
+      dest[c[(src[i]>>shift) & 0xFF]++]=src[i];
+    Gswap(src, dest);
+  }
+  if (src!=keys) memcpy(keys, src, n*sizeof(uint64));
+  GFREE(buf);
+  GFREE(counts);
+}
+
+//batch clustering of the records queued in gdata->pending: they are sorted
+//once by start coordinate (ties kept in loading order) and then swept,
+//so only the loci still reaching the current record have to be checked
+//(this gives the same loci as calling placeGf() for each record in turn)
+void GffLoader::sweepPending(GenomicSeqData* gdata) {
+  int n=gdata->pending.Count();
+  uint64* keys=NULL;
+  GMALLOC(keys, n*sizeof(uint64));
+  for (int i=0;i<n;i++)
+    keys[i]=(((uint64)gdata->pending[i]->start)<<32) | (uint64)i;
+  radixSortKeys(keys, n);
+  GPVec<GffLocus> active(false); //loci which may still overlap upcoming records
+  GPVec<GffLocus> tloci(false);
+  for (int k=0;k<n;k++) {
+    GffObj* t=gdata->pending[(int)(keys[k] & 0xFFFFFFFF)];
+    GTData* tdata=NULL;
+    bool noexon_gfs=false;
+    if (!storeGf(t, gdata, tdata, noexon_gfs)) {
+      t->isUsed(false);
+      continue;
+    }
+    uint t_start=0, t_end=0;
+    locusSpan(t, t_start, t_end);
+    //t_start never decreases, so loci ending before it can be retired
+    tloci.Clear();
+    int j=0;
+    for (int a=0;a<active.Count();a++) {
+      GffLocus* loc=active[a];
+      if (loc->merged || loc->end<t_start) continue;
+      active.Put(j, loc);
+      j++;
+      tloci.Add(loc);
+    }
+    active.setCount(j);
+    if (tloci.Count()>1) tloci.Sort(gloc_cmpRevLoc);
+    GffLocus* loc=addToLoci(t, tdata, noexon_gfs, gdata, tloci, false);
+    if (tloci.IndexOf(loc)<0) active.Add(loc); //new locus
+  }
+  GFREE(keys);
+}
+
+static int cmpRegions(const pointer p1, const pointer p2) {
+  GffRegion& r1=*(GffRegion*)p1;
+  GffRegion& r2=*(GffRegion*)p2;
+  if (r1.start!=r2.start) return (r1.start<r2.start) ? -1 : 1;
+  if (r1.end!=r2.end) return (r1.end<r2.end) ? -1 : 1;
+  return 0;
+}
+
+//BED input: <seqname> <start> <end> [<name> ..] with 0-based start;
+//regions without a name are named <seqname>:<start>-<end> (1-based)
+int GffRegions::load(const char* fname) {
+  GLineReader lr(fname);
+  char* line=NULL;
+  GDynArray<char*> t;
+  int added=0;
+  while ((line=lr.nextLine())!=NULL) {
+    if (line[0]==0 || line[0]=='#' || startsWith(line, "track") ||
+        startsWith(line, "browser")) continue;
+    int nt=strsplit(line, t, '\t');
+    uint rstart=0, rend=0;
+    if (nt<3 || !strToUInt(t[1], rstart) || !strToUInt(t[2], rend) || rend<=rstart)
+      GError("Error parsing BED region at line %d of %s!\n", lr.readcount(), fname);
+    rstart++;
+    GStr rname;
+    if (nt>3 && t[3][0]!=0) rname=t[3];
+    else {
+      rname=t[0];
+      rname.appendfmt(":%u-%u", rstart, rend);
+    }
+    GPVec<GffRegion>* rlst=seqs.Find(t[0]);
+    if (rlst==NULL) {
+      rlst=new GPVec<GffRegion>(true);
+      seqs.Add(t[0], rlst);
+    }
+    rlst->Add(new GffRegion(rstart, rend, rname.chars()));
+    added++;
+  }
+  GPVec<GffRegion>* rlst=NULL;
+  seqs.startIterate();
+  while ((rlst=seqs.NextData())!=NULL)
+    rlst->Sort(cmpRegions);
+  count+=added;
+  return added;
+}
+
+int GffRegions::join(const char* gseq, GPVec<GffObj>& recs) {
+  int n=recs.Count();
+  GPVec<GffRegion>* rlst=(gseq==NULL) ? NULL : seqs.Find(gseq);
+  if (rlst==NULL) {
+    for (int i=0;i<n;i++) recs[i]->isUsed(false);
+    recs.Clear();
+    return 0;
+  }
+  GPVec<GffRegion>& rgs=*rlst;
+  uint64* keys=NULL;
+  GMALLOC(keys, n*sizeof(uint64));
+  for (int i=0;i<n;i++)
+    keys[i]=(((uint64)recs[i]->start)<<32) | (uint64)i;
+  radixSortKeys(keys, n);
+  bool* keep=NULL;
+  GCALLOC(keep, n*sizeof(bool));
+  GPVec<GffRegion> active(false); //regions starting before the current record, ending after its start
+  int r=0; //next region to activate
+  GStr rnames;
+  for (int k=0;k<n;k++) {
+    int i=(int)(keys[k] & 0xFFFFFFFF);
+    GffObj* t=recs[i];
+    while (r<rgs.Count() && rgs[r]->start<=t->start) {
+      active.Add(rgs[r]);
+      r++;
+    }
+    int j=0;
+    for (int a=0;a<active.Count();a++) {
+      if (active[a]->end<t->start) continue;
+      active.Put(j, active[a]);
+      j++;
+    }
+    active.setCount(j);
+    rnames.clear();
+    for (int a=0;a<active.Count();a++) {
+      if (!rnames.is_empty()) rnames.append(',');
+      rnames.append(active[a]->name);
+    }
+    //regions starting within the record span
+    for (int q=r;q<rgs.Count() && rgs[q]->start<=t->end;q++) {
+      if (!rnames.is_empty()) rnames.append(',');
+      rnames.append(rgs[q]->name);
+    }
+    if (rnames.is_empty()) continue;
+    t->addAttr("regions", rnames.chars());
+    keep[i]=true;
+  }
+  int kept=0;
+  for (int i=0;i<n;i++) {
+    if (keep[i]) {
+      recs.Put(kept, recs[i]);
+      kept++;
+    }
+    else recs[i]->isUsed(false);
+  }
+  recs.setCount(kept);
+  GFREE(keep);
+  GFREE(keys);
+  return kept;
+}
+
+struct GSeqDataJobs {
+	GList<GenomicSeqData>* seqdata;
+	GVec<int> order; //seqdata indexes, largest first
+	GSeqDataProc* proc;
+	void* udata;
+	GSeqDataJobs(GList<GenomicSeqData>& sd, GSeqDataProc* p, void* u):seqdata(&sd),
+			order(sd.Count()), proc(p), udata(u) { }
+};
+
+struct GSeqWorkload {
+	int idx; //index in the seqdata list
+	int count; //number of records on this genomic sequence
+};
+
+static int cmpGSeqWorkload(const pointer p1, const pointer p2) {
+	int w1=((GSeqWorkload*)p1)->count;
+	int w2=((GSeqWorkload*)p2)->count;
+	if (w1!=w2) return (w1>w2) ? -1 : 1;
+	return ((GSeqWorkload*)p1)->idx-((GSeqWorkload*)p2)->idx;
+}
+
+static void gseqRange(int from, int to, void* p) {
+	GSeqDataJobs& jobs=*(GSeqDataJobs*)p;
+	for (int i=from;i<to;i++)
+		(*jobs.proc)(jobs.seqdata->Get(jobs.order[i]), jobs.udata);
+}
+
+void forEachGSeqData(GList<GenomicSeqData>& seqdata, GSeqDataProc* proc, void* udata, int numThreads) {
+	GThreadPool& pool=GThreadPool::global();
+	if (numThreads<=1 || pool.size()<=1 || seqdata.Count()<=1) {
+		for (int g=0;g<seqdata.Count();g++)
+			(*proc)(seqdata[g], udata);
+		return;
+	}
+	GSeqDataJobs jobs(seqdata, proc, udata);
+	GVec<GSeqWorkload> bysize(seqdata.Count());
+	for (int g=0;g<seqdata.Count();g++) {
+		GenomicSeqData* gdata=seqdata[g];
+		GSeqWorkload w;
+		w.idx=g;
+		w.count=gdata->pending.Count()+gdata->rnas.Count()+gdata->gfs.Count();
+		bysize.Add(w);
+	}
+	bysize.Sort(cmpGSeqWorkload);
+	for (int i=0;i<bysize.Count();i++)
+		jobs.order.Add(bysize[i].idx);
+	//one genomic sequence per task, as their sizes can be very different
+	pool.parallel_for(0, jobs.order.Count(), gseqRange, (void*) &jobs, 1);
+}
+
+static void collectGSeqLoci(GenomicSeqData* gdata, void* udata) {
+	bool covInfo=*(bool*)udata;
+	GTraceSpan tspan("locus data", "gff", gdata->gseq_name);
+	for (int l=0;l<gdata->loci.Count();l++) {
+		GffLocus& loc=*(gdata->loci[l]);
+		GHash<int> gnames(true); //gene names in this locus
+		//GHash<int> geneids(true); //Entrez GeneID: numbers
+		GHash<int> geneids(true);
+		int fstrand=0,rstrand=0,ustrand=0;
+		for (int i=0;i<loc.rnas.Count();i++) {
+			GffObj& t=*(loc.rnas[i]);
+			char tstrand=(char) T_OSTRAND(t.udata);
+			if (tstrand==0) tstrand=t.strand;
+			if (tstrand=='+') fstrand++;
+			 else if (tstrand=='-') rstrand++;
+			   else ustrand++;
+			GStr gname(t.getGeneName());
+			if (!gname.is_empty()) {
+				gname.upper();
+				int* prevg=gnames.Find(gname.chars());
+				if (prevg!=NULL) (*prevg)++;
+				else gnames.Add(gname, new int(1));
+			}
+			GStr geneid(t.getGeneID());
+			if (!geneid.is_empty())
+				geneids.Add(geneid.chars());
+			//parse GeneID xrefs, if any (RefSeq):
+			/*
+			GStr xrefs(t.getAttr("xrefs"));
+			if (!xrefs.is_empty()) {
+				xrefs.startTokenize(",");
+				GStr token;
+				while (xrefs.nextToken(token)) {
+					token.upper();
+					if (token.startsWith("GENEID:")) {
+						token.cut(0,token.index(':')+1);
+						int* prevg=geneids.Find(token.chars());
+						if (prevg!=NULL) (*prevg)++;
+						else geneids.Add(token, new int(1));
+					}
+				} //for each xref
+			} //xrefs parsing
+			*/
+		}//for each transcript
+            if ((fstrand>0 && rstrand>0) ||
+            		 (fstrand==0 && rstrand==0)) loc.strand='.';
+            else if (fstrand==0 && rstrand>0) loc.strand='-';
+            else loc.strand='+';
+		for (int i=0;i<loc.gfs.Count();i++) {
+			GffObj& nt=*(loc.gfs[i]);
+			if (nt.isGene()) {
+				GStr gname(nt.getGeneName());
 				if (!gname.is_empty()) {
 					gname.upper();
 					int* prevg=gnames.Find(gname.chars());
 					if (prevg!=NULL) (*prevg)++;
 					else gnames.Add(gname, new int(1));
 				}
-				GStr geneid(t.getGeneID());
-				if (!geneid.is_empty())
-					geneids.Add(geneid.chars());
-				//parse GeneID xrefs, if any (RefSeq):
-				/*
-				GStr xrefs(t.getAttr("xrefs"));
-				if (!xrefs.is_empty()) {
-					xrefs.startTokenize(",");
-					GStr token;
-					while (xrefs.nextToken(token)) {
-						token.upper();
-						if (token.startsWith("GENEID:")) {
-							token.cut(0,token.index(':')+1);
-							int* prevg=geneids.Find(token.chars());
-							if (prevg!=NULL) (*prevg)++;
-							else geneids.Add(token, new int(1));
-						}
-					} //for each xref
-				} //xrefs parsing
-				*/
-			}//for each transcript
-            if ((fstrand>0 && rstrand>0) ||
-            		 (fstrand==0 && rstrand==0)) loc.strand='.';
-            else if (fstrand==0 && rstrand>0) loc.strand='-';
-            else loc.strand='+';
-			for (int i=0;i<loc.gfs.Count();i++) {
-				GffObj& nt=*(loc.gfs[i]);
-				if (nt.isGene()) {
-					GStr gname(nt.getGeneName());
-					if (!gname.is_empty()) {
-						gname.upper();
-						int* prevg=gnames.Find(gname.chars());
+				GStr geneid(nt.getID());
+				if (!geneid.is_empty()) {
+					geneids.Add(geneid.chars(), new int(1));
+				}
+			}
+			//parse GeneID xrefs, if any (RefSeq):
+			/*
+			GStr xrefs(nt.getAttr("xrefs"));
+			if (!xrefs.is_empty()) {
+				xrefs.startTokenize(",");
+				GStr token;
+				while (xrefs.nextToken(token)) {
+					token.upper();
+					if (token.startsWith("GENEID:")) {
+						token.cut(0,token.index(':')+1);
+						int* prevg=geneids.Find(token.chars());
 						if (prevg!=NULL) (*prevg)++;
-						else gnames.Add(gname, new int(1));
+						else geneids.Add(token, new int(1));
 					}
-					GStr geneid(nt.getID());
-					if (!geneid.is_empty()) {
-						geneids.Add(geneid.chars(), new int(1));
-					}
-				}
-				//parse GeneID xrefs, if any (RefSeq):
-				/*
-				GStr xrefs(nt.getAttr("xrefs"));
-				if (!xrefs.is_empty()) {
-					xrefs.startTokenize(",");
-					GStr token;
-					while (xrefs.nextToken(token)) {
-						token.upper();
-						if (token.startsWith("GENEID:")) {
-							token.cut(0,token.index(':')+1);
-							int* prevg=geneids.Find(token.chars());
-							if (prevg!=NULL) (*prevg)++;
-							else geneids.Add(token, new int(1));
-						}
-					} //for each xref
-				} //xrefs parsing
-				*/
-			}//for each non-transcript (genes?)
-			if (covInfo) {
-				for (int m=0;m<loc.mexons.Count();m++) {
-					if (loc.strand=='+')
-						gdata->f_bases+=loc.mexons[m].len();
-					else if (loc.strand=='-')
-						gdata->r_bases+=loc.mexons[m].len();
-					else gdata->u_bases+=loc.mexons[m].len();
-				}
+				} //for each xref
+			} //xrefs parsing
+			*/
+		}//for each non-transcript (genes?)
+		if (covInfo) {
+			for (int m=0;m<loc.mexons.Count();m++) {
+				if (loc.strand=='+')
+					gdata->f_bases+=loc.mexons[m].len();
+				else if (loc.strand=='-')
+					gdata->r_bases+=loc.mexons[m].len();
+				else gdata->u_bases+=loc.mexons[m].len();
 			}
-			locus_num++;
-			loc.locus_num=locus_num;
-			if (gnames.Count()>0) { //collect all gene names associated to this locus
-				gnames.startIterate();
-				int* gfreq=NULL;
-				char* key=NULL;
-				while ((gfreq=gnames.NextData(key))!=NULL) {
-					loc.gene_names.AddIfNew(new CGeneSym(key,*gfreq));
-				}
-			} //added collected gene_names
-			if (geneids.Count()>0) { //collect all GeneIDs names associated to this locus
-				geneids.startIterate();
-				int* gfreq=NULL;
-				char* key=NULL;
-				while ((gfreq=geneids.NextData(key))!=NULL) {
-					loc.gene_ids.AddIfNew(new CGeneSym(key,*gfreq));
-				}
+		}
+		if (gnames.Count()>0) { //collect all gene names associated to this locus
+			gnames.startIterate();
+			int* gfreq=NULL;
+			char* key=NULL;
+			while ((gfreq=gnames.NextData(key))!=NULL) {
+				loc.gene_names.AddIfNew(new CGeneSym(key,*gfreq));
+			}
+		} //added collected gene_names
+		if (geneids.Count()>0) { //collect all GeneIDs names associated to this locus
+			geneids.startIterate();
+			int* gfreq=NULL;
+			char* key=NULL;
+			while ((gfreq=geneids.NextData(key))!=NULL) {
+				loc.gene_ids.AddIfNew(new CGeneSym(key,*gfreq));
 			}
-		} //for each locus
-	}//for each genomic sequence
+		}
+	} //for each locus
+}
+
+void collectLocusData(GList<GenomicSeqData>& ref_data, bool covInfo, int numThreads) {
+	forEachGSeqData(ref_data, collectGSeqLoci, &covInfo, numThreads);
+	//locus numbering follows the genomic sequence order, regardless of threading
+	int locus_num=0;
+	for (int g=0;g<ref_data.Count();g++) {
+		GenomicSeqData* gdata=ref_data[g];
+		for (int l=0;l<gdata->loci.Count();l++) {
+			locus_num++;
+			gdata->loci[l]->locus_num=locus_num;
+		}
+	}
 }
 
 void GffLoader::loadRefNames(GStr& flst) {
@@ -687,13 +1093,100 @@ void GffLoader::loadRefNames(GStr& flst) {
 	}
 }
 
-GenomicSeqData* getGSeqData(GList<GenomicSeqData>& seqdata, int gseq_id) {
+static void indexRefSeq(GenomicSeqData* gdata, void* udata) {
+	GffCmpRef& cref=*(GffCmpRef*)udata;
+	GffRefSeq* rseq=cref.seqidx.Find(gdata->gseqId());
+	for (int i=0;i<gdata->rnas.Count();i++)
+		if (gdata->rnas[i]->exons.Count()>0)
+			rseq->add(gdata->rnas[i]);
+}
+
+int GffCmpRef::load(const char* fname, int numThreads) {
+	GffLoader refloader;
+	GStr rfname(fname);
+	refloader.openFile(rfname);
+	refloader.load(refdata);
+	int numrefs=0;
+	//the per strand indexes are built in parallel, but created here
+	//so the worker threads only read seqidx
+	for (int g=0;g<refdata.Count();g++) {
+		seqidx.Add(refdata[g]->gseqId(), new GffRefSeq());
+		numrefs+=refdata[g]->rnas.Count();
+	}
+	forEachGSeqData(refdata, indexRefSeq, this, numThreads);
+	return numrefs;
+}
+
+void GffCmpRef::classify(int gseq_id, GPVec<GffObj>& qrecs) {
+	GffRefSeq* rseq=seqidx.Find(gseq_id);
+	GPVec<GffObj> rovl(false);
+	for (int i=0;i<qrecs.Count();i++) {
+		GffObj& m=*qrecs[i];
+		if (!m.isTranscript() || m.exons.Count()==0) continue;
+		GffObj* bref=NULL; //best matching reference transcript
+		char bcode=0;
+		int brank=0, bovlen=0, blendiff=0;
+		if (rseq!=NULL) {
+			//same strand (or unknown strand) overlaps first
+			rovl.Clear();
+			if (m.strand!='-') rseq->fwd.findOverlaps(m.start, m.end, rovl);
+			if (m.strand!='+') rseq->rev.findOverlaps(m.start, m.end, rovl);
+			rseq->unk.findOverlaps(m.start, m.end, rovl);
+			for (int j=0;j<rovl.Count();j++) {
+				GffObj& r=*rovl[j];
+				int ovlen=0; //not always computed by getOvlCode()
+				char c=getOvlCode(m, r, ovlen, strictMatch);
+				if (c==0) continue;
+				ovlen=m.exonOverlapLen(r);
+				int rank=classcode_rank(c);
+				int lendiff=abs(r.covlen-m.covlen);
+				if (bref==NULL || rank<brank || (rank==brank && (ovlen>bovlen ||
+						(ovlen==bovlen && (lendiff<blendiff ||
+						 (lendiff==blendiff && gfo_cmpByLoc(&r, bref)<0)))))) {
+					bref=&r;
+					bcode=c;
+					brank=rank;
+					bovlen=ovlen;
+					blendiff=lendiff;
+				}
+			}
+			if (bref==NULL && (m.strand=='+' || m.strand=='-')) {
+				//exon overlap on the opposite strand only
+				rovl.Clear();
+				if (m.strand=='+') rseq->rev.findOverlaps(m.start, m.end, rovl);
+				else rseq->fwd.findOverlaps(m.start, m.end, rovl);
+				for (int j=0;j<rovl.Count();j++) {
+					GffObj& r=*rovl[j];
+					int ovlen=m.exonOverlapLen(r);
+					if (ovlen==0) continue;
+					if (bref==NULL || ovlen>bovlen ||
+							(ovlen==bovlen && gfo_cmpByLoc(&r, bref)<0)) {
+						bref=&r;
+						bcode='x';
+						bovlen=ovlen;
+					}
+				}
+			}
+		}
+		if (bref==NULL) {
+			m.addAttr("class_code", "u");
+			continue;
+		}
+		m.addAttr("cmp_ref", bref->getID());
+		char cc[2]={bcode, 0};
+		m.addAttr("class_code", cc);
+		GStr ovl(bovlen);
+		m.addAttr("ovl_len", ovl.chars());
+	}
+}
+
+GenomicSeqData* getGSeqData(GList<GenomicSeqData>& seqdata, int gseq_id, GffNames* names) {
 	int i=-1;
 	GenomicSeqData f(gseq_id);
 	GenomicSeqData* gdata=NULL;
 	if (seqdata.Found(&f,i)) gdata=seqdata[i];
 	else { //entry not created yet for this genomic seq
-		gdata=new GenomicSeqData(gseq_id);
+		gdata=new GenomicSeqData(gseq_id, names);
 		seqdata.Add(gdata);
 	}
 	return gdata;
@@ -703,49 +1196,112 @@ void warnPseudo(GffObj& m) {
 	GMessage("Info: pseudo gene/transcript record with ID=%s discarded.\n",m.getID());
 }
 
-void GffLoader::load(GList<GenomicSeqData>& seqdata, GFValidateFunc* gf_validate, GFFCommentParser* gf_parsecomment) {
+static void placePending(GenomicSeqData* gdata, void* udata) {
+	GffLoader& loader=*(GffLoader*)udata;
+	GTraceSpan tspan("cluster", "gff", gdata->gseq_name);
+	gdata->beginBulk(loader.trAdoption);
+	if (loader.regions!=NULL)
+		loader.regions->join(gdata->gseq_name, gdata->pending);
+	if (loader.cmpRef!=NULL)
+		loader.cmpRef->classify(gdata->gseqId(), gdata->pending);
+	//sweeping needs all the records of this genomic sequence, so loci
+	//already built from a previous input file are extended incrementally
+	if (loader.doCluster && loader.batchCluster && gdata->loci.Count()==0)
+		loader.sweepPending(gdata);
+	else {
+		if (gdata->loctree.Count()==0) //loci were built by sweeping, not indexed yet
+			for (int l=0;l<gdata->loci.Count();l++)
+				gdata->loctree.Add(gdata->loci[l]);
+		for (int i=0;i<gdata->pending.Count();i++) {
+			GffObj* m=gdata->pending[i];
+			if (!loader.placeGf(m, gdata))
+				m->isUsed(false);
+		}
+	}
+	gdata->pending.Clear();
+	gdata->endBulk();
+	if (loader.doCluster) gdata->packLoci();
+}
+
+void GffLoader::load(GList<GenomicSeqData>& seqdata, GFValidateFunc* gf_validate, GFFCommentParser* gf_parsecomment,
+		void* udata) {
 	if (f==NULL) GError("Error: GffLoader::load() cannot be called before ::openFile()!\n");
-	GffReader* gffr=new GffReader(f, this->transcriptsOnly, true); //not only mRNA features, sorted
+	GffStageTimer ftimer(gstFinalize);
+	GTraceSpan tspan("load", "gff", fname.chars());
+	GffReader* gffr=new GffReader(f, this->transcriptsOnly, true, names); //not only mRNA features, sorted
 	clearHeaderLines();
 	gffr->showWarnings(verbose);
 	//           keepAttrs   mergeCloseExons  noExonAttr
 	gffr->gene2Exon(gene2exon);
 	if (BEDinput) gffr->isBED(true);
+	if (GBKinput) {
+		gffr->isGBK(true);
+		gffr->gbkSeqs=seqdb;
+	}
 	//if (TLFinput) gffr->isTLF(true);
 	gffr->mergeCloseExons(mergeCloseExons);
 	gffr->keepAttrs(fullAttributes, gatherExonAttrs, keep_AllExonAttrs);
 	gffr->keepGenes(keepGenes);
 	gffr->setIgnoreLocus(ignoreLocus);
 	gffr->setRefAlphaSorted(this->sortRefsAlpha);
-	if (keepGff3Comments && gf_parsecomment!=NULL) gffr->setCommentParser(gf_parsecomment);
-	gffr->readAll();
+	if (keepGff3Comments && gf_parsecomment!=NULL) gffr->setCommentParser(gf_parsecomment, udata);
+	GLinePipe* lpipe=NULL;
+	if (pipeInput && !GBKinput) {
+		lpipe=new GLinePipe(f);
+		lpipe->start();
+		gffr->setLinePipe(lpipe);
+	}
+	uint64_t t0=gthreads_clock_ns();
+	{
+		GffStageTimer ptimer(gstParse);
+		gffr->readAll();
+	}
+	if (gffStats.enabled) {
+		off_t fsize=gffr->getFilePos();
+		if (fsize==0) fsize=ftello(f); //GenBank input
+		gffStats.addInput(fsize>0 ? (uint64)fsize : 0);
+	}
+	if (lpipe!=NULL) {
+		if (verbose) {
+			double secs=(gthreads_clock_ns()-t0)/1e9;
+			GMessage("Input pipeline stages:\n");
+			lpipe->printStats(stderr);
+			GMessage("  %-16s %llu lines parsed in %.3f s (%.0f lines/s)\n", "parser",
+					(unsigned long long)lpipe->lineCount(), secs, secs>0 ? lpipe->lineCount()/secs : 0.0);
+		}
+		gffr->setLinePipe(NULL);
+		delete lpipe;
+	}
 	GVec<int> pseudoFeatureIds; //feature type: pseudo*
 	GVec<int> pseudoAttrIds;  // attribute: [is]pseudo*=true/yes/1
 	GVec<int> pseudoTypeAttrIds;  // attribute: *_type=pseudo*
 
 	if (this->noPseudo) {
-		GffNameList& fnames = GffObj::names->feats; //gffr->names->feats;
+		GffNameList& fnames = names->feats;
 		for (int i=0;i<fnames.Count();i++) {
-			char* n=fnames[i]->name;
+			char* n=fnames.Get(i)->name;
 			if (startsWith(n, "pseudo")) {
-				pseudoFeatureIds.Add(fnames[i]->idx);
+				pseudoFeatureIds.Add(fnames.Get(i)->idx);
 			}
 		}
-		GffNameList& attrnames = GffObj::names->attrs;//gffr->names->attrs;
+		GffNameList& attrnames = names->attrs;
 		for (int i=0;i<attrnames.Count();i++) {
-			char* n=attrnames[i]->name;
+			char* n=attrnames.Get(i)->name;
 			if (endsiWith(n, "type")) {
-				pseudoTypeAttrIds.Add(attrnames[i]->idx);
+				pseudoTypeAttrIds.Add(attrnames.Get(i)->idx);
 			}// else {
 			char* p=strifind(n, "pseudo");
 			if (p==n || (p==n+2 && tolower(n[0])=='i' && tolower(n[1])=='s') ||
 					(p==n+3 && startsiWith(n, "is_")) ) {
-				pseudoAttrIds.Add(attrnames[i]->idx);
+				pseudoAttrIds.Add(attrnames.Get(i)->idx);
 			}
 			//}
 		}
 	}
 
+	//clustering is done per genomic sequence after loading (in parallel if requested),
+	//unless the incremental clustering was requested
+	bool queuePlace=(doCluster && (batchCluster || numThreads>1)) || regions!=NULL || cmpRef!=NULL;
 	//int redundant=0; //redundant annotation discarded
 	if (verbose) GMessage("   .. loaded %d genomic features from %s\n", gffr->gflst.Count(), fname.chars());
 	//int rna_deleted=0;
@@ -807,11 +1363,16 @@ void GffLoader::load(GList<GenomicSeqData>& seqdata, GFValidateFunc* gf_validate
 			m->subftype_id=gff_fid_exon;
 		}
 		//GList<GffObj> gfadd(false,false); -- for gf_validate()?
-		if (gf_validate!=NULL && !(*gf_validate)(m, NULL)) {
+		if (gf_validate!=NULL && !(*gf_validate)(m, NULL, udata)) {
 			continue;
 		}
 		m->isUsed(true); //so the gffreader won't destroy it
-		GenomicSeqData* gdata=getGSeqData(seqdata, m->gseq_id);
+		GenomicSeqData* gdata=getGSeqData(seqdata, m->gseq_id, names);
+		if (queuePlace) {
+			gdata->pending.Add(m);
+			continue;
+		}
+		if (!gdata->rnas.inBulk()) gdata->beginBulk(trAdoption);
 		bool keep=placeGf(m, gdata);
 		if (!keep) {
 			m->isUsed(false);
@@ -819,6 +1380,29 @@ void GffLoader::load(GList<GenomicSeqData>& seqdata, GFValidateFunc* gf_validate
 			//GMessage("Feature %s(%d-%d) is going to be discarded..\n",m->getID(), m->start, m->end);
 		}
 	} //for each read gffObj
+	if (queuePlace) {
+		//attribute names that placeGf() may add must be in the shared dictionary
+		//already, so the worker threads only read it
+		if (trAdoption && numThreads>1) {
+			names->attrs.addName("Name");
+			names->attrs.addName("gene_name");
+			names->attrs.addName("geneID");
+		}
+		if (regions!=NULL) names->attrs.addName("regions");
+		if (cmpRef!=NULL) {
+			names->attrs.addName("cmp_ref");
+			names->attrs.addName("class_code");
+			names->attrs.addName("ovl_len");
+		}
+		GffStageTimer ctimer(gstCluster);
+		forEachGSeqData(seqdata, placePending, this, numThreads);
+	}
+	else {
+		for (int g=0;g<seqdata.Count();g++) {
+			seqdata[g]->endBulk();
+			if (doCluster) seqdata[g]->packLoci();
+		}
+	}
 	//if (verbose) GMessage("  .. %d records from %s clustered into loci.\n", gffr->gflst.Count(), fname.chars());
 	//if (f && f!=stdin) { fclose(f); f=NULL; }
 	delete gffr;
@@ -3,11 +3,14 @@
 #include "gff.h"
 #include "GStr.h"
 #include "GFaSeqGet.h"
+#include "GIntHash.hh"
+#include "GIntervalTree.hh"
 
 extern bool verbose;
 extern bool debugMode;
 
-typedef bool GFValidateFunc(GffObj* gf, GList<GffObj>* gfadd);
+//udata is the pointer given to GffLoader::load()
+typedef bool GFValidateFunc(GffObj* gf, GList<GffObj>* gfadd, void* udata);
 
 //test if a transcript should be printed (and not printed yet)
 #define T_PRINTABLE(d) (((d) & 0x100)==0)
@@ -46,7 +49,7 @@ class GeneInfo { //for Ensembl GTF conversion
      }
 
    void create_gf(GffObj* gfrec, bool ensembl_convert) {
-     gf=new GffObj(gfrec->getGeneID());
+     gf=new GffObj(gfrec->names, gfrec->getGeneID());
      gf->gseq_id=gfrec->gseq_id;
      gf->track_id=gfrec->track_id;
      gf->start=gfrec->start;
@@ -118,10 +121,10 @@ class GTData { //transcript associated data
    GffLocus* locus;
    GffObj* replaced_by;
    GeneInfo* geneinfo;
-   //int flag;
+   int flag; //scratch mark, e.g. for redundancy candidates
    GTData(GffObj* t=NULL) {
        rna=t;
-       //flag=0;
+       flag=0;
        locus=NULL;
        replaced_by=NULL;
        geneinfo=NULL;
@@ -163,6 +166,7 @@ public:
     GList<CGeneSym> gene_names;
     GList<CGeneSym> gene_ids;
     int v; //user flag/data
+    bool merged; //absorbed by another locus, to be discarded
    /*
    bool operator==(GffLocus& d){
        return (gseq_id==d.gseq_id && strand==d.strand && start==d.start && end==d.end);
@@ -211,16 +215,17 @@ public:
         end=0;
         strand=0;
         is_mrna=false;
+        merged=false;
 
         if (t!=NULL) {
            GSeg seg;
            bool is_t=(t->exons.Count()>0);
            if (is_t) {
-             start=t->exons.First()->start;
-             end=t->exons.Last()->end;
+             start=t->exons.First().start;
+             end=t->exons.Last().end;
              for (int i=0;i<t->exons.Count();i++) {
-               seg.start=t->exons[i]->start;
-               seg.end=t->exons[i]->end;
+               seg.start=t->exons[i].start;
+               seg.end=t->exons[i].end;
                mexons.Add(seg);
              }
              rnas.Add(t);
@@ -332,6 +337,19 @@ public:
             t_maxcov=locus.t_maxcov;
     }
 
+    //index of the first merged exon ending at or after x
+    //(mexons do not overlap, so their end coordinates are sorted as well)
+    int mexonIdx(uint x) {
+        int l=0;
+        int h=mexons.Count()-1;
+        while (l<=h) {
+            int i=(l+h)>>1;
+            if (mexons[i].end<x) l=i+1;
+            else h=i-1;
+        }
+        return l;
+    }
+
     bool add_gfobj(GffObj* t, bool adj) {
         //if (rnas.Count()==0) return true; //? should never be called on an empty locus
     	uint t_start=t->start;
@@ -347,17 +365,17 @@ public:
         bool hasovl=false;
         if (t->exons.Count()>0) { //transcript-like entity
         	if (adj) {
-        		t->exons.First()->start--;
-        		t->exons.Last()->end++;
+        		t->exons.First().start--;
+        		t->exons.Last().end++;
         	}
-			int i=0; //index of first mexons with a merge
+			int i=mexonIdx(t->exons.First().start); //index of first mexons with a merge
 			int j=0; //index current t exon
 			GArray<int> ovlexons(true,true); //list of mrna exon indexes overlapping mexons
 			while (i<mexons.Count() && j<t->exons.Count()) {
 				uint istart=mexons[i].start;
 				uint iend=mexons[i].end;
-				uint jstart=t->exons[j]->start;
-				uint jend=t->exons[j]->end;
+				uint jstart=t->exons[j].start;
+				uint jend=t->exons[j].end;
 				if (iend<jstart) { i++; continue; }
 				if (jend<istart) { j++; continue; }
 				//exon overlap found if we're here:
@@ -381,15 +399,15 @@ public:
 				j++; //check the next t exon
 			}//all vs all exon check loop
         	if (adj) {
-        		t->exons.First()->start++;
-        		t->exons.Last()->end--;
+        		t->exons.First().start++;
+        		t->exons.Last().end--;
         	}
 	        if (hasovl) {
 	            GSeg seg;
 	             //add the rest of the non-overlapping exons
 	            for (int i=0;i<t->exons.Count();i++) {
-	                seg.start=t->exons[i]->start;
-	                seg.end=t->exons[i]->end;
+	                seg.start=t->exons[i].start;
+	                seg.end=t->exons[i].end;
 	                if (!ovlexons.Exists(i)) mexons.Add(seg);
 	            }
 	            t_add(t);
@@ -401,7 +419,7 @@ public:
         	//gene overlap check
 			uint jstart=t->start;
 			uint jend=t->end;
-        	for (int i=0;i<mexons.Count();++i) {
+        	for (int i=mexonIdx(jstart);i<mexons.Count();++i) {
 				uint istart=mexons[i].start;
 				uint iend=mexons[i].end;
 				if (iend<jstart) continue;
@@ -459,17 +477,39 @@ class GenomicSeqData {
   GList<GffObj> gfs; //all non-transcript features -> usually gene features
   GList<GffObj> rnas; //all transcripts on this genomic sequence
   GList<GffLocus> loci; //all loci clusters
+  GIntervalTree<GffLocus> loctree; //overlap index of loci, used while clustering
+  GPVec<GffObj> pending; //records waiting for (parallel) placement into loci
+  //redundancy (-M) lookup of the transcripts placed in loci:
+  GIntHashP< GPVec<GffObj> > tchains; //multi-exon transcripts by intron chain hash
+  GIntHashP< GPVec<GffObj> > tintrons; //multi-exon transcripts by intron hash (-K)
+  GIntHashP< GPVec<GffObj> > tfirst; //multi-exon transcripts by first intron hash (-K)
+  GIntervalTree<GffObj> tsingle; //single-exon transcripts
   GList<GTData> tdata; //transcript data (uptr holder for all rnas loaded here)
   uint64 f_bases;//base coverage on forward strand
   uint64 r_bases;//base coverage on reverse strand
   uint64 u_bases;//base coverage on undetermined strand
   //GenomicSeqData(int gid=-1):rnas(true,true,false),loci(true,true,true),
-  GenomicSeqData(int gid=-1):gseq_id(gid), gseq_name(NULL), seqreg_start(0), seqreg_end(0),
-		  gfs(true, true, false),rnas((GCompareProc*)gfo_cmpByLoc),loci(true,true,false),
-		  tdata(false,true,false),  f_bases(0), r_bases(0), u_bases(0) {
-  if (gseq_id>=0)
-    gseq_name=GffObj::names->gseqs.getName(gseq_id);
+  GenomicSeqData(int gid=-1, GffNames* gnames=NULL):gseq_id(gid), gseq_name(NULL), seqreg_start(0), seqreg_end(0),
+		  gfs(true, true, false),rnas((GCompareProc*)gfo_cmpByLoc),loci(false,true,false), pending(false),
+		  tdata(false,true,false), f_bases(0), r_bases(0), u_bases(0) {
+  if (gseq_id>=0 && gnames!=NULL)
+    gseq_name=gnames->gseqs.getName(gseq_id);
+  }
+
+  int gseqId() { return gseq_id; }
+  //bulk loading of rnas and gfs (see GList::beginBulk()): the records are
+  //appended while loading and sorted once by endBulk(); gfs must be kept sorted
+  //if transcripts are to be adopted by genes loaded from a previous input file
+  void beginBulk(bool trAdoption) {
+    rnas.beginBulk();
+    if (!trAdoption || gfs.Count()==0) gfs.beginBulk();
+  }
+  void endBulk() {
+    rnas.endBulk();
+    gfs.endBulk();
   }
+  //drop the loci merged during clustering and sort the rest by location
+  void packLoci();
 
   bool operator==(GenomicSeqData& d){
     return gseq_id==d.gseq_id;
@@ -479,9 +519,18 @@ class GenomicSeqData {
   }
 };
 
+typedef void GSeqDataProc(GenomicSeqData* gdata, void* udata);
+
+//run proc on each genomic sequence, as tasks of the GThreadPool::global() pool
+//unless numThreads<=1; the larger sequences (by record count) are scheduled first
+void forEachGSeqData(GList<GenomicSeqData>& seqdata, GSeqDataProc* proc,
+		void* udata=NULL, int numThreads=1);
+
 int gseqCmpName(const pointer p1, const pointer p2);
+int gloc_cmpByLoc(const pointer p1, const pointer p2);
+int gloc_cmpRevLoc(const pointer p1, const pointer p2);
 
-GenomicSeqData* getGSeqData(GList<GenomicSeqData>& seqdata, int gseq_id);
+GenomicSeqData* getGSeqData(GList<GenomicSeqData>& seqdata, int gseq_id, GffNames* names);
 
 class GSpliceSite {
  public:
@@ -545,12 +594,64 @@ class GSpliceSite {
     }
 };
 
+class GffRegion: public GSeg {
+ public:
+  char* name;
+  GffRegion(uint rstart=0, uint rend=0, const char* rname=NULL):GSeg(rstart, rend),
+	  name(Gstrdup(rname)) { }
+  ~GffRegion() { GFREE(name); }
+};
+
+//query regions (--regions), loaded from a BED file
+class GffRegions {
+ public:
+  GHash< GPVec<GffRegion> > seqs; //regions on each genomic sequence, sorted by start
+  int count;
+  GffRegions():seqs(), count(0) { }
+  int load(const char* fname);
+  //sweep-line join of the records in recs with the regions on genomic sequence gseq:
+  //only the records overlapping any region are kept, and the names of
+  //their regions are added as the "regions" attribute;
+  //returns the number of records kept
+  int join(const char* gseq, GPVec<GffObj>& recs);
+};
+
+class GffRefSeq { //reference transcripts on a genomic sequence, by strand
+ public:
+  GIntervalTree<GffObj> fwd;
+  GIntervalTree<GffObj> rev;
+  GIntervalTree<GffObj> unk; //unknown strand
+  GffRefSeq():fwd(), rev(), unk() { }
+  void add(GffObj* t) {
+    if (t->strand=='+') fwd.Add(t);
+    else if (t->strand=='-') rev.Add(t);
+    else unk.Add(t);
+  }
+};
+
+//reference annotation for --compare: the query transcripts are given the
+//class code (see getOvlCode()) of their best matching reference transcript
+class GffCmpRef {
+ public:
+  GList<GenomicSeqData> refdata;
+  GIntHashP<GffRefSeq> seqidx; //by genomic sequence id
+  bool strictMatch;
+  GffCmpRef():refdata(true,true,true), seqidx(), strictMatch(false) { }
+  int load(const char* fname, int numThreads=1); //returns the number of reference transcripts
+  //add the cmp_ref, class_code and ovl_len attributes to the query transcripts in qrecs
+  void classify(int gseq_id, GPVec<GffObj>& qrecs);
+};
+
 class GffLoader {
  public:
   GVec<char*> headerLines; //for GFF3 we keep the first few header lines (not the sequence-region one)
   GStr fname;
   FILE* f;
   GffNames* names;
+  int numThreads; //for per-genomic sequence clustering
+  GffRegions* regions; //if set, only the records overlapping these regions are loaded
+  GffCmpRef* cmpRef; //if set, the loaded transcripts are compared to this reference annotation
+  GFastaDb* seqdb; //if set, the sequences found in GenBank/EMBL input are added here
   union {
 	  unsigned int options;
 	  struct {
@@ -564,6 +665,7 @@ class GffLoader {
 		bool noPseudo:1;
 		bool BEDinput:1;
 		bool TLFinput:1;
+		bool GBKinput:1; //GenBank or EMBL flat file input
 		bool keepGenes:1;
 		bool trAdoption:1; //orphan transcript adoption by the container gene
 		bool keepGff3Comments:1;
@@ -574,13 +676,17 @@ class GffLoader {
 		bool fuzzSpan:1; //matching/contained redundancy relaxed to disregard full boundary containment
 		bool dOvlSET:1; //discard overlapping Single Exon Transcripts on any strand
 		bool forceExons:1;
+		bool batchCluster:1; //sort and sweep all the loaded records instead of placing them one by one
+		bool pipeInput:1; //read the input file in a separate thread (GLinePipe)
 	  };
   };
 
-  GffLoader():fname(),f(NULL), names(NULL), options(0) {
+  //the records are loaded into the gnames dictionary, or into a new one if NULL
+  GffLoader(GffNames* gnames=NULL):fname(),f(NULL), names(gnames), numThreads(1), regions(NULL),
+		  cmpRef(NULL), seqdb(NULL), options(0) {
       transcriptsOnly=true;
-      gffnames_ref(GffObj::names);
-      names=GffObj::names;
+      batchCluster=true;
+      gffnames_ref(names);
   }
 
   void loadRefNames(GStr& flst);
@@ -599,9 +705,24 @@ class GffLoader {
       }
   }
 
-  void load(GList<GenomicSeqData>&seqdata, GFValidateFunc* gf_validate=NULL, GFFCommentParser* gf_parsecomment=NULL);
+  //use an already open stream, e.g. with only a subset of the lines of file_name
+  void openFile(FILE* fh, const char* file_name) {
+	  fname=file_name;
+	  f=fh;
+  }
+
+  void load(GList<GenomicSeqData>&seqdata, GFValidateFunc* gf_validate=NULL, GFFCommentParser* gf_parsecomment=NULL,
+		  void* udata=NULL);
 
+  bool storeGf(GffObj* t, GenomicSeqData* gdata, GTData*& tdata, bool& noexon_gfs);
+  void locusSpan(GffObj* t, uint& t_start, uint& t_end);
+  GffLocus* addToLoci(GffObj* t, GTData* tdata, bool noexon_gfs, GenomicSeqData* gdata,
+		  GPVec<GffLocus>& tloci, bool useIndex);
+  bool redundancyCandidates(GffObj* t, GenomicSeqData* gdata, GPVec<GffObj>& cands);
+  void indexRedundancy(GffObj* t, GenomicSeqData* gdata);
+  void checkRedundant(GffObj* t, GTData* tdata, GffObj* o);
   bool placeGf(GffObj* t, GenomicSeqData* gdata);
+  void sweepPending(GenomicSeqData* gdata);
 
   bool unsplContained(GffObj& ti, GffObj&  tj);
   GffObj* redundantTranscripts(GffObj& ti, GffObj&  tj);
@@ -609,7 +730,7 @@ class GffLoader {
 
   void terminate() {
 	  //if (f!=NULL) closeFile(); GffReader is going to close the file
-	  gffnames_unref(GffObj::names);
+	  gffnames_unref(names);
 	  names=NULL;
   }
   void clearHeaderLines() {
@@ -642,6 +763,6 @@ GffObj* redundantTranscripts(GffObj& ti, GffObj&  tj, bool matchAllIntrons=true,
 
 //void loadGFF(FILE* f, GList<GenomicSeqData>& seqdata, const char* fname);
 
-void collectLocusData(GList<GenomicSeqData>& ref_data, bool covInfo=false);
+void collectLocusData(GList<GenomicSeqData>& ref_data, bool covInfo=false, int numThreads=1);
 
 #endif
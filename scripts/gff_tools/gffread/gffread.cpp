@@ -1,5 +1,13 @@
 #include "GArgs.h"
 #include "gff_utils.h"
+#include "gff_merge.h"
+#include "gff_intergenic.h"
+#include "gff_server.h"
+#include "GffIndex.h"
+#include "GThreads.h"
+#include "GPipe.h"
+#include "GTrace.h"
+#include "gff_stats.h"
 #include <ctype.h>
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
@@ -27,6 +35,18 @@ Options:\n\
       (on chromosome/contig <chr>, strand <strand> if provided)\n\
  -R   for -r option, discard all transcripts that are not fully \n\
       contained within the given range\n\
+ --index : build a coordinate index (<input_gff>.gxi) for each of the\n\
+      given sorted GFF/GTF files (plain or BGZF-compressed) and exit; when\n\
+      the index is found, -r <chr>:<start>-<end> only reads the records\n\
+      around the given range instead of parsing the whole file\n\
+ --regions <regions.bed> : only show the records overlapping any of the regions\n\
+      in the given BED file, adding the names of the overlapping regions\n\
+      (4th BED column, or <chr>:<start>-<end>) as a regions attribute\n\
+ --compare <ref_gff> : compare the input transcripts to the reference transcripts\n\
+      in <ref_gff>, adding the ID of the best matching reference transcript,\n\
+      the class code of the match (as in gffcompare, or 'u' if no match)\n\
+      and the exonic overlap length as cmp_ref, class_code and ovl_len\n\
+      attributes (e.g. for --table @id,cmp_ref,class_code,ovl_len)\n\
  -U   discard single-exon transcripts\n\
  -C   coding only: discard mRNAs that have no CDS features\n\
  --nc non-coding only: discard mRNAs that have CDS features\n\
@@ -74,6 +94,10 @@ Misc options: \n\
  --in-tlf: input GFF-like one-line-per-transcript format without exon/CDS\n\
            features (see --tlf option below); automatic if the input\n\
            filename ends with .tlf)\n\
+ --in-gbk: input is a GenBank or EMBL flat file (automatic if the input\n\
+           filename ends with .gbk, .gb, .gbff, .genbank or .embl); CDS\n\
+           features become mRNA records, and the ORIGIN/SQ sequences are\n\
+           used for -w/-x/-y etc. when -g is not given\n\
 Clustering:\n\
  -M/--merge : cluster the input transcripts into loci, discarding\n\
       \"duplicated\" transcripts (those with the same exact introns\n\
@@ -88,6 +112,36 @@ Clustering:\n\
       multi-exon transcripts, and >=80% overlap for single-exon transcripts\n\
  -Y   for -M option, enforce -Q but also discard overlapping single-exon \n\
       transcripts, even on the opposite strand (can be combined with -K)\n\
+ -p   use a pool of <threads> worker threads for clustering (-M, --cluster-only),\n\
+      --compare, --ig and --batch; with more than one thread the input is also\n\
+      read, and the -o,-w,-x,-y output written, by separate threads; the output\n\
+      does not depend on the number of threads (with -v the pool utilization and\n\
+      the throughput of the pipeline stages are reported)\n\
+Annotation merging (Prokka GFF input, no clustering; implies -F --keep-genes):\n\
+ --merge-ipr <file> : InterProScan GFF3 output for the Prokka proteins\n\
+ --merge-pvog <file> : hmmsearch --domtblout output for the pVOG HMMs\n\
+ --merge-amr <file> : NCBI AMRFinderPlus output for the Prokka proteins\n\
+ --merge-abricate <file>[,<file>..] : Abricate output (matched by location)\n\
+ --merge-btss <file> : bTSSfinder GFF output, added as promoter features\n\
+      (forward strand predictions only)\n\
+ --merge-tterm <file> : TransTermHP --bag-output, added as terminator features\n\
+      the results are added as notes (and Dbxref/Ontology_term attributes for\n\
+      InterProScan) to the matching transcript records\n\
+Batch mode:\n\
+ --batch <manifest> : process many annotation files with the same options; each\n\
+      line of the <manifest> file gives <input_gff> <genome_fasta> <out_prefix>\n\
+      (use - for <genome_fasta> to use the -g file, if any); the samples are\n\
+      processed by up to -p worker threads, and the values of the -o,-w,-x,-y,-d\n\
+      options become suffixes of <out_prefix> for the output file names\n\
+      (default: only -o, with the output format as the file extension)\n\
+Query server:\n\
+ --server <address> : load the input annotation and the -g genome once, then\n\
+      answer one-line requests over a Unix socket (<address> is a socket file\n\
+      path, or unix:<path>) or a TCP socket ([<host>:]<port>), using -p worker\n\
+      threads; requests: region <chr>[:<start>-<end>], gff <id>,\n\
+      transcript <id>, cds <id>, protein <id>, table <id> (--table columns),\n\
+      ping, quit; each reply ends with a #OK line, or is a #ERR <message> line;\n\
+      the server stops on SIGINT or SIGTERM\n\
 Output options:\n\
  --force-exons: make sure that the lowest level GFF features are considered\n\
        \"exon\" features\n\
@@ -109,6 +163,15 @@ Output options:\n\
        coordinates projected onto the spliced sequence;\n\
        for -y option, write transcript attributes in the FASTA defline\n\
  -S    for -y option, use '*' instead of '.' as stop codon translation\n\
+ --intergenic <file> : write a fasta file with the intergenic regions, i.e. the\n\
+       gaps between consecutive CDS, as <chr>-ign-<n> records (requires -g)\n\
+ --ig-min <N> : minimum length of the intergenic regions (default 50)\n\
+ --ig-strand <mode> : for --intergenic, <mode> is one of: split (default, gaps\n\
+       between the CDS on the same strand), rc (same as split, with the - strand\n\
+       regions reverse complemented), any (gaps between the CDS on any strand)\n\
+ --ptt <file> : write a NCBI protein table (.ptt) with the CDS records of the\n\
+       genomic sequence, e.g. for TransTermHP (implies -F); the input must have\n\
+       CDS records on a single sequence (use --batch for several genomes)\n\
  -L    Ensembl GTF to GFF3 conversion (implies -F; should be used with -m)\n\
  -m    <chr_replace> is a name mapping table for converting reference \n\
        sequence names, having this 2-column format:\n\
@@ -129,6 +192,16 @@ Output options:\n\
        @chr, @start, @end, @strand, @numexons, @exons, @cds, @covlen, @cdslen\n\
  -v,-E expose (warn about) duplicate transcript IDs and other potential\n\
        problems with the given GFF/GTF records\n\
+ --stats <file> : write a JSON report of the run to <file> (- for stdout, only\n\
+       if the records are written to files, e.g. with -o <outfile>):\n\
+       wall and CPU time of each stage (parse, finalize, cluster, seqfetch,\n\
+       translate, output), input bytes and records per second, peak RSS,\n\
+       genomic sequence cache hits and misses, and the number of features,\n\
+       transcripts and loci; in --batch mode only the totals are reported\n\
+ --trace <file> : write a timeline of the run to <file> in the Chrome\n\
+       trace-event JSON format (open it in chrome://tracing or Perfetto):\n\
+       input file loading, clustering and sequence fetching for each\n\
+       genomic sequence, --batch samples and output writing, by thread\n\
 "
 
 class SeqInfo { //populated from the -s option of gffread
@@ -183,11 +256,8 @@ class CTableField {
 
 FILE* ffasta=NULL;
 FILE* f_in=NULL;
-FILE* f_out=NULL;
-FILE* f_w=NULL; //writing fasta with spliced exons (transcripts)
 int wPadding = 0; //padding for -w option
-FILE* f_x=NULL; //writing fasta with spliced CDS
-FILE* f_y=NULL; //wrting fasta with translated CDS
+GffIntergenic intergenic;
 
 bool wCDSonly=false;
 bool wNConly=false;
@@ -220,6 +290,7 @@ bool fullCDSonly=false; // starts with START, ends with STOP codon
 bool ensembl_convert=false; //-L, assist in converting Ensembl GTF to GFF3
 bool BEDinput=false;
 bool TLFinput=false;
+bool GBKinput=false;
 
 bool fmtGFF3=true; //default output: GFF3
 //other formats only make sens in transcriptOnly mode
@@ -241,16 +312,28 @@ uint rfltStart=0;
 uint rfltEnd=MAX_UINT;
 bool rfltWithin=false; //check for full containment within given range
 
-GffLoader gffloader;
-
-GList<GenomicSeqData> g_data(true,true,true); //list of GFF records by genomic seq
+//the loader, the loaded records and the output files of one input;
+//main() uses a single one, --batch mode one for each sample
+struct GSampleData {
+  GffLoader gffloader;
+  GList<GenomicSeqData> g_data; //list of GFF records by genomic seq
+  GHash<int> isoCounter; //counts the valid isoforms
+  GHash<GeneInfo> gene_ids;
+    //min-max gene span associated to chr|gene_id (mostly for Ensembl conversion)
+  FILE* f_out;
+  FILE* f_w; //writing fasta with spliced exons (transcripts)
+  FILE* f_x; //writing fasta with spliced CDS
+  FILE* f_y; //wrting fasta with translated CDS
+  FILE* f_repl; //-d output (duplicates info)
+  FILE* f_ig; //--intergenic output
+  FILE* f_ptt; //--ptt output
+  GSampleData():gffloader(), g_data(true,true,true), isoCounter(), gene_ids(),
+      f_out(NULL), f_w(NULL), f_x(NULL), f_y(NULL), f_repl(NULL), f_ig(NULL), f_ptt(NULL) { }
+};
 
 //hash with sequence info
 GHash<SeqInfo> seqinfo;
-GHash<int> isoCounter; //counts the valid isoforms
 GHash<RefTran> reftbl;
-GHash<GeneInfo> gene_ids;
-  //min-max gene span associated to chr|gene_id (mostly for Ensembl conversion)
 
 bool debugMode=false;
 //bool verbose=false;
@@ -348,7 +431,7 @@ void loadRefTable(FILE* f, GHash<RefTran>& rt) {
 }
 
 char* getSeqDescr(char* seqid) {
- static char charbuf[128];
+ static thread_local char charbuf[128];
  if (seqinfo.Count()==0) return NULL;
  char* suf=rstrchr(seqid, '.');
  if (suf!=NULL) *suf=0;
@@ -378,7 +461,7 @@ char* getSeqDescr(char* seqid) {
 }
 
 char* getSeqName(char* seqid) {
-  static char charbuf[128];
+  static thread_local char charbuf[128];
   char* suf=rstrchr(seqid, '.');
   if (suf!=NULL) *suf=0;
   strcpy(charbuf, seqid);
@@ -395,9 +478,9 @@ int adjust_stopcodon(GffObj& gffrec, int adj, GList<GSeg>* seglst=NULL) {
        if ((int)gffrec.CDstart>adj) {
            gffrec.CDstart-=adj;
            realadj=adj;
-           if (gffrec.exons.First()->start>gffrec.CDstart) {
-                 gffrec.covlen+=gffrec.exons.First()->start - gffrec.CDstart;
-                 gffrec.exons.First()->start=gffrec.CDstart;
+           if (gffrec.exons.First().start>gffrec.CDstart) {
+                 gffrec.covlen+=gffrec.exons.First().start - gffrec.CDstart;
+                 gffrec.exons.First().start=gffrec.CDstart;
                  gffrec.start=gffrec.CDstart;
                  }
              }
@@ -407,15 +490,15 @@ int adjust_stopcodon(GffObj& gffrec, int adj, GList<GSeg>* seglst=NULL) {
          realadj=adj;
          gffrec.CDend+=adj;
          if (adj<0) {//restore
-           if (gffrec.exons.Last()->end==gffrec.CDend-adj) {
-                        gffrec.exons.Last()->end+=adj;
-                        gffrec.end=gffrec.exons.Last()->end;
+           if (gffrec.exons.Last().end==gffrec.CDend-adj) {
+                        gffrec.exons.Last().end+=adj;
+                        gffrec.end=gffrec.exons.Last().end;
                         gffrec.covlen+=adj;
                         }
          }
-         else if (gffrec.exons.Last()->end<gffrec.CDend) {
-             gffrec.covlen+=gffrec.CDend-gffrec.exons.Last()->end;
-             gffrec.exons.Last()->end=gffrec.CDend;
+         else if (gffrec.exons.Last().end<gffrec.CDend) {
+             gffrec.covlen+=gffrec.CDend-gffrec.exons.Last().end;
+             gffrec.exons.Last().end=gffrec.CDend;
              gffrec.end=gffrec.CDend;
              }
          }
@@ -423,7 +506,7 @@ int adjust_stopcodon(GffObj& gffrec, int adj, GList<GSeg>* seglst=NULL) {
   return realadj;
  }
 
-bool process_transcript(GFastaDb& gfasta, GffObj& gffrec) {
+bool process_transcript(GFastaDb& gfasta, GffObj& gffrec, GSampleData& sd) {
  if (!gffrec.isTranscript()) return false; //shouldn't call this function unless it's a transcript
  //returns true if the transcript passed the filter
  char* gname=gffrec.getGeneName();
@@ -458,10 +541,10 @@ bool process_transcript(GFastaDb& gfasta, GffObj& gffrec) {
           }
       }
  if (gname && strcmp(gname, gffrec.getID())!=0) {
-   int* isonum=isoCounter.Find(gname);
+   int* isonum=sd.isoCounter.Find(gname);
    if  (isonum==NULL) {
        isonum=new int(1);
-       isoCounter.Add(gname,isonum);
+       sd.isoCounter.Add(gname,isonum);
        }
       else (*isonum)++;
    //defline.appendfmt(" gene=%s", gname);
@@ -475,7 +558,7 @@ bool process_transcript(GFastaDb& gfasta, GffObj& gffrec) {
   char* cdsaa = NULL;
   int aalen=0;
   for (int i=1;i<gffrec.exons.Count();i++) {
-     int ilen=gffrec.exons[i]->start-gffrec.exons[i-1]->end-1;
+     int ilen=gffrec.exons[i].start-gffrec.exons[i-1].end-1;
      if (verbose && ilen>4000000)
             GMessage("Warning: very large intron (%d) for transcript %s\n",
                            ilen, gffrec.getID());
@@ -485,7 +568,8 @@ bool process_transcript(GFastaDb& gfasta, GffObj& gffrec) {
   }
   GMapSegments seglst(gffrec.strand);
   GFaSeqGet* faseq=NULL;
-  if (f_x!=NULL || f_y!=NULL || f_w!=NULL || spliceCheck || validCDSonly || addCDSattrs) {
+  if (sd.f_x!=NULL || sd.f_y!=NULL || sd.f_w!=NULL || spliceCheck || validCDSonly || addCDSattrs) {
+	  GffStageTimer stimer(gstSeqFetch);
 	  faseq=fastaSeqGet(gfasta, gffrec.getGSeqName());
       if (faseq==NULL)
 	    	GError("Error: no genomic sequence available (check -g option!).\n");
@@ -497,8 +581,8 @@ bool process_transcript(GFastaDb& gfasta, GffObj& gffrec) {
     bool revcompl=(gffrec.strand=='-');
     bool ssValid=true;
     for (int e=1;e<gffrec.exons.Count();e++) {
-      const char* intron=gseq+gffrec.exons[e-1]->end+1-gffrec.start;
-      int intronlen=gffrec.exons[e]->start-gffrec.exons[e-1]->end-1;
+      const char* intron=gseq+gffrec.exons[e-1].end+1-gffrec.start;
+      int intronlen=gffrec.exons[e].start-gffrec.exons[e-1].end-1;
       GSpliceSite acceptorSite(intron,intronlen,true, revcompl);
       GSpliceSite    donorSite(intron,intronlen, false, revcompl);
       //GMessage("%c intron %d-%d : %s .. %s\n",
@@ -530,15 +614,21 @@ bool process_transcript(GFastaDb& gfasta, GffObj& gffrec) {
   if (gffrec.CDphase=='1' || gffrec.CDphase=='2')
       mCDphase = gffrec.CDphase-'0';
   //CDS partialness only added when -y -x -V options are given
-  if (gffrec.hasCDS() && (f_y!=NULL || f_x!=NULL || validCDSonly || addCDSattrs)) {
+  if (gffrec.hasCDS() && (sd.f_y!=NULL || sd.f_x!=NULL || validCDSonly || addCDSattrs)) {
     int strandNum=0;
     int phaseNum=0;
   CDS_CHECK:
     uint cds_olen=0;
-    cdsnt=gffrec.getSpliced(faseq, true, &seqlen, NULL, &cds_olen, &seglst, adjustStop);
+    {
+      GffStageTimer stimer(gstSeqFetch);
+      cdsnt=gffrec.getSpliced(faseq, true, &seqlen, NULL, &cds_olen, &seglst, adjustStop);
+    }
     //if adjustStop, seqlen has the CDS+3'UTR length, but cds_olen still has the original CDS length
     if (cdsnt!=NULL && cdsnt[0]!='\0') { //has CDS
-         cdsaa=translateDNA(cdsnt, aalen, seqlen);
+         {
+           GffStageTimer ttimer(gstTranslate);
+           cdsaa=translateDNA(cdsnt, aalen, seqlen);
+         }
          char* p=strchr(cdsaa,'.');
          int cds_aalen=aalen;
          if (adjustStop)
@@ -638,8 +728,9 @@ bool process_transcript(GFastaDb& gfasta, GffObj& gffrec) {
   if (adjstop!=NULL) delete adjstop;
   */
   if (cdsnt!=NULL) { // && !inframeStop) {
-	  if (f_y!=NULL) { //CDS translation fasta output requested
+	  if (sd.f_y!=NULL) { //CDS translation fasta output requested
 			 if (cdsaa==NULL) { //translate now if not done before
+			   GffStageTimer ttimer(gstTranslate);
 			   cdsaa=translateDNA(cdsnt, aalen, seqlen);
 			 }
 			 GStr defline(gffrec.getID());
@@ -656,10 +747,10 @@ bool process_transcript(GFastaDb& gfasta, GffObj& gffrec) {
 			 }
 			 if (aalen>0) {
 			   if (cdsaa[aalen-1]=='.' || cdsaa[aalen-1]=='\0') --aalen; //avoid printing the stop codon
-			   printFasta(f_y, defline, cdsaa, aalen, StarStop);
+			   printFasta(sd.f_y, defline, cdsaa, aalen, StarStop);
 			 }
 	  }
-	  if (f_x!=NULL) { //CDS only
+	  if (sd.f_x!=NULL) { //CDS only
 			 GStr defline(gffrec.getID());
 			 if (writeExonSegs) {
 				  defline.append(" loc:");
@@ -689,12 +780,12 @@ bool process_transcript(GFastaDb& gfasta, GffObj& gffrec) {
 					else defline.appendQuoted(s, '{', true);
 				}
 			}
-			printFasta(f_x, defline, cdsnt, seqlen);
+			printFasta(sd.f_x, defline, cdsnt, seqlen);
 	  }
 	  GFREE(cdsnt);
 	  GFREE(cdsaa);
   } //writing CDS or its translation
-  if (f_w!=NULL) { //write spliced exons
+  if (sd.f_w!=NULL) { //write spliced exons
 	  uint cds_start=0;
 	  uint cds_end=0;
 	  seglst.Clear();
@@ -708,7 +799,11 @@ bool process_transcript(GFastaDb& gfasta, GffObj& gffrec) {
 	    padRight=(wPadding>ediff) ?  ediff : wPadding;
    	    gffrec.addPadding(padLeft, padRight);
 	  }
-	  char* exont=gffrec.getSpliced(faseq, false, &seqlen, &cds_start, &cds_end, &seglst);
+	  char* exont=NULL;
+	  {
+		  GffStageTimer stimer(gstSeqFetch);
+		  exont=gffrec.getSpliced(faseq, false, &seqlen, &cds_start, &cds_end, &seglst);
+	  }
 	  //restore exons to normal (remove padding)
 	  if (wPadding>0)
 		  gffrec.removePadding(padLeft, padRight);
@@ -730,9 +825,9 @@ bool process_transcript(GFastaDb& gfasta, GffObj& gffrec) {
 			  defline.append(" exons:");
 			  for (int i=0;i<gffrec.exons.Count();i++) {
 				  if (i>0) defline.append(",");
-				  defline+=(int)gffrec.exons[i]->start;
+				  defline+=(int)gffrec.exons[i].start;
 				  defline.append("-");
-				  defline+=(int)gffrec.exons[i]->end;
+				  defline+=(int)gffrec.exons[i].end;
 			  }
 			if (wPadding>0) {
 				defline.append(" padding:");
@@ -761,7 +856,7 @@ bool process_transcript(GFastaDb& gfasta, GffObj& gffrec) {
 				  else defline.appendQuoted(s, '{', true);
 			  }
 		  }
-		  printFasta(f_w, defline, exont, seqlen);
+		  printFasta(sd.f_w, defline, exont, seqlen);
 		  GFREE(exont);
 	  }
   } //writing f_w (spliced exons)
@@ -782,7 +877,52 @@ void openfw(FILE* &f, GArgs& args, char opt) {
 
 #define FWCLOSE(fh) if (fh!=NULL && fh!=stdout) fclose(fh)
 
-void printGff3Header(FILE* f, GArgs& args) {
+//pipelined mode: the -o/-w/-x/-y output is written by separate threads,
+//using a shared pool of blocks
+GBlockPool* outBlocks=NULL;
+GOutPipe* outPipes[4]={NULL, NULL, NULL, NULL};
+const char* outPipeNames[4]={"writer -o", "writer -w", "writer -x", "writer -y"};
+
+void pipeOutput(GSampleData& sd, bool stdoutShared) {
+	FILE** outs[4]={&sd.f_out, &sd.f_w, &sd.f_x, &sd.f_y};
+	FILE* dests[4]={sd.f_out, sd.f_w, sd.f_x, sd.f_y};
+	outBlocks=new GBlockPool(16);
+	for (int i=0;i<4;i++) {
+		if (dests[i]==NULL || (stdoutShared && dests[i]==stdout)) continue;
+		int j=0; //the same file may be given for several outputs
+		while (j<i && (outPipes[j]==NULL || dests[j]!=dests[i])) j++;
+		if (j<i) *outs[i]=outPipes[j]->file();
+		else {
+			outPipes[i]=new GOutPipe(dests[i], dests[i]!=stdout, outBlocks);
+			*outs[i]=outPipes[i]->file();
+		}
+	}
+}
+
+void closePipedOutput(GSampleData& sd) {
+	GTraceSpan tspan("flush", "output");
+	FILE** outs[4]={&sd.f_out, &sd.f_w, &sd.f_x, &sd.f_y};
+	for (int i=0;i<4;i++) {
+		if (outPipes[i]==NULL) continue;
+		for (int j=0;j<4;j++)
+			if (*outs[j]==outPipes[i]->file()) *outs[j]=NULL;
+		outPipes[i]->close();
+	}
+	if (verbose) {
+		for (int i=0;i<4;i++)
+			if (outPipes[i]!=NULL) outPipes[i]->printStats(stderr, outPipeNames[i]);
+		GQueueStats bs=outBlocks->getStats();
+		bs.print(stderr, "output blocks");
+	}
+	for (int i=0;i<4;i++) {
+		delete outPipes[i];
+		outPipes[i]=NULL;
+	}
+	delete outBlocks;
+	outBlocks=NULL;
+}
+
+void printGff3Header(FILE* f, GArgs& args, GffLoader& gffloader) {
   if (gffloader.keepGff3Comments) {
 	for (int i=0;i<gffloader.headerLines.Count();i++) {
 		fprintf(f, "%s\n", gffloader.headerLines[i]);
@@ -795,14 +935,15 @@ void printGff3Header(FILE* f, GArgs& args) {
   }
 }
 
-void printGSeqHeader(FILE* f, GenomicSeqData* gdata) {
+void printGSeqHeader(FILE* f, GenomicSeqData* gdata, GffLoader& gffloader) {
 if (f && gffloader.keepGff3Comments && gdata->seqreg_start>0 && gdata->seqreg_end>0)
 	 fprintf(f, "##sequence-region %s %d %d\n", gdata->gseq_name,
 			 gdata->seqreg_start, gdata->seqreg_end);
 
 }
 
-void processGffComment(const char* cmline, GfList* gflst) {
+void processGffComment(const char* cmline, GfList* gflst, void* udata) {
+ GSampleData& sd=*(GSampleData*)udata;
  if (cmline[0]!='#') return;
  const char* p=cmline;
  while (*p=='#') p++;
@@ -814,9 +955,9 @@ void processGffComment(const char* cmline, GfList* gflst) {
   if (s.nextToken(w) && w=="sequence-region") {
 	 GStr chr, wend;
 	 if (s.nextToken(chr) && s.nextToken(w) && s.nextToken(wend)) {
-		 int gseq_id=gffloader.names->gseqs.addName(chr.chars());
+		 int gseq_id=sd.gffloader.names->gseqs.addName(chr.chars());
 		 if (gseq_id>=0) {
-			 GenomicSeqData* gseqdata=getGSeqData(g_data, gseq_id);
+			 GenomicSeqData* gseqdata=getGSeqData(sd.g_data, gseq_id, sd.gffloader.names);
 			 gseqdata->seqreg_start=w.asInt();
 			 gseqdata->seqreg_end=wend.asInt();
 		 }
@@ -827,11 +968,12 @@ void processGffComment(const char* cmline, GfList* gflst) {
  if (gflst->Count()==0) {
     //initial Gff3 header, store it
 	char* hl=Gstrdup(cmline);
-    gffloader.headerLines.Add(hl);
+    sd.gffloader.headerLines.Add(hl);
  }
 }
 
-bool validateGffRec(GffObj* gffrec, GList<GffObj>* gfnew) {
+bool validateGffRec(GffObj* gffrec, GList<GffObj>* gfnew, void* udata) {
+	GSampleData& sd=*(GSampleData*)udata;
 	if (reftbl.Count()>0) { //check if we need to reject by ref seq filter
 		GStr refname(gffrec->getRefName());
 		RefTran* rt=reftbl.Find(refname.chars());
@@ -852,7 +994,7 @@ bool validateGffRec(GffObj* gffrec, GList<GffObj>* gfnew) {
 			return false; //discard, ref seq not in the given translation table
 		}*/
 	}
-	if (gffloader.transcriptsOnly && gffrec->isDiscarded()) {
+	if (sd.gffloader.transcriptsOnly && gffrec->isDiscarded()) {
 		//discard generic "locus" features with no other detailed subfeatures
 		//GMessage("Warning: discarding %s GFF generic gene/locus container %s\n",gffrec->getID());
 		return false;
@@ -895,10 +1037,10 @@ bool validateGffRec(GffObj* gffrec, GList<GffObj>* gfnew) {
 		//keep track of chr|gene_id data -- coordinate range
 		char* geneid=gffrec->getGeneID();
 		if (geneid!=NULL) {
-			GeneInfo* ginfo=gene_ids.Find(geneid);
+			GeneInfo* ginfo=sd.gene_ids.Find(geneid);
 			if (ginfo==NULL) {//first time seeing this gene ID
 				GeneInfo* geneinfo=new GeneInfo(gffrec, ensembl_convert);
-				gene_ids.Add(geneid, geneinfo);
+				sd.gene_ids.Add(geneid, geneinfo);
 				if (gfnew!=NULL)
 					gfnew->Add(geneinfo->gf); //do we really need this?
 			}
@@ -974,7 +1116,7 @@ void printGxfTab(FILE* f, GffObj& g) {
 			if (g.exons.Count()>0) {
 				for (int x=0;x<g.exons.Count();x++) {
 					if (x>0) fprintf(f,",");
-					fprintf(f,"%d-%d",g.exons[x]->start, g.exons[x]->end);
+					fprintf(f,"%d-%d",g.exons[x].start, g.exons[x].end);
 				}
 			} else fprintf(f,".");
 			break;
@@ -1027,17 +1169,578 @@ void printAsTable(FILE* f, GffObj* gfo, int* out_counter=NULL) {
     printGxfTab(f, *gfo);
 }
 
+//if an up to date index is found for the input file and -r gives a genomic
+//sequence, copy the GFF lines overlapping the range into a temporary file
+FILE* fetchIndexedRegion(GStr& infile) {
+  bool bgzf=GffIndex::isBGZF(infile.chars());
+  GStr gxifile(infile);
+  gxifile.append(GFFIDX_EXT);
+  if (rfltGSeq==NULL || fileExists(gxifile.chars())!=2) {
+    if (bgzf) GError("Error: BGZF-compressed input %s can only be queried by range "
+          "(-r <chr>:<start>-<end>) after indexing it with --index\n", infile.chars());
+    return NULL;
+  }
+  GffIndex gxi(infile.chars(), gxifile.chars());
+  if (!gxi.hasIndex()) return NULL;
+  if (!gxi.isCurrent()) {
+    if (bgzf) GError("Error: index %s is out of date, please rebuild it with --index\n", gxifile.chars());
+    GMessage("Warning: index %s is out of date (ignored), please rebuild it with --index\n", gxifile.chars());
+    return NULL;
+  }
+  FILE* f=tmpfile();
+  if (f==NULL) GError("Error creating temporary file for indexed range query!\n");
+  int numblocks=gxi.fetchRegion(rfltGSeq, rfltStart, rfltEnd, f);
+  if (verbose) GMessage("  .. %d indexed blocks of %s overlap the given range\n", numblocks, infile.chars());
+  rewind(f);
+  return f;
+}
+
+//value of a GenBank qualifier kept as attribute, or "-"
+static void pttAttr(GStr& s, GffObj& t, const char* attr) {
+	const char* v=t.getAttr(attr);
+	if (v==NULL) { s="-"; return; }
+	s="";
+	for (const char* p=v;*p!=0;p++) { //undo the %XX escaping of GenBank qualifiers
+		if (p[0]=='%' && isxdigit(p[1]) && isxdigit(p[2])) {
+			char hex[3]={p[1], p[2], 0};
+			s.append((char)strtol(hex, NULL, 16));
+			p+=2;
+		}
+		else s.append(*p);
+	}
+}
+
+//write the NCBI protein table (.ptt) of the genomic sequence with CDS records
+//(the -F attributes of GenBank input give the columns); a .ptt file describes
+//a single sequence, as expected by TransTermHP, so multi-sequence input is rejected
+int writePTT(FILE* f, GFastaDb& gfasta, GSampleData& sd) {
+ GenomicSeqData* cdsdata=NULL;
+ for (int g=0;g<sd.g_data.Count();g++) {
+   GenomicSeqData& gdata=*(sd.g_data[g]);
+   for (int i=0;i<gdata.rnas.Count();i++) {
+     GffObj& t=*(gdata.rnas[i]);
+     if (!t.hasCDS() || t.isDiscarded()) continue;
+     if (cdsdata!=NULL && cdsdata!=&gdata)
+       GError("Error: --ptt writes the protein table of a single sequence, but CDS records "
+           "were found on %s and %s (split the input into one file per sequence)!\n",
+           cdsdata->gseq_name, gdata.gseq_name);
+     cdsdata=&gdata;
+     break;
+   }
+ }
+ if (cdsdata==NULL) return 0;
+ int numwritten=0;
+ {
+   GenomicSeqData& gdata=*cdsdata;
+   GPVec<GffObj> cds(false);
+   uint seqlen=0;
+   for (int i=0;i<gdata.rnas.Count();i++) {
+     GffObj& t=*(gdata.rnas[i]);
+     if (t.end>seqlen) seqlen=t.end;
+     if (t.hasCDS() && !t.isDiscarded()) cds.Add(&t);
+   }
+   GFaSeqGet* faseq=NULL;
+   {
+     GffStageTimer stimer(gstSeqFetch);
+     faseq=fastaSeqGet(gfasta, gdata.gseq_name);
+   }
+   if (faseq!=NULL && faseq->getseqlen()>0) seqlen=faseq->getseqlen();
+   fprintf(f, "%s - 0..%u\r\n", gdata.gseq_name, seqlen);
+   fprintf(f, "%d proteins\r\n", cds.Count());
+   fprintf(f, "Location\tStrand\tLength\tPID\tGene\tSynonym\tCode\tCOG\tProduct\r\n");
+   GStr gene, synonym, product, xref;
+   for (int i=0;i<cds.Count();i++) {
+     GffObj& t=*(cds[i]);
+     GVec<GffExon> cdsegs;
+     t.getCDSegs(cdsegs);
+     int cdslen=0;
+     for (int s=0;s<cdsegs.Count();s++)
+       cdslen+=cdsegs[s].end-cdsegs[s].start+1;
+     pttAttr(gene, t, "gene");
+     if (gene=="-" && t.getGeneName()!=NULL) gene=t.getGeneName();
+     pttAttr(synonym, t, "locus_tag");
+     if (synonym=="-") synonym=t.getID();
+     pttAttr(product, t, "product");
+     pttAttr(xref, t, "db_xref");
+     GStr pid("-");
+     int p=xref.index("GI:");
+     if (p>=0) {
+       pid=xref.substr(p+3);
+       int e=0;
+       while (e<pid.length() && isdigit(pid[e])) e++;
+       pid=(e>0) ? pid.substr(0, e) : GStr("-");
+     }
+     GStr cog("-");
+     if (startsWith(product.chars(), "COG")) {
+       cog=product;
+       p=cog.index(' ');
+       if (p>0) cog.cut(p);
+     }
+     fprintf(f, "%d..%d\t%c\t%d\t%s\t%s\t%s\t-\t%s\t%s\r\n", t.CDstart, t.CDend, t.strand,
+         cdslen/3-1, pid.chars(), gene.chars(), synonym.chars(), cog.chars(), product.chars());
+   }
+   numwritten+=cds.Count();
+ }
+ return numwritten;
+}
+
+//load the records from an input file into sd.g_data
+void loadInput(GStr& infile, GSampleData& sd) {
+ const char* fext=getFileExt(infile.chars());
+ if (BEDinput || (Gstricmp(fext, "bed")==0))
+	   sd.gffloader.BEDinput=true;
+ if (TLFinput || (Gstricmp(fext, "tlf")==0))
+	   sd.gffloader.TLFinput=true;
+ if (GBKinput || GbkReader::hasGbkExt(infile.chars()))
+	   sd.gffloader.GBKinput=true;
+ FILE* f_rgn=NULL; //only the GFF records around the -r range, fetched using the index
+ if (infile!="stdin" && !sd.gffloader.BEDinput && !sd.gffloader.TLFinput && !sd.gffloader.GBKinput)
+   f_rgn=fetchIndexedRegion(infile);
+ if (f_rgn!=NULL) sd.gffloader.openFile(f_rgn, infile.chars());
+   else sd.gffloader.openFile(infile);
+ sd.gffloader.load(sd.g_data, &validateGffRec, &processGffComment, (void*) &sd);
+ // will also place the transcripts in loci, if doCluster is enabled
+ if (sd.gffloader.doCluster) {
+   GffStageTimer ctimer(gstCluster);
+   collectLocusData(sd.g_data, covInfo, sd.gffloader.numThreads);
+ }
+}
+
+//write the loaded records (and their sequences) to the output files
+void writeRecords(GArgs& args, GFastaDb& gfasta, GSampleData& sd) {
+ GffStageTimer otimer(gstOutput);
+ GTraceSpan tspan("output", "output");
+ int out_counter=0; //number of records printed
+ if (sd.f_ig!=NULL) {
+   int numig=intergenic.write(sd.f_ig, sd.g_data, gfasta, sd.gffloader.numThreads);
+   if (verbose) GMessage("%d intergenic regions written\n", numig);
+ }
+ if (sd.f_ptt!=NULL) {
+   int numptt=writePTT(sd.f_ptt, gfasta, sd);
+   if (verbose) GMessage("%d proteins written to the protein table\n", numptt);
+ }
+ if (covInfo) {
+	 //report coverage info at STDOUT
+	 uint64 f_bases=0;
+	 uint64 r_bases=0;
+	 uint64 u_bases=0;
+	 for (int g=0;g<sd.g_data.Count();g++) {
+		 f_bases+=sd.g_data[g]->f_bases;
+		 r_bases+=sd.g_data[g]->r_bases;
+		 u_bases+=sd.g_data[g]->u_bases;
+	 }
+	 fprintf(stdout, "Total bases covered by transcripts:\n");
+	 if (f_bases>0) fprintf(stdout, "\t%" PRIu64 " on + strand\n", f_bases);
+	 if (r_bases>0) fprintf(stdout, "\t%" PRIu64 " on - strand\n", r_bases);
+	 if (u_bases>0) fprintf(stdout, "\t%" PRIu64 " on . strand\n", u_bases);
+ }
+ GStr loctrack("gffcl");
+ if (tracklabel) loctrack=tracklabel;
+ if (sd.gffloader.sortRefsAlpha)
+    sd.g_data.setSorted(&gseqCmpName);
+ GffPrintMode exonPrinting;
+ if (fmtGTF)
+	 exonPrinting = pgtfAny;
+ else if (fmtBED)
+	 exonPrinting=pgffBED;
+ else if (fmtTLF)
+	exonPrinting=pgffTLF;
+ else { //printing regular GFF3
+	exonPrinting = sd.gffloader.forceExons ? pgffBoth : pgffAny;
+ }
+ bool firstGff3Print=fmtGFF3;
+ if (sd.gffloader.doCluster) {
+   //grouped in loci
+   for (int g=0;g<sd.g_data.Count();g++) {
+     GenomicSeqData* gdata=sd.g_data[g];
+     bool firstGSeqHeader=fmtGFF3;
+     if (sd.f_out && fmtGFF3 && sd.gffloader.keepGff3Comments && gdata->seqreg_start>0)
+    	 fprintf(sd.f_out, "##sequence-region %s %d %d\n", gdata->gseq_name,
+    			 gdata->seqreg_start, gdata->seqreg_end);
+     for (int l=0;l<gdata->loci.Count();l++) {
+       bool firstLocusPrint=true;
+       GffLocus& loc=*(gdata->loci[l]);
+       //check all non-replaced transcripts in this locus:
+       int numvalid=0;
+       int idxfirstvalid=-1;
+       for (int i=0;i<loc.rnas.Count();i++) {
+         GffObj& t=*(loc.rnas[i]);
+         GTData* tdata=(GTData*)(t.uptr);
+         if (tdata->replaced_by!=NULL) {
+            if (sd.f_repl && T_DUPSHOWABLE(t.udata)) {
+               fprintf(sd.f_repl, "%s", t.getID());
+               GTData* rby=tdata;
+               while (rby->replaced_by!=NULL) {
+                  fprintf(sd.f_repl," => %s", rby->replaced_by->getID());
+                  T_NO_DUPSHOW(rby->rna->udata);
+                  rby=(GTData*)(rby->replaced_by->uptr);
+               }
+               fprintf(sd.f_repl, "\n");
+            }
+            T_NO_PRINT(t.udata);
+            if (verbose) {
+            	GMessage("Info: %s discarded: superseded by %s\n",
+            			t.getID(), tdata->replaced_by->getID());
+            }
+            continue;
+         }
+         //restore strand for dOvlSET
+         char orig_strand=T_OSTRAND(t.udata);
+         if (orig_strand!=0) t.strand=orig_strand;
+
+         if (process_transcript(gfasta, t, sd)) {
+             numvalid++;
+             if (idxfirstvalid<0) idxfirstvalid=i;
+         }
+       } //for each transcript
+
+       int rnas_i=0;
+       if (idxfirstvalid>=0) rnas_i=idxfirstvalid;
+       int gfs_i=0;
+       if (sd.f_out) {
+           GStr locname("RLOC_");
+           locname.appendfmt("%08d",loc.locus_num);
+           //GMessage("Locus: %s (%d-%d), %d rnas, %d gfs\n", locname.chars(), loc.start, loc.end,
+           //	   loc.rnas.Count(), loc.gfs.Count());
+		   while (gfs_i<loc.gfs.Count() || rnas_i<loc.rnas.Count()) {
+			   if (gfs_i<loc.gfs.Count() && (rnas_i>=loc.rnas.Count() ||
+					     loc.gfs[gfs_i]->start<=loc.rnas[rnas_i]->start) ) {
+				   //print the gene object first
+				   if (fmtGFF3) { //BED, TLF and GTF: only show transcripts
+					   if (firstGff3Print) { printGff3Header(sd.f_out, args, sd.gffloader);firstGff3Print=false; }
+					   if (firstGSeqHeader) { printGSeqHeader(sd.f_out, gdata, sd.gffloader); firstGSeqHeader=false; }
+					   if (firstLocusPrint) {
+						   loc.print(sd.f_out, idxfirstvalid, locname, loctrack);
+						   firstLocusPrint=false;
+					   }
+					   printGffObj(sd.f_out, loc.gfs[gfs_i], locname, exonPrinting, out_counter);
+				   }
+				   ++gfs_i;
+				   continue;
+			   }
+			   if (rnas_i<loc.rnas.Count()) {
+				       //loc.rnas[rnas_i]->printGxf(f_out, exonPrinting, tracklabel, NULL, decodeChars);
+				       if (fmtGFF3) {
+					     if (firstGff3Print) { printGff3Header(sd.f_out, args, sd.gffloader); firstGff3Print=false; }
+					     if (firstGSeqHeader) { printGSeqHeader(sd.f_out, gdata, sd.gffloader); firstGSeqHeader=false; }
+					     if (firstLocusPrint) {
+					    	 loc.print(sd.f_out, idxfirstvalid, locname, loctrack);
+					    	 firstLocusPrint=false;
+					     }
+				       }
+				       if (fmtTable)  printAsTable(sd.f_out, loc.rnas[rnas_i], &out_counter);
+				       else printGffObj(sd.f_out, loc.rnas[rnas_i], locname, exonPrinting, out_counter);
+					   ++rnas_i;
+			   }
+		   }
+       }
+     }//for each locus
+    } //for each genomic sequence
+   } //if Clustering enabled
+  else { //no clustering
+   //not grouped into loci, print the rnas with their parents, if any
+   int numvalid=0;
+   for (int g=0;g<sd.g_data.Count();g++) {
+     GenomicSeqData* gdata=sd.g_data[g];
+     bool firstGSeqHeader=fmtGFF3;
+     int gfs_i=0;
+     for (int m=0;m<gdata->rnas.Count();m++) {
+        GffObj& t=*(gdata->rnas[m]);
+        if (sd.f_out && (fmtGFF3 || fmtTable)) {
+         //print other non-transcript (gene?) feature that might be there before t
+           while (gfs_i<gdata->gfs.Count() && gdata->gfs[gfs_i]->start<=t.start) {
+             GffObj& gfst=*(gdata->gfs[gfs_i]);
+             if T_PRINTABLE(gfst.udata) { //never printed
+               T_NO_PRINT(gfst.udata);
+               if (fmtGFF3) {
+                 if (firstGff3Print) { printGff3Header(sd.f_out, args, sd.gffloader);firstGff3Print=false; }
+                 if (firstGSeqHeader) { printGSeqHeader(sd.f_out, gdata, sd.gffloader); firstGSeqHeader=false; }
+                 gfst.printGxf(sd.f_out, exonPrinting, tracklabel, NULL, decodeChars);
+               }
+               else printGxfTab(sd.f_out, gfst);
+             }
+             ++gfs_i;
+           }
+        }
+        GTData* tdata=(GTData*)(t.uptr);
+        if (tdata->replaced_by!=NULL) continue;
+        if (process_transcript(gfasta, t, sd)) {
+           numvalid++;
+           if (sd.f_out && T_PRINTABLE(t.udata) ) {
+             T_NO_PRINT(t.udata);
+             if (fmtGFF3 || fmtTable || t.isTranscript()) {
+				 if (tdata->geneinfo)
+					 tdata->geneinfo->finalize();
+				 out_counter++;
+				 if (fmtGFF3) {
+				   if (firstGff3Print) { printGff3Header(sd.f_out, args, sd.gffloader);firstGff3Print=false; }
+				   if (firstGSeqHeader) { printGSeqHeader(sd.f_out, gdata, sd.gffloader); firstGSeqHeader=false; }
+				 }
+				 //for GFF3 && table output, print the parent first, if any
+				 if ((fmtGFF3 || fmtTable) && t.parent!=NULL && T_PRINTABLE(t.parent->udata)) {
+					 GTData* pdata=(GTData*)(t.parent->uptr);
+					 if (pdata && pdata->geneinfo!=NULL)
+						  pdata->geneinfo->finalize();
+					 if (fmtTable)
+						 printGxfTab(sd.f_out, *(t.parent));
+					 else
+						 t.parent->printGxf(sd.f_out, exonPrinting, tracklabel, NULL, decodeChars);
+					 T_NO_PRINT(t.parent->udata);
+				 }
+				 if (fmtTable)
+					 printGxfTab(sd.f_out, t);
+				 else
+					 t.printGxf(sd.f_out, exonPrinting, tracklabel, NULL, decodeChars);
+             }
+           }//GFF/GTF output requested
+        } //valid transcript
+     } //for each rna
+     //print the rest of the isolated pseudo/gene/region features not printed yet
+     if (sd.f_out && (fmtGFF3 || fmtTable)) {
+      while (gfs_i<gdata->gfs.Count()) {
+         GffObj& gfst=*(gdata->gfs[gfs_i]);
+         if T_PRINTABLE(gfst.udata) { //never printed
+           T_NO_PRINT(gfst.udata);
+           if (fmtGFF3) {
+              if (firstGff3Print) { printGff3Header(sd.f_out, args, sd.gffloader); firstGff3Print=false; }
+              if (firstGSeqHeader) { printGSeqHeader(sd.f_out, gdata, sd.gffloader); firstGSeqHeader=false; }
+              gfst.printGxf(sd.f_out, exonPrinting, tracklabel, NULL, decodeChars);
+           } else
+              printGxfTab(sd.f_out, gfst);
+         }
+         ++gfs_i;
+      }
+     }
+    } //for each genomic seq
+   } //no clustering
+}
+
+FILE* f_stats=NULL; //--stats report
+FILE* f_trace=NULL; //--trace timeline
+
+void writeStats() {
+	if (f_stats==NULL) return;
+	gffStats.writeJSON(f_stats, GThreadPool::global().size());
+	FWCLOSE(f_stats);
+	f_stats=NULL;
+}
+
+void writeTrace() {
+	if (f_trace==NULL) return;
+	GTrace::write(f_trace);
+	FWCLOSE(f_trace);
+	f_trace=NULL;
+}
+
+//--batch mode: the samples listed in a manifest file are loaded and written
+//by separate worker threads, each sample with its own GSampleData (loader,
+//name dictionary, records and output files)
+struct GBatchSample {
+	GStr gff; //input annotation file
+	GStr fasta; //genomic sequence(s), empty if not available
+	GStr prefix; //prefix of the output file names
+};
+
+struct GBatchJobs {
+	GArgs* args;
+	GPVec<GBatchSample>* samples;
+	GffLoader* loader; //the options of main()'s loader apply to all the samples
+	int numFailed; //samples skipped because of errors
+	GBatchJobs(GArgs& a, GPVec<GBatchSample>& s, GffLoader& l):args(&a), samples(&s),
+			loader(&l), numFailed(0) { }
+};
+
+int loadManifest(const char* fname, GPVec<GBatchSample>& samples) {
+	FILE* f=fopen(fname, "r");
+	if (f==NULL) GError("Error: cannot open batch manifest file %s!\n", fname);
+	GLineReader lr(f);
+	char* line=NULL;
+	while ((line=lr.getLine())!=NULL) {
+		GStr l(line);
+		l.trim();
+		if (l.is_empty() || l[0]=='#') continue;
+		GStr gff, fasta, prefix;
+		l.startTokenize(" \t", tkCharSet);
+		if (!l.nextToken(gff) || !l.nextToken(fasta) || !l.nextToken(prefix))
+			GError("Error parsing manifest line %d (expected <input_gff> <genome_fasta> <out_prefix>):\n%s\n",
+					lr.readcount(), line);
+		GBatchSample* sample=new GBatchSample();
+		sample->gff=gff;
+		if (fasta!="-") sample->fasta=fasta;
+		sample->prefix=prefix;
+		samples.Add(sample);
+	}
+	fclose(f);
+	return samples.Count();
+}
+
+//report a problem with the files of a sample, which is skipped
+static bool skipSample(GBatchSample& sample, const char* format, const char* fname) {
+	GStr msg;
+	msg.appendfmt(format, fname);
+	GMessage("Error: %s, sample %s skipped!\n", msg.chars(), sample.prefix.chars());
+	return false;
+}
+
+//open <prefix><suffix>.tmp for writing, where <suffix> is the value of option opt
+//(or defsuffix if that option was not given); the output file names are added
+//to outNames, and the files are only renamed when the sample is done
+static bool openSampleOut(FILE* &f, GArgs& args, const char* opt, GBatchSample& sample,
+		GPVec<GStr>& outNames, const char* defsuffix=NULL) {
+	GStr suffix=args.getOpt(opt);
+	if (suffix.is_empty()) {
+		if (defsuffix==NULL) return true;
+		suffix=defsuffix;
+	}
+	GStr* fname=new GStr(sample.prefix);
+	fname->append(suffix);
+	outNames.Add(fname);
+	GStr tmpname(*fname);
+	tmpname.append(".tmp");
+	if ((f=fopen(tmpname.chars(), "w"))==NULL)
+		return skipSample(sample, "cannot create file %s", tmpname.chars());
+	return true;
+}
+
+//close the output files of a sample, then either rename them to their final
+//names or remove them (if the sample failed)
+static bool closeSampleOut(GSampleData& sd, GBatchSample& sample, GPVec<GStr>& outNames, bool done) {
+	FILE** fhs[7]={ &sd.f_out, &sd.f_w, &sd.f_x, &sd.f_y, &sd.f_repl, &sd.f_ig, &sd.f_ptt };
+	for (int i=0;i<7;i++) {
+		FWCLOSE(*fhs[i]);
+		*fhs[i]=NULL;
+	}
+	for (int i=0;i<outNames.Count();i++) {
+		GStr tmpname(*outNames[i]);
+		tmpname.append(".tmp");
+		if (!done) remove(tmpname.chars());
+		else if (rename(tmpname.chars(), outNames[i]->chars())!=0) {
+			remove(tmpname.chars());
+			done=skipSample(sample, "cannot create file %s", outNames[i]->chars());
+		}
+	}
+	return done;
+}
+
+//load and write a sample into sd, whose loader has the options of the main loader;
+//returns false if the sample was skipped
+bool processSample(GArgs& args, GBatchSample& sample, GSampleData& sd) {
+	GTraceSpan tspan("sample", "batch", sample.gff.chars());
+	sd.gffloader.numThreads=1; //a sample is clustered by the thread processing it
+	if (!sortBy.is_empty()) sd.gffloader.loadRefNames(sortBy);
+	const char* outsuffix=NULL;
+	if (args.getOpt('w')==NULL && args.getOpt('x')==NULL && args.getOpt('y')==NULL &&
+			args.getOpt("intergenic")==NULL && args.getOpt("ptt")==NULL) {
+		if (fmtGTF) outsuffix=".gtf";
+		else if (fmtBED) outsuffix=".bed";
+		else if (fmtTLF) outsuffix=".tlf";
+		else if (fmtTable) outsuffix=".tab";
+		else outsuffix=".gff3";
+	}
+	//the input and output files are checked before loading, so a missing or
+	//unreadable file only skips its sample
+	FILE* f=fopen(sample.gff.chars(), "r");
+	if (f==NULL || fileExists(sample.gff.chars())!=2) {
+		if (f!=NULL) fclose(f);
+		return skipSample(sample, "cannot open GFF file %s", sample.gff.chars());
+	}
+	fclose(f);
+	const char* fasta=sample.fasta.is_empty() ? args.getOpt('g') : sample.fasta.chars();
+	if (fasta!=NULL && fileExists(fasta)==0)
+		return skipSample(sample, "genome FASTA file %s not found", fasta);
+	bool gbkInput=(GBKinput || GbkReader::hasGbkExt(sample.gff.chars()));
+	if (fasta==NULL && !gbkInput && (validCDSonly || spliceCheck || args.getOpt('w')!=NULL ||
+			args.getOpt('x')!=NULL || args.getOpt('y')!=NULL || args.getOpt("intergenic")!=NULL))
+		return skipSample(sample, "no genome FASTA file given (required by options %s)",
+				"-w, -x, -y, -V, -N, --intergenic");
+	GPVec<GStr> outNames(true);
+	if (!openSampleOut(sd.f_out, args, "o", sample, outNames, outsuffix) ||
+			!openSampleOut(sd.f_w, args, "w", sample, outNames) ||
+			!openSampleOut(sd.f_x, args, "x", sample, outNames) ||
+			!openSampleOut(sd.f_y, args, "y", sample, outNames) ||
+			!openSampleOut(sd.f_repl, args, "d", sample, outNames) ||
+			!openSampleOut(sd.f_ig, args, "intergenic", sample, outNames) ||
+			!openSampleOut(sd.f_ptt, args, "ptt", sample, outNames))
+		return closeSampleOut(sd, sample, outNames, false);
+	GFastaDb gfasta(fasta);
+	sd.gffloader.seqdb=&gfasta; //for the sequences of GenBank input
+	if (verbose) GMessage("Processing %s\n", sample.gff.chars());
+	loadInput(sample.gff, sd);
+	writeRecords(args, gfasta, sd);
+	sd.gffloader.seqdb=NULL;
+	if (!closeSampleOut(sd, sample, outNames, true)) return false;
+	gffStats.addCounts(sd.g_data);
+	gffStats.addSeqCache(gfasta);
+	return true;
+}
+
+static void batchRange(int from, int to, void* p) {
+	GBatchJobs& jobs=*(GBatchJobs*)p;
+	for (int i=from;i<to;i++) {
+		//the records of a sample (and its name dictionary) are freed when it's done
+		GSampleData sd;
+		sd.gffloader.options=jobs.loader->options;
+		sd.gffloader.regions=jobs.loader->regions;
+		if (!processSample(*jobs.args, *(jobs.samples->Get(i)), sd))
+			__atomic_add_fetch(&jobs.numFailed, 1, __ATOMIC_RELAXED);
+	}
+}
+
+//returns the number of samples skipped because of errors
+int runBatch(GArgs& args, GStr& manifest, GffLoader& loader) {
+	GPVec<GBatchSample> samples(true);
+	int numsamples=loadManifest(manifest.chars(), samples);
+	if (numsamples==0) GError("Error: no samples found in manifest file %s!\n", manifest.chars());
+	const char* outopts[7]={ "o", "w", "x", "y", "d", "intergenic", "ptt" };
+	for (int i=0;i<7;i++) {
+		const char* v=args.getOpt(outopts[i]);
+		if (v!=NULL && strcmp(v, "-")==0)
+			GError("Error: output to stdout is not supported in --batch mode!\n");
+	}
+	GStr s=args.getOpt("w-add");
+	if (!s.is_empty()) {
+		if (args.getOpt('w')==NULL) GError("Error: --w-add option requires -w option!\n");
+		wPadding=s.asInt();
+	}
+	GThreadPool& pool=GThreadPool::global();
+	int numThreads=pool.size();
+	if (numThreads>numsamples) numThreads=numsamples;
+	if (verbose) GMessage("Processing %d samples from %s using %d threads\n",
+			numsamples, manifest.chars(), numThreads);
+	//one sample per task; the pool threads (and this one) take the next
+	//sample when done with the previous one
+	GBatchJobs jobs(args, samples, loader);
+	pool.parallel_for(0, numsamples, batchRange, (void*) &jobs, 1);
+	return jobs.numFailed;
+}
+
 int main(int argc, char* argv[]) {
  GArgs args(argc, argv,
-   "version;debug;merge;adj-stop;bed;in-bed;tlf;in-tlf;cluster-only;nc;cov-info;help;"
+   "version;debug;merge;adj-stop;bed;in-bed;tlf;in-tlf;in-gbk;ptt=;cluster-only;nc;cov-info;help;"
     "sort-alpha;keep-genes;w-add=;keep-comments;keep-exon-attrs;force-exons;t-adopt;gene2exon;"
-    "ignore-locus;no-pseudo;table=sort-by=hvOUNHPWCVJMKQYTDARSZFGLEBm:g:i:r:s:l:t:o:w:x:y:d:");
+    "ignore-locus;no-pseudo;index;batch=;server=;stats=;trace=;intergenic=;ig-min=;ig-strand=;regions=;compare=;merge-ipr=;merge-pvog=;merge-amr=;merge-abricate=;merge-btss=;merge-tterm=;table=sort-by=hvOUNHPWCVJMKQYTDARSZFGLEBm:g:i:r:s:l:t:o:w:x:y:d:p:");
  args.printError(USAGE, true);
  if (args.getOpt('h') || args.getOpt("help")) {
     GMessage("%s",USAGE);
     exit(1);
  }
+ GSampleData sd;
+ GffLoader& gffloader=sd.gffloader; //its options are also used by the --batch samples
 
+ GStr statsFile=args.getOpt("stats");
+ if (!statsFile.is_empty()) {
+   if (statsFile=="-") f_stats=stdout;
+   else if ((f_stats=fopen(statsFile.chars(), "w"))==NULL)
+     GError("Error creating file: %s\n", statsFile.chars());
+   gffStats.enable();
+ }
+ GStr traceFile=args.getOpt("trace");
+ if (!traceFile.is_empty()) {
+   if (traceFile=="-") f_trace=stdout;
+   else if ((f_trace=fopen(traceFile.chars(), "w"))==NULL)
+     GError("Error creating file: %s\n", traceFile.chars());
+   GTrace::start();
+ }
  debugMode=(args.getOpt("debug")!=NULL);
  decodeChars=(args.getOpt('D')!=NULL);
  gffloader.forceExons=(args.getOpt("force-exons")!=NULL);
@@ -1068,6 +1771,7 @@ int main(int argc, char* argv[]) {
 
  BEDinput=(args.getOpt("in-bed")!=NULL);
  TLFinput=(args.getOpt("in-tlf")!=NULL);
+ GBKinput=(args.getOpt("in-gbk")!=NULL);
  bothStrands=(args.getOpt('B')!=NULL);
  fullCDSonly=(args.getOpt('J')!=NULL);
  spliceCheck=(args.getOpt('N')!=NULL);
@@ -1111,6 +1815,19 @@ int main(int argc, char* argv[]) {
 	 gffloader.fuzzSpan=true; //-Q enforced by -Y
  covInfo=(args.getOpt("cov-info"));
  if (covInfo) gffloader.doCluster=true; //need to collapse overlapping exons
+ GffAnnMerge annmerge;
+ annmerge.iprFile=args.getOpt("merge-ipr");
+ annmerge.pvogFile=args.getOpt("merge-pvog");
+ annmerge.amrFile=args.getOpt("merge-amr");
+ annmerge.abricateFiles=args.getOpt("merge-abricate");
+ annmerge.btssFile=args.getOpt("merge-btss");
+ annmerge.ttermFile=args.getOpt("merge-tterm");
+ //checked only after all the options enabling the clustering were parsed
+ if (annmerge.enabled() && gffloader.doCluster) {
+   GMessage("%s",USAGE);
+   GMessage("Error: the --merge-* options cannot be used with -M/--merge, --cluster-only or --cov-info!\n");
+   exit(1);
+ }
  if (fullCDSonly) validCDSonly=true;
  if (verbose) {
      fprintf(stderr, "Command line was:\n");
@@ -1120,6 +1837,18 @@ int main(int argc, char* argv[]) {
   GMessage(VERSION"\n");
   exit(0);
  }
+ if (args.getOpt("index")) {
+   int numfiles=args.startNonOpt();
+   if (numfiles==0) GError("Error: --index requires at least one input GFF file!\n");
+   GStr infile;
+   while (!(infile=args.nextNonOpt()).is_empty()) {
+     GffIndex gxi(infile.chars());
+     int numblocks=gxi.buildIndex();
+     gxi.storeIndex();
+     if (verbose) GMessage("%d blocks indexed in %s\n", numblocks, gxi.indexFileName());
+   }
+   exit(0);
+ }
  gffloader.fullAttributes=(args.getOpt('F')!=NULL);
  gffloader.keep_AllExonAttrs=(args.getOpt("keep-exon-attrs")!=NULL);
  if (gffloader.keep_AllExonAttrs && !gffloader.fullAttributes) {
@@ -1136,6 +1865,12 @@ int main(int argc, char* argv[]) {
 	 gffloader.gatherExonAttrs=true;
 	 gffloader.fullAttributes=true;
  }
+ if (args.getOpt("ptt")!=NULL) //the protein table columns come from the attributes
+	 gffloader.fullAttributes=true;
+ if (annmerge.enabled()) { //keep all the Prokka attributes and gene features
+	 gffloader.fullAttributes=true;
+	 gffloader.keepGenes=true;
+ }
  ensembl_convert=(args.getOpt('L')!=NULL);
  if (ensembl_convert) {
     gffloader.fullAttributes=true;
@@ -1162,14 +1897,37 @@ int main(int argc, char* argv[]) {
  if (!s.is_empty()) maxintron=s.asInt();
  s=args.getOpt('l');
  if (!s.is_empty()) minLen=s.asInt();
+ s=args.getOpt('p');
+ if (!s.is_empty()) {
+   gffloader.numThreads=s.asInt();
+   if (gffloader.numThreads<1) gffloader.numThreads=1;
+ }
+ //all the parallel work (clustering, --batch samples, --compare, --ig) is
+ //run as tasks of the global thread pool
+ GThreadPool::setGlobal(gffloader.numThreads);
+
+ GffRegions qregions;
+ s=args.getOpt("regions");
+ if (!s.is_empty()) {
+   int numregions=qregions.load(s.chars());
+   if (verbose) GMessage("%d query regions loaded from %s\n", numregions, s.chars());
+   gffloader.regions=&qregions;
+ }
+
+ GffCmpRef cmpref;
+ s=args.getOpt("compare");
+ if (!s.is_empty()) {
+   int numrefs=cmpref.load(s.chars(), gffloader.numThreads);
+   if (verbose) GMessage("%d reference transcripts loaded from %s\n", numrefs, s.chars());
+   gffloader.cmpRef=&cmpref;
+ }
 
- FILE* f_repl=NULL;
  s=args.getOpt('d');
  if (!s.is_empty()) {
-   if (s=="-") f_repl=stdout;
+   if (s=="-") sd.f_repl=stdout;
    else {
-       f_repl=fopen(s.chars(), "w");
-       if (f_repl==NULL) GError("Error creating file %s\n", s.chars());
+       sd.f_repl=fopen(s.chars(), "w");
+       if (sd.f_repl==NULL) GError("Error creating file %s\n", s.chars());
    }
  }
 
@@ -1227,28 +1985,87 @@ int main(int argc, char* argv[]) {
    fclose(fsize);
    }
 
- openfw(f_out, args, 'o');
+ s=args.getOpt("ig-min");
+ if (!s.is_empty()) {
+   intergenic.minLen=s.asInt();
+   if (intergenic.minLen<1) GError("Error: invalid --ig-min value (%s)!\n", s.chars());
+ }
+ s=args.getOpt("ig-strand");
+ if (!s.is_empty() && !intergenic.setStrandMode(s.chars()))
+   GError("Error: invalid --ig-strand mode (%s), must be split, rc or any!\n", s.chars());
+ GStr batchFile=args.getOpt("batch");
+ if (!batchFile.is_empty()) {
+   if (annmerge.enabled() || gffloader.cmpRef!=NULL || covInfo)
+     GError("Error: option --batch cannot be used with --compare, --merge-* or --cov-info!\n");
+   gffStats.timing=false; //the samples are processed concurrently
+   int numFailed=runBatch(args, batchFile, gffloader);
+   if (verbose && GThreadPool::global().size()>1) GThreadPool::global().printStats(stderr);
+#ifdef GMEMSTATS
+   if (verbose) GMemPrintStats(stderr);
+#endif
+   writeStats();
+   writeTrace();
+   seqinfo.Clear();
+   GFREE(rfltGSeq);
+   if (numFailed>0) {
+     GMessage("Error: %d sample(s) could not be processed!\n", numFailed);
+     return 1;
+   }
+   return 0;
+ }
+ openfw(sd.f_out, args, 'o');
  //if (f_out==NULL) f_out=stdout;
- if (gfasta.fastaPath==NULL && (validCDSonly || spliceCheck || args.getOpt('w')!=NULL || args.getOpt('x')!=NULL || args.getOpt('y')!=NULL))
-  GError("Error: -g option is required for options -w, -x, -y, -V, -N, -M !\n");
- openfw(f_w, args, 'w');
- openfw(f_x, args, 'x');
- openfw(f_y, args, 'y');
+ //GenBank/EMBL input provides its own genomic sequences
+ bool gbkInput=GBKinput;
+ int numfiles = args.startNonOpt();
+ for (int i=0;i<numfiles && !gbkInput;i++)
+   gbkInput=GbkReader::hasGbkExt(args.nextNonOpt());
+ gffloader.seqdb=&gfasta;
+ if (gfasta.fastaPath==NULL && !gbkInput && (validCDSonly || spliceCheck || args.getOpt('w')!=NULL || args.getOpt('x')!=NULL || args.getOpt('y')!=NULL
+        || args.getOpt("intergenic")!=NULL))
+  GError("Error: -g option is required for options -w, -x, -y, -V, -N, -M, --intergenic !\n");
+ openfw(sd.f_w, args, 'w');
+ openfw(sd.f_x, args, 'x');
+ openfw(sd.f_y, args, 'y');
+ s=args.getOpt("intergenic");
+ if (!s.is_empty()) {
+   if (s=="-") sd.f_ig=stdout;
+   else if ((sd.f_ig=fopen(s.chars(), "w"))==NULL)
+     GError("Error creating file: %s\n", s.chars());
+ }
+ s=args.getOpt("ptt");
+ if (!s.is_empty()) {
+   if (s=="-") sd.f_ptt=stdout;
+   else if ((sd.f_ptt=fopen(s.chars(), "w"))==NULL)
+     GError("Error creating file: %s\n", s.chars());
+ }
  s=args.getOpt("w-add");
  if (!s.is_empty()) {
-	 if (f_w==NULL) GError("Error: --w-add option requires -w option!\n");
+	 if (sd.f_w==NULL) GError("Error: --w-add option requires -w option!\n");
 	 wPadding=s.asInt();
  }
 
- if (f_out==NULL && f_w==NULL && f_x==NULL && f_y==NULL && !covInfo)
-	 f_out=stdout;
+ if (sd.f_out==NULL && sd.f_w==NULL && sd.f_x==NULL && sd.f_y==NULL && sd.f_ig==NULL && sd.f_ptt==NULL && !covInfo)
+	 sd.f_out=stdout;
+ //the JSON report cannot share stdout with the records
+ if (f_stats==stdout && (sd.f_out==stdout || sd.f_w==stdout || sd.f_x==stdout || sd.f_y==stdout ||
+          sd.f_ig==stdout || sd.f_ptt==stdout || sd.f_repl==stdout || covInfo))
+	 GError("Error: --stats - requires all the other output to be written to files (e.g. -o <outfile>)!\n");
+
+ //with several threads, the input is read and the output is written by
+ //separate threads, overlapping with the parsing and the processing
+ bool pipelined=(GThreadPool::global().size()>1 && args.getOpt("server")==NULL && !covInfo);
+ if (pipelined) {
+	 gffloader.pipeInput=true;
+	 if (GOutPipe::supported())
+		 pipeOutput(sd, sd.f_ig==stdout || sd.f_ptt==stdout || sd.f_repl==stdout);
+ }
 
  //if (f_y!=NULL || f_x!=NULL) wCDSonly=true;
  //useBadCDS=useBadCDS || (fgtfok==NULL && fgtfbad==NULL && f_y==NULL && f_x==NULL);
 
- int numfiles = args.startNonOpt();
+ numfiles = args.startNonOpt();
  //GList<GffObj> gfkept(false,true); //unsorted, free items on delete
- int out_counter=0; //number of records printed
  while (true) {
    GStr infile;
    if (numfiles) {
@@ -1262,221 +2079,61 @@ int main(int argc, char* argv[]) {
    }
    else infile="-";
 
-   const char* fext=getFileExt(infile.chars());
-   if (BEDinput || (Gstricmp(fext, "bed")==0))
-	   gffloader.BEDinput=true;
-   if (TLFinput || (Gstricmp(fext, "tlf")==0))
-	   gffloader.TLFinput=true;
-   gffloader.openFile(infile);
-   gffloader.load(g_data, &validateGffRec, &processGffComment);
-   // will also place the transcripts in loci, if doCluster is enabled
-   if (gffloader.doCluster)
-     collectLocusData(g_data, covInfo);
+   loadInput(infile, sd);
    if (numfiles==0) break;
  }
- if (covInfo) {
-	 //report coverage info at STDOUT
-	 uint64 f_bases=0;
-	 uint64 r_bases=0;
-	 uint64 u_bases=0;
-	 for (int g=0;g<g_data.Count();g++) {
-		 f_bases+=g_data[g]->f_bases;
-		 r_bases+=g_data[g]->r_bases;
-		 u_bases+=g_data[g]->u_bases;
-	 }
-	 fprintf(stdout, "Total bases covered by transcripts:\n");
-	 if (f_bases>0) fprintf(stdout, "\t%" PRIu64 " on + strand\n", f_bases);
-	 if (r_bases>0) fprintf(stdout, "\t%" PRIu64 " on - strand\n", r_bases);
-	 if (u_bases>0) fprintf(stdout, "\t%" PRIu64 " on . strand\n", u_bases);
+ if (annmerge.enabled()) annmerge.merge(sd.g_data, gffloader.names);
+ s=args.getOpt("server");
+ if (!s.is_empty()) {
+   if (tableCols.Count()==0) {
+     GStr tfmt("@id,@chr,@start,@end,@strand,@exons,@cds");
+     setTableFormat(tfmt);
+   }
+   GffServer server(sd.g_data, gfasta);
+   server.numThreads=gffloader.numThreads;
+   server.tlabel=tracklabel;
+   server.tableRow=printGxfTab;
+   server.starStop=StarStop;
+   server.run(s.chars());
+   seqinfo.Clear();
+   GFREE(rfltGSeq);
+   writeStats();
+   writeTrace();
+   return 0;
  }
- GStr loctrack("gffcl");
- if (tracklabel) loctrack=tracklabel;
- if (gffloader.sortRefsAlpha)
-    g_data.setSorted(&gseqCmpName);
- GffPrintMode exonPrinting;
- if (fmtGTF)
-	 exonPrinting = pgtfAny;
- else if (fmtBED)
-	 exonPrinting=pgffBED;
- else if (fmtTLF)
-	exonPrinting=pgffTLF;
- else { //printing regular GFF3
-	exonPrinting = gffloader.forceExons ? pgffBoth : pgffAny;
+ uint64_t t0=gthreads_clock_ns();
+ writeRecords(args, gfasta, sd);
+ if (pipelined) {
+	 if (verbose) {
+		 GMessage("Output pipeline stages:\n");
+		 GMessage("  %-16s %.3f s\n", "process/format", (gthreads_clock_ns()-t0)/1e9);
+	 }
+	 closePipedOutput(sd);
  }
- bool firstGff3Print=fmtGFF3;
- if (gffloader.doCluster) {
-   //grouped in loci
-   for (int g=0;g<g_data.Count();g++) {
-     GenomicSeqData* gdata=g_data[g];
-     bool firstGSeqHeader=fmtGFF3;
-     if (f_out && fmtGFF3 && gffloader.keepGff3Comments && gdata->seqreg_start>0)
-    	 fprintf(f_out, "##sequence-region %s %d %d\n", gdata->gseq_name,
-    			 gdata->seqreg_start, gdata->seqreg_end);
-     for (int l=0;l<gdata->loci.Count();l++) {
-       bool firstLocusPrint=true;
-       GffLocus& loc=*(gdata->loci[l]);
-       //check all non-replaced transcripts in this locus:
-       int numvalid=0;
-       int idxfirstvalid=-1;
-       for (int i=0;i<loc.rnas.Count();i++) {
-         GffObj& t=*(loc.rnas[i]);
-         GTData* tdata=(GTData*)(t.uptr);
-         if (tdata->replaced_by!=NULL) {
-            if (f_repl && T_DUPSHOWABLE(t.udata)) {
-               fprintf(f_repl, "%s", t.getID());
-               GTData* rby=tdata;
-               while (rby->replaced_by!=NULL) {
-                  fprintf(f_repl," => %s", rby->replaced_by->getID());
-                  T_NO_DUPSHOW(rby->rna->udata);
-                  rby=(GTData*)(rby->replaced_by->uptr);
-               }
-               fprintf(f_repl, "\n");
-            }
-            T_NO_PRINT(t.udata);
-            if (verbose) {
-            	GMessage("Info: %s discarded: superseded by %s\n",
-            			t.getID(), tdata->replaced_by->getID());
-            }
-            continue;
-         }
-         //restore strand for dOvlSET
-         char orig_strand=T_OSTRAND(t.udata);
-         if (orig_strand!=0) t.strand=orig_strand;
-
-         if (process_transcript(gfasta, t)) {
-             numvalid++;
-             if (idxfirstvalid<0) idxfirstvalid=i;
-         }
-       } //for each transcript
-
-       int rnas_i=0;
-       if (idxfirstvalid>=0) rnas_i=idxfirstvalid;
-       int gfs_i=0;
-       if (f_out) {
-           GStr locname("RLOC_");
-           locname.appendfmt("%08d",loc.locus_num);
-           //GMessage("Locus: %s (%d-%d), %d rnas, %d gfs\n", locname.chars(), loc.start, loc.end,
-           //	   loc.rnas.Count(), loc.gfs.Count());
-		   while (gfs_i<loc.gfs.Count() || rnas_i<loc.rnas.Count()) {
-			   if (gfs_i<loc.gfs.Count() && (rnas_i>=loc.rnas.Count() ||
-					     loc.gfs[gfs_i]->start<=loc.rnas[rnas_i]->start) ) {
-				   //print the gene object first
-				   if (fmtGFF3) { //BED, TLF and GTF: only show transcripts
-					   if (firstGff3Print) { printGff3Header(f_out, args);firstGff3Print=false; }
-					   if (firstGSeqHeader) { printGSeqHeader(f_out, gdata); firstGSeqHeader=false; }
-					   if (firstLocusPrint) {
-						   loc.print(f_out, idxfirstvalid, locname, loctrack);
-						   firstLocusPrint=false;
-					   }
-					   printGffObj(f_out, loc.gfs[gfs_i], locname, exonPrinting, out_counter);
-				   }
-				   ++gfs_i;
-				   continue;
-			   }
-			   if (rnas_i<loc.rnas.Count()) {
-				       //loc.rnas[rnas_i]->printGxf(f_out, exonPrinting, tracklabel, NULL, decodeChars);
-				       if (fmtGFF3) {
-					     if (firstGff3Print) { printGff3Header(f_out, args); firstGff3Print=false; }
-					     if (firstGSeqHeader) { printGSeqHeader(f_out, gdata); firstGSeqHeader=false; }
-					     if (firstLocusPrint) {
-					    	 loc.print(f_out, idxfirstvalid, locname, loctrack);
-					    	 firstLocusPrint=false;
-					     }
-				       }
-				       if (fmtTable)  printAsTable(f_out, loc.rnas[rnas_i], &out_counter);
-				       else printGffObj(f_out, loc.rnas[rnas_i], locname, exonPrinting, out_counter);
-					   ++rnas_i;
-			   }
-		   }
-       }
-     }//for each locus
-    } //for each genomic sequence
-   } //if Clustering enabled
-  else { //no clustering
-   //not grouped into loci, print the rnas with their parents, if any
-   int numvalid=0;
-   for (int g=0;g<g_data.Count();g++) {
-     GenomicSeqData* gdata=g_data[g];
-     bool firstGSeqHeader=fmtGFF3;
-     int gfs_i=0;
-     for (int m=0;m<gdata->rnas.Count();m++) {
-        GffObj& t=*(gdata->rnas[m]);
-        if (f_out && (fmtGFF3 || fmtTable)) {
-         //print other non-transcript (gene?) feature that might be there before t
-           while (gfs_i<gdata->gfs.Count() && gdata->gfs[gfs_i]->start<=t.start) {
-             GffObj& gfst=*(gdata->gfs[gfs_i]);
-             if T_PRINTABLE(gfst.udata) { //never printed
-               T_NO_PRINT(gfst.udata);
-               if (fmtGFF3) {
-                 if (firstGff3Print) { printGff3Header(f_out, args);firstGff3Print=false; }
-                 if (firstGSeqHeader) { printGSeqHeader(f_out, gdata); firstGSeqHeader=false; }
-                 gfst.printGxf(f_out, exonPrinting, tracklabel, NULL, decodeChars);
-               }
-               else printGxfTab(f_out, gfst);
-             }
-             ++gfs_i;
-           }
-        }
-        GTData* tdata=(GTData*)(t.uptr);
-        if (tdata->replaced_by!=NULL) continue;
-        if (process_transcript(gfasta, t)) {
-           numvalid++;
-           if (f_out && T_PRINTABLE(t.udata) ) {
-             T_NO_PRINT(t.udata);
-             if (fmtGFF3 || fmtTable || t.isTranscript()) {
-				 if (tdata->geneinfo)
-					 tdata->geneinfo->finalize();
-				 out_counter++;
-				 if (fmtGFF3) {
-				   if (firstGff3Print) { printGff3Header(f_out, args);firstGff3Print=false; }
-				   if (firstGSeqHeader) { printGSeqHeader(f_out, gdata); firstGSeqHeader=false; }
-				 }
-				 //for GFF3 && table output, print the parent first, if any
-				 if ((fmtGFF3 || fmtTable) && t.parent!=NULL && T_PRINTABLE(t.parent->udata)) {
-					 GTData* pdata=(GTData*)(t.parent->uptr);
-					 if (pdata && pdata->geneinfo!=NULL)
-						  pdata->geneinfo->finalize();
-					 if (fmtTable)
-						 printGxfTab(f_out, *(t.parent));
-					 else
-						 t.parent->printGxf(f_out, exonPrinting, tracklabel, NULL, decodeChars);
-					 T_NO_PRINT(t.parent->udata);
-				 }
-				 if (fmtTable)
-					 printGxfTab(f_out, t);
-				 else
-					 t.printGxf(f_out, exonPrinting, tracklabel, NULL, decodeChars);
-             }
-           }//GFF/GTF output requested
-        } //valid transcript
-     } //for each rna
-     //print the rest of the isolated pseudo/gene/region features not printed yet
-     if (f_out && (fmtGFF3 || fmtTable)) {
-      while (gfs_i<gdata->gfs.Count()) {
-         GffObj& gfst=*(gdata->gfs[gfs_i]);
-         if T_PRINTABLE(gfst.udata) { //never printed
-           T_NO_PRINT(gfst.udata);
-           if (fmtGFF3) {
-              if (firstGff3Print) { printGff3Header(f_out, args); firstGff3Print=false; }
-              if (firstGSeqHeader) { printGSeqHeader(f_out, gdata); firstGSeqHeader=false; }
-              gfst.printGxf(f_out, exonPrinting, tracklabel, NULL, decodeChars);
-           } else
-              printGxfTab(f_out, gfst);
-         }
-         ++gfs_i;
-      }
-     }
-    } //for each genomic seq
-   } //no clustering
- if (f_repl && f_repl!=stdout) fclose(f_repl);
+ if (sd.f_repl && sd.f_repl!=stdout) fclose(sd.f_repl);
  seqinfo.Clear();
  //if (faseq!=NULL) delete faseq;
  //if (gcdb!=NULL) delete gcdb;
  GFREE(rfltGSeq);
- FWCLOSE(f_out);
- FWCLOSE(f_w);
- FWCLOSE(f_x);
- FWCLOSE(f_y);
+ {
+	 GTraceSpan tspan("flush", "output");
+	 FWCLOSE(sd.f_out);
+	 FWCLOSE(sd.f_w);
+	 FWCLOSE(sd.f_x);
+	 FWCLOSE(sd.f_y);
+	 FWCLOSE(sd.f_ig);
+	 FWCLOSE(sd.f_ptt);
+ }
+ if (verbose && GThreadPool::global().size()>1) GThreadPool::global().printStats(stderr);
+#ifdef GMEMSTATS
+ if (verbose) GMemPrintStats(stderr);
+#endif
+ if (gffStats.enabled) {
+	 gffStats.addCounts(sd.g_data);
+	 gffStats.addSeqCache(gfasta);
+	 writeStats();
+ }
+ writeTrace();
  }
 
 
@@ -0,0 +1,148 @@
+#!/bin/bash
+# Regression tests: runs gffread on the small inputs in tests/data and compares
+# its output with the files in tests/expected.
+# Run it from the gffread directory with 'make test', or directly.
+
+cd "$(dirname "$0")/.."
+gffread=./gffread
+if [ ! -x $gffread ]; then
+  echo "Error: $gffread not found, build it first" >&2
+  exit 1
+fi
+data=tests/data
+expected=tests/expected
+out=$(mktemp -d)
+trap "rm -rf $out" EXIT
+passed=0
+failed=0
+
+# check <name> <gffread arguments..>: the output written to $out/<name>
+# (by -o, --ptt etc.) must match $expected/<name>
+check() {
+  local name=$1
+  shift
+  if ! $gffread "$@" 2>$out/$name.log; then
+    echo "FAIL $name: gffread $* exited with an error:" >&2
+    cat $out/$name.log >&2
+    failed=$((failed+1))
+  elif ! diff -u <(sed '/^# /d' $expected/$name) <(sed '/^# /d' $out/$name) >&2; then
+    echo "FAIL $name: gffread $* output differs from $expected/$name" >&2
+    failed=$((failed+1))
+  else
+    passed=$((passed+1))
+  fi
+}
+
+# check_ok <name> <gffread arguments..>: gffread must exit without an error
+check_ok() {
+  local name=$1
+  shift
+  if ! $gffread "$@" >$out/$name.stdout 2>$out/$name.log; then
+    echo "FAIL $name: gffread $* exited with an error:" >&2
+    cat $out/$name.log >&2
+    failed=$((failed+1))
+  else
+    passed=$((passed+1))
+  fi
+}
+
+# check_error <name> <gffread arguments..>: gffread must exit with an error
+check_error() {
+  local name=$1
+  shift
+  if $gffread "$@" 2>$out/$name.log; then
+    echo "FAIL $name: gffread $* should have failed" >&2
+    failed=$((failed+1))
+  else
+    passed=$((passed+1))
+  fi
+}
+
+# check_same <name> <file1> <file2>: two output files must be the same
+check_same() {
+  local name=$1
+  if [ ! -f "$2" ] || [ ! -f "$3" ]; then
+    echo "FAIL $name: missing output file $2 or $3" >&2
+    failed=$((failed+1))
+  elif ! diff -u <(sed '/^# /d' $2) <(sed '/^# /d' $3) >&2; then
+    echo "FAIL $name: $2 differs from $3" >&2
+    failed=$((failed+1))
+  else
+    passed=$((passed+1))
+  fi
+}
+
+# --ptt with a plain NCBI /db_xref="GI:<digits>" qualifier
+check ptt_gi.ptt $data/ptt_gi.gbk --ptt $out/ptt_gi.ptt
+# a .ptt file describes a single sequence
+check_error ptt_multi $data/ptt_multi.gbk --ptt $out/ptt_multi.ptt
+
+# --index keeps the lines of a transcript in one block when its exons are on
+# both sides of another record (T1 at 100-200 and 1000-1100, T2 at 300-400)
+cp $data/index_span.gtf $data/index_unsorted.gtf $out/
+check_ok index_span.gxi --index $out/index_span.gtf
+check index_span.out.gtf $out/index_span.gtf -r c1:1000-1100 -T -o $out/index_span.out.gtf
+# unsorted input is not indexed
+check_error index_unsorted --index $out/index_unsorted.gtf
+
+# --regions: BED coordinates are 0-based, half open (the "edge" region 240-240
+# does not overlap G001 at 33-239); records overlapping several regions get all
+# their names, unnamed regions are named <chr>:<start>-<end>
+check regions.gff3 $data/genes.gff3 --regions $data/regions.bed -o $out/regions.gff3
+
+# --compare: one query transcript for each class code (named Q<n>_<code>),
+# also with the transcripts classified by several threads
+check compare.tab $data/compare_query.gtf --compare $data/compare_ref.gtf \
+  --table @id,cmp_ref,class_code,ovl_len -o $out/compare.tab
+check compare.tab $data/compare_query.gtf --compare $data/compare_ref.gtf \
+  --table @id,cmp_ref,class_code,ovl_len -p 3 -o $out/compare.tab
+
+# --intergenic: the gaps between the CDS of genes.gff3 (some of them
+# overlapping), on the same strand (split, rc) or on any strand; the FASTA file
+# is copied as its .fai index is created next to it
+cp $data/genome.fa $out/
+check intergenic.fa $data/genes.gff3 -g $out/genome.fa --intergenic $out/intergenic.fa
+check intergenic_rc.fa $data/genes.gff3 -g $out/genome.fa --intergenic $out/intergenic_rc.fa \
+  --ig-strand rc --ig-min 30
+check intergenic_any.fa $data/genes.gff3 -g $out/genome.fa --intergenic $out/intergenic_any.fa \
+  --ig-strand any --ig-min 10 -p 2
+
+# --batch: the output of each sample must be the same as the output of a
+# standalone run; a sample with a missing input file is skipped (without any
+# output files), the others are still processed, and the exit status is 1
+mkdir $out/batch
+printf '%s\n' "$data/genes.gff3 $out/genome.fa $out/batch/genes" \
+  "$out/missing.gff3 $out/genome.fa $out/batch/missing" \
+  "$data/compare_ref.gtf $out/genome.fa $out/batch/ref" > $out/batch.txt
+check_error batch --batch $out/batch.txt -T -o .gtf -y .faa -p 2
+check_ok batch_genes $data/genes.gff3 -g $out/genome.fa -T -o $out/genes.gtf -y $out/genes.faa
+check_ok batch_ref $data/compare_ref.gtf -g $out/genome.fa -T -o $out/ref.gtf -y $out/ref.faa
+check_same batch_genes.gtf $out/batch/genes.gtf $out/genes.gtf
+check_same batch_genes.faa $out/batch/genes.faa $out/genes.faa
+check_same batch_ref.gtf $out/batch/ref.gtf $out/ref.gtf
+if ls $out/batch/missing* >/dev/null 2>&1; then
+  echo "FAIL batch_missing: output files written for a skipped sample" >&2
+  failed=$((failed+1))
+else
+  passed=$((passed+1))
+fi
+
+# --merge-*: the results of the annotation tools merged into a Prokka GFF
+# (duplicate notes and features are dropped, the Abricate hits go to the
+# overlapping gene on the same strand, and only the + strand bTSSfinder
+# promoters are added)
+check merge.gff3 $data/merge_prokka.gff --merge-ipr $data/merge_interpro.gff3 \
+  --merge-pvog $data/merge_pvog.domtbl --merge-amr $data/merge_amrfinder.tsv \
+  --merge-abricate $data/merge_abricate_vfdb.tbl,$data/merge_abricate_card.tbl \
+  --merge-btss $data/merge_btss.gff --merge-tterm $data/merge_tterm.bag -o $out/merge.gff3
+
+# the --stats report cannot go to stdout along with the records
+check_error stats_stdout $data/index_span.gtf -T --stats -
+check_ok stats_stdout_o $data/index_span.gtf -T -o $out/stats.gtf --stats -
+
+# --server does not replace a file that is not a socket
+echo keep > $out/not_a_socket
+check_error server_not_socket $data/index_span.gtf --server $out/not_a_socket
+
+echo "$passed tests passed, $failed failed" >&2
+[ $failed -eq 0 ]